@@ -0,0 +1,1055 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef _WIN32
+#include <process.h>
+#define batch_core_getpid() _getpid()
+#else
+#include <unistd.h>
+#define batch_core_getpid() getpid()
+#endif
+
+#include <boolean.h>
+#include <compat/strl.h>
+#include <dynamic/dylib.h>
+#include <encodings/crc32.h>
+#include <file/file_path.h>
+#include <rthreads/rthreads.h>
+#include <streams/file_stream.h>
+#include <string/stdstring.h>
+
+#include "batch_core.h"
+
+#include "configuration.h"
+#include "dirs.h"
+#include "dynamic.h"
+#include "file_path_special.h"
+#include "paths.h"
+#include "verbosity.h"
+#include "managers/core_option_manager.h"
+#include "runahead/secondary_core.h"
+
+enum batch_job
+{
+   BATCH_JOB_NONE = 0,
+   BATCH_JOB_LOAD,
+   BATCH_JOB_RUN,
+   BATCH_JOB_SERIALIZE_SIZE,
+   BATCH_JOB_SERIALIZE,
+   BATCH_JOB_UNSERIALIZE,
+   BATCH_JOB_QUIT
+};
+
+struct batch_instance
+{
+   batch_core_t *batch;
+   unsigned index;
+
+   char *library_path;
+   dylib_t module;
+   struct retro_core_t core;
+   core_option_manager_t *options;
+
+   struct retro_system_av_info av_info;
+   enum retro_pixel_format pix_fmt;
+
+   /* Audio of the current frame */
+   int16_t *audio;
+   size_t audio_frames;
+   size_t audio_cap;
+
+   /* Joypad script of the current run */
+   uint16_t *joypad;
+   size_t joypad_cap;
+   bool scripted;
+   unsigned frame;
+
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+
+   /* Job posted to the worker and its parameters, guarded by lock.
+    * The worker resets job to BATCH_JOB_NONE when done. */
+   enum batch_job job;
+   unsigned frames;
+   void *state;
+   const void *state_const;
+   size_t state_size;
+   bool result;
+};
+
+struct batch_core
+{
+   struct batch_instance *instances;
+   unsigned count;
+
+   struct batch_core_callbacks cbs;
+
+   struct retro_game_info game;
+   void *content_data;
+   bool has_content;
+
+   char content_path[PATH_MAX_LENGTH];
+   char system_dir[PATH_MAX_LENGTH];
+   char save_dir[PATH_MAX_LENGTH];
+   char options_path[PATH_MAX_LENGTH];
+};
+
+/* Libretro callbacks carry no context, each worker thread
+ * points this at the instance it drives. */
+static sthread_tls_t batch_core_tls;
+static bool batch_core_active = false;
+
+static struct batch_instance *batch_core_current(void)
+{
+   return (struct batch_instance*)sthread_tls_get(&batch_core_tls);
+}
+
+static bool batch_core_environment(unsigned cmd, void *data)
+{
+   struct batch_instance *inst = batch_core_current();
+   batch_core_t *batch         = inst->batch;
+
+   switch (cmd)
+   {
+      case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+         *(bool*)data = true;
+         break;
+
+      case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
+      {
+         enum retro_pixel_format pix_fmt =
+            *(const enum retro_pixel_format*)data;
+
+         switch (pix_fmt)
+         {
+            case RETRO_PIXEL_FORMAT_0RGB1555:
+            case RETRO_PIXEL_FORMAT_RGB565:
+            case RETRO_PIXEL_FORMAT_XRGB8888:
+               inst->pix_fmt = pix_fmt;
+               break;
+            default:
+               return false;
+         }
+         break;
+      }
+
+      case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+         *(const char**)data = batch->system_dir;
+         break;
+
+      case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+         *(const char**)data = batch->save_dir;
+         break;
+
+      case RETRO_ENVIRONMENT_SET_VARIABLES:
+         core_option_manager_free(inst->options);
+         inst->options = NULL;
+
+         if (!string_is_empty(batch->options_path))
+            inst->options = core_option_manager_new(
+                  batch->options_path, data);
+         break;
+
+      case RETRO_ENVIRONMENT_GET_VARIABLE:
+      {
+         struct retro_variable *var = (struct retro_variable*)data;
+
+         var->value = NULL;
+         if (!inst->options)
+            return false;
+         core_option_manager_get(inst->options, var);
+         break;
+      }
+
+      case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+         *(bool*)data = false;
+         break;
+
+      case RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO:
+         inst->av_info = *(const struct retro_system_av_info*)data;
+         break;
+
+      case RETRO_ENVIRONMENT_SET_GEOMETRY:
+         inst->av_info.geometry = *(const struct retro_game_geometry*)data;
+         break;
+
+      case RETRO_ENVIRONMENT_SET_MESSAGE:
+         RARCH_LOG("[Batch]: Instance %u: %s\n", inst->index,
+               ((const struct retro_message*)data)->msg);
+         break;
+
+      /* Read only queries of the frontend */
+      case RETRO_ENVIRONMENT_GET_OVERSCAN:
+      case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+      case RETRO_ENVIRONMENT_GET_PERF_INTERFACE:
+      case RETRO_ENVIRONMENT_GET_USERNAME:
+      case RETRO_ENVIRONMENT_GET_LANGUAGE:
+         return rarch_environment_cb(cmd, data);
+
+      /* Nothing to present them to */
+      case RETRO_ENVIRONMENT_SET_SUPPORT_NO_GAME:
+      case RETRO_ENVIRONMENT_SET_PERFORMANCE_LEVEL:
+      case RETRO_ENVIRONMENT_SET_INPUT_DESCRIPTORS:
+      case RETRO_ENVIRONMENT_SET_CONTROLLER_INFO:
+      case RETRO_ENVIRONMENT_SET_SUBSYSTEM_INFO:
+      case RETRO_ENVIRONMENT_SET_MEMORY_MAPS:
+      case RETRO_ENVIRONMENT_SET_SUPPORT_ACHIEVEMENTS:
+         break;
+
+      /* Hardware rendering needs a video driver */
+      default:
+         return false;
+   }
+
+   return true;
+}
+
+static void batch_core_video_refresh(const void *data,
+      unsigned width, unsigned height, size_t pitch)
+{
+   struct batch_instance *inst = batch_core_current();
+   batch_core_t *batch         = inst->batch;
+
+   if (!batch->cbs.video)
+      return;
+
+   if (data == RETRO_HW_FRAME_BUFFER_VALID)
+      data = NULL;
+
+   batch->cbs.video(batch->cbs.userdata, inst->index,
+         data, width, height, pitch, inst->pix_fmt);
+}
+
+static size_t batch_core_audio_sample_batch(const int16_t *data,
+      size_t frames)
+{
+   struct batch_instance *inst = batch_core_current();
+
+   if (inst->audio_frames + frames > inst->audio_cap)
+   {
+      size_t new_cap = (inst->audio_frames + frames) * 2;
+      int16_t *audio = (int16_t*)realloc(inst->audio,
+            new_cap * 2 * sizeof(int16_t));
+
+      if (!audio)
+         return 0;
+
+      inst->audio     = audio;
+      inst->audio_cap = new_cap;
+   }
+
+   memcpy(inst->audio + inst->audio_frames * 2, data,
+         frames * 2 * sizeof(int16_t));
+   inst->audio_frames += frames;
+
+   return frames;
+}
+
+static void batch_core_audio_sample(int16_t left, int16_t right)
+{
+   int16_t frame[2];
+
+   frame[0] = left;
+   frame[1] = right;
+
+   batch_core_audio_sample_batch(frame, 1);
+}
+
+static void batch_core_input_poll(void) { }
+
+static int16_t batch_core_input_state(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   struct batch_instance *inst = batch_core_current();
+   batch_core_t *batch         = inst->batch;
+
+   if (inst->scripted)
+   {
+      uint16_t mask;
+
+      if (     port >= BATCH_CORE_MAX_PORTS
+            || (device & RETRO_DEVICE_MASK) != RETRO_DEVICE_JOYPAD
+            || id >= 16)
+         return 0;
+
+      mask = inst->joypad[inst->frame * BATCH_CORE_MAX_PORTS + port];
+      return (mask >> id) & 1;
+   }
+
+   if (batch->cbs.input)
+      return batch->cbs.input(batch->cbs.userdata, inst->index,
+            port, device, index, id);
+
+   return 0;
+}
+
+static bool batch_core_load(struct batch_instance *inst)
+{
+   unsigned port;
+   batch_core_t *batch       = inst->batch;
+   struct retro_core_t *core = &inst->core;
+
+   core->retro_set_environment(batch_core_environment);
+   core->retro_init();
+   core->inited = true;
+
+   core->retro_set_video_refresh(batch_core_video_refresh);
+   core->retro_set_audio_sample(batch_core_audio_sample);
+   core->retro_set_audio_sample_batch(batch_core_audio_sample_batch);
+   core->retro_set_input_poll(batch_core_input_poll);
+   core->retro_set_input_state(batch_core_input_state);
+
+   core->game_loaded = core->retro_load_game(
+         batch->has_content ? &batch->game : NULL);
+   if (!core->game_loaded)
+   {
+      RARCH_ERR("[Batch]: Instance %u failed to load content.\n",
+            inst->index);
+      return false;
+   }
+
+   core->retro_get_system_av_info(&inst->av_info);
+
+   for (port = 0; port < BATCH_CORE_MAX_PORTS; port++)
+      core->retro_set_controller_port_device(port, RETRO_DEVICE_JOYPAD);
+
+   return true;
+}
+
+static void batch_core_unload(struct batch_instance *inst)
+{
+   struct retro_core_t *core = &inst->core;
+
+   if (core->game_loaded)
+      core->retro_unload_game();
+   if (core->inited)
+      core->retro_deinit();
+
+   core->game_loaded = false;
+   core->inited      = false;
+}
+
+static bool batch_core_run_frames(struct batch_instance *inst)
+{
+   batch_core_t *batch = inst->batch;
+
+   for (inst->frame = 0; inst->frame < inst->frames; inst->frame++)
+   {
+      inst->audio_frames = 0;
+
+      inst->core.retro_run();
+
+      if (inst->audio_frames && batch->cbs.audio)
+         batch->cbs.audio(batch->cbs.userdata, inst->index,
+               inst->audio, inst->audio_frames);
+   }
+
+   return true;
+}
+
+static void batch_core_worker(void *data)
+{
+   struct batch_instance *inst = (struct batch_instance*)data;
+   struct retro_core_t *core   = &inst->core;
+   bool quit                   = false;
+
+   sthread_tls_set(&batch_core_tls, inst);
+
+   while (!quit)
+   {
+      enum batch_job job;
+      bool result = true;
+
+      slock_lock(inst->lock);
+      while (inst->job == BATCH_JOB_NONE)
+         scond_wait(inst->cond, inst->lock);
+      job = inst->job;
+      slock_unlock(inst->lock);
+
+      switch (job)
+      {
+         case BATCH_JOB_LOAD:
+            result = batch_core_load(inst);
+            break;
+         case BATCH_JOB_RUN:
+            result = batch_core_run_frames(inst);
+            break;
+         case BATCH_JOB_SERIALIZE_SIZE:
+            inst->state_size = core->retro_serialize_size();
+            break;
+         case BATCH_JOB_SERIALIZE:
+            result = core->retro_serialize(inst->state, inst->state_size);
+            break;
+         case BATCH_JOB_UNSERIALIZE:
+            result = core->retro_unserialize(inst->state_const,
+                  inst->state_size);
+            break;
+         case BATCH_JOB_QUIT:
+            batch_core_unload(inst);
+            quit = true;
+            break;
+         case BATCH_JOB_NONE:
+            break;
+      }
+
+      slock_lock(inst->lock);
+      inst->result = result;
+      inst->job    = BATCH_JOB_NONE;
+      scond_broadcast(inst->cond);
+      slock_unlock(inst->lock);
+   }
+}
+
+static void batch_core_wait_idle(struct batch_instance *inst)
+{
+   while (inst->job != BATCH_JOB_NONE)
+      scond_wait(inst->cond, inst->lock);
+}
+
+/* Posts a job and waits for it, the lock must be held */
+static bool batch_core_call(struct batch_instance *inst,
+      enum batch_job job)
+{
+   inst->job = job;
+   scond_broadcast(inst->cond);
+   batch_core_wait_idle(inst);
+   return inst->result;
+}
+
+static struct batch_instance *batch_core_get(batch_core_t *batch,
+      unsigned instance)
+{
+   if (!batch || instance >= batch->count)
+      return NULL;
+   return &batch->instances[instance];
+}
+
+static void batch_core_resolve_dirs(batch_core_t *batch)
+{
+   settings_t *settings = config_get_ptr();
+   const char *save_dir = dir_get(RARCH_DIR_SAVEFILE);
+   char content_dir[PATH_MAX_LENGTH];
+
+   content_dir[0] = '\0';
+   if (batch->has_content)
+      fill_pathname_basedir(content_dir, batch->content_path,
+            sizeof(content_dir));
+
+   if (settings && !string_is_empty(settings->paths.directory_system))
+      strlcpy(batch->system_dir, settings->paths.directory_system,
+            sizeof(batch->system_dir));
+   else
+      strlcpy(batch->system_dir, content_dir, sizeof(batch->system_dir));
+
+   if (!string_is_empty(save_dir))
+      strlcpy(batch->save_dir, save_dir, sizeof(batch->save_dir));
+   else
+      strlcpy(batch->save_dir, content_dir, sizeof(batch->save_dir));
+
+   /* Game specific options need the main core's system info */
+   if (settings && !string_is_empty(settings->paths.path_core_options))
+      strlcpy(batch->options_path, settings->paths.path_core_options,
+            sizeof(batch->options_path));
+   else if (!path_is_empty(RARCH_PATH_CONFIG))
+      fill_pathname_resolve_relative(batch->options_path,
+            path_get(RARCH_PATH_CONFIG),
+            file_path_str(FILE_PATH_CORE_OPTIONS_CONFIG),
+            sizeof(batch->options_path));
+}
+
+static bool batch_core_load_content(batch_core_t *batch)
+{
+   struct retro_system_info info;
+   int64_t size = 0;
+
+   if (!batch->has_content)
+      return true;
+
+   memset(&info, 0, sizeof(info));
+   batch->instances[0].core.retro_get_system_info(&info);
+
+   batch->game.path = batch->content_path;
+
+   if (info.need_fullpath)
+      return true;
+
+   /* Shared by all instances, cores only read it */
+   if (!filestream_read_file(batch->content_path,
+            &batch->content_data, &size))
+   {
+      RARCH_ERR("[Batch]: Could not read \"%s\".\n", batch->content_path);
+      return false;
+   }
+
+   batch->game.data = batch->content_data;
+   batch->game.size = (size_t)size;
+   return true;
+}
+
+batch_core_t *batch_core_new(const char *core_path,
+      const char *content_path, unsigned count,
+      const struct batch_core_callbacks *cbs)
+{
+   unsigned i;
+   batch_core_t *batch = NULL;
+
+   if (batch_core_active || !count || string_is_empty(core_path))
+      return NULL;
+
+   batch = (batch_core_t*)calloc(1, sizeof(*batch));
+   if (!batch)
+      return NULL;
+
+   batch->instances = (struct batch_instance*)
+      calloc(count, sizeof(*batch->instances));
+   if (!batch->instances)
+   {
+      free(batch);
+      return NULL;
+   }
+
+   batch_core_active = true;
+   sthread_tls_create(&batch_core_tls);
+
+   if (cbs)
+      batch->cbs = *cbs;
+
+   if (!string_is_empty(content_path))
+   {
+      strlcpy(batch->content_path, content_path,
+            sizeof(batch->content_path));
+      batch->has_content = true;
+   }
+
+   batch_core_resolve_dirs(batch);
+
+   /* Every instance gets its own copy of the library, loading the
+    * same file again would share the core's globals. */
+   for (i = 0; i < count; i++)
+   {
+      char prefix[64];
+      struct batch_instance *inst = &batch->instances[i];
+
+      inst->batch   = batch;
+      inst->index   = i;
+      inst->pix_fmt = RETRO_PIXEL_FORMAT_0RGB1555;
+      batch->count  = i + 1;
+
+      snprintf(prefix, sizeof(prefix), "batch%d_%u_",
+            (int)batch_core_getpid(), i);
+
+      inst->library_path = copy_core_to_temp_file(core_path, prefix);
+      if (!inst->library_path)
+      {
+         RARCH_ERR("[Batch]: Failed to copy \"%s\".\n", core_path);
+         goto error;
+      }
+
+      if (!init_libretro_sym_custom(CORE_TYPE_PLAIN, &inst->core,
+               inst->library_path, &inst->module))
+      {
+         RARCH_ERR("[Batch]: Failed to load \"%s\".\n", inst->library_path);
+         goto error;
+      }
+      inst->core.symbols_inited = true;
+
+      inst->lock = slock_new();
+      inst->cond = scond_new();
+      if (!inst->lock || !inst->cond)
+         goto error;
+   }
+
+   if (!batch_core_load_content(batch))
+      goto error;
+
+   for (i = 0; i < count; i++)
+   {
+      struct batch_instance *inst = &batch->instances[i];
+
+      inst->job    = BATCH_JOB_LOAD;
+      inst->thread = sthread_create(batch_core_worker, inst);
+      if (!inst->thread)
+      {
+         inst->job = BATCH_JOB_NONE;
+         goto error;
+      }
+   }
+
+   for (i = 0; i < count; i++)
+   {
+      struct batch_instance *inst = &batch->instances[i];
+      bool loaded;
+
+      slock_lock(inst->lock);
+      batch_core_wait_idle(inst);
+      loaded = inst->result;
+      slock_unlock(inst->lock);
+
+      if (!loaded)
+         goto error;
+   }
+
+   RARCH_LOG("[Batch]: Loaded %u instances of \"%s\".\n", count, core_path);
+   return batch;
+
+error:
+   batch_core_free(batch);
+   return NULL;
+}
+
+void batch_core_free(batch_core_t *batch)
+{
+   unsigned i;
+
+   if (!batch)
+      return;
+
+   for (i = 0; i < batch->count; i++)
+   {
+      struct batch_instance *inst = &batch->instances[i];
+
+      if (!inst->thread)
+         continue;
+
+      slock_lock(inst->lock);
+      batch_core_wait_idle(inst);
+      batch_core_call(inst, BATCH_JOB_QUIT);
+      slock_unlock(inst->lock);
+
+      sthread_join(inst->thread);
+   }
+
+   for (i = 0; i < batch->count; i++)
+   {
+      struct batch_instance *inst = &batch->instances[i];
+
+      core_option_manager_free(inst->options);
+
+      if (inst->module)
+         dylib_close(inst->module);
+
+      if (inst->library_path)
+      {
+         filestream_delete(inst->library_path);
+         free(inst->library_path);
+      }
+
+      if (inst->cond)
+         scond_free(inst->cond);
+      if (inst->lock)
+         slock_free(inst->lock);
+
+      free(inst->audio);
+      free(inst->joypad);
+   }
+
+   free(batch->content_data);
+   free(batch->instances);
+   free(batch);
+
+   sthread_tls_delete(&batch_core_tls);
+   batch_core_active = false;
+}
+
+const struct retro_system_av_info *batch_core_get_av_info(
+      batch_core_t *batch, unsigned instance)
+{
+   struct batch_instance *inst = batch_core_get(batch, instance);
+
+   if (!inst)
+      return NULL;
+
+   /* The worker updates it while running */
+   slock_lock(inst->lock);
+   batch_core_wait_idle(inst);
+   slock_unlock(inst->lock);
+
+   return &inst->av_info;
+}
+
+bool batch_core_run(batch_core_t *batch, unsigned instance,
+      const uint16_t *joypad, unsigned frames)
+{
+   struct batch_instance *inst = batch_core_get(batch, instance);
+   bool ret                    = true;
+
+   if (!inst)
+      return false;
+
+   slock_lock(inst->lock);
+   batch_core_wait_idle(inst);
+
+   inst->scripted = joypad != NULL;
+
+   if (joypad)
+   {
+      size_t count = (size_t)frames * BATCH_CORE_MAX_PORTS;
+
+      if (count > inst->joypad_cap)
+      {
+         uint16_t *tmp = (uint16_t*)realloc(inst->joypad,
+               count * sizeof(*tmp));
+
+         if (!tmp)
+         {
+            ret = false;
+            goto end;
+         }
+
+         inst->joypad     = tmp;
+         inst->joypad_cap = count;
+      }
+
+      memcpy(inst->joypad, joypad, count * sizeof(*joypad));
+   }
+
+   inst->frames = frames;
+   inst->job    = BATCH_JOB_RUN;
+   scond_broadcast(inst->cond);
+
+end:
+   slock_unlock(inst->lock);
+   return ret;
+}
+
+bool batch_core_wait(batch_core_t *batch, unsigned instance)
+{
+   bool ret;
+   struct batch_instance *inst = batch_core_get(batch, instance);
+
+   if (!inst)
+      return false;
+
+   slock_lock(inst->lock);
+   batch_core_wait_idle(inst);
+   ret = inst->result;
+   slock_unlock(inst->lock);
+
+   return ret;
+}
+
+size_t batch_core_serialize_size(batch_core_t *batch, unsigned instance)
+{
+   size_t size                 = 0;
+   struct batch_instance *inst = batch_core_get(batch, instance);
+
+   if (!inst)
+      return 0;
+
+   slock_lock(inst->lock);
+   batch_core_wait_idle(inst);
+   if (batch_core_call(inst, BATCH_JOB_SERIALIZE_SIZE))
+      size = inst->state_size;
+   slock_unlock(inst->lock);
+
+   return size;
+}
+
+bool batch_core_serialize(batch_core_t *batch, unsigned instance,
+      void *data, size_t size)
+{
+   bool ret;
+   struct batch_instance *inst = batch_core_get(batch, instance);
+
+   if (!inst || !data)
+      return false;
+
+   slock_lock(inst->lock);
+   batch_core_wait_idle(inst);
+   inst->state      = data;
+   inst->state_size = size;
+   ret              = batch_core_call(inst, BATCH_JOB_SERIALIZE);
+   inst->state      = NULL;
+   slock_unlock(inst->lock);
+
+   return ret;
+}
+
+bool batch_core_unserialize(batch_core_t *batch, unsigned instance,
+      const void *data, size_t size)
+{
+   bool ret;
+   struct batch_instance *inst = batch_core_get(batch, instance);
+
+   if (!inst || !data)
+      return false;
+
+   slock_lock(inst->lock);
+   batch_core_wait_idle(inst);
+   inst->state_const = data;
+   inst->state_size  = size;
+   ret               = batch_core_call(inst, BATCH_JOB_UNSERIALIZE);
+   inst->state_const = NULL;
+   slock_unlock(inst->lock);
+
+   return ret;
+}
+
+struct batch_core_result
+{
+   uint32_t video_crc;
+   uint32_t audio_crc;
+   uint32_t state_crc;
+   unsigned frames;
+};
+
+struct batch_core_runner
+{
+   struct batch_core_result *results;
+   /* Index of the input each instance runs */
+   size_t *current;
+};
+
+static void batch_core_runner_video(void *userdata, unsigned instance,
+      const void *data, unsigned width, unsigned height, size_t pitch,
+      enum retro_pixel_format format)
+{
+   unsigned y;
+   struct batch_core_runner *runner = (struct batch_core_runner*)userdata;
+   struct batch_core_result *result =
+      &runner->results[runner->current[instance]];
+   const uint8_t *src               = (const uint8_t*)data;
+   size_t row_size                  = width *
+      ((format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2);
+
+   /* Duplicated frames are identical to the last one */
+   if (!src)
+      return;
+
+   for (y = 0; y < height; y++, src += pitch)
+      result->video_crc = encoding_crc32(result->video_crc, src, row_size);
+}
+
+static void batch_core_runner_audio(void *userdata, unsigned instance,
+      const int16_t *data, size_t frames)
+{
+   struct batch_core_runner *runner = (struct batch_core_runner*)userdata;
+   struct batch_core_result *result =
+      &runner->results[runner->current[instance]];
+
+   result->audio_crc = encoding_crc32(result->audio_crc,
+         (const uint8_t*)data, frames * 2 * sizeof(int16_t));
+}
+
+/* Parses an input script into BATCH_CORE_MAX_PORTS masks per frame */
+static uint16_t *batch_core_load_input(const char *path, unsigned *frames)
+{
+   void *buf         = NULL;
+   int64_t len       = 0;
+   uint16_t *joypad  = NULL;
+   size_t cap        = 0;
+   unsigned count    = 0;
+   char *line        = NULL;
+
+   if (!filestream_read_file(path, &buf, &len))
+      return NULL;
+
+   for (line = (char*)buf; line && *line; )
+   {
+      unsigned port;
+      char *next = strchr(line, '\n');
+
+      if (next)
+         *next++ = '\0';
+
+      while (isspace((unsigned char)*line))
+         line++;
+
+      if (*line && *line != '#')
+      {
+         if (count >= cap)
+         {
+            size_t new_cap = cap ? cap * 2 : 1024;
+            uint16_t *tmp  = (uint16_t*)realloc(joypad,
+                  new_cap * BATCH_CORE_MAX_PORTS * sizeof(*tmp));
+
+            if (!tmp)
+            {
+               free(joypad);
+               free(buf);
+               return NULL;
+            }
+
+            joypad = tmp;
+            cap    = new_cap;
+         }
+
+         for (port = 0; port < BATCH_CORE_MAX_PORTS; port++)
+         {
+            char *end;
+            unsigned long mask = strtoul(line, &end, 16);
+
+            joypad[count * BATCH_CORE_MAX_PORTS + port] =
+               (end != line) ? (uint16_t)mask : 0;
+            line = end;
+         }
+
+         count++;
+      }
+
+      line = next;
+   }
+
+   free(buf);
+
+   /* An empty script still runs, for zero frames */
+   if (!joypad)
+      joypad = (uint16_t*)calloc(BATCH_CORE_MAX_PORTS, sizeof(*joypad));
+
+   *frames = count;
+   return joypad;
+}
+
+bool batch_core_run_inputs(const char *core_path,
+      const char *content_path, unsigned count,
+      const struct string_list *inputs)
+{
+   unsigned i;
+   size_t first;
+   struct batch_core_callbacks cbs;
+   struct batch_core_runner runner;
+   batch_core_t *batch  = NULL;
+   uint8_t **initial    = NULL;
+   uint8_t *final_state = NULL;
+   size_t state_size    = 0;
+   bool ret             = false;
+
+   if (!inputs || !inputs->size)
+      return false;
+
+   if (count > inputs->size)
+      count = (unsigned)inputs->size;
+
+   runner.results = (struct batch_core_result*)
+      calloc(inputs->size, sizeof(*runner.results));
+   runner.current = (size_t*)calloc(count, sizeof(*runner.current));
+
+   cbs.video    = batch_core_runner_video;
+   cbs.audio    = batch_core_runner_audio;
+   cbs.input    = NULL;
+   cbs.userdata = &runner;
+
+   if (!runner.results || !runner.current)
+      goto end;
+
+   batch = batch_core_new(core_path, content_path, count, &cbs);
+   if (!batch)
+      goto end;
+
+   /* Every input starts from the state right after loading */
+   state_size = batch_core_serialize_size(batch, 0);
+   if (!state_size)
+   {
+      RARCH_ERR("[Batch]: The core does not support savestates.\n");
+      goto end;
+   }
+
+   initial     = (uint8_t**)calloc(count, sizeof(*initial));
+   final_state = (uint8_t*)malloc(state_size);
+   if (!initial || !final_state)
+      goto end;
+
+   for (i = 0; i < count; i++)
+   {
+      initial[i] = (uint8_t*)malloc(state_size);
+      if (!initial[i] || !batch_core_serialize(batch, i,
+               initial[i], state_size))
+         goto end;
+   }
+
+   RARCH_LOG("[Batch]: Running %u inputs on %u instances.\n",
+         (unsigned)inputs->size, count);
+
+   ret = true;
+
+   for (first = 0; first < inputs->size; first += count)
+   {
+      unsigned running = 0;
+
+      for (i = 0; i < count && first + i < inputs->size; i++)
+      {
+         unsigned frames         = 0;
+         const char *path        = inputs->elems[first + i].data;
+         uint16_t *joypad        = batch_core_load_input(path, &frames);
+
+         if (!joypad)
+         {
+            RARCH_ERR("[Batch]: Could not read input \"%s\".\n", path);
+            ret = false;
+            break;
+         }
+
+         runner.current[i]                      = first + i;
+         runner.results[first + i].frames       = frames;
+
+         if (     !batch_core_unserialize(batch, i, initial[i], state_size)
+               || !batch_core_run(batch, i, joypad, frames))
+         {
+            free(joypad);
+            ret = false;
+            break;
+         }
+
+         free(joypad);
+         running++;
+      }
+
+      for (i = 0; i < running; i++)
+      {
+         struct batch_core_result *result = &runner.results[first + i];
+
+         if (     !batch_core_wait(batch, i)
+               || !batch_core_serialize(batch, i, final_state, state_size))
+         {
+            ret = false;
+            continue;
+         }
+
+         result->state_crc = encoding_crc32(0, final_state, state_size);
+
+         fprintf(stdout, "%s: %u frames, video %08x, audio %08x, "
+               "state %08x\n", inputs->elems[first + i].data,
+               result->frames, result->video_crc, result->audio_crc,
+               result->state_crc);
+      }
+
+      fflush(stdout);
+
+      if (!ret)
+         break;
+   }
+
+end:
+   if (initial)
+   {
+      for (i = 0; i < count; i++)
+         free(initial[i]);
+      free(initial);
+   }
+
+   batch_core_free(batch);
+   free(final_state);
+   free(runner.results);
+   free(runner.current);
+
+   return ret;
+}
@@ -0,0 +1,130 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __BATCH_CORE_H
+#define __BATCH_CORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+#include <lists/string_list.h>
+
+RETRO_BEGIN_DECLS
+
+/* Headless batch emulation. Runs several independent instances of
+ * one core, each loaded from its own copy of the core library and
+ * driven by its own worker thread, without any video, audio or
+ * input driver. Only one batch can exist at a time. */
+
+#define BATCH_CORE_MAX_PORTS 4
+
+typedef struct batch_core batch_core_t;
+
+/* Callbacks run on the worker thread of the instance, they may be
+ * called for different instances at the same time. */
+struct batch_core_callbacks
+{
+   /* After every video frame. data is NULL for duplicated and
+    * hardware rendered frames, and only valid during the call. */
+   void (*video)(void *userdata, unsigned instance,
+         const void *data, unsigned width, unsigned height, size_t pitch,
+         enum retro_pixel_format format);
+   /* Once per frame with all the interleaved stereo frames of it. */
+   void (*audio)(void *userdata, unsigned instance,
+         const int16_t *data, size_t frames);
+   /* Input for runs without a joypad script. May be NULL. */
+   int16_t (*input)(void *userdata, unsigned instance,
+         unsigned port, unsigned device, unsigned index, unsigned id);
+   void *userdata;
+};
+
+/**
+ * batch_core_new:
+ * @core_path        : path of the libretro core.
+ * @content_path     : content to load, NULL or empty for none.
+ * @count            : number of instances.
+ * @cbs              : frame, audio and input callbacks.
+ *
+ * Loads @count instances of the core with the content, each on its
+ * own worker thread.
+ *
+ * Returns: batch handle, or NULL if any instance failed to load.
+ **/
+batch_core_t *batch_core_new(const char *core_path,
+      const char *content_path, unsigned count,
+      const struct batch_core_callbacks *cbs);
+
+void batch_core_free(batch_core_t *batch);
+
+const struct retro_system_av_info *batch_core_get_av_info(
+      batch_core_t *batch, unsigned instance);
+
+/**
+ * batch_core_run:
+ * @batch            : batch handle.
+ * @instance         : index of the instance.
+ * @joypad           : joypad script, or NULL to use the input callback.
+ * @frames           : number of frames to run.
+ *
+ * Starts running @frames frames on the instance and returns without
+ * waiting. The script holds BATCH_CORE_MAX_PORTS joypad masks of
+ * RETRO_DEVICE_ID_JOYPAD_* bits per frame and is copied.
+ *
+ * Returns: true if the run was started.
+ **/
+bool batch_core_run(batch_core_t *batch, unsigned instance,
+      const uint16_t *joypad, unsigned frames);
+
+/* Waits for the instance to finish its run. Returns false if
+ * the core failed. */
+bool batch_core_wait(batch_core_t *batch, unsigned instance);
+
+/* Savestates of a single instance, waiting for its run first. */
+size_t batch_core_serialize_size(batch_core_t *batch, unsigned instance);
+
+bool batch_core_serialize(batch_core_t *batch, unsigned instance,
+      void *data, size_t size);
+
+bool batch_core_unserialize(batch_core_t *batch, unsigned instance,
+      const void *data, size_t size);
+
+/**
+ * batch_core_run_inputs:
+ * @core_path        : path of the libretro core.
+ * @content_path     : content to load, NULL or empty for none.
+ * @count            : number of instances.
+ * @inputs           : paths of the input scripts.
+ *
+ * Runs every input script from the state right after loading the
+ * content, spread over @count instances, and prints the frame count
+ * and the CRC32 of the video, audio and final state of each.
+ *
+ * An input script is a text file with one line per frame, holding
+ * the hexadecimal joypad mask of each port separated by spaces.
+ * Empty lines and lines starting with '#' are skipped.
+ *
+ * Returns: true if every script ran.
+ **/
+bool batch_core_run_inputs(const char *core_path,
+      const char *content_path, unsigned count,
+      const struct string_list *inputs);
+
+RETRO_END_DECLS
+
+#endif
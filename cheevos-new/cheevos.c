@@ -540,21 +540,8 @@ static void rcheevos_award(rcheevos_cheevo_t* cheevo, int mode)
 
 static unsigned rcheevos_peek(unsigned address, unsigned num_bytes, void* ud)
 {
-   const uint8_t* data = rcheevos_fixup_find(&rcheevos_locals.fixups,
-      address, rcheevos_locals.patchdata.console_id);
-   unsigned value = 0;
-
-   if (data)
-   {
-      switch (num_bytes)
-      {
-         case 4: value |= data[2] << 16 | data[3] << 24;
-         case 2: value |= data[1] << 8;
-         case 1: value |= data[0];
-      }
-   }
-
-   return value;
+   return rcheevos_fixup_peek(&rcheevos_locals.fixups,
+      address, num_bytes, rcheevos_locals.patchdata.console_id);
 }
 
 static void rcheevos_test_cheevo_set(bool official)
@@ -1001,6 +988,8 @@ void rcheevos_test(void)
 {
    settings_t *settings = config_get_ptr();
 
+   rcheevos_fixup_new_frame(&rcheevos_locals.fixups);
+
    rcheevos_test_cheevo_set(true);
 
    if (settings)
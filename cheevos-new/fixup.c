@@ -13,6 +13,9 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "fixup.h"
 #include "cheevos.h"
 #include "util.h"
@@ -22,6 +25,26 @@
 
 #include "../deps/rcheevos/include/rcheevos.h"
 
+/* Console addresses are translated through a two level page
+ * table of 256 byte pages, filled in the first time a page is
+ * referenced. Pages which don't map linearly to host memory
+ * (i.e. that cross a mirror or descriptor boundary) are marked
+ * as irregular and resolved per address like before. */
+#define RCHEEVOS_PAGE_SHIFT     8
+#define RCHEEVOS_PAGE_SIZE      (1 << RCHEEVOS_PAGE_SHIFT)
+#define RCHEEVOS_DIR_SHIFT      20
+#define RCHEEVOS_DIR_SIZE       (1 << (32 - RCHEEVOS_DIR_SHIFT))
+#define RCHEEVOS_PAGES_PER_DIR  (1 << (RCHEEVOS_DIR_SHIFT - RCHEEVOS_PAGE_SHIFT))
+
+/* Number of distinct memory reads remembered per frame */
+#define RCHEEVOS_PEEK_CACHE_SIZE 1024
+#define RCHEEVOS_PEEK_CACHE_PROBES 8
+
+static const uint8_t rcheevos_page_unmapped[1];
+static const uint8_t rcheevos_page_irregular[1];
+
+static const uint8_t* rcheevos_patch_address_internal(unsigned address, int console, bool log);
+
 static int rcheevos_cmpaddr(const void* e1, const void* e2)
 {
    const rcheevos_fixup_t* f1 = (const rcheevos_fixup_t*)e1;
@@ -69,15 +92,29 @@ void rcheevos_fixup_init(rcheevos_fixups_t* fixups)
    fixups->elements = NULL;
    fixups->capacity = fixups->count = 0;
    fixups->dirty = false;
+   fixups->pages = NULL;
+   fixups->peeks = NULL;
+   fixups->frame = 1;
 }
 
 void rcheevos_fixup_destroy(rcheevos_fixups_t* fixups)
 {
+   if (fixups->pages != NULL)
+   {
+      unsigned i;
+
+      for (i = 0; i < RCHEEVOS_DIR_SIZE; i++)
+         CHEEVOS_FREE(fixups->pages[i]);
+
+      CHEEVOS_FREE(fixups->pages);
+   }
+
+   CHEEVOS_FREE(fixups->peeks);
    CHEEVOS_FREE(fixups->elements);
    rcheevos_fixup_init(fixups);
 }
 
-const uint8_t* rcheevos_fixup_find(rcheevos_fixups_t* fixups, unsigned address, int console)
+static const uint8_t* rcheevos_fixup_find_slow(rcheevos_fixups_t* fixups, unsigned address, int console)
 {
    rcheevos_fixup_t key;
    rcheevos_fixup_t* found;
@@ -120,7 +157,141 @@ const uint8_t* rcheevos_fixup_find(rcheevos_fixups_t* fixups, unsigned address,
    return location;
 }
 
+static const uint8_t* rcheevos_fixup_resolve_page(unsigned address, int console)
+{
+   unsigned i;
+   unsigned start        = address & ~(unsigned)(RCHEEVOS_PAGE_SIZE - 1);
+   const uint8_t* base   = rcheevos_patch_address_internal(start, console, false);
+
+   for (i = 1; i < RCHEEVOS_PAGE_SIZE; i++)
+   {
+      const uint8_t* location = rcheevos_patch_address_internal(start + i, console, false);
+
+      if (base == NULL ? location != NULL : location != base + i)
+         return rcheevos_page_irregular;
+   }
+
+   return base == NULL ? rcheevos_page_unmapped : base;
+}
+
+const uint8_t* rcheevos_fixup_find(rcheevos_fixups_t* fixups, unsigned address, int console)
+{
+   const uint8_t** dir;
+   const uint8_t** page;
+
+   if (fixups->pages == NULL)
+   {
+      fixups->pages = (const uint8_t***)calloc(RCHEEVOS_DIR_SIZE, sizeof(*fixups->pages));
+
+      if (fixups->pages == NULL)
+         return rcheevos_fixup_find_slow(fixups, address, console);
+   }
+
+   dir = fixups->pages[address >> RCHEEVOS_DIR_SHIFT];
+
+   if (dir == NULL)
+   {
+      dir = (const uint8_t**)calloc(RCHEEVOS_PAGES_PER_DIR, sizeof(*dir));
+
+      if (dir == NULL)
+         return rcheevos_fixup_find_slow(fixups, address, console);
+
+      fixups->pages[address >> RCHEEVOS_DIR_SHIFT] = dir;
+   }
+
+   page = &dir[(address >> RCHEEVOS_PAGE_SHIFT) & (RCHEEVOS_PAGES_PER_DIR - 1)];
+
+   if (*page == NULL)
+   {
+      /* Log the translation once, like the per address lookup does */
+      rcheevos_patch_address(address, console);
+      *page = rcheevos_fixup_resolve_page(address, console);
+   }
+
+   if (*page == rcheevos_page_irregular)
+      return rcheevos_fixup_find_slow(fixups, address, console);
+
+   if (*page == rcheevos_page_unmapped)
+      return NULL;
+
+   return *page + (address & (RCHEEVOS_PAGE_SIZE - 1));
+}
+
+void rcheevos_fixup_new_frame(rcheevos_fixups_t* fixups)
+{
+   /* Entries tagged with an older frame are treated as empty */
+   if (++fixups->frame == 0)
+   {
+      if (fixups->peeks != NULL)
+         memset(fixups->peeks, 0, RCHEEVOS_PEEK_CACHE_SIZE * sizeof(*fixups->peeks));
+
+      fixups->frame = 1;
+   }
+}
+
+static unsigned rcheevos_fixup_read(rcheevos_fixups_t* fixups, unsigned address, unsigned num_bytes, int console)
+{
+   const uint8_t* data = rcheevos_fixup_find(fixups, address, console);
+   unsigned value = 0;
+
+   if (data)
+   {
+      switch (num_bytes)
+      {
+         case 4: value |= data[2] << 16 | data[3] << 24;
+         case 2: value |= data[1] << 8;
+         case 1: value |= data[0];
+      }
+   }
+
+   return value;
+}
+
+unsigned rcheevos_fixup_peek(rcheevos_fixups_t* fixups, unsigned address, unsigned num_bytes, int console)
+{
+   unsigned i;
+   unsigned slot;
+   unsigned value;
+
+   /* Many triggers and leaderboards reference the same
+    * addresses, so reads are remembered for the frame */
+   if (fixups->peeks == NULL)
+   {
+      fixups->peeks = (rcheevos_peek_t*)calloc(RCHEEVOS_PEEK_CACHE_SIZE, sizeof(*fixups->peeks));
+
+      if (fixups->peeks == NULL)
+         return rcheevos_fixup_read(fixups, address, num_bytes, console);
+   }
+
+   slot = (address * 2654435761U) >> 22;
+
+   for (i = 0; i < RCHEEVOS_PEEK_CACHE_PROBES; i++)
+   {
+      rcheevos_peek_t* peek = &fixups->peeks[(slot + i) & (RCHEEVOS_PEEK_CACHE_SIZE - 1)];
+
+      if (peek->frame != fixups->frame)
+      {
+         value           = rcheevos_fixup_read(fixups, address, num_bytes, console);
+         peek->address   = address;
+         peek->num_bytes = num_bytes;
+         peek->frame     = fixups->frame;
+         peek->value     = value;
+         return value;
+      }
+
+      if (peek->address == address && peek->num_bytes == num_bytes)
+         return peek->value;
+   }
+
+   return rcheevos_fixup_read(fixups, address, num_bytes, console);
+}
+
 const uint8_t* rcheevos_patch_address(unsigned address, int console)
+{
+   return rcheevos_patch_address_internal(address, console, true);
+}
+
+static const uint8_t* rcheevos_patch_address_internal(unsigned address, int console, bool log)
 {
    rarch_system_info_t* system = runloop_get_system_info();
    const void* pointer = NULL;
@@ -130,7 +301,8 @@ const uint8_t* rcheevos_patch_address(unsigned address, int console)
       if (address >= 0x0800 && address < 0x2000)
       {
          /* Address in the mirrorred RAM, adjust to real RAM. */
-         CHEEVOS_LOG(RCHEEVOS_TAG "NES memory address in mirrorred RAM %X, adjusted to %X\n", address, address & 0x07ff);
+         if (log)
+            CHEEVOS_LOG(RCHEEVOS_TAG "NES memory address in mirrorred RAM %X, adjusted to %X\n", address, address & 0x07ff);
          address &= 0x07ff;
       }
    }
@@ -139,7 +311,8 @@ const uint8_t* rcheevos_patch_address(unsigned address, int console)
       if (address >= 0xe000 && address <= 0xfdff)
       {
          /* Address in the echo RAM, adjust to real RAM. */
-         CHEEVOS_LOG(RCHEEVOS_TAG "GBC memory address in echo RAM %X, adjusted to %X\n", address, address - 0x2000);
+         if (log)
+            CHEEVOS_LOG(RCHEEVOS_TAG "GBC memory address in echo RAM %X, adjusted to %X\n", address, address - 0x2000);
          address -= 0x2000;
       }
    }
@@ -156,20 +329,23 @@ const uint8_t* rcheevos_patch_address(unsigned address, int console)
          if (address < 0x8000)
          {
             /* Internal RAM. */
-            CHEEVOS_LOG(RCHEEVOS_TAG "GBA memory address %X adjusted to %X\n", address, address + 0x3000000);
+            if (log)
+               CHEEVOS_LOG(RCHEEVOS_TAG "GBA memory address %X adjusted to %X\n", address, address + 0x3000000);
             address += 0x3000000;
          }
          else
          {
             /* Work RAM. */
-            CHEEVOS_LOG(RCHEEVOS_TAG "GBA memory address %X adjusted to %X\n", address, address + 0x2000000 - 0x8000);
+            if (log)
+               CHEEVOS_LOG(RCHEEVOS_TAG "GBA memory address %X adjusted to %X\n", address, address + 0x2000000 - 0x8000);
             address += 0x2000000 - 0x8000;
          }
       }
       else if (console == RC_CONSOLE_PC_ENGINE)
       {
          /* RAM. */
-         CHEEVOS_LOG(RCHEEVOS_TAG "PCE memory address %X adjusted to %X\n", address, address + 0x1f0000);
+         if (log)
+            CHEEVOS_LOG(RCHEEVOS_TAG "PCE memory address %X adjusted to %X\n", address, address + 0x1f0000);
          address += 0x1f0000;
       }
       else if (console == RC_CONSOLE_SUPER_NINTENDO)
@@ -177,13 +353,15 @@ const uint8_t* rcheevos_patch_address(unsigned address, int console)
          if (address < 0x020000)
          {
             /* Work RAM. */
-            CHEEVOS_LOG(RCHEEVOS_TAG "SNES memory address %X adjusted to %X\n", address, address + 0x7e0000);
+            if (log)
+               CHEEVOS_LOG(RCHEEVOS_TAG "SNES memory address %X adjusted to %X\n", address, address + 0x7e0000);
             address += 0x7e0000;
          }
          else
          {
             /* Save RAM. */
-            CHEEVOS_LOG(RCHEEVOS_TAG "SNES memory address %X adjusted to %X\n", address, address + 0x006000 - 0x020000);
+            if (log)
+               CHEEVOS_LOG(RCHEEVOS_TAG "SNES memory address %X adjusted to %X\n", address, address + 0x006000 - 0x020000);
             address += 0x006000 - 0x020000;
          }
       }
@@ -207,7 +385,8 @@ const uint8_t* rcheevos_patch_address(unsigned address, int console)
 
             address += desc->core.offset;
 
-            CHEEVOS_LOG(RCHEEVOS_TAG "address %X set to descriptor %d at offset %X\n", addr, (int)((desc - system->mmaps.descriptors) + 1), address);
+            if (log)
+               CHEEVOS_LOG(RCHEEVOS_TAG "address %X set to descriptor %d at offset %X\n", addr, (int)((desc - system->mmaps.descriptors) + 1), address);
             break;
          }
       }
@@ -29,11 +29,27 @@ typedef struct
    const uint8_t* location;
 } rcheevos_fixup_t;
 
+typedef struct
+{
+   unsigned address;
+   unsigned num_bytes;
+   unsigned frame;
+   unsigned value;
+} rcheevos_peek_t;
+
 typedef struct
 {
    rcheevos_fixup_t* elements;
    unsigned capacity, count;
    bool dirty;
+
+   /* Page table from console addresses to host pointers,
+    * pages[address >> 20][(address >> 8) & 0xfff] */
+   const uint8_t*** pages;
+
+   /* Values read during the current frame */
+   rcheevos_peek_t* peeks;
+   unsigned frame;
 } rcheevos_fixups_t;
 
 void rcheevos_fixup_init(rcheevos_fixups_t* fixups);
@@ -41,6 +57,9 @@ void rcheevos_fixup_destroy(rcheevos_fixups_t* fixups);
 
 const uint8_t* rcheevos_fixup_find(rcheevos_fixups_t* fixups, unsigned address, int console);
 
+void rcheevos_fixup_new_frame(rcheevos_fixups_t* fixups);
+unsigned rcheevos_fixup_peek(rcheevos_fixups_t* fixups, unsigned address, unsigned num_bytes, int console);
+
 const uint8_t* rcheevos_patch_address(unsigned address, int console);
 
 RETRO_END_DECLS
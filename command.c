@@ -99,6 +99,10 @@
 #include "input/input_remapping.h"
 #include "version.h"
 
+#ifdef HAVE_SHM_EXPORT
+#include "shm_export.h"
+#endif
+
 #define DEFAULT_NETWORK_CMD_PORT 55355
 #define STDIN_BUF_SIZE           4096
 
@@ -236,6 +240,7 @@ static const struct cmd_map map[] = {
    { "MENU_TOGGLE",            RARCH_MENU_TOGGLE },
    { "RECORDING_TOGGLE",       RARCH_RECORDING_TOGGLE },
    { "STREAMING_TOGGLE",       RARCH_STREAMING_TOGGLE },
+   { "REPLAY_SAVE",            RARCH_REPLAY_SAVE },
    { "MENU_UP",                RETRO_DEVICE_ID_JOYPAD_UP },
    { "MENU_DOWN",              RETRO_DEVICE_ID_JOYPAD_DOWN },
    { "MENU_LEFT",              RETRO_DEVICE_ID_JOYPAD_LEFT },
@@ -1785,6 +1790,10 @@ bool command_event(enum event_command cmd, void *data)
          else
             command_event(CMD_EVENT_RECORD_INIT, NULL);
          break;
+      case CMD_EVENT_REPLAY_SAVE:
+         if (!recording_save_replay())
+            return false;
+         break;
       case CMD_EVENT_OSK_TOGGLE:
          if (input_keyboard_ctl(
                   RARCH_INPUT_KEYBOARD_CTL_IS_LINEFEED_ENABLED, NULL))
@@ -2150,6 +2159,7 @@ TODO: Add a setting for these tweaks */
          {
             settings_t *settings           = config_get_ptr();
             settings->bools.video_fps_show = !(settings->bools.video_fps_show);
+            video_driver_build_info_invalidate();
          }
          break;
       case CMD_EVENT_OVERLAY_DEINIT:
@@ -2350,6 +2360,9 @@ TODO: Add a setting for these tweaks */
             content_reset_savestate_backups();
             hwr = video_driver_get_hw_context();
             command_event_deinit_core(true);
+#ifdef HAVE_SHM_EXPORT
+            shm_export_deinit();
+#endif
 
             if (hwr)
                memset(hwr, 0, sizeof(*hwr));
@@ -249,6 +249,8 @@ enum event_command
    CMD_EVENT_OSK_TOGGLE,
    CMD_EVENT_RECORDING_TOGGLE,
    CMD_EVENT_STREAMING_TOGGLE,
+   /* Writes the replay buffer of the running recording to disk. */
+   CMD_EVENT_REPLAY_SAVE,
    CMD_EVENT_AI_SERVICE_TOGGLE,
    CMD_EVENT_BSV_RECORDING_TOGGLE,
    CMD_EVENT_SHADER_NEXT,
@@ -682,8 +682,27 @@ static const unsigned netplay_delay_frames = 16;
 
 static const int netplay_check_frames = 600;
 
+/* Save the core state for rollbacks only every this many frames, plus
+ * the first frame run on predicted input and the CRC check frames.
+ * Rollbacks then replay from the nearest saved frame. Raise it for cores
+ * with large savestates. */
+static const unsigned netplay_state_interval = 1;
+
 static const bool netplay_use_mitm_server = false;
 
+/* Also send input over UDP, ahead of the TCP stream. Every packet
+ * repeats the last netplay_udp_redundancy frames of input, and the
+ * measured round trip time drives the input latency within the
+ * netplay_input_latency_frames_min/range window. */
+static const bool netplay_udp_enable = false;
+
+static const unsigned netplay_udp_redundancy = 8;
+
+/* Encode input once for all spectators and sync joining spectators to
+ * a periodic keyframe, instead of buffering everything per spectator
+ * and resending the state to every peer when one joins. */
+static const bool netplay_shared_spectator_stream = false;
+
 static const char *netplay_mitm_server = "nyc";
 
 #ifdef HAVE_NETWORKING
@@ -734,6 +753,13 @@ static const bool network_cmd_enable = false;
 static const uint16_t network_cmd_port = 55355;
 static const bool stdin_cmd_enable = false;
 
+/* Enable the binary memory watch interface for local tools. */
+static const bool network_memwatch_enable = false;
+static const uint16_t network_memwatch_port = 55356;
+
+/* Export core memory and the last frame through shared memory. */
+static const bool shm_export_enable = false;
+
 static const uint16_t network_remote_base_port = 55400;
 
 static const bool network_on_demand_thumbnails = false;
@@ -759,6 +785,8 @@ static const unsigned playlist_entry_remove_enable = PLAYLIST_ENTRY_REMOVE_ENABL
 
 static const bool scan_without_core_match      = false;
 
+static const bool scan_incremental             = false;
+
 static const bool playlist_show_sublabels      = false;
 
 static const bool playlist_fuzzy_archive_match = false;
@@ -787,6 +815,13 @@ static const unsigned libretro_log_level = 1;
 #define RARCH_STREAM_DEFAULT_PORT 56400
 #endif
 
+/* Seconds of video a recording keeps in memory instead of writing
+ * it out, saved on demand with the replay hotkey. 0 disables it. */
+#define DEFAULT_REPLAY_BUFFER_LENGTH 0
+
+/* Memory budget of the replay buffer, in megabytes. */
+#define DEFAULT_REPLAY_BUFFER_SIZE 256
+
 /* KEYBINDS, JOYPAD */
 
 /* Axis threshold (between 0.0 and 1.0)
@@ -104,6 +104,7 @@ static const struct retro_keybind retro_keybinds_1[] = {
    { true, RARCH_MENU_TOGGLE,              MENU_ENUM_LABEL_VALUE_INPUT_META_MENU_TOGGLE,          RETROK_SPACE,   NO_BTN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_RECORDING_TOGGLE,         MENU_ENUM_LABEL_VALUE_INPUT_META_RECORDING_TOGGLE,     RETROK_UNKNOWN,      NO_BTN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_STREAMING_TOGGLE,         MENU_ENUM_LABEL_VALUE_INPUT_META_STREAMING_TOGGLE,     RETROK_UNKNOWN,      NO_BTN, NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_REPLAY_SAVE,              MENU_ENUM_LABEL_VALUE_INPUT_META_REPLAY_SAVE,          RETROK_UNKNOWN,      NO_BTN, NO_BTN, 0, AXIS_NONE },
 #else
    { true, RETRO_DEVICE_ID_JOYPAD_B,      MENU_ENUM_LABEL_VALUE_INPUT_JOYPAD_B,              RETROK_z,       NO_BTN, NO_BTN, 0, AXIS_NONE },
    { true, RETRO_DEVICE_ID_JOYPAD_Y,      MENU_ENUM_LABEL_VALUE_INPUT_JOYPAD_Y,              RETROK_a,       NO_BTN, NO_BTN, 0, AXIS_NONE },
@@ -185,6 +186,7 @@ static const struct retro_keybind retro_keybinds_1[] = {
    { true, RARCH_MENU_TOGGLE,              MENU_ENUM_LABEL_VALUE_INPUT_META_MENU_TOGGLE,          RETROK_F1,      NO_BTN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_RECORDING_TOGGLE,         MENU_ENUM_LABEL_VALUE_INPUT_META_RECORDING_TOGGLE,     RETROK_UNKNOWN,      NO_BTN, NO_BTN, 0, AXIS_NONE },
    { true, RARCH_STREAMING_TOGGLE,         MENU_ENUM_LABEL_VALUE_INPUT_META_STREAMING_TOGGLE,     RETROK_UNKNOWN,      NO_BTN, NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_REPLAY_SAVE,              MENU_ENUM_LABEL_VALUE_INPUT_META_REPLAY_SAVE,          RETROK_UNKNOWN,      NO_BTN, NO_BTN, 0, AXIS_NONE },
 #endif
 };
 
@@ -1344,6 +1344,8 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("netplay_stateless_mode",        &settings->bools.netplay_stateless_mode, true, netplay_stateless_mode, false);
    SETTING_OVERRIDE(RARCH_OVERRIDE_SETTING_NETPLAY_STATELESS_MODE);
    SETTING_BOOL("netplay_use_mitm_server",       &settings->bools.netplay_use_mitm_server, true, netplay_use_mitm_server, false);
+   SETTING_BOOL("netplay_udp_enable",            &settings->bools.netplay_udp_enable, true, netplay_udp_enable, false);
+   SETTING_BOOL("netplay_shared_spectator_stream", &settings->bools.netplay_shared_spectator_stream, true, netplay_shared_spectator_stream, false);
    SETTING_BOOL("netplay_request_device_p1",     &settings->bools.netplay_request_devices[0], true, false, false);
    SETTING_BOOL("netplay_request_device_p2",     &settings->bools.netplay_request_devices[1], true, false, false);
    SETTING_BOOL("netplay_request_device_p3",     &settings->bools.netplay_request_devices[2], true, false, false);
@@ -1556,8 +1558,12 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
 #endif
 #ifdef HAVE_COMMAND
    SETTING_BOOL("network_cmd_enable",           &settings->bools.network_cmd_enable, true, network_cmd_enable, false);
+   SETTING_BOOL("network_memwatch_enable",      &settings->bools.network_memwatch_enable, true, network_memwatch_enable, false);
    SETTING_BOOL("stdin_cmd_enable",             &settings->bools.stdin_cmd_enable, true, stdin_cmd_enable, false);
 #endif
+#ifdef HAVE_SHM_EXPORT
+   SETTING_BOOL("shm_export_enable",            &settings->bools.shm_export_enable, true, shm_export_enable, false);
+#endif
 #ifdef HAVE_NETWORKGAMEPAD
    SETTING_BOOL("network_remote_enable",        &settings->bools.network_remote_enable, false, false /* TODO */, false);
 #endif
@@ -1576,6 +1582,7 @@ static struct config_bool_setting *populate_settings_bool(settings_t *settings,
    SETTING_BOOL("auto_remaps_enable",           &settings->bools.auto_remaps_enable, true, default_auto_remaps_enable, false);
    SETTING_BOOL("auto_shaders_enable",          &settings->bools.auto_shaders_enable, true, default_auto_shaders_enable, false);
    SETTING_BOOL("scan_without_core_match",   &settings->bools.scan_without_core_match, true, scan_without_core_match, false);
+   SETTING_BOOL("scan_incremental",          &settings->bools.scan_incremental, true, scan_incremental, false);
    SETTING_BOOL("sort_savefiles_enable",        &settings->bools.sort_savefiles_enable, true, default_sort_savefiles_enable, false);
    SETTING_BOOL("sort_savestates_enable",       &settings->bools.sort_savestates_enable, true, default_sort_savestates_enable, false);
    SETTING_BOOL("config_save_on_exit",          &settings->bools.config_save_on_exit, true, DEFAULT_CONFIG_SAVE_ON_EXIT, false);
@@ -1709,6 +1716,7 @@ static struct config_uint_setting *populate_settings_uint(settings_t *settings,
 #endif
 #ifdef HAVE_COMMAND
    SETTING_UINT("network_cmd_port",             &settings->uints.network_cmd_port,    true, network_cmd_port, false);
+   SETTING_UINT("network_memwatch_port",        &settings->uints.network_memwatch_port, true, network_memwatch_port, false);
 #endif
 #ifdef HAVE_NETWORKGAMEPAD
    SETTING_UINT("network_remote_base_port",     &settings->uints.network_remote_base_port, true, network_remote_base_port, false);
@@ -1783,6 +1791,8 @@ static struct config_uint_setting *populate_settings_uint(settings_t *settings,
    SETTING_OVERRIDE(RARCH_OVERRIDE_SETTING_NETPLAY_IP_PORT);
    SETTING_UINT("netplay_input_latency_frames_min",&settings->uints.netplay_input_latency_frames_min, true, 0, false);
    SETTING_UINT("netplay_input_latency_frames_range",&settings->uints.netplay_input_latency_frames_range, true, 0, false);
+   SETTING_UINT("netplay_udp_redundancy",       &settings->uints.netplay_udp_redundancy, true, netplay_udp_redundancy, false);
+   SETTING_UINT("netplay_state_interval",       &settings->uints.netplay_state_interval, true, netplay_state_interval, false);
    SETTING_UINT("netplay_share_digital",        &settings->uints.netplay_share_digital, true, netplay_share_digital, false);
    SETTING_UINT("netplay_share_analog",         &settings->uints.netplay_share_analog,  true, netplay_share_analog, false);
 #endif
@@ -1802,6 +1812,8 @@ static struct config_uint_setting *populate_settings_uint(settings_t *settings,
 
    SETTING_UINT("video_stream_port",            &settings->uints.video_stream_port,    true, RARCH_STREAM_DEFAULT_PORT, false);
    SETTING_UINT("video_record_quality",            &settings->uints.video_record_quality,    true, RECORD_CONFIG_TYPE_RECORDING_LOSSLESS_QUALITY, false);
+   SETTING_UINT("video_replay_buffer_length",      &settings->uints.video_replay_buffer_length, true, DEFAULT_REPLAY_BUFFER_LENGTH, false);
+   SETTING_UINT("video_replay_buffer_size",        &settings->uints.video_replay_buffer_size, true, DEFAULT_REPLAY_BUFFER_SIZE, false);
    SETTING_UINT("video_stream_quality",            &settings->uints.video_stream_quality,    true, RECORD_CONFIG_TYPE_STREAMING_LOW_QUALITY, false);
    SETTING_UINT("video_record_scale_factor",            &settings->uints.video_record_scale_factor,    true, 1, false);
    SETTING_UINT("video_stream_scale_factor",            &settings->uints.video_stream_scale_factor,    true, 1, false);
@@ -3158,9 +3170,13 @@ static bool config_load_file(const char *path, settings_t *settings)
 
    frontend_driver_set_sustained_performance_mode(settings->bools.sustained_performance_mode);
    recording_driver_update_streaming_url();
+   video_driver_build_info_invalidate();
 
    if (!config_entry_exists(conf, "user_language"))
       msg_hash_set_uint(MSG_HASH_USER_LANGUAGE, frontend_driver_get_user_language());
+   else /* Loaded in place, this updates the strings */
+      msg_hash_set_uint(MSG_HASH_USER_LANGUAGE,
+            *msg_hash_get_uint(MSG_HASH_USER_LANGUAGE));
 
    ret = true;
 end:
@@ -230,6 +230,8 @@ typedef struct settings
       bool netplay_stateless_mode;
       bool netplay_nat_traversal;
       bool netplay_use_mitm_server;
+      bool netplay_udp_enable;
+      bool netplay_shared_spectator_stream;
       bool netplay_request_devices[MAX_USERS];
 
       /* Network */
@@ -291,6 +293,8 @@ typedef struct settings
       bool savestate_auto_load;
       bool savestate_thumbnail_enable;
       bool network_cmd_enable;
+      bool network_memwatch_enable;
+      bool shm_export_enable;
       bool stdin_cmd_enable;
       bool keymapper_enable;
       bool network_remote_enable;
@@ -341,6 +345,7 @@ typedef struct settings
       bool log_to_file_timestamp;
 
       bool scan_without_core_match;
+      bool scan_incremental;
 
       bool ai_service_enable;
    } bools;
@@ -416,6 +421,8 @@ typedef struct settings
       unsigned netplay_port;
       unsigned netplay_input_latency_frames_min;
       unsigned netplay_input_latency_frames_range;
+      unsigned netplay_udp_redundancy;
+      unsigned netplay_state_interval;
       unsigned netplay_share_digital;
       unsigned netplay_share_analog;
       unsigned bundle_assets_extract_version_current;
@@ -426,6 +433,7 @@ typedef struct settings
       unsigned rewind_buffer_size_step;
       unsigned autosave_interval;
       unsigned network_cmd_port;
+      unsigned network_memwatch_port;
       unsigned network_remote_base_port;
       unsigned keymapper_port;
       unsigned video_window_opacity;
@@ -447,6 +455,8 @@ typedef struct settings
       unsigned video_msg_bgcolor_blue;
       unsigned video_stream_port;
       unsigned video_record_quality;
+      unsigned video_replay_buffer_length;
+      unsigned video_replay_buffer_size;
       unsigned video_stream_quality;
       unsigned video_record_scale_factor;
       unsigned video_stream_scale_factor;
@@ -15,6 +15,10 @@
  *  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
 #include <compat/strl.h>
 #include <string/stdstring.h>
 #include <file/config_file.h>
@@ -36,11 +40,512 @@
 #include "uwp/uwp_func.h"
 #endif
 
-static const char *core_info_tmp_path               = NULL;
-static const struct string_list *core_info_tmp_list = NULL;
 static core_info_t *core_info_current               = NULL;
 static core_info_list_t *core_info_curr_list        = NULL;
 
+/* Binary cache of the parsed .info files, stored next to them.
+ *
+ * Layout, in native byte order:
+ *    core_info_cache_header_t
+ *    core_info_cache_record_t[count], sorted by .info file name
+ *    core_info_cache_firmware_t[firmware_count]
+ *    string table, strings are referenced by their offset in it,
+ *    offset 0 is the NULL string
+ *
+ * A record is only used while the size and modification time of
+ * its .info file are unchanged, other files are parsed again. */
+
+#define CORE_INFO_CACHE_MAGIC   "RAINFO"
+#define CORE_INFO_CACHE_VERSION 1
+
+enum core_info_cache_string
+{
+   CORE_INFO_CACHE_DISPLAY_NAME = 0,
+   CORE_INFO_CACHE_DISPLAY_VERSION,
+   CORE_INFO_CACHE_CORE_NAME,
+   CORE_INFO_CACHE_SYSTEM_MANUFACTURER,
+   CORE_INFO_CACHE_SYSTEMNAME,
+   CORE_INFO_CACHE_SYSTEM_ID,
+   CORE_INFO_CACHE_SUPPORTED_EXTENSIONS,
+   CORE_INFO_CACHE_AUTHORS,
+   CORE_INFO_CACHE_PERMISSIONS,
+   CORE_INFO_CACHE_LICENSES,
+   CORE_INFO_CACHE_CATEGORIES,
+   CORE_INFO_CACHE_DATABASES,
+   CORE_INFO_CACHE_NOTES,
+   CORE_INFO_CACHE_STRING_LAST
+};
+
+enum core_info_cache_flags
+{
+   CORE_INFO_CACHE_FLAG_SUPPORTS_NO_GAME              = (1 << 0),
+   CORE_INFO_CACHE_FLAG_DATABASE_MATCH_ARCHIVE_MEMBER = (1 << 1)
+};
+
+typedef struct
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t count;
+   uint32_t firmware_count;
+   uint32_t strings_size;
+   int64_t dir_mtime;
+} core_info_cache_header_t;
+
+typedef struct
+{
+   int64_t size;
+   int64_t mtime;
+   uint32_t name;
+   uint32_t strings[CORE_INFO_CACHE_STRING_LAST];
+   uint32_t firmware;
+   uint32_t firmware_count;
+   uint32_t flags;
+} core_info_cache_record_t;
+
+typedef struct
+{
+   uint32_t path;
+   uint32_t desc;
+   uint32_t optional;
+} core_info_cache_firmware_t;
+
+typedef struct
+{
+   void *data;
+   const core_info_cache_header_t *header;
+   const core_info_cache_record_t *records;
+   const core_info_cache_firmware_t *firmware;
+   const char *strings;
+} core_info_cache_t;
+
+/* .info file of a core, as it was found while building the list */
+typedef struct
+{
+   const char *name;
+   core_info_t *info;
+   int64_t size;
+   int64_t mtime;
+} core_info_cache_entry_t;
+
+/* Members of core_info_t matching enum core_info_cache_string */
+static const size_t core_info_cache_members[CORE_INFO_CACHE_STRING_LAST] =
+{
+   offsetof(core_info_t, display_name),
+   offsetof(core_info_t, display_version),
+   offsetof(core_info_t, core_name),
+   offsetof(core_info_t, system_manufacturer),
+   offsetof(core_info_t, systemname),
+   offsetof(core_info_t, system_id),
+   offsetof(core_info_t, supported_extensions),
+   offsetof(core_info_t, authors),
+   offsetof(core_info_t, permissions),
+   offsetof(core_info_t, licenses),
+   offsetof(core_info_t, categories),
+   offsetof(core_info_t, databases),
+   offsetof(core_info_t, notes)
+};
+
+/* Keys of the .info files matching enum core_info_cache_string */
+static const char *core_info_cache_keys[CORE_INFO_CACHE_STRING_LAST] =
+{
+   "display_name",
+   "display_version",
+   "corename",
+   "manufacturer",
+   "systemname",
+   "systemid",
+   "supported_extensions",
+   "authors",
+   "permissions",
+   "license",
+   "categories",
+   "database",
+   "notes"
+};
+
+#define CORE_INFO_MEMBER(info, i) \
+   (*(char**)((uint8_t*)(info) + core_info_cache_members[i]))
+
+static void core_info_cache_free(core_info_cache_t *cache)
+{
+   if (!cache)
+      return;
+
+   free(cache->data);
+   free(cache);
+}
+
+static core_info_cache_t *core_info_cache_read(const char *path)
+{
+   int64_t len                    = 0;
+   void *data                     = NULL;
+   core_info_cache_t *cache       = NULL;
+   const core_info_cache_header_t *header;
+   size_t records_size, firmware_size;
+   uint32_t i;
+
+   if (!path_is_valid(path) || !filestream_read_file(path, &data, &len))
+      return NULL;
+
+   header = (const core_info_cache_header_t*)data;
+
+   if (  (size_t)len < sizeof(*header)
+         || memcmp(header->magic, CORE_INFO_CACHE_MAGIC,
+            sizeof(CORE_INFO_CACHE_MAGIC))
+         || header->version != CORE_INFO_CACHE_VERSION)
+      goto error;
+
+   records_size  = header->count * sizeof(core_info_cache_record_t);
+   firmware_size = header->firmware_count * sizeof(core_info_cache_firmware_t);
+
+   if ((uint64_t)len != sizeof(*header) + (uint64_t)records_size
+         + firmware_size + header->strings_size
+         || header->strings_size == 0)
+      goto error;
+
+   cache = (core_info_cache_t*)calloc(1, sizeof(*cache));
+
+   if (!cache)
+      goto error;
+
+   cache->data     = data;
+   cache->header   = header;
+   cache->records  = (const core_info_cache_record_t*)(header + 1);
+   cache->firmware = (const core_info_cache_firmware_t*)
+      (cache->records + header->count);
+   cache->strings  = (const char*)(cache->firmware + header->firmware_count);
+
+   /* Make sure a damaged cache can't point outside of it */
+   if (cache->strings[header->strings_size - 1] != '\0')
+      goto error;
+
+   for (i = 0; i < header->count; i++)
+   {
+      unsigned j;
+      const core_info_cache_record_t *record = &cache->records[i];
+
+      if (record->name >= header->strings_size
+            || record->firmware > header->firmware_count
+            || record->firmware_count > header->firmware_count
+               - record->firmware)
+         goto error;
+
+      for (j = 0; j < CORE_INFO_CACHE_STRING_LAST; j++)
+         if (record->strings[j] >= header->strings_size)
+            goto error;
+   }
+
+   for (i = 0; i < header->firmware_count; i++)
+      if (  cache->firmware[i].path >= header->strings_size
+         || cache->firmware[i].desc >= header->strings_size)
+         goto error;
+
+   return cache;
+
+error:
+   RARCH_WARN("[Core Info]: Ignoring invalid cache \"%s\".\n", path);
+   free(cache);
+   free(data);
+   return NULL;
+}
+
+static const core_info_cache_record_t *core_info_cache_find(
+      const core_info_cache_t *cache, const char *name)
+{
+   size_t lo = 0;
+   size_t hi = cache ? cache->header->count : 0;
+
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+      int cmp    = strcmp(name,
+            cache->strings + cache->records[mid].name);
+
+      if (cmp == 0)
+         return &cache->records[mid];
+      if (cmp < 0)
+         hi = mid;
+      else
+         lo = mid + 1;
+   }
+
+   return NULL;
+}
+
+static char *core_info_cache_strdup(const core_info_cache_t *cache,
+      uint32_t offset)
+{
+   return offset ? strdup(cache->strings + offset) : NULL;
+}
+
+static void core_info_cache_load(const core_info_cache_t *cache,
+      const core_info_cache_record_t *record, core_info_t *info)
+{
+   unsigned i;
+
+   for (i = 0; i < CORE_INFO_CACHE_STRING_LAST; i++)
+      CORE_INFO_MEMBER(info, i) =
+         core_info_cache_strdup(cache, record->strings[i]);
+
+   info->supports_no_game              = !!(record->flags
+         & CORE_INFO_CACHE_FLAG_SUPPORTS_NO_GAME);
+   info->database_match_archive_member = !!(record->flags
+         & CORE_INFO_CACHE_FLAG_DATABASE_MATCH_ARCHIVE_MEMBER);
+   info->firmware_count                = record->firmware_count;
+
+   if (record->firmware_count)
+   {
+      info->firmware = (core_info_firmware_t*)
+         calloc(record->firmware_count, sizeof(*info->firmware));
+
+      if (!info->firmware)
+      {
+         info->firmware_count = 0;
+         return;
+      }
+
+      for (i = 0; i < record->firmware_count; i++)
+      {
+         const core_info_cache_firmware_t *firmware =
+            &cache->firmware[record->firmware + i];
+
+         info->firmware[i].path     =
+            core_info_cache_strdup(cache, firmware->path);
+         info->firmware[i].desc     =
+            core_info_cache_strdup(cache, firmware->desc);
+         info->firmware[i].optional = !!firmware->optional;
+      }
+   }
+}
+
+/* Growable buffer used to build the cache */
+typedef struct
+{
+   uint8_t *data;
+   size_t size;
+   size_t capacity;
+} core_info_cache_buffer_t;
+
+static bool core_info_cache_buffer_append(core_info_cache_buffer_t *buffer,
+      const void *data, size_t size)
+{
+   if (buffer->size + size > buffer->capacity)
+   {
+      size_t capacity = buffer->capacity ? buffer->capacity : 4096;
+      uint8_t *tmp;
+
+      while (buffer->size + size > capacity)
+         capacity <<= 1;
+
+      if (!(tmp = (uint8_t*)realloc(buffer->data, capacity)))
+         return false;
+
+      buffer->data     = tmp;
+      buffer->capacity = capacity;
+   }
+
+   memcpy(buffer->data + buffer->size, data, size);
+   buffer->size += size;
+   return true;
+}
+
+static uint32_t core_info_cache_add_string(core_info_cache_buffer_t *strings,
+      const char *str)
+{
+   uint32_t offset = (uint32_t)strings->size;
+
+   if (!str)
+      return 0;
+
+   if (!core_info_cache_buffer_append(strings, str, strlen(str) + 1))
+      return 0;
+
+   return offset;
+}
+
+static int core_info_cache_entry_cmp(const void *a_, const void *b_)
+{
+   const core_info_cache_entry_t *a = (const core_info_cache_entry_t*)a_;
+   const core_info_cache_entry_t *b = (const core_info_cache_entry_t*)b_;
+   return strcmp(a->name, b->name);
+}
+
+/* @entries have to be sorted by name */
+static void core_info_cache_write(const char *path, int64_t dir_mtime,
+      const core_info_cache_entry_t *entries, size_t count)
+{
+   size_t i;
+   RFILE *file                        = NULL;
+   core_info_cache_header_t header    = {{0}};
+   core_info_cache_buffer_t records   = {0};
+   core_info_cache_buffer_t firmware  = {0};
+   core_info_cache_buffer_t strings   = {0};
+
+   /* Offset 0 is the NULL string */
+   if (!core_info_cache_buffer_append(&strings, "", 1))
+      goto end;
+
+   for (i = 0; i < count; i++)
+   {
+      unsigned j;
+      core_info_cache_record_t record;
+      const core_info_t *info = entries[i].info;
+
+      /* Cores sharing an .info file share a record */
+      if (i > 0 && string_is_equal(entries[i - 1].name, entries[i].name))
+         continue;
+
+      memset(&record, 0, sizeof(record));
+      record.size           = entries[i].size;
+      record.mtime          = entries[i].mtime;
+      record.name           = core_info_cache_add_string(&strings,
+            entries[i].name);
+      record.firmware       = (uint32_t)(firmware.size
+            / sizeof(core_info_cache_firmware_t));
+      record.firmware_count = (uint32_t)info->firmware_count;
+
+      for (j = 0; j < CORE_INFO_CACHE_STRING_LAST; j++)
+         record.strings[j]  = core_info_cache_add_string(&strings,
+               CORE_INFO_MEMBER(info, j));
+
+      if (info->supports_no_game)
+         record.flags      |= CORE_INFO_CACHE_FLAG_SUPPORTS_NO_GAME;
+      if (info->database_match_archive_member)
+         record.flags      |= CORE_INFO_CACHE_FLAG_DATABASE_MATCH_ARCHIVE_MEMBER;
+
+      for (j = 0; j < info->firmware_count; j++)
+      {
+         core_info_cache_firmware_t entry;
+
+         entry.path     = core_info_cache_add_string(&strings,
+               info->firmware[j].path);
+         entry.desc     = core_info_cache_add_string(&strings,
+               info->firmware[j].desc);
+         entry.optional = info->firmware[j].optional;
+
+         if (!core_info_cache_buffer_append(&firmware, &entry, sizeof(entry)))
+            goto end;
+      }
+
+      if (!record.name
+            || !core_info_cache_buffer_append(&records, &record, sizeof(record)))
+         goto end;
+   }
+
+   memcpy(header.magic, CORE_INFO_CACHE_MAGIC, sizeof(CORE_INFO_CACHE_MAGIC));
+   header.version        = CORE_INFO_CACHE_VERSION;
+   header.count          = (uint32_t)(records.size
+         / sizeof(core_info_cache_record_t));
+   header.firmware_count = (uint32_t)(firmware.size
+         / sizeof(core_info_cache_firmware_t));
+   header.strings_size   = (uint32_t)strings.size;
+   header.dir_mtime      = dir_mtime;
+
+   /* The info directory may well be read-only */
+   if (!(file = filestream_open(path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      goto end;
+
+   filestream_write(file, &header, sizeof(header));
+   filestream_write(file, records.data, records.size);
+   filestream_write(file, firmware.data, firmware.size);
+   filestream_write(file, strings.data, strings.size);
+   filestream_close(file);
+
+end:
+   free(records.data);
+   free(firmware.data);
+   free(strings.data);
+}
+
+static void core_info_split_lists(core_info_t *info)
+{
+   if (info->supported_extensions)
+      info->supported_extensions_list =
+         string_split(info->supported_extensions, "|");
+   if (info->authors)
+      info->authors_list     = string_split(info->authors, "|");
+   if (info->permissions)
+      info->permissions_list = string_split(info->permissions, "|");
+   if (info->licenses)
+      info->licenses_list    = string_split(info->licenses, "|");
+   if (info->categories)
+      info->categories_list  = string_split(info->categories, "|");
+   if (info->databases)
+      info->databases_list   = string_split(info->databases, "|");
+   if (info->notes)
+      info->note_list        = string_split(info->notes, "|");
+}
+
+static void core_info_parse_config(core_info_t *info, config_file_t *conf)
+{
+   unsigned i;
+   unsigned count = 0;
+   bool tmp_bool  = false;
+
+   for (i = 0; i < CORE_INFO_CACHE_STRING_LAST; i++)
+   {
+      char *tmp = NULL;
+
+      if (config_get_string(conf, core_info_cache_keys[i], &tmp)
+            && !string_is_empty(tmp))
+      {
+         CORE_INFO_MEMBER(info, i) = tmp;
+         continue;
+      }
+
+      free(tmp);
+   }
+
+   if (config_get_bool(conf, "supports_no_game", &tmp_bool))
+      info->supports_no_game = tmp_bool;
+
+   if (config_get_bool(conf, "database_match_archive_member", &tmp_bool))
+      info->database_match_archive_member = tmp_bool;
+
+   if (!config_get_uint(conf, "firmware_count", &count) || !count)
+      return;
+
+   info->firmware = (core_info_firmware_t*)
+      calloc(count, sizeof(*info->firmware));
+
+   if (!info->firmware)
+      return;
+
+   info->firmware_count = count;
+
+   for (i = 0; i < count; i++)
+   {
+      char path_key[64];
+      char desc_key[64];
+      char opt_key[64];
+      char *tmp         = NULL;
+      path_key[0]       = desc_key[0] = opt_key[0] = '\0';
+
+      snprintf(path_key, sizeof(path_key), "firmware%u_path", i);
+      snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", i);
+      snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  i);
+
+      if (config_get_string(conf, path_key, &tmp) && !string_is_empty(tmp))
+      {
+         info->firmware[i].path = tmp;
+         tmp = NULL;
+      }
+      free(tmp);
+      tmp = NULL;
+      if (config_get_string(conf, desc_key, &tmp) && !string_is_empty(tmp))
+      {
+         info->firmware[i].desc = tmp;
+         tmp = NULL;
+      }
+      free(tmp);
+      if (config_get_bool(conf, opt_key, &tmp_bool))
+         info->firmware[i].optional = tmp_bool;
+   }
+}
+
 static void core_info_list_resolve_all_extensions(
       core_info_list_t *core_info_list)
 {
@@ -81,61 +586,109 @@ static void core_info_list_resolve_all_extensions(
 #endif
 }
 
-static void core_info_list_resolve_all_firmware(
+/* Extensions are matched like string_list_find_elem_prefix
+ * with a "." prefix, ignoring the case and a leading dot. */
+static const char *core_info_ext_key(const char *ext)
+{
+   return (*ext == '.') ? ext + 1 : ext;
+}
+
+static int core_info_ext_cmp(const void *a_, const void *b_)
+{
+   const core_info_ext_t *a = (const core_info_ext_t*)a_;
+   const core_info_ext_t *b = (const core_info_ext_t*)b_;
+   int cmp                  = strcasecmp(a->ext, b->ext);
+
+   if (cmp)
+      return cmp;
+   return (a->core > b->core) - (a->core < b->core);
+}
+
+static void core_info_list_resolve_ext_index(
       core_info_list_t *core_info_list)
 {
-   size_t i;
-   unsigned c;
+   size_t i, j;
+   size_t count = 0;
 
    for (i = 0; i < core_info_list->count; i++)
-   {
-      unsigned count                  = 0;
-      core_info_firmware_t *firmware  = NULL;
-      core_info_t *info               = (core_info_t*)&core_info_list->list[i];
-      config_file_t *config           = (config_file_t*)info->config_data;
+      if (core_info_list->list[i].supported_extensions_list)
+         count += core_info_list->list[i].supported_extensions_list->size;
 
-      if (!config || !config_get_uint(config, "firmware_count", &count))
-         continue;
+   if (!count)
+      return;
 
-      firmware = (core_info_firmware_t*)calloc(count, sizeof(*firmware));
+   core_info_list->ext_index = (core_info_ext_t*)
+      malloc(count * sizeof(*core_info_list->ext_index));
 
-      if (!firmware)
-         continue;
+   if (!core_info_list->ext_index)
+      return;
 
-      info->firmware = firmware;
+   for (i = 0; i < core_info_list->count; i++)
+   {
+      const struct string_list *exts =
+         core_info_list->list[i].supported_extensions_list;
 
-      for (c = 0; c < count; c++)
+      if (!exts)
+         continue;
+
+      for (j = 0; j < exts->size; j++)
       {
-         char path_key[64];
-         char desc_key[64];
-         char opt_key[64];
-         bool tmp_bool     = false;
-         char *tmp         = NULL;
-         path_key[0]       = desc_key[0] = opt_key[0] = '\0';
-
-         snprintf(path_key, sizeof(path_key), "firmware%u_path", c);
-         snprintf(desc_key, sizeof(desc_key), "firmware%u_desc", c);
-         snprintf(opt_key,  sizeof(opt_key),  "firmware%u_opt",  c);
-
-         if (config_get_string(config, path_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].path = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(config, desc_key, &tmp) && !string_is_empty(tmp))
-         {
-            info->firmware[c].desc = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (tmp)
-            free(tmp);
-         tmp = NULL;
-         if (config_get_bool(config, opt_key , &tmp_bool))
-            info->firmware[c].optional = tmp_bool;
+         core_info_ext_t *entry = &core_info_list->ext_index[
+            core_info_list->ext_count];
+
+         if (string_is_empty(exts->elems[j].data))
+            continue;
+
+         entry->ext  = core_info_ext_key(exts->elems[j].data);
+         entry->core = i;
+         core_info_list->ext_count++;
       }
    }
+
+   qsort(core_info_list->ext_index, core_info_list->ext_count,
+         sizeof(*core_info_list->ext_index), core_info_ext_cmp);
+}
+
+/* Flags the cores supporting the extension of @path */
+static void core_info_list_mark_supported(
+      const core_info_list_t *core_info_list,
+      const char *path, uint8_t *supported)
+{
+   size_t lo, hi;
+   const char *ext = NULL;
+
+   if (string_is_empty(path))
+      return;
+
+   ext = path_get_extension(path);
+
+   if (string_is_empty(ext))
+      return;
+
+   ext = core_info_ext_key(ext);
+   lo  = 0;
+   hi  = core_info_list->ext_count;
+
+   /* Lower bound of the extension */
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (strcasecmp(core_info_list->ext_index[mid].ext, ext) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   for (; lo < core_info_list->ext_count; lo++)
+   {
+      const core_info_ext_t *entry = &core_info_list->ext_index[lo];
+
+      if (strcasecmp(entry->ext, ext))
+         break;
+
+      supported[entry->core] = 1;
+   }
 }
 
 static void core_info_list_free(core_info_list_t *core_info_list)
@@ -170,7 +723,6 @@ static void core_info_list_free(core_info_list_t *core_info_list)
       string_list_free(info->licenses_list);
       string_list_free(info->categories_list);
       string_list_free(info->databases_list);
-      config_file_free((config_file_t*)info->config_data);
 
       for (j = 0; j < info->firmware_count; j++)
       {
@@ -181,29 +733,25 @@ static void core_info_list_free(core_info_list_t *core_info_list)
    }
 
    free(core_info_list->all_ext);
+   free(core_info_list->ext_index);
+   free(core_info_list->supported);
    free(core_info_list->list);
    free(core_info_list);
 }
 
-static config_file_t *core_info_list_iterate(
+/* Fills @info_path with the path of the .info file of a core */
+static void core_info_get_info_path(
       const char *current_path,
-      const char *path_basedir)
+      const char *path_basedir,
+      char *info_path, size_t info_path_size)
 {
-   size_t info_path_base_size = PATH_MAX_LENGTH * sizeof(char);
-   char *info_path_base       = NULL;
-   char *info_path            = NULL;
-   config_file_t *conf        = NULL;
-
-   if (!current_path)
-      return NULL;
-
-   info_path_base             = (char*)malloc(info_path_base_size);
+   char *info_path_base       = (char*)malloc(info_path_size);
 
    info_path_base[0] = '\0';
 
    fill_pathname_base_noext(info_path_base,
          current_path,
-         info_path_base_size);
+         info_path_size);
 
 #if defined(RARCH_MOBILE) || (defined(RARCH_CONSOLE) && !defined(PSP) && !defined(_3DS) && !defined(VITA) && !defined(PS2) && !defined(HW_WUP))
    {
@@ -215,14 +763,28 @@ static config_file_t *core_info_list_iterate(
 
    strlcat(info_path_base,
          file_path_str(FILE_PATH_CORE_INFO_EXTENSION),
-         info_path_base_size);
+         info_path_size);
 
-   info_path = (char*)malloc(info_path_base_size);
    fill_pathname_join(info_path,
          path_basedir,
-         info_path_base, info_path_base_size);
+         info_path_base, info_path_size);
    free(info_path_base);
-   info_path_base = NULL;
+}
+
+static config_file_t *core_info_list_iterate(
+      const char *current_path,
+      const char *path_basedir)
+{
+   size_t info_path_size      = PATH_MAX_LENGTH * sizeof(char);
+   char *info_path            = NULL;
+   config_file_t *conf        = NULL;
+
+   if (!current_path)
+      return NULL;
+
+   info_path = (char*)malloc(info_path_size);
+   core_info_get_info_path(current_path, path_basedir,
+         info_path, info_path_size);
 
    if (path_is_valid(info_path))
       conf = config_file_new(info_path);
@@ -241,6 +803,15 @@ static core_info_list_t *core_info_list_new(const char *path,
    core_info_list_t *core_info_list = NULL;
    const char       *path_basedir   = libretro_info_dir;
    struct string_list *contents     = string_list_new();
+   core_info_cache_t *cache         = NULL;
+   core_info_cache_entry_t *entries = NULL;
+   size_t num_entries               = 0;
+   bool cache_dirty                 = false;
+   int64_t dir_size                 = 0;
+   int64_t dir_mtime                = 0;
+   size_t info_path_size            = PATH_MAX_LENGTH * sizeof(char);
+   char *info_path                  = NULL;
+   char *cache_path                 = NULL;
    bool                          ok = dir_list_append(contents, path, exts,
          false, dir_show_hidden_files, false, false);
 
@@ -279,179 +850,116 @@ static core_info_list_t *core_info_list_new(const char *path,
       return NULL;
    }
 
-   core_info_list->list  = core_info;
-   core_info_list->count = contents->size;
-
-   for (i = 0; i < contents->size; i++)
-   {
-      const char *path      = contents->elems[i].data;
-      config_file_t *conf   = core_info_list_iterate(path,
-            path_basedir);
-
-      if (conf)
-      {
-         char *tmp           = NULL;
-
-         if (config_get_string(conf, "display_name", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].display_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(conf, "display_version", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].display_version = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-         if (config_get_string(conf, "corename", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].core_name = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "systemname", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].systemname = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "systemid", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].system_id = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
+   core_info_list->list      = core_info;
+   core_info_list->count     = contents->size;
+   core_info_list->supported = (core_info_t*)calloc(
+         contents->size ? contents->size : 1, sizeof(*core_info));
 
-         if (config_get_string(conf, "manufacturer", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].system_manufacturer = strdup(tmp);
-            free(tmp);
-            tmp = NULL;
-         }
+   info_path  = (char*)malloc(info_path_size);
+   cache_path = (char*)malloc(info_path_size);
+   entries    = (core_info_cache_entry_t*)calloc(
+         contents->size ? contents->size : 1, sizeof(*entries));
 
-         {
-            unsigned count      = 0;
-            config_get_uint(conf, "firmware_count", &count);
-            core_info[i].firmware_count = count;
-         }
+   fill_pathname_join(cache_path, path_basedir,
+         file_path_str(FILE_PATH_CORE_INFO_CACHE), info_path_size);
 
-         if (config_get_string(conf, "supported_extensions", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].supported_extensions      = strdup(tmp);
-            core_info[i].supported_extensions_list =
-               string_split(core_info[i].supported_extensions, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
-
-         if (config_get_string(conf, "authors", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].authors      = strdup(tmp);
-            core_info[i].authors_list =
-               string_split(core_info[i].authors, "|");
+   /* Without a directory timestamp nothing can be validated */
+   if (path_get_size_mtime(path_basedir, &dir_size, &dir_mtime))
+      cache = core_info_cache_read(cache_path);
+   else
+   {
+      free(entries);
+      entries = NULL;
+   }
 
-            free(tmp);
-            tmp = NULL;
-         }
+   for (i = 0; i < contents->size; i++)
+   {
+      int64_t size          = 0;
+      int64_t mtime         = 0;
+      bool cacheable        = false;
+      const char *path      = contents->elems[i].data;
 
-         if (config_get_string(conf, "permissions", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].permissions      = strdup(tmp);
-            core_info[i].permissions_list =
-               string_split(core_info[i].permissions, "|");
+      if (!string_is_empty(path))
+         core_info[i].path = strdup(path);
 
-            free(tmp);
-            tmp = NULL;
-         }
+      core_info_get_info_path(path, path_basedir,
+            info_path, info_path_size);
 
-         if (config_get_string(conf, "license", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].licenses      = strdup(tmp);
-            core_info[i].licenses_list =
-               string_split(core_info[i].licenses, "|");
+      cacheable = entries
+         && path_get_size_mtime(info_path, &size, &mtime);
 
-            free(tmp);
-            tmp = NULL;
-         }
+      if (cacheable)
+      {
+         const core_info_cache_record_t *record =
+            core_info_cache_find(cache, path_basename(info_path));
 
-         if (config_get_string(conf, "categories", &tmp)
-               && !string_is_empty(tmp))
+         if (record && record->size == size && record->mtime == mtime)
          {
-            core_info[i].categories      = strdup(tmp);
-            core_info[i].categories_list =
-               string_split(core_info[i].categories, "|");
-
-            free(tmp);
-            tmp = NULL;
+            core_info_cache_load(cache, record, &core_info[i]);
+            core_info[i].has_info = true;
          }
+      }
 
-         if (config_get_string(conf, "database", &tmp)
-               && !string_is_empty(tmp))
-         {
-            core_info[i].databases      = strdup(tmp);
-            core_info[i].databases_list =
-               string_split(core_info[i].databases, "|");
-
-            free(tmp);
-            tmp = NULL;
-         }
+      if (!core_info[i].has_info && path_is_valid(info_path))
+      {
+         config_file_t *conf = config_file_new(info_path);
 
-         if (config_get_string(conf, "notes", &tmp)
-               && !string_is_empty(tmp))
+         if (conf)
          {
-            core_info[i].notes     = strdup(tmp);
-            core_info[i].note_list = string_split(core_info[i].notes, "|");
-
-            free(tmp);
-            tmp = NULL;
+            core_info_parse_config(&core_info[i], conf);
+            core_info[i].has_info = true;
+            cache_dirty          |= cacheable;
+            config_file_free(conf);
          }
+      }
 
-         if (tmp)
-            free(tmp);
-         tmp    = NULL;
-
-         {
-            bool tmp_bool       = false;
-            if (config_get_bool(conf, "supports_no_game",
-                     &tmp_bool))
-               core_info[i].supports_no_game = tmp_bool;
-
-            if (config_get_bool(conf, "database_match_archive_member",
-                     &tmp_bool))
-               core_info[i].database_match_archive_member = tmp_bool;
-         }
+      if (cacheable && core_info[i].has_info)
+      {
+         core_info_cache_entry_t *entry = &entries[num_entries++];
 
-         core_info[i].config_data = conf;
+         entry->name  = strdup(path_basename(info_path));
+         entry->info  = &core_info[i];
+         entry->size  = size;
+         entry->mtime = mtime;
       }
 
-      if (!string_is_empty(path))
-         core_info[i].path = strdup(path);
+      core_info_split_lists(&core_info[i]);
 
       if (!core_info[i].display_name)
          core_info[i].display_name =
             strdup(path_basename(core_info[i].path));
    }
 
-   if (core_info_list)
+   if (entries)
    {
-      core_info_list_resolve_all_extensions(core_info_list);
-      core_info_list_resolve_all_firmware(core_info_list);
+      size_t num_records = 0;
+
+      qsort(entries, num_entries, sizeof(*entries),
+            core_info_cache_entry_cmp);
+
+      for (i = 0; i < num_entries; i++)
+         if (i == 0 || !string_is_equal(entries[i - 1].name, entries[i].name))
+            num_records++;
+
+      /* Also drop the records of .info files that went away */
+      if (  cache_dirty
+            || !cache
+            || cache->header->count != num_records
+            || cache->header->dir_mtime != dir_mtime)
+         core_info_cache_write(cache_path, dir_mtime, entries, num_entries);
+
+      for (i = 0; i < num_entries; i++)
+         free((char*)entries[i].name);
+      free(entries);
    }
 
+   core_info_cache_free(cache);
+   free(info_path);
+   free(cache_path);
+
+   core_info_list_resolve_all_extensions(core_info_list);
+   core_info_list_resolve_ext_index(core_info_list);
+
    string_list_free(contents);
    return core_info_list;
 }
@@ -484,47 +992,11 @@ static bool core_info_list_get_info(core_info_list_t *core_info_list,
    return false;
 }
 
-static bool core_info_does_support_any_file(const core_info_t *core,
-      const struct string_list *list)
-{
-   size_t i;
-   if (!list || !core || !core->supported_extensions_list)
-      return false;
-
-   for (i = 0; i < list->size; i++)
-      if (string_list_find_elem_prefix(core->supported_extensions_list,
-               ".", path_get_extension(list->elems[i].data)))
-         return true;
-   return false;
-}
-
-static bool core_info_does_support_file(
-      const core_info_t *core, const char *path)
-{
-   if (!core || !core->supported_extensions_list)
-      return false;
-   if (string_is_empty(path))
-      return false;
-
-   return string_list_find_elem_prefix(
-         core->supported_extensions_list, ".", path_get_extension(path));
-}
-
-/* qsort_r() is not in standard C, sadly. */
-
 static int core_info_qsort_cmp(const void *a_, const void *b_)
 {
    const core_info_t *a = (const core_info_t*)a_;
    const core_info_t *b = (const core_info_t*)b_;
-   int support_a        =
-         core_info_does_support_any_file(a, core_info_tmp_list)
-      || core_info_does_support_file(a, core_info_tmp_path);
-   int support_b        =
-         core_info_does_support_any_file(b, core_info_tmp_list)
-      || core_info_does_support_file(b, core_info_tmp_path);
-
-   if (support_a != support_b)
-      return support_b - support_a;
+
    return strcasecmp(a->display_name, b->display_name);
 }
 
@@ -702,44 +1174,50 @@ void core_info_list_get_supported_cores(core_info_list_t *core_info_list,
       const char *path, const core_info_t **infos, size_t *num_infos)
 {
    size_t i;
-   struct string_list *list = NULL;
+   uint8_t *supported_cores = NULL;
    size_t supported         = 0;
 
    if (!core_info_list)
       return;
 
-   core_info_tmp_path = path;
-
-#ifdef HAVE_COMPRESSION
-   if (path_is_compressed_file(path))
-      list = file_archive_get_file_list(path, NULL);
-   core_info_tmp_list = list;
-#endif
+   supported_cores = (uint8_t*)calloc(
+         core_info_list->count ? core_info_list->count : 1, 1);
 
-   /* Let supported core come first in list so we can return
-    * a pointer to them. */
-   qsort(core_info_list->list, core_info_list->count,
-         sizeof(core_info_t), core_info_qsort_cmp);
-
-   for (i = 0; i < core_info_list->count; i++, supported++)
+   if (!supported_cores || !core_info_list->supported)
    {
-      const core_info_t *core = &core_info_list->list[i];
+      free(supported_cores);
+      *infos     = core_info_list->supported;
+      *num_infos = 0;
+      return;
+   }
 
-      if (core_info_does_support_file(core, path))
-         continue;
+   core_info_list_mark_supported(core_info_list, path, supported_cores);
 
 #ifdef HAVE_COMPRESSION
-      if (core_info_does_support_any_file(core, list))
-         continue;
-#endif
+   if (path_is_compressed_file(path))
+   {
+      struct string_list *list = file_archive_get_file_list(path, NULL);
 
-      break;
+      if (list)
+      {
+         for (i = 0; i < list->size; i++)
+            core_info_list_mark_supported(core_info_list,
+                  list->elems[i].data, supported_cores);
+         string_list_free(list);
+      }
    }
+#endif
+
+   for (i = 0; i < core_info_list->count; i++)
+      if (supported_cores[i])
+         core_info_list->supported[supported++] = core_info_list->list[i];
 
-   if (list)
-      string_list_free(list);
+   free(supported_cores);
 
-   *infos     = core_info_list->list;
+   qsort(core_info_list->supported, supported,
+         sizeof(core_info_t), core_info_qsort_cmp);
+
+   *infos     = core_info_list->supported;
    *num_infos = supported;
 }
 
@@ -797,11 +1275,7 @@ size_t core_info_list_num_info_files(core_info_list_t *core_info_list)
       return 0;
 
    for (i = 0; i < core_info_list->count; i++)
-   {
-      config_file_t *conf = (config_file_t*)
-         core_info_list->list[i].config_data;
-      num += !!conf;
-   }
+      num += core_info_list->list[i].has_info;
 
    return num;
 }
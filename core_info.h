@@ -39,9 +39,10 @@ typedef struct
 {
    bool supports_no_game;
    bool database_match_archive_member;
+   /* Whether an .info file was found for this core */
+   bool has_info;
    size_t firmware_count;
    char *path;
-   void *config_data;
    char *display_name;
    char *display_version;
    char *core_name;
@@ -66,11 +67,25 @@ typedef struct
    void *userdata;
 } core_info_t;
 
+/* Entry of the reverse index from supported extensions
+ * to the cores in a core_info_list_t */
+typedef struct
+{
+   const char *ext;
+   size_t core;
+} core_info_ext_t;
+
 typedef struct
 {
    core_info_t *list;
    size_t count;
    char *all_ext;
+   /* Sorted by extension, case insensitively */
+   core_info_ext_t *ext_index;
+   size_t ext_count;
+   /* Backing store of core_info_list_get_supported_cores,
+    * overwritten by every call */
+   core_info_t *supported;
 } core_info_list_t;
 
 typedef struct core_info_ctx_firmware
@@ -90,7 +105,21 @@ typedef struct core_info_ctx_find
 
 size_t core_info_list_num_info_files(core_info_list_t *list);
 
-/* Non-reentrant, does not allocate. Returns pointer to internal state. */
+/**
+ * core_info_list_get_supported_cores:
+ * @list                 : Core info list.
+ * @path                 : Content path.
+ * @infos                : Set to the cores supporting @path, sorted
+ *                         by display name.
+ * @num_infos            : Set to the number of entries in @infos.
+ *
+ * Non-reentrant, does not allocate. @infos points to storage owned
+ * by @list and holds shallow copies of its entries: the array is
+ * overwritten by the next call on the same list and freed by
+ * core_info_list_free. Callers must copy whatever they need before
+ * looking up supported cores again; the strings inside stay valid
+ * for as long as @list does.
+ **/
 void core_info_list_get_supported_cores(core_info_list_t *list,
       const char *path, const core_info_t **infos, size_t *num_infos);
 
@@ -17,6 +17,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 
 #include <compat/strl.h>
 #include <retro_endianness.h>
@@ -148,30 +149,63 @@ char *bin_to_hex_alloc(const uint8_t *data, size_t len)
    return ret;
 }
 
-static int database_cursor_iterate(libretrodb_cursor_t *cur,
-      database_info_t *db_info)
+/* Copies a string of a record, into @strings when set */
+static char *database_info_strdup(rmsgpack_dom_arena_t *strings,
+      const struct rmsgpack_dom_value *val)
 {
-   unsigned i;
-   struct rmsgpack_dom_value item;
-   const char* str                = NULL;
+   char *s = NULL;
 
-   if (libretrodb_cursor_read_item(cur, &item) != 0)
-      return -1;
+   if (!strings)
+      return strdup(val->val.string.buff);
 
-   if (item.type != RDT_MAP)
+   if ((s = (char*)rmsgpack_dom_arena_alloc(strings,
+               val->val.string.len + 1)))
    {
-      rmsgpack_dom_value_free(&item);
-      return 1;
+      memcpy(s, val->val.string.buff, val->val.string.len);
+      s[val->val.string.len] = '\0';
+   }
+
+   return s;
+}
+
+static char *database_info_hex(rmsgpack_dom_arena_t *strings,
+      const struct rmsgpack_dom_value *val)
+{
+   size_t i;
+   char *s = NULL;
+
+   if (!strings)
+      return bin_to_hex_alloc((uint8_t*)val->val.binary.buff,
+            val->val.binary.len);
+
+   if ((s = (char*)rmsgpack_dom_arena_alloc(strings,
+               val->val.binary.len * 2 + 1)))
+   {
+      for (i = 0; i < val->val.binary.len; i++)
+         snprintf(s + i * 2, 3, "%02X", (uint8_t)val->val.binary.buff[i]);
+      s[val->val.binary.len * 2] = '\0';
    }
 
+   return s;
+}
+
+static int database_info_from_item(const struct rmsgpack_dom_value *item,
+      database_info_t *db_info, rmsgpack_dom_arena_t *strings)
+{
+   unsigned i;
+   const char* str                = NULL;
+
+   if (item->type != RDT_MAP)
+      return 1;
+
    db_info->analog_supported       = -1;
    db_info->rumble_supported       = -1;
    db_info->coop_supported         = -1;
 
-   for (i = 0; i < item.val.map.len; i++)
+   for (i = 0; i < item->val.map.len; i++)
    {
-      struct rmsgpack_dom_value *key = &item.val.map.items[i].key;
-      struct rmsgpack_dom_value *val = &item.val.map.items[i].value;
+      struct rmsgpack_dom_value *key = &item->val.map.items[i].key;
+      struct rmsgpack_dom_value *val = &item->val.map.items[i].value;
       const char *val_string         = NULL;
 
       if (!key || !val)
@@ -183,7 +217,7 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       if (string_is_equal(str, "publisher"))
       {
          if (!string_is_empty(val_string))
-            db_info->publisher = strdup(val_string);
+            db_info->publisher = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "developer"))
       {
@@ -193,72 +227,72 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       else if (string_is_equal(str, "serial"))
       {
          if (!string_is_empty(val_string))
-            db_info->serial = strdup(val_string);
+            db_info->serial = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "rom_name"))
       {
          if (!string_is_empty(val_string))
-            db_info->rom_name = strdup(val_string);
+            db_info->rom_name = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "name"))
       {
          if (!string_is_empty(val_string))
-            db_info->name = strdup(val_string);
+            db_info->name = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "description"))
       {
          if (!string_is_empty(val_string))
-            db_info->description = strdup(val_string);
+            db_info->description = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "genre"))
       {
          if (!string_is_empty(val_string))
-            db_info->genre = strdup(val_string);
+            db_info->genre = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "origin"))
       {
          if (!string_is_empty(val_string))
-            db_info->origin = strdup(val_string);
+            db_info->origin = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "franchise"))
       {
          if (!string_is_empty(val_string))
-            db_info->franchise = strdup(val_string);
+            db_info->franchise = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "bbfc_rating"))
       {
          if (!string_is_empty(val_string))
-            db_info->bbfc_rating = strdup(val_string);
+            db_info->bbfc_rating = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "esrb_rating"))
       {
          if (!string_is_empty(val_string))
-            db_info->esrb_rating = strdup(val_string);
+            db_info->esrb_rating = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "elspa_rating"))
       {
          if (!string_is_empty(val_string))
-            db_info->elspa_rating = strdup(val_string);
+            db_info->elspa_rating = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "cero_rating"))
       {
          if (!string_is_empty(val_string))
-            db_info->cero_rating          = strdup(val_string);
+            db_info->cero_rating          = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "pegi_rating"))
       {
          if (!string_is_empty(val_string))
-            db_info->pegi_rating          = strdup(val_string);
+            db_info->pegi_rating          = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "enhancement_hw"))
       {
          if (!string_is_empty(val_string))
-            db_info->enhancement_hw       = strdup(val_string);
+            db_info->enhancement_hw       = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "edge_review"))
       {
          if (!string_is_empty(val_string))
-            db_info->edge_magazine_review = strdup(val_string);
+            db_info->edge_magazine_review = database_info_strdup(strings, val);
       }
       else if (string_is_equal(str, "edge_rating"))
          db_info->edge_magazine_rating    = (unsigned)val->val.uint_;
@@ -283,25 +317,50 @@ static int database_cursor_iterate(libretrodb_cursor_t *cur,
       else if (string_is_equal(str, "size"))
          db_info->size                    = (unsigned)val->val.uint_;
       else if (string_is_equal(str, "crc"))
-         db_info->crc32 = swap_if_little32(
-               *(uint32_t*)val->val.binary.buff);
+      {
+         uint32_t crc32 = 0;
+         if (val->val.binary.len == sizeof(crc32))
+            memcpy(&crc32, val->val.binary.buff, sizeof(crc32));
+         db_info->crc32 = swap_if_little32(crc32);
+      }
       else if (string_is_equal(str, "sha1"))
-         db_info->sha1 = bin_to_hex_alloc(
-               (uint8_t*)val->val.binary.buff, val->val.binary.len);
+         db_info->sha1 = database_info_hex(strings, val);
       else if (string_is_equal(str, "md5"))
-         db_info->md5 = bin_to_hex_alloc(
-               (uint8_t*)val->val.binary.buff, val->val.binary.len);
+         db_info->md5 = database_info_hex(strings, val);
       else
       {
          RARCH_LOG("Unknown key: %s\n", str);
       }
    }
 
-   rmsgpack_dom_value_free(&item);
-
    return 0;
 }
 
+static int database_cursor_iterate(libretrodb_cursor_t *cur,
+      database_info_t *db_info, rmsgpack_dom_arena_t *strings)
+{
+   int ret;
+   struct rmsgpack_dom_value item;
+
+   /* Records are only borrowed until they're converted */
+   if (strings)
+   {
+      if (libretrodb_cursor_read_item_view(cur, &item) != 0)
+         return -1;
+
+      ret = database_info_from_item(&item, db_info, strings);
+      libretrodb_cursor_release_views(cur);
+      return ret;
+   }
+
+   if (libretrodb_cursor_read_item(cur, &item) != 0)
+      return -1;
+
+   ret = database_info_from_item(&item, db_info, NULL);
+   rmsgpack_dom_value_free(&item);
+   return ret;
+}
+
 static int database_cursor_open(libretrodb_t *db,
       libretrodb_cursor_t *cur, const char *path, const char *query)
 {
@@ -439,6 +498,54 @@ void database_info_free(database_info_handle_t *db)
    string_list_free(db->list);
 }
 
+static void database_info_entry_free(database_info_t *info,
+      bool free_strings)
+{
+   if (info->developer)
+      string_list_free(info->developer);
+   info->developer = NULL;
+
+   /* Everything else lives in the list's arena */
+   if (!free_strings)
+      return;
+
+   if (info->name)
+      free(info->name);
+   if (info->rom_name)
+      free(info->rom_name);
+   if (info->serial)
+      free(info->serial);
+   if (info->genre)
+      free(info->genre);
+   if (info->description)
+      free(info->description);
+   if (info->publisher)
+      free(info->publisher);
+   if (info->origin)
+      free(info->origin);
+   if (info->franchise)
+      free(info->franchise);
+   if (info->edge_magazine_review)
+      free(info->edge_magazine_review);
+
+   if (info->cero_rating)
+      free(info->cero_rating);
+   if (info->pegi_rating)
+      free(info->pegi_rating);
+   if (info->enhancement_hw)
+      free(info->enhancement_hw);
+   if (info->elspa_rating)
+      free(info->elspa_rating);
+   if (info->esrb_rating)
+      free(info->esrb_rating);
+   if (info->bbfc_rating)
+      free(info->bbfc_rating);
+   if (info->sha1)
+      free(info->sha1);
+   if (info->md5)
+      free(info->md5);
+}
+
 database_info_list_t *database_info_list_new(
       const char *rdb_path, const char *query)
 {
@@ -461,63 +568,41 @@ database_info_list_t *database_info_list_new(
    if (!database_info_list)
       goto end;
 
-   database_info_list->count  = 0;
-   database_info_list->list   = NULL;
+   database_info_list->count   = 0;
+   database_info_list->list    = NULL;
+   database_info_list->strings = NULL;
+
+   /* Decode records in place from a copy of the database if it
+    * fits in memory, and keep the strings of the matching ones
+    * together so that they're released at once */
+   if (libretrodb_cursor_map(cur) == 0)
+      database_info_list->strings = rmsgpack_dom_arena_new();
 
    while (ret != -1)
    {
       database_info_t db_info = {0};
-      ret = database_cursor_iterate(cur, &db_info);
+      ret = database_cursor_iterate(cur, &db_info,
+            database_info_list->strings);
 
       if (ret == 0)
       {
-         database_info_t *db_ptr  = NULL;
          database_info_t *new_ptr = (database_info_t*)
             realloc(database_info, (k+1) * sizeof(database_info_t));
 
          if (!new_ptr)
          {
-            if (db_info.bbfc_rating)
-               free(db_info.bbfc_rating);
-            if (db_info.cero_rating)
-               free(db_info.cero_rating);
-            if (db_info.description)
-               free(db_info.description);
-            if (db_info.edge_magazine_review)
-               free(db_info.edge_magazine_review);
-            if (db_info.elspa_rating)
-               free(db_info.elspa_rating);
-            if (db_info.enhancement_hw)
-               free(db_info.enhancement_hw);
-            if (db_info.esrb_rating)
-               free(db_info.esrb_rating);
-            if (db_info.franchise)
-               free(db_info.franchise);
-            if (db_info.genre)
-               free(db_info.genre);
-            if (db_info.name)
-               free(db_info.name);
-            if (db_info.origin)
-               free(db_info.origin);
-            if (db_info.pegi_rating)
-               free(db_info.pegi_rating);
-            if (db_info.publisher)
-               free(db_info.publisher);
-            if (db_info.rom_name)
-               free(db_info.rom_name);
-            if (db_info.serial)
-               free(db_info.serial);
+            database_info_entry_free(&db_info,
+                  !database_info_list->strings);
+            database_info_list->list  = database_info;
+            database_info_list->count = k;
             database_info_list_free(database_info_list);
-            free(database_info);
             free(database_info_list);
             database_info_list = NULL;
             goto end;
          }
 
          database_info = new_ptr;
-         db_ptr        = &database_info[k];
-
-         memcpy(db_ptr, &db_info, sizeof(*db_ptr));
+         memcpy(&database_info[k], &db_info, sizeof(db_info));
 
          k++;
       }
@@ -546,48 +631,415 @@ void database_info_list_free(database_info_list_t *database_info_list)
       return;
 
    for (i = 0; i < database_info_list->count; i++)
+      database_info_entry_free(&database_info_list->list[i],
+            !database_info_list->strings);
+
+   free(database_info_list->list);
+
+   if (database_info_list->strings)
+      rmsgpack_dom_arena_free(database_info_list->strings);
+
+   database_info_list->list    = NULL;
+   database_info_list->count   = 0;
+   database_info_list->strings = NULL;
+}
+
+/* A scan session holds the crc32 and serial of every record of
+ * every database taking part in a scan, so that each scanned file
+ * only costs a lookup in memory instead of a pass over every
+ * database. Records are only decoded once they're known to match. */
+
+typedef struct database_info_fingerprint
+{
+   uint32_t key;    /* crc32, or hash of the serial */
+   uint32_t db;     /* index into the session's paths */
+   uint64_t offset; /* offset of the record in the database */
+} database_info_fingerprint_t;
+
+typedef struct database_info_fingerprints
+{
+   database_info_fingerprint_t *list;
+   size_t count;
+   size_t capacity;
+} database_info_fingerprints_t;
+
+struct database_info_scan
+{
+   char **paths; /* sorted */
+   size_t num_paths;
+   database_info_fingerprints_t crcs;
+   database_info_fingerprints_t serials;
+};
+
+static uint32_t database_info_serial_hash(const char *serial, size_t len)
+{
+   size_t i;
+   uint32_t hash = 5381;
+
+   for (i = 0; i < len; i++)
+      hash = (hash << 5) + hash + (uint8_t)serial[i];
+
+   return hash;
+}
+
+static int database_info_path_compare(const void *a, const void *b)
+{
+   return strcmp(*(char* const*)a, *(char* const*)b);
+}
+
+static int database_info_fingerprint_compare(const void *a, const void *b)
+{
+   const database_info_fingerprint_t *x = (const database_info_fingerprint_t*)a;
+   const database_info_fingerprint_t *y = (const database_info_fingerprint_t*)b;
+
+   if (x->key != y->key)
+      return (x->key < y->key) ? -1 : 1;
+   if (x->db != y->db)
+      return (x->db < y->db) ? -1 : 1;
+   if (x->offset != y->offset)
+      return (x->offset < y->offset) ? -1 : 1;
+   return 0;
+}
+
+static int database_info_offset_compare(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t*)a;
+   uint64_t y = *(const uint64_t*)b;
+
+   if (x < y)
+      return -1;
+   if (x > y)
+      return 1;
+   return 0;
+}
+
+static bool database_info_fingerprints_push(
+      database_info_fingerprints_t *fps,
+      uint32_t key, uint32_t db, uint64_t offset)
+{
+   database_info_fingerprint_t *fp = NULL;
+
+   if (fps->count == fps->capacity)
    {
-      database_info_t *info = &database_info_list->list[i];
-
-      if (info->name)
-         free(info->name);
-      if (info->rom_name)
-         free(info->rom_name);
-      if (info->serial)
-         free(info->serial);
-      if (info->genre)
-         free(info->genre);
-      if (info->description)
-         free(info->description);
-      if (info->publisher)
-         free(info->publisher);
-      if (info->developer)
-         string_list_free(info->developer);
-      info->developer = NULL;
-      if (info->origin)
-         free(info->origin);
-      if (info->franchise)
-         free(info->franchise);
-      if (info->edge_magazine_review)
-         free(info->edge_magazine_review);
-
-      if (info->cero_rating)
-         free(info->cero_rating);
-      if (info->pegi_rating)
-         free(info->pegi_rating);
-      if (info->enhancement_hw)
-         free(info->enhancement_hw);
-      if (info->elspa_rating)
-         free(info->elspa_rating);
-      if (info->esrb_rating)
-         free(info->esrb_rating);
-      if (info->bbfc_rating)
-         free(info->bbfc_rating);
-      if (info->sha1)
-         free(info->sha1);
-      if (info->md5)
-         free(info->md5);
+      size_t capacity                     = fps->capacity
+         ? fps->capacity * 2 : 1024;
+      database_info_fingerprint_t *list   = (database_info_fingerprint_t*)
+         realloc(fps->list, capacity * sizeof(*list));
+
+      if (!list)
+         return false;
+
+      fps->list     = list;
+      fps->capacity = capacity;
    }
 
-   free(database_info_list->list);
+   fp         = &fps->list[fps->count++];
+   fp->key    = key;
+   fp->db     = db;
+   fp->offset = offset;
+
+   return true;
+}
+
+/* Index of the first fingerprint not smaller than (key, db) */
+static size_t database_info_fingerprints_find(
+      const database_info_fingerprints_t *fps, uint32_t key, uint32_t db)
+{
+   size_t lo = 0;
+   size_t hi = fps->count;
+
+   while (lo < hi)
+   {
+      size_t mid                            = lo + (hi - lo) / 2;
+      const database_info_fingerprint_t *fp = &fps->list[mid];
+
+      if (fp->key < key || (fp->key == key && fp->db < db))
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   return lo;
+}
+
+static bool database_info_fingerprints_has(
+      const database_info_fingerprints_t *fps, uint32_t key)
+{
+   size_t i = database_info_fingerprints_find(fps, key, 0);
+   return i < fps->count && fps->list[i].key == key;
+}
+
+static void database_info_scan_load(database_info_scan_t *scan,
+      uint32_t index)
+{
+   struct rmsgpack_dom_value crc_key;
+   struct rmsgpack_dom_value serial_key;
+   bool mapped              = false;
+   libretrodb_t *db         = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+
+   if (!db || !cur)
+      goto end;
+
+   if (database_cursor_open(db, cur, scan->paths[index], NULL) != 0)
+      goto end;
+
+   crc_key.type               = RDT_STRING;
+   crc_key.val.string.len     = STRLEN_CONST("crc");
+   crc_key.val.string.buff    = (char*)"crc";
+   serial_key.type            = RDT_STRING;
+   serial_key.val.string.len  = STRLEN_CONST("serial");
+   serial_key.val.string.buff = (char*)"serial";
+
+   mapped                     = (libretrodb_cursor_map(cur) == 0);
+
+   for (;;)
+   {
+      struct rmsgpack_dom_value item;
+      struct rmsgpack_dom_value *val = NULL;
+      uint64_t offset                = libretrodb_cursor_tell(cur);
+
+      if (mapped)
+      {
+         libretrodb_cursor_release_views(cur);
+         if (libretrodb_cursor_read_item_view(cur, &item) != 0)
+            break;
+      }
+      else if (libretrodb_cursor_read_item(cur, &item) != 0)
+         break;
+
+      if (item.type == RDT_MAP)
+      {
+         val = rmsgpack_dom_value_map_value(&item, &crc_key);
+
+         if (val && val->type == RDT_BINARY && val->val.binary.len == 4)
+         {
+            uint32_t crc;
+            memcpy(&crc, val->val.binary.buff, sizeof(crc));
+            database_info_fingerprints_push(&scan->crcs,
+                  swap_if_little32(crc), index, offset);
+         }
+
+         val = rmsgpack_dom_value_map_value(&item, &serial_key);
+
+         if (val && (val->type == RDT_BINARY || val->type == RDT_STRING)
+               && val->val.binary.len > 0)
+            database_info_fingerprints_push(&scan->serials,
+                  database_info_serial_hash(val->val.binary.buff,
+                     val->val.binary.len), index, offset);
+      }
+
+      if (!mapped)
+         rmsgpack_dom_value_free(&item);
+   }
+
+end:
+   if (db)
+   {
+      database_cursor_close(db, cur);
+      libretrodb_free(db);
+   }
+   if (cur)
+      libretrodb_cursor_free(cur);
+}
+
+database_info_scan_t *database_info_scan_new(
+      const struct string_list *rdb_list)
+{
+   size_t i;
+   database_info_scan_t *scan = (database_info_scan_t*)
+      calloc(1, sizeof(*scan));
+
+   if (!scan)
+      return NULL;
+
+   if (!rdb_list || rdb_list->size == 0)
+      return scan;
+
+   scan->paths = (char**)calloc(rdb_list->size, sizeof(char*));
+
+   if (!scan->paths)
+      goto error;
+
+   for (i = 0; i < rdb_list->size; i++)
+   {
+      if (!(scan->paths[i] = strdup(rdb_list->elems[i].data)))
+         goto error;
+      scan->num_paths++;
+   }
+
+   qsort(scan->paths, scan->num_paths, sizeof(char*),
+         database_info_path_compare);
+
+   for (i = 0; i < scan->num_paths; i++)
+      database_info_scan_load(scan, (uint32_t)i);
+
+   qsort(scan->crcs.list, scan->crcs.count,
+         sizeof(database_info_fingerprint_t),
+         database_info_fingerprint_compare);
+   qsort(scan->serials.list, scan->serials.count,
+         sizeof(database_info_fingerprint_t),
+         database_info_fingerprint_compare);
+
+   RARCH_LOG("[Scanner]: Loaded %u crcs and %u serials from %u databases.\n",
+         (unsigned)scan->crcs.count, (unsigned)scan->serials.count,
+         (unsigned)scan->num_paths);
+
+   return scan;
+
+error:
+   database_info_scan_free(scan);
+   return NULL;
+}
+
+void database_info_scan_free(database_info_scan_t *scan)
+{
+   size_t i;
+
+   if (!scan)
+      return;
+
+   for (i = 0; i < scan->num_paths; i++)
+      free(scan->paths[i]);
+
+   free(scan->paths);
+   free(scan->crcs.list);
+   free(scan->serials.list);
+   free(scan);
+}
+
+bool database_info_scan_has_crc(const database_info_scan_t *scan,
+      uint32_t crc)
+{
+   return database_info_fingerprints_has(&scan->crcs, crc);
+}
+
+bool database_info_scan_has_serial(const database_info_scan_t *scan,
+      const char *serial)
+{
+   return database_info_fingerprints_has(&scan->serials,
+         database_info_serial_hash(serial, strlen(serial)));
+}
+
+/* Decodes the records of @rdb_path with any of @keys, in file order */
+static database_info_list_t *database_info_scan_list(
+      const database_info_scan_t *scan,
+      const database_info_fingerprints_t *fps,
+      const char *rdb_path, const uint32_t *keys, unsigned num_keys)
+{
+   unsigned i;
+   char **found                             = NULL;
+   uint64_t *offsets                        = NULL;
+   size_t num_offsets                       = 0;
+   libretrodb_t *db                         = NULL;
+   libretrodb_cursor_t *cur                 = NULL;
+   database_info_list_t *database_info_list = (database_info_list_t*)
+      calloc(1, sizeof(*database_info_list));
+
+   if (!database_info_list)
+      return NULL;
+
+   if (scan->num_paths)
+      found = (char**)bsearch(&rdb_path, scan->paths, scan->num_paths,
+            sizeof(char*), database_info_path_compare);
+
+   if (!found)
+      return database_info_list;
+
+   for (i = 0; i < num_keys; i++)
+   {
+      uint32_t index = (uint32_t)(found - scan->paths);
+      size_t j       = database_info_fingerprints_find(fps, keys[i], index);
+
+      for (; j < fps->count
+            && fps->list[j].key == keys[i]
+            && fps->list[j].db  == index; j++)
+      {
+         uint64_t *new_offsets = (uint64_t*)realloc(offsets,
+               (num_offsets + 1) * sizeof(uint64_t));
+
+         if (!new_offsets)
+            break;
+
+         offsets                = new_offsets;
+         offsets[num_offsets++] = fps->list[j].offset;
+      }
+   }
+
+   if (num_offsets == 0)
+      goto end;
+
+   qsort(offsets, num_offsets, sizeof(uint64_t),
+         database_info_offset_compare);
+
+   database_info_list->list = (database_info_t*)
+      calloc(num_offsets, sizeof(database_info_t));
+
+   if (!database_info_list->list)
+      goto end;
+
+   db  = libretrodb_new();
+   cur = libretrodb_cursor_new();
+
+   if (!db || !cur)
+      goto end;
+
+   if (database_cursor_open(db, cur, rdb_path, NULL) != 0)
+      goto end;
+
+   for (i = 0; i < num_offsets; i++)
+   {
+      struct rmsgpack_dom_value item;
+      database_info_t *db_info = NULL;
+
+      /* The same record can be found through both keys */
+      if (i > 0 && offsets[i] == offsets[i - 1])
+         continue;
+
+      if (libretrodb_cursor_read_item_at(cur, offsets[i], &item) != 0)
+         continue;
+
+      db_info = &database_info_list->list[database_info_list->count];
+
+      if (database_info_from_item(&item, db_info, NULL) == 0)
+         database_info_list->count++;
+      else
+         memset(db_info, 0, sizeof(*db_info));
+
+      rmsgpack_dom_value_free(&item);
+   }
+
+end:
+   if (db)
+   {
+      database_cursor_close(db, cur);
+      libretrodb_free(db);
+   }
+   if (cur)
+      libretrodb_cursor_free(cur);
+   free(offsets);
+
+   return database_info_list;
+}
+
+database_info_list_t *database_info_scan_list_crc(
+      const database_info_scan_t *scan, const char *rdb_path,
+      uint32_t crc, uint32_t archive_crc)
+{
+   uint32_t keys[2];
+
+   keys[0] = crc;
+   keys[1] = archive_crc;
+
+   return database_info_scan_list(scan, &scan->crcs, rdb_path,
+         keys, (crc == archive_crc) ? 1 : 2);
+}
+
+database_info_list_t *database_info_scan_list_serial(
+      const database_info_scan_t *scan, const char *rdb_path,
+      const char *serial)
+{
+   uint32_t key = database_info_serial_hash(serial, strlen(serial));
+
+   return database_info_scan_list(scan, &scan->serials, rdb_path, &key, 1);
 }
@@ -114,10 +114,14 @@ typedef struct
    void *userdata;
 } database_info_t;
 
+struct rmsgpack_dom_arena;
+
 typedef struct
 {
    size_t count;
    database_info_t *list;
+   /* When set, holds the strings of all entries */
+   struct rmsgpack_dom_arena *strings;
 } database_info_list_t;
 
 database_info_list_t *database_info_list_new(const char *rdb_path,
@@ -141,6 +145,34 @@ int database_info_build_query_enum(
  * memory after it is no longer required. */
 char *bin_to_hex_alloc(const uint8_t *data, size_t len);
 
+typedef struct database_info_scan database_info_scan_t;
+
+/* Loads the crc32 and serial of every record of the databases
+ * in @rdb_list, for matching many files against them */
+database_info_scan_t *database_info_scan_new(
+      const struct string_list *rdb_list);
+
+void database_info_scan_free(database_info_scan_t *scan);
+
+bool database_info_scan_has_crc(const database_info_scan_t *scan,
+      uint32_t crc);
+
+bool database_info_scan_has_serial(const database_info_scan_t *scan,
+      const char *serial);
+
+/* Like database_info_list_new, for the records of @rdb_path matching
+ * @crc or @archive_crc. Never returns an unallocated list unless out
+ * of memory. */
+database_info_list_t *database_info_scan_list_crc(
+      const database_info_scan_t *scan, const char *rdb_path,
+      uint32_t crc, uint32_t archive_crc);
+
+/* Like database_info_list_new, for the records of @rdb_path which
+ * may have @serial. Entries still need to be compared with @serial. */
+database_info_list_t *database_info_scan_list_serial(
+      const database_info_scan_t *scan, const char *rdb_path,
+      const char *serial);
+
 RETRO_END_DECLS
 
 #endif /* CORE_INFO_H_ */
@@ -25,12 +25,18 @@
 #include <dynamic/dylib.h>
 #include <string/stdstring.h>
 #include <retro_assert.h>
+#include <retro_miscellaneous.h>
+#include <streams/file_stream.h>
 #include <libretro.h>
 #define VFS_FRONTEND
 #include <vfs/vfs_implementation.h>
 
 #include <features/features_cpu.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #ifdef HAVE_CONFIG_H
 #include "config.h"
 #endif
@@ -60,6 +66,7 @@
 #include "cores/internal_cores.h"
 #include "content.h"
 #include "dirs.h"
+#include "file_path_special.h"
 #include "paths.h"
 #include "retroarch.h"
 #include "configuration.h"
@@ -143,6 +150,8 @@ static dylib_t lib_handle;
 static bool ignore_environment_cb   = false;
 static bool core_set_shared_context = false;
 static bool *load_no_content_hook   = NULL;
+/* Whether the core set its subsystems from retro_set_environment */
+static bool subsystem_info_set      = false;
 
 struct retro_subsystem_info subsystem_data[SUBSYSTEM_MAX_SUBSYSTEMS];
 struct retro_subsystem_rom_info subsystem_data_roms[SUBSYSTEM_MAX_SUBSYSTEMS][SUBSYSTEM_MAX_SUBSYSTEM_ROMS];
@@ -226,6 +235,7 @@ static bool environ_cb_get_system_info(unsigned cmd, void *data)
          unsigned log_level      = settings->uints.libretro_log_level;
 
          subsystem_current_count = 0;
+         subsystem_info_set      = true;
 
          RARCH_LOG("Environ SET_SUBSYSTEM_INFO.\n");
 
@@ -403,7 +413,541 @@ static dylib_t libretro_get_system_info_lib(const char *path,
 
    return lib;
 }
+
+/* Persistent cache of what libretro_get_system_info learns by
+ * loading a core, keyed by the path, size and modification time
+ * of the core, so cores are only loaded to be run.
+ *
+ * The file is a header followed by the entries, in native byte
+ * order, strings are a length (~0 for NULL) and their bytes. */
+
+#define SYSTEM_INFO_CACHE_MAGIC   "RASYSINF"
+#define SYSTEM_INFO_CACHE_VERSION 1
+
+typedef struct
+{
+   char *path;
+   int64_t size;
+   int64_t mtime;
+   struct retro_system_info info;
+   /* Whether the environment was queried as well */
+   bool has_environment;
+   bool load_no_content;
+   bool has_subsystems;
+   unsigned num_subsystems;
+   /* Terminated by an entry with a NULL ident */
+   struct retro_subsystem_info *subsystems;
+} system_info_cache_entry_t;
+
+typedef struct
+{
+   const uint8_t *data;
+   size_t len;
+   size_t pos;
+   bool error;
+} system_info_cache_reader_t;
+
+static system_info_cache_entry_t *system_info_cache = NULL;
+static size_t system_info_cache_count               = 0;
+static bool system_info_cache_loaded                = false;
+/* Entries were added since the file was written */
+static bool system_info_cache_dirty                 = false;
+#ifdef HAVE_THREADS
+static slock_t *system_info_cache_lock              = NULL;
+#endif
+
+static void system_info_cache_lock_acquire(void)
+{
+#ifdef HAVE_THREADS
+   if (system_info_cache_lock)
+      slock_lock(system_info_cache_lock);
+#endif
+}
+
+static void system_info_cache_lock_release(void)
+{
+#ifdef HAVE_THREADS
+   if (system_info_cache_lock)
+      slock_unlock(system_info_cache_lock);
 #endif
+}
+
+static void system_info_cache_get_path(char *s, size_t len)
+{
+   settings_t *settings = config_get_ptr();
+
+   s[0] = '\0';
+
+   if (!settings)
+      return;
+
+   if (!string_is_empty(settings->paths.path_libretro_info))
+      fill_pathname_join(s, settings->paths.path_libretro_info,
+            file_path_str(FILE_PATH_CORE_SYSTEM_INFO_CACHE), len);
+   else if (!string_is_empty(settings->paths.directory_libretro))
+      fill_pathname_join(s, settings->paths.directory_libretro,
+            file_path_str(FILE_PATH_CORE_SYSTEM_INFO_CACHE), len);
+}
+
+static void system_info_cache_entry_free(system_info_cache_entry_t *entry)
+{
+   unsigned i, j;
+
+   free(entry->path);
+   free((void*)entry->info.library_name);
+   free((void*)entry->info.library_version);
+   free((void*)entry->info.valid_extensions);
+
+   if (entry->subsystems)
+   {
+      for (i = 0; i < entry->num_subsystems; i++)
+      {
+         struct retro_subsystem_info *subsystem = &entry->subsystems[i];
+
+         for (j = 0; j < subsystem->num_roms; j++)
+         {
+            free((void*)subsystem->roms[j].desc);
+            free((void*)subsystem->roms[j].valid_extensions);
+         }
+
+         free((void*)subsystem->roms);
+         free((void*)subsystem->desc);
+         free((void*)subsystem->ident);
+      }
+
+      free(entry->subsystems);
+   }
+
+   memset(entry, 0, sizeof(*entry));
+}
+
+static void system_info_cache_read_bytes(system_info_cache_reader_t *reader,
+      void *data, size_t len)
+{
+   if (reader->error || reader->len - reader->pos < len)
+   {
+      reader->error = true;
+      memset(data, 0, len);
+      return;
+   }
+
+   memcpy(data, reader->data + reader->pos, len);
+   reader->pos += len;
+}
+
+static uint32_t system_info_cache_read_uint(system_info_cache_reader_t *reader)
+{
+   uint32_t val;
+   system_info_cache_read_bytes(reader, &val, sizeof(val));
+   return val;
+}
+
+static bool system_info_cache_read_bool(system_info_cache_reader_t *reader)
+{
+   uint8_t val;
+   system_info_cache_read_bytes(reader, &val, sizeof(val));
+   return val != 0;
+}
+
+static char *system_info_cache_read_string(system_info_cache_reader_t *reader)
+{
+   char *str;
+   uint32_t len = system_info_cache_read_uint(reader);
+
+   if (reader->error || len == (uint32_t)~0)
+      return NULL;
+
+   if (reader->len - reader->pos < len)
+   {
+      reader->error = true;
+      return NULL;
+   }
+
+   if (!(str = (char*)malloc(len + 1)))
+   {
+      reader->error = true;
+      return NULL;
+   }
+
+   system_info_cache_read_bytes(reader, str, len);
+   str[len] = '\0';
+   return str;
+}
+
+static bool system_info_cache_read_entry(system_info_cache_reader_t *reader,
+      system_info_cache_entry_t *entry)
+{
+   unsigned i, j;
+
+   memset(entry, 0, sizeof(*entry));
+
+   entry->path                  = system_info_cache_read_string(reader);
+   system_info_cache_read_bytes(reader, &entry->size,  sizeof(entry->size));
+   system_info_cache_read_bytes(reader, &entry->mtime, sizeof(entry->mtime));
+   entry->info.library_name     = system_info_cache_read_string(reader);
+   entry->info.library_version  = system_info_cache_read_string(reader);
+   entry->info.valid_extensions = system_info_cache_read_string(reader);
+   entry->info.need_fullpath    = system_info_cache_read_bool(reader);
+   entry->info.block_extract    = system_info_cache_read_bool(reader);
+   entry->has_environment       = system_info_cache_read_bool(reader);
+   entry->load_no_content       = system_info_cache_read_bool(reader);
+   entry->has_subsystems        = system_info_cache_read_bool(reader);
+   entry->num_subsystems        = system_info_cache_read_uint(reader);
+
+   if (reader->error || !entry->path
+         || entry->num_subsystems > SUBSYSTEM_MAX_SUBSYSTEMS)
+      goto error;
+
+   entry->subsystems = (struct retro_subsystem_info*)calloc(
+         entry->num_subsystems + 1, sizeof(*entry->subsystems));
+
+   if (!entry->subsystems)
+      goto error;
+
+   for (i = 0; i < entry->num_subsystems; i++)
+   {
+      struct retro_subsystem_rom_info *roms  = NULL;
+      struct retro_subsystem_info *subsystem = &entry->subsystems[i];
+
+      subsystem->desc     = system_info_cache_read_string(reader);
+      subsystem->ident    = system_info_cache_read_string(reader);
+      subsystem->id       = system_info_cache_read_uint(reader);
+      subsystem->num_roms = system_info_cache_read_uint(reader);
+
+      if (reader->error || !subsystem->ident
+            || subsystem->num_roms > SUBSYSTEM_MAX_SUBSYSTEM_ROMS)
+      {
+         subsystem->num_roms = 0;
+         entry->num_subsystems = i + 1;
+         goto error;
+      }
+
+      roms = (struct retro_subsystem_rom_info*)calloc(
+            subsystem->num_roms + 1, sizeof(*roms));
+      subsystem->roms = roms;
+
+      if (!roms)
+      {
+         subsystem->num_roms = 0;
+         entry->num_subsystems = i + 1;
+         goto error;
+      }
+
+      for (j = 0; j < subsystem->num_roms; j++)
+      {
+         roms[j].desc             = system_info_cache_read_string(reader);
+         roms[j].valid_extensions = system_info_cache_read_string(reader);
+         roms[j].required         = system_info_cache_read_bool(reader);
+         roms[j].block_extract    = system_info_cache_read_bool(reader);
+         roms[j].need_fullpath    = system_info_cache_read_bool(reader);
+      }
+   }
+
+   if (reader->error)
+      goto error;
+
+   return true;
+
+error:
+   system_info_cache_entry_free(entry);
+   return false;
+}
+
+static void system_info_cache_load(void)
+{
+   char path[PATH_MAX_LENGTH];
+   char magic[8];
+   void *data                        = NULL;
+   int64_t len                       = 0;
+   uint32_t i, count;
+   system_info_cache_reader_t reader = {0};
+
+   system_info_cache_loaded          = true;
+
+   system_info_cache_get_path(path, sizeof(path));
+
+   if (string_is_empty(path) || !path_is_valid(path)
+         || !filestream_read_file(path, &data, &len))
+      return;
+
+   reader.data = (const uint8_t*)data;
+   reader.len  = (size_t)len;
+
+   system_info_cache_read_bytes(&reader, magic, sizeof(magic));
+
+   if (  memcmp(magic, SYSTEM_INFO_CACHE_MAGIC, sizeof(magic))
+         || system_info_cache_read_uint(&reader) != SYSTEM_INFO_CACHE_VERSION)
+      goto end;
+
+   count = system_info_cache_read_uint(&reader);
+
+   /* Every entry takes more than a byte */
+   if (reader.error || count > reader.len)
+      goto end;
+
+   system_info_cache = (system_info_cache_entry_t*)
+      calloc(count ? count : 1, sizeof(*system_info_cache));
+
+   if (!system_info_cache)
+      goto end;
+
+   for (i = 0; i < count; i++)
+   {
+      if (!system_info_cache_read_entry(&reader,
+               &system_info_cache[system_info_cache_count]))
+      {
+         RARCH_WARN("Ignoring invalid core system info cache \"%s\".\n",
+               path);
+         break;
+      }
+      system_info_cache_count++;
+   }
+
+end:
+   free(data);
+}
+
+static void system_info_cache_write_bytes(RFILE *file,
+      const void *data, size_t len)
+{
+   filestream_write(file, data, len);
+}
+
+static void system_info_cache_write_uint(RFILE *file, uint32_t val)
+{
+   system_info_cache_write_bytes(file, &val, sizeof(val));
+}
+
+static void system_info_cache_write_bool(RFILE *file, bool val)
+{
+   uint8_t byte = val ? 1 : 0;
+   system_info_cache_write_bytes(file, &byte, sizeof(byte));
+}
+
+static void system_info_cache_write_string(RFILE *file, const char *str)
+{
+   if (!str)
+   {
+      system_info_cache_write_uint(file, (uint32_t)~0);
+      return;
+   }
+
+   system_info_cache_write_uint(file, (uint32_t)strlen(str));
+   system_info_cache_write_bytes(file, str, strlen(str));
+}
+
+static void system_info_cache_save(void)
+{
+   char path[PATH_MAX_LENGTH];
+   size_t i;
+   unsigned j, k;
+   RFILE *file = NULL;
+
+   system_info_cache_dirty = false;
+
+   system_info_cache_get_path(path, sizeof(path));
+
+   /* The directory may well be read-only */
+   if (string_is_empty(path) || !(file = filestream_open(path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      return;
+
+   system_info_cache_write_bytes(file, SYSTEM_INFO_CACHE_MAGIC, 8);
+   system_info_cache_write_uint(file, SYSTEM_INFO_CACHE_VERSION);
+   system_info_cache_write_uint(file, (uint32_t)system_info_cache_count);
+
+   for (i = 0; i < system_info_cache_count; i++)
+   {
+      const system_info_cache_entry_t *entry = &system_info_cache[i];
+
+      system_info_cache_write_string(file, entry->path);
+      system_info_cache_write_bytes(file, &entry->size,  sizeof(entry->size));
+      system_info_cache_write_bytes(file, &entry->mtime, sizeof(entry->mtime));
+      system_info_cache_write_string(file, entry->info.library_name);
+      system_info_cache_write_string(file, entry->info.library_version);
+      system_info_cache_write_string(file, entry->info.valid_extensions);
+      system_info_cache_write_bool(file, entry->info.need_fullpath);
+      system_info_cache_write_bool(file, entry->info.block_extract);
+      system_info_cache_write_bool(file, entry->has_environment);
+      system_info_cache_write_bool(file, entry->load_no_content);
+      system_info_cache_write_bool(file, entry->has_subsystems);
+      system_info_cache_write_uint(file, entry->num_subsystems);
+
+      for (j = 0; j < entry->num_subsystems; j++)
+      {
+         const struct retro_subsystem_info *subsystem = &entry->subsystems[j];
+
+         system_info_cache_write_string(file, subsystem->desc);
+         system_info_cache_write_string(file, subsystem->ident);
+         system_info_cache_write_uint(file, subsystem->id);
+         system_info_cache_write_uint(file, subsystem->num_roms);
+
+         for (k = 0; k < subsystem->num_roms; k++)
+         {
+            system_info_cache_write_string(file, subsystem->roms[k].desc);
+            system_info_cache_write_string(file,
+                  subsystem->roms[k].valid_extensions);
+            system_info_cache_write_bool(file, subsystem->roms[k].required);
+            system_info_cache_write_bool(file,
+                  subsystem->roms[k].block_extract);
+            system_info_cache_write_bool(file,
+                  subsystem->roms[k].need_fullpath);
+         }
+      }
+   }
+
+   filestream_close(file);
+}
+
+static system_info_cache_entry_t *system_info_cache_find(const char *path)
+{
+   size_t i;
+
+   if (!system_info_cache_loaded)
+      system_info_cache_load();
+
+   for (i = 0; i < system_info_cache_count; i++)
+      if (string_is_equal(system_info_cache[i].path, path))
+         return &system_info_cache[i];
+
+   return NULL;
+}
+
+static char *system_info_cache_strdup(const char *str)
+{
+   return str ? strdup(str) : NULL;
+}
+
+/* Records what was just learned from the core at @path */
+static void system_info_cache_add(const char *path,
+      int64_t size, int64_t mtime,
+      const struct retro_system_info *info, const bool *load_no_content)
+{
+   unsigned i, j;
+   system_info_cache_entry_t *entry = system_info_cache_find(path);
+
+   if (entry)
+      system_info_cache_entry_free(entry);
+   else
+   {
+      system_info_cache_entry_t *tmp = (system_info_cache_entry_t*)realloc(
+            system_info_cache,
+            (system_info_cache_count + 1) * sizeof(*system_info_cache));
+
+      if (!tmp)
+         return;
+
+      system_info_cache = tmp;
+      entry             = &system_info_cache[system_info_cache_count++];
+      memset(entry, 0, sizeof(*entry));
+   }
+
+   entry->path                  = strdup(path);
+   entry->size                  = size;
+   entry->mtime                 = mtime;
+   entry->info.library_name     = system_info_cache_strdup(info->library_name);
+   entry->info.library_version  = system_info_cache_strdup(info->library_version);
+   entry->info.valid_extensions = system_info_cache_strdup(info->valid_extensions);
+   entry->info.need_fullpath    = info->need_fullpath;
+   entry->info.block_extract    = info->block_extract;
+   entry->has_environment       = load_no_content != NULL;
+   entry->load_no_content       = load_no_content && *load_no_content;
+   entry->has_subsystems        = entry->has_environment && subsystem_info_set;
+   entry->num_subsystems        = entry->has_subsystems
+      ? subsystem_current_count : 0;
+   entry->subsystems            = (struct retro_subsystem_info*)calloc(
+         entry->num_subsystems + 1, sizeof(*entry->subsystems));
+
+   if (!entry->subsystems)
+      entry->num_subsystems     = 0;
+
+   /* The environment callback kept a copy of them */
+   for (i = 0; i < entry->num_subsystems; i++)
+   {
+      struct retro_subsystem_rom_info *roms  = NULL;
+      struct retro_subsystem_info *subsystem = &entry->subsystems[i];
+
+      subsystem->desc     = system_info_cache_strdup(subsystem_data[i].desc);
+      subsystem->ident    = system_info_cache_strdup(subsystem_data[i].ident);
+      subsystem->id       = subsystem_data[i].id;
+      subsystem->num_roms = MIN(subsystem_data[i].num_roms,
+            SUBSYSTEM_MAX_SUBSYSTEM_ROMS);
+
+      roms = (struct retro_subsystem_rom_info*)calloc(
+            subsystem->num_roms + 1, sizeof(*roms));
+      subsystem->roms = roms;
+
+      if (!roms)
+      {
+         subsystem->num_roms = 0;
+         continue;
+      }
+
+      for (j = 0; j < subsystem->num_roms; j++)
+      {
+         const struct retro_subsystem_rom_info *rom =
+            &subsystem_data_roms[i][j];
+
+         roms[j].desc             = system_info_cache_strdup(rom->desc);
+         roms[j].valid_extensions = system_info_cache_strdup(
+               rom->valid_extensions);
+         roms[j].required         = rom->required;
+         roms[j].block_extract    = rom->block_extract;
+         roms[j].need_fullpath    = rom->need_fullpath;
+      }
+   }
+
+   /* Written once at exit, not for every core */
+   system_info_cache_dirty = true;
+}
+#endif
+
+/**
+ * libretro_system_info_cache_init:
+ *
+ * Sets up the core system info cache, before other
+ * threads may ask for system info.
+ **/
+void libretro_system_info_cache_init(void)
+{
+#if defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+   if (!system_info_cache_lock)
+      system_info_cache_lock = slock_new();
+#endif
+}
+
+/**
+ * libretro_system_info_cache_deinit:
+ *
+ * Writes the core system info cache if it changed, and frees it.
+ **/
+void libretro_system_info_cache_deinit(void)
+{
+#ifdef HAVE_DYNAMIC
+   size_t i;
+
+   system_info_cache_lock_acquire();
+
+   if (system_info_cache_dirty)
+      system_info_cache_save();
+
+   for (i = 0; i < system_info_cache_count; i++)
+      system_info_cache_entry_free(&system_info_cache[i]);
+   free(system_info_cache);
+
+   system_info_cache        = NULL;
+   system_info_cache_count  = 0;
+   system_info_cache_loaded = false;
+
+   system_info_cache_lock_release();
+
+#ifdef HAVE_THREADS
+   slock_free(system_info_cache_lock);
+   system_info_cache_lock   = NULL;
+#endif
+#endif
+}
 
 static char current_library_name[1024];
 static char current_library_version[1024];
@@ -426,7 +970,11 @@ bool libretro_get_system_info(const char *path,
 {
    struct retro_system_info dummy_info;
 #ifdef HAVE_DYNAMIC
-   dylib_t lib;
+   int64_t size                     = 0;
+   int64_t mtime                    = 0;
+   dylib_t lib                      = NULL;
+   system_info_cache_entry_t *entry = NULL;
+   bool cacheable                   = path_get_size_mtime(path, &size, &mtime);
 #endif
 
    dummy_info.library_name     = NULL;
@@ -436,16 +984,47 @@ bool libretro_get_system_info(const char *path,
    dummy_info.block_extract    = false;
 
 #ifdef HAVE_DYNAMIC
-   lib                         = libretro_get_system_info_lib(
-         path, &dummy_info, load_no_content);
+   /* Held until the entry's strings are copied below */
+   system_info_cache_lock_acquire();
 
-   if (!lib)
+   if (cacheable)
+      entry                    = system_info_cache_find(path);
+
+   if (     entry
+         && entry->size  == size
+         && entry->mtime == mtime
+         && (entry->has_environment || !load_no_content))
    {
-      RARCH_ERR("%s: \"%s\"\n",
-            msg_hash_to_str(MSG_FAILED_TO_OPEN_LIBRETRO_CORE),
-            path);
-      RARCH_ERR("Error(s): %s\n", dylib_error());
-      return false;
+      dummy_info               = entry->info;
+
+      if (load_no_content)
+      {
+         *load_no_content      = entry->load_no_content;
+
+         if (entry->has_subsystems)
+            environ_cb_get_system_info(RETRO_ENVIRONMENT_SET_SUBSYSTEM_INFO,
+                  entry->subsystems);
+      }
+   }
+   else
+   {
+      subsystem_info_set       = false;
+      lib                      = libretro_get_system_info_lib(
+            path, &dummy_info, load_no_content);
+
+      if (!lib)
+      {
+         RARCH_ERR("%s: \"%s\"\n",
+               msg_hash_to_str(MSG_FAILED_TO_OPEN_LIBRETRO_CORE),
+               path);
+         RARCH_ERR("Error(s): %s\n", dylib_error());
+         system_info_cache_lock_release();
+         return false;
+      }
+
+      if (cacheable)
+         system_info_cache_add(path, size, mtime,
+               &dummy_info, load_no_content);
    }
 #else
    if (load_no_content)
@@ -490,7 +1069,10 @@ bool libretro_get_system_info(const char *path,
    info->valid_extensions = current_valid_extensions;
 
 #ifdef HAVE_DYNAMIC
-   dylib_close(lib);
+   system_info_cache_lock_release();
+
+   if (lib)
+      dylib_close(lib);
 #endif
    return true;
 }
@@ -40,6 +40,21 @@ RETRO_BEGIN_DECLS
 bool libretro_get_system_info(const char *path,
       struct retro_system_info *info, bool *load_no_content);
 
+/**
+ * libretro_system_info_cache_init:
+ *
+ * Sets up the core system info cache. Must be called
+ * at startup, before other threads ask for system info.
+ **/
+void libretro_system_info_cache_init(void);
+
+/**
+ * libretro_system_info_cache_deinit:
+ *
+ * Writes the core system info cache if it changed, and frees it.
+ **/
+void libretro_system_info_cache_deinit(void);
+
 /**
  * libretro_free_system_info:
  * @info                         : Pointer to system info information.
@@ -95,6 +95,11 @@ enum file_path_enum
    FILE_PATH_XM_EXTENSION,
    FILE_PATH_CONFIG_EXTENSION,
    FILE_PATH_CORE_INFO_EXTENSION,
+   FILE_PATH_CORE_INFO_CACHE,
+   FILE_PATH_CORE_SYSTEM_INFO_CACHE,
+   FILE_PATH_SCAN_MANIFEST_EXTENSION,
+   FILE_PATH_PLAYLIST_CACHE_EXTENSION,
+   FILE_PATH_PLAYLIST_JOURNAL_EXTENSION,
    FILE_PATH_RUNTIME_EXTENSION,
    FILE_PATH_DEFAULT_EVENT_LOG,
    FILE_PATH_EVENT_LOG_EXTENSION
@@ -74,6 +74,21 @@ const char *file_path_str(enum file_path_enum enum_idx)
       case FILE_PATH_CORE_INFO_EXTENSION:
          str = ".info";
          break;
+      case FILE_PATH_CORE_INFO_CACHE:
+         str = "core_info.cache";
+         break;
+      case FILE_PATH_CORE_SYSTEM_INFO_CACHE:
+         str = "core_system_info.cache";
+         break;
+      case FILE_PATH_SCAN_MANIFEST_EXTENSION:
+         str = ".scan";
+         break;
+      case FILE_PATH_PLAYLIST_CACHE_EXTENSION:
+         str = ".cache";
+         break;
+      case FILE_PATH_PLAYLIST_JOURNAL_EXTENSION:
+         str = ".journal";
+         break;
       case FILE_PATH_CONFIG_EXTENSION:
          str = ".cfg";
          break;
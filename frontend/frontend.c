@@ -23,6 +23,7 @@
 #endif
 
 #include <retro_timers.h>
+#include <lists/dir_list.h>
 
 #ifdef HAVE_MENU
 #include "../menu/menu_driver.h"
@@ -35,6 +36,7 @@
 #include "../tasks/task_content.h"
 
 #include "../driver.h"
+#include "../dynamic.h"
 #include "../paths.h"
 #include "../retroarch.h"
 #include "../verbosity.h"
@@ -65,6 +67,8 @@ void main_exit(void *args)
    if (settings->bools.config_save_on_exit)
       command_event(CMD_EVENT_MENU_SAVE_CURRENT_CONFIG, NULL);
 
+   libretro_system_info_cache_deinit();
+
 #ifdef HAVE_MENU
    /* Do not want menu context to live any more. */
    menu_driver_ctl(RARCH_MENU_CTL_UNSET_OWN_DRIVER, NULL);
@@ -92,6 +96,8 @@ void main_exit(void *args)
    ui_companion_driver_free();
    frontend_driver_free();
 
+   dir_list_cache_deinit();
+
 #if defined(_WIN32) && !defined(_XBOX) && !defined(__WINRT__)
    CoUninitialize();
 #endif
@@ -123,6 +129,9 @@ int rarch_main(int argc, char *argv[], void *data)
    }
 #endif
 
+   dir_list_cache_init();
+   libretro_system_info_cache_init();
+
    rarch_ctl(RARCH_CTL_PREINIT, NULL);
    frontend_driver_init_first(args);
    rarch_ctl(RARCH_CTL_INIT, NULL);
@@ -1168,6 +1168,8 @@ NETPLAY
 #include "../network/netplay/netplay_io.c"
 #include "../network/netplay/netplay_keyboard.c"
 #include "../network/netplay/netplay_sync.c"
+#include "../network/netplay/netplay_udp.c"
+#include "../network/netplay/netplay_spectate.c"
 #include "../network/netplay/netplay_discovery.c"
 #include "../network/netplay/netplay_buf.c"
 #include "../network/netplay/netplay_room_parse.c"
@@ -1175,6 +1177,7 @@ NETPLAY
 #include "../libretro-common/net/net_socket.c"
 #include "../libretro-common/net/net_http.c"
 #include "../libretro-common/net/net_natt.c"
+#include "../network/net_memwatch.c"
 #if !defined(HAVE_SOCKET_LEGACY)
 #include "../libretro-common/net/net_ifinfo.c"
 #endif
@@ -1362,6 +1365,10 @@ MENU
 
 #include "../command.c"
 
+#ifdef HAVE_SHM_EXPORT
+#include "../shm_export.c"
+#endif
+
 #if defined(HAVE_NETWORKING)
 #include "../libretro-common/net/net_http_parse.c"
 #endif
@@ -1373,6 +1380,9 @@ MENU
 #include "../runahead/copy_load_info.c"
 #include "../runahead/dirty_input.c"
 #include "../runahead/mylist.c"
+#ifdef HAVE_BATCH_CORE
+#include "../batch_core.c"
+#endif
 #endif
 
 /*============================================================
@@ -116,6 +116,7 @@ enum
 
    RARCH_RECORDING_TOGGLE,
    RARCH_STREAMING_TOGGLE,
+   RARCH_REPLAY_SAVE,
 
    RARCH_AI_SERVICE,
 
@@ -4903,6 +4903,14 @@ MSG_HASH(
     MSG_RECORDING_TO,
     "Recording to"
     )
+MSG_HASH(
+    MSG_SAVING_REPLAY_TO,
+    "Saving replay to"
+    )
+MSG_HASH(
+    MSG_REPLAY_BUFFER_NOT_RUNNING,
+    "Replay buffer is not running."
+    )
 MSG_HASH(
     MSG_REDIRECTING_CHEATFILE_TO,
     "Redirecting cheat file to"
@@ -8523,6 +8531,10 @@ MSG_HASH(
     MENU_ENUM_LABEL_VALUE_INPUT_META_STREAMING_TOGGLE,
     "Streaming toggle"
     )
+MSG_HASH(
+    MENU_ENUM_LABEL_VALUE_INPUT_META_REPLAY_SAVE,
+    "Save replay"
+    )
 MSG_HASH(
     MENU_ENUM_LABEL_VALUE_INPUT_META_AI_SERVICE,
     "AI Service"
@@ -8871,6 +8883,10 @@ MSG_HASH(MENU_ENUM_LABEL_VALUE_SCAN_WITHOUT_CORE_MATCH,
       "Scan without core match")
 MSG_HASH(MENU_ENUM_SUBLABEL_SCAN_WITHOUT_CORE_MATCH,
       "When disabled, content is only added to playlists if you have a core installed that supports its extension. By enabling this, it will add to playlist regardless. This way, you can install the core you need later on after scanning.")
+MSG_HASH(MENU_ENUM_LABEL_VALUE_SCAN_INCREMENTAL,
+      "Incremental scan")
+MSG_HASH(MENU_ENUM_SUBLABEL_SCAN_INCREMENTAL,
+      "Remember the files found when scanning a directory. Rescanning it then only scans files that were added or modified since, and removes the entries of files that are gone.")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_MENU_XMB_ANIMATION_HORIZONTAL_HIGHLIGHT,
       "Animation Horizontal Icon Highlight")
 MSG_HASH(MENU_ENUM_LABEL_VALUE_MENU_XMB_ANIMATION_MOVE_UP_DOWN,
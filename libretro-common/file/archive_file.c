@@ -45,6 +45,14 @@
 #include <lists/string_list.h>
 #include <string/stdstring.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#ifndef ARCHIVE_MAX_WORKERS
+#define ARCHIVE_MAX_WORKERS 8
+#endif
+
 struct file_archive_file_data
 {
 #ifdef HAVE_MMAP
@@ -484,6 +492,144 @@ static bool file_archive_walk(const char *file, const char *valid_exts,
    return returnerr;
 }
 
+/**
+ * file_archive_walk_directory:
+ * @file                        : filename path of archive
+ * @valid_exts                  : Valid extensions of archive to be parsed.
+ *                                If NULL, allow all.
+ * @file_cb                     : file_cb function pointer
+ * @userdata                    : userdata to pass to file_cb function pointer.
+ *
+ * Like file_archive_walk, but only reads the directory of the
+ * archive when the backend can, in which case file_cb gets no
+ * compressed data.
+ *
+ * Returns: true (1) on success, otherwise false (0).
+ **/
+static bool file_archive_walk_directory(const char *file,
+      const char *valid_exts, file_archive_file_cb file_cb,
+      struct archive_extract_userdata *userdata)
+{
+   char path[PATH_MAX_LENGTH];
+   char *last                                      = NULL;
+   const struct file_archive_file_backend *backend = NULL;
+
+   strlcpy(path, file, sizeof(path));
+
+   if ((last = (char*)path_get_archive_delim(path)))
+      *last = '\0';
+
+   backend = file_archive_get_file_backend(path);
+
+   if (!backend)
+      return false;
+
+   if (!backend->archive_parse_directory)
+      return file_archive_walk(file, valid_exts, file_cb, userdata);
+
+   strlcpy(userdata->archive_path, file, sizeof(userdata->archive_path));
+
+   return backend->archive_parse_directory(path,
+         valid_exts, userdata, file_cb) != -1;
+}
+
+void file_archive_run_workers(void (*worker)(void *data), void *data,
+      size_t num_jobs)
+{
+#ifdef HAVE_THREADS
+   size_t i;
+   sthread_t *threads[ARCHIVE_MAX_WORKERS];
+   size_t num_threads = num_jobs;
+
+   if (num_threads > ARCHIVE_MAX_WORKERS)
+      num_threads = ARCHIVE_MAX_WORKERS;
+
+   /* the calling thread is a worker too */
+   for (i = 1; i < num_threads; i++)
+      threads[i] = sthread_create(worker, data);
+
+   worker(data);
+
+   for (i = 1; i < num_threads; i++)
+      if (threads[i])
+         sthread_join(threads[i]);
+#else
+   worker(data);
+#endif
+}
+
+static int file_archive_name_cmp(const struct file_archive_name *a,
+      const char *name, size_t len)
+{
+   int cmp = memcmp(a->name, name, a->len < len ? a->len : len);
+
+   if (cmp)
+      return cmp;
+   if (a->len != len)
+      return a->len < len ? -1 : 1;
+   return 0;
+}
+
+static int file_archive_sort_names_cmp(const void *a, const void *b)
+{
+   const struct file_archive_name *x = (const struct file_archive_name*)a;
+   const struct file_archive_name *y = (const struct file_archive_name*)b;
+   int cmp = file_archive_name_cmp(x, y->name, y->len);
+
+   /* Keep duplicates in list order */
+   if (cmp)
+      return cmp;
+   if (x->index != y->index)
+      return x->index < y->index ? -1 : 1;
+   return 0;
+}
+
+struct file_archive_name *file_archive_sort_names(
+      const struct string_list *names)
+{
+   size_t i;
+   struct file_archive_name *sorted = (struct file_archive_name*)
+      malloc((names->size ? names->size : 1) * sizeof(*sorted));
+
+   if (!sorted)
+      return NULL;
+
+   for (i = 0; i < names->size; i++)
+   {
+      sorted[i].name  = names->elems[i].data;
+      sorted[i].len   = strlen(names->elems[i].data);
+      sorted[i].index = i;
+   }
+
+   qsort(sorted, names->size, sizeof(*sorted),
+         file_archive_sort_names_cmp);
+
+   return sorted;
+}
+
+size_t file_archive_find_name(const struct file_archive_name *sorted,
+      size_t count, const char *name, size_t len)
+{
+   size_t lo = 0;
+   size_t hi = count;
+
+   /* First entry which isn't smaller than the name */
+   while (lo < hi)
+   {
+      size_t mid = lo + (hi - lo) / 2;
+
+      if (file_archive_name_cmp(&sorted[mid], name, len) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
+   }
+
+   if (lo < count && file_archive_name_cmp(&sorted[lo], name, len) != 0)
+      return count;
+
+   return lo;
+}
+
 int file_archive_parse_file_progress(file_archive_transfer_t *state)
 {
    ptrdiff_t delta = 0;
@@ -608,7 +754,7 @@ struct string_list *file_archive_get_file_list(const char *path,
    if (!userdata.list)
       goto error;
 
-   if (!file_archive_walk(path, valid_exts,
+   if (!file_archive_walk_directory(path, valid_exts,
          file_archive_get_file_list_cb, &userdata))
       goto error;
 
@@ -810,6 +956,158 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
    return NULL;
 }
 
+enum file_archive_crc32_status
+{
+   ARCHIVE_CRC32_NOT_FOUND = 0,
+   ARCHIVE_CRC32_FOUND,
+   /* In the directory, but without a CRC32 */
+   ARCHIVE_CRC32_MISSING
+};
+
+typedef struct
+{
+   const struct string_list *names;
+   struct file_archive_name *sorted;
+   uint32_t *crcs;
+   uint8_t *status;
+   size_t num_found;
+} file_archive_crc32s_state_t;
+
+static int file_archive_get_file_crc32s_cb(const char *name,
+      const char *valid_exts, const uint8_t *cdata, unsigned cmode,
+      uint32_t csize, uint32_t size, uint32_t checksum,
+      struct archive_extract_userdata *userdata)
+{
+   file_archive_crc32s_state_t *state =
+      (file_archive_crc32s_state_t*)userdata->context;
+   size_t count = state->names->size;
+   size_t len   = strlen(name);
+   size_t j     = file_archive_find_name(state->sorted, count, name, len);
+
+   /* A name listed twice takes the next file of that name */
+   for (; j < count
+         && file_archive_name_cmp(&state->sorted[j], name, len) == 0; j++)
+   {
+      size_t i = state->sorted[j].index;
+
+      if (state->status[i] != ARCHIVE_CRC32_NOT_FOUND)
+         continue;
+
+      state->crcs[i]   = checksum;
+      /* Empty files are the only ones with a CRC32 of 0 */
+      state->status[i] = (checksum != 0 || size == 0)
+         ? ARCHIVE_CRC32_FOUND : ARCHIVE_CRC32_MISSING;
+      state->num_found++;
+      break;
+   }
+
+   /* Stop once every file has been seen */
+   return state->num_found < state->names->size;
+}
+
+bool file_archive_get_file_crc32s(const char *path,
+      const struct string_list *names, uint32_t *crcs)
+{
+   size_t i;
+   char archive_path[PATH_MAX_LENGTH];
+   file_archive_crc32s_state_t state;
+   struct archive_extract_userdata userdata        = {{0}};
+   struct string_list *missing                     = NULL;
+   uint32_t *missing_crcs                          = NULL;
+   const struct file_archive_file_backend *backend = NULL;
+   bool ret                                        = false;
+   char *last                                      = NULL;
+
+   if (!names || names->size == 0)
+      return true;
+
+   memset(crcs, 0, names->size * sizeof(*crcs));
+
+   state.names     = names;
+   state.sorted    = file_archive_sort_names(names);
+   state.crcs      = crcs;
+   state.status    = (uint8_t*)calloc(names->size, sizeof(*state.status));
+   state.num_found = 0;
+
+   if (!state.sorted || !state.status)
+   {
+      free(state.sorted);
+      free(state.status);
+      return false;
+   }
+
+   userdata.context = &state;
+
+   if (!file_archive_walk_directory(path, NULL,
+            file_archive_get_file_crc32s_cb, &userdata))
+      goto end;
+
+   ret = true;
+
+   for (i = 0; i < names->size; i++)
+      if (state.status[i] == ARCHIVE_CRC32_MISSING)
+         break;
+
+   if (i == names->size)
+      goto end;
+
+   /* The directory lacks some CRC32s, hash the files instead */
+   strlcpy(archive_path, path, sizeof(archive_path));
+
+   if ((last = (char*)path_get_archive_delim(archive_path)))
+      *last = '\0';
+
+   backend = file_archive_get_file_backend(archive_path);
+
+   if (!backend || !backend->archive_hash_files)
+      goto end;
+
+   if (!(missing = string_list_new()))
+      goto end;
+
+   for (; i < names->size; i++)
+      if (state.status[i] == ARCHIVE_CRC32_MISSING)
+         string_list_append(missing, names->elems[i].data,
+               names->elems[i].attr);
+
+   if (!(missing_crcs = (uint32_t*)calloc(missing->size,
+               sizeof(*missing_crcs))))
+      goto end;
+
+   if (backend->archive_hash_files(archive_path, missing, missing_crcs))
+   {
+      size_t j = 0;
+
+      for (i = 0; i < names->size; i++)
+         if (state.status[i] == ARCHIVE_CRC32_MISSING)
+            crcs[i] = missing_crcs[j++];
+   }
+
+end:
+   free(missing_crcs);
+   if (missing)
+      string_list_free(missing);
+   free(state.sorted);
+   free(state.status);
+   return ret;
+}
+
+static int file_archive_get_first_file_cb(const char *name,
+      const char *valid_exts, const uint8_t *cdata, unsigned cmode,
+      uint32_t csize, uint32_t size, uint32_t checksum,
+      struct archive_extract_userdata *userdata)
+{
+   size_t len = strlen(name);
+
+   /* Skip directories */
+   if (len == 0 || name[len - 1] == '/' || name[len - 1] == '\\')
+      return 1;
+
+   strlcpy(userdata->archive_name, name, sizeof(userdata->archive_name));
+   userdata->found_file = true;
+   return 0;
+}
+
 /**
  * file_archive_get_file_crc32:
  * @path                         : filename path of archive
@@ -820,13 +1118,14 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
  **/
 uint32_t file_archive_get_file_crc32(const char *path)
 {
-   file_archive_transfer_t state;
-   struct archive_extract_userdata userdata        = {{0}};
-   bool returnerr                                  = false;
-   const char *archive_path                        = NULL;
-   bool contains_compressed = path_contains_compressed_file(path);
+   union string_list_elem_attr attr;
+   struct string_list *names = NULL;
+   const char *archive_path  = NULL;
+   uint32_t crc              = 0;
 
-   if (contains_compressed)
+   attr.i = 0;
+
+   if (path_contains_compressed_file(path))
    {
       archive_path = path_get_archive_delim(path);
 
@@ -835,49 +1134,24 @@ uint32_t file_archive_get_file_crc32(const char *path)
          archive_path += 1;
    }
 
-   state.type          = ARCHIVE_TRANSFER_INIT;
-   state.archive_size  = 0;
-   state.handle        = NULL;
-   state.stream        = NULL;
-   state.footer        = NULL;
-   state.directory     = NULL;
-   state.data          = NULL;
-   state.backend       = NULL;
-
-   /* Initialize and open archive first.
-      Sets next state type to ITERATE. */
-   file_archive_parse_file_iterate(&state,
-            &returnerr, path, NULL, NULL,
-            &userdata);
+   if (!(names = string_list_new()))
+      return 0;
 
-   for (;;)
+   if (!string_is_empty(archive_path))
+      string_list_append(names, archive_path, attr);
+   else
    {
-      /* Now find the first file in the archive. */
-      if (state.type == ARCHIVE_TRANSFER_ITERATE)
-         file_archive_parse_file_iterate(&state,
-                  &returnerr, path, NULL, NULL,
-                  &userdata);
-
-      /* If no path specified within archive, stop after
-       * finding the first file.
-       */
-      if (!contains_compressed)
-         break;
+      struct archive_extract_userdata userdata = {{0}};
 
-      /* Stop when the right file in the archive is found. */
-      if (archive_path)
-      {
-         if (string_is_equal(userdata.extracted_file_path, archive_path))
-            break;
-      }
-      else
-         break;
+      if (file_archive_walk_directory(path, NULL,
+               file_archive_get_first_file_cb, &userdata)
+            && userdata.found_file)
+         string_list_append(names, userdata.archive_name, attr);
    }
 
-   file_archive_parse_file_iterate_stop(&state);
+   if (names->size)
+      file_archive_get_file_crc32s(path, names, &crc);
 
-   if (userdata.crc)
-      return userdata.crc;
-
-   return 0;
+   string_list_free(names);
+   return crc;
 }
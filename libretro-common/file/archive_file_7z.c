@@ -36,6 +36,10 @@
 #include <7zip/7zCrc.h>
 #include <7zip/7zFile.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define SEVENZIP_MAGIC "7z\xBC\xAF\x27\x1C"
 #define SEVENZIP_MAGIC_LEN 6
 
@@ -343,20 +347,12 @@ static int sevenzip_stream_decompress_data_to_file_iterate(void *data)
    return 1;
 }
 
-static int sevenzip_parse_file_init(file_archive_transfer_t *state,
-      const char *file)
+/* Opens the archive and reads its headers, which is all that's
+ * needed to list its files. CrcGenerateTable must have been
+ * called. */
+static bool sevenzip_context_open(
+      struct sevenzip_context_t *sevenzip_context, const char *file)
 {
-   struct sevenzip_context_t *sevenzip_context =
-         (struct sevenzip_context_t*)sevenzip_stream_new();
-
-   if (state->archive_size < SEVENZIP_MAGIC_LEN)
-      goto error;
-
-   if (string_is_not_equal_fast(state->data, SEVENZIP_MAGIC, SEVENZIP_MAGIC_LEN))
-      goto error;
-
-   state->stream = sevenzip_context;
-
 #if defined(_WIN32) && defined(USE_WINDOWS_FILE) && !defined(LEGACY_WIN32)
    if (!string_is_empty(file))
    {
@@ -368,7 +364,7 @@ static int sevenzip_parse_file_init(file_archive_transfer_t *state,
          if (InFile_OpenW(&sevenzip_context->archiveStream.file, fileW))
          {
             free(fileW);
-            goto error;
+            return false;
          }
 
          free(fileW);
@@ -377,18 +373,36 @@ static int sevenzip_parse_file_init(file_archive_transfer_t *state,
 #else
    /* could not open 7zip archive? */
    if (InFile_Open(&sevenzip_context->archiveStream.file, file))
-      goto error;
+      return false;
 #endif
 
    FileInStream_CreateVTable(&sevenzip_context->archiveStream);
    LookToRead_CreateVTable(&sevenzip_context->lookStream, false);
    sevenzip_context->lookStream.realStream = &sevenzip_context->archiveStream.s;
    LookToRead_Init(&sevenzip_context->lookStream);
-   CrcGenerateTable();
    SzArEx_Init(&sevenzip_context->db);
 
-   if (SzArEx_Open(&sevenzip_context->db, &sevenzip_context->lookStream.s,
-         &sevenzip_context->allocImp, &sevenzip_context->allocTempImp) != SZ_OK)
+   return SzArEx_Open(&sevenzip_context->db, &sevenzip_context->lookStream.s,
+         &sevenzip_context->allocImp, &sevenzip_context->allocTempImp) == SZ_OK;
+}
+
+static int sevenzip_parse_file_init(file_archive_transfer_t *state,
+      const char *file)
+{
+   struct sevenzip_context_t *sevenzip_context =
+         (struct sevenzip_context_t*)sevenzip_stream_new();
+
+   if (state->archive_size < SEVENZIP_MAGIC_LEN)
+      goto error;
+
+   if (string_is_not_equal_fast(state->data, SEVENZIP_MAGIC, SEVENZIP_MAGIC_LEN))
+      goto error;
+
+   state->stream = sevenzip_context;
+
+   CrcGenerateTable();
+
+   if (!sevenzip_context_open(sevenzip_context, file))
       goto error;
 
    return 0;
@@ -503,6 +517,281 @@ static uint32_t sevenzip_stream_crc32_calculate(uint32_t crc,
    return encoding_crc32(crc, data, length);
 }
 
+/* Gets the UTF-8 name of file @index, false if it doesn't fit */
+static bool sevenzip_get_file_name(struct sevenzip_context_t *sevenzip_context,
+      uint32_t index, uint16_t **temp, size_t *temp_size,
+      char *s, size_t len)
+{
+   size_t name_len = SzArEx_GetFileNameUtf16(&sevenzip_context->db,
+         index, NULL);
+
+   if (name_len > *temp_size)
+   {
+      uint16_t *new_temp = (uint16_t*)realloc(*temp,
+            name_len * sizeof(**temp));
+
+      if (!new_temp)
+         return false;
+
+      *temp      = new_temp;
+      *temp_size = name_len;
+   }
+
+   SzArEx_GetFileNameUtf16(&sevenzip_context->db, index, *temp);
+
+   return utf16_to_char_string(*temp, s, len);
+}
+
+static int sevenzip_parse_directory(const char *path, const char *valid_exts,
+      struct archive_extract_userdata *userdata, file_archive_file_cb file_cb)
+{
+   uint32_t i;
+   char filename[PATH_MAX_LENGTH];
+   uint16_t *temp                              = NULL;
+   size_t temp_size                            = 0;
+   int ret                                     = 0;
+   struct sevenzip_context_t *sevenzip_context =
+         (struct sevenzip_context_t*)sevenzip_stream_new();
+
+   if (!sevenzip_context)
+      return -1;
+
+   CrcGenerateTable();
+
+   if (!sevenzip_context_open(sevenzip_context, path))
+   {
+      ret = -1;
+      goto end;
+   }
+
+   for (i = 0; i < sevenzip_context->db.db.NumFiles; i++)
+   {
+      const CSzFileItem *file = sevenzip_context->db.db.Files + i;
+      uint64_t compressed_size = 0;
+
+      /* Same compressed size as when iterating */
+      if (i < sevenzip_context->db.db.NumPackStreams)
+         compressed_size = sevenzip_context->db.db.PackSizes[i];
+
+      if (file->IsDir)
+         continue;
+
+      if (!sevenzip_get_file_name(sevenzip_context, i, &temp, &temp_size,
+               filename, sizeof(filename)))
+      {
+         ret = -1;
+         break;
+      }
+
+      userdata->extracted_file_path = filename;
+      userdata->crc                 = file->Crc;
+
+      if (file_cb && !file_cb(filename, valid_exts, NULL,
+               ARCHIVE_MODE_COMPRESSED, (uint32_t)compressed_size,
+               (uint32_t)file->Size, file->Crc, userdata))
+         break;
+   }
+
+   userdata->extracted_file_path = NULL;
+
+end:
+   free(temp);
+   sevenzip_stream_free(sevenzip_context);
+   free(sevenzip_context);
+   return ret;
+}
+
+typedef struct
+{
+   const char *path;
+   const struct string_list *names;
+   uint32_t *crcs;
+   /* Index of each file of @names in the archive, ~0 if missing */
+   uint32_t *files;
+   /* Folders holding those files, each decoded by one worker */
+   uint32_t *folders;
+   size_t num_folders;
+   size_t next;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+} sevenzip_hash_state_t;
+
+static void sevenzip_hash_worker(void *data)
+{
+   sevenzip_hash_state_t *state                = (sevenzip_hash_state_t*)data;
+   /* Size of the decoded folder kept in output */
+   size_t output_size                          = 0;
+   struct sevenzip_context_t *sevenzip_context =
+         (struct sevenzip_context_t*)sevenzip_stream_new();
+
+   /* Every worker has its own handle on the archive */
+   if (!sevenzip_context
+         || !sevenzip_context_open(sevenzip_context, state->path))
+      goto end;
+
+   for (;;)
+   {
+      size_t i, job;
+      uint32_t folder;
+
+#ifdef HAVE_THREADS
+      slock_lock(state->lock);
+#endif
+      job = state->next++;
+#ifdef HAVE_THREADS
+      slock_unlock(state->lock);
+#endif
+
+      if (job >= state->num_folders)
+         break;
+
+      folder = state->folders[job];
+
+      /* Extracting files of the same folder in a row decodes
+       * the folder only once */
+      for (i = 0; i < state->names->size; i++)
+      {
+         size_t offset           = 0;
+         size_t outSizeProcessed = 0;
+         uint32_t file           = state->files[i];
+
+         if (     file == (uint32_t)~0
+               || sevenzip_context->db.FileIndexToFolderIndexMap[file] != folder)
+            continue;
+
+         if (SzArEx_Extract(&sevenzip_context->db,
+                  &sevenzip_context->lookStream.s, file,
+                  &sevenzip_context->block_index, &sevenzip_context->output,
+                  &output_size, &offset, &outSizeProcessed,
+                  &sevenzip_context->allocImp,
+                  &sevenzip_context->allocTempImp) == SZ_OK)
+            state->crcs[i] = encoding_crc32(0,
+                  sevenzip_context->output + offset, outSizeProcessed);
+      }
+   }
+
+end:
+   if (sevenzip_context)
+   {
+      IAlloc_Free(&sevenzip_context->allocImp, sevenzip_context->output);
+      sevenzip_context->output = NULL;
+      sevenzip_stream_free(sevenzip_context);
+      free(sevenzip_context);
+   }
+}
+
+static bool sevenzip_hash_files(const char *path,
+      const struct string_list *names, uint32_t *crcs)
+{
+   uint32_t i;
+   size_t j, len;
+   char filename[PATH_MAX_LENGTH];
+   sevenzip_hash_state_t state;
+   uint16_t *temp                              = NULL;
+   size_t temp_size                            = 0;
+   bool ret                                    = false;
+   struct file_archive_name *sorted            = NULL;
+   struct sevenzip_context_t *sevenzip_context =
+         (struct sevenzip_context_t*)sevenzip_stream_new();
+
+   if (!sevenzip_context)
+      return false;
+
+   state.path        = path;
+   state.names       = names;
+   state.crcs        = crcs;
+   state.num_folders = 0;
+   state.next        = 0;
+   state.files       = (uint32_t*)malloc(names->size * sizeof(*state.files));
+   state.folders     = (uint32_t*)malloc(names->size * sizeof(*state.folders));
+
+   sorted            = file_archive_sort_names(names);
+
+   if (!state.files || !state.folders || !sorted)
+      goto end;
+
+   CrcGenerateTable();
+
+   if (!sevenzip_context_open(sevenzip_context, path))
+      goto end;
+
+   for (j = 0; j < names->size; j++)
+      state.files[j] = (uint32_t)~0;
+
+   for (i = 0; i < sevenzip_context->db.db.NumFiles; i++)
+   {
+      uint32_t folder;
+
+      if (     sevenzip_context->db.db.Files[i].IsDir
+            || !sevenzip_get_file_name(sevenzip_context, i, &temp,
+               &temp_size, filename, sizeof(filename)))
+         continue;
+
+      len = strlen(filename);
+
+      /* A name listed twice takes the next file of that name */
+      for (j = file_archive_find_name(sorted, names->size, filename, len);
+            j < names->size; j++)
+      {
+         if (sorted[j].len != len || memcmp(sorted[j].name, filename, len))
+            j = names->size;
+         if (j == names->size || state.files[sorted[j].index] == (uint32_t)~0)
+            break;
+      }
+
+      if (j == names->size)
+         continue;
+
+      j              = sorted[j].index;
+      state.files[j] = i;
+      folder         = sevenzip_context->db.FileIndexToFolderIndexMap[i];
+
+      /* Empty files have no folder */
+      if (folder == (uint32_t)-1)
+      {
+         state.files[j] = (uint32_t)~0;
+         continue;
+      }
+
+      for (j = 0; j < state.num_folders; j++)
+         if (state.folders[j] == folder)
+            break;
+
+      if (j == state.num_folders)
+         state.folders[state.num_folders++] = folder;
+   }
+
+   ret = true;
+
+   /* The headers are all the workers need from this handle */
+   sevenzip_stream_free(sevenzip_context);
+   free(sevenzip_context);
+   sevenzip_context = NULL;
+
+#ifdef HAVE_THREADS
+   state.lock = slock_new();
+#endif
+
+   file_archive_run_workers(sevenzip_hash_worker, &state, state.num_folders);
+
+#ifdef HAVE_THREADS
+   slock_free(state.lock);
+#endif
+
+end:
+   if (sevenzip_context)
+   {
+      sevenzip_stream_free(sevenzip_context);
+      free(sevenzip_context);
+   }
+   free(temp);
+   free(sorted);
+   free(state.files);
+   free(state.folders);
+   return ret;
+}
+
 const struct file_archive_file_backend sevenzip_backend = {
    sevenzip_stream_new,
    sevenzip_stream_free,
@@ -512,5 +801,7 @@ const struct file_archive_file_backend sevenzip_backend = {
    sevenzip_file_read,
    sevenzip_parse_file_init,
    sevenzip_parse_file_iterate_step,
+   sevenzip_parse_directory,
+   sevenzip_hash_files,
    "7z"
 };
@@ -26,10 +26,16 @@
 #include <file/archive_file.h>
 #include <streams/file_stream.h>
 #include <streams/trans_stream.h>
+#include <lists/string_list.h>
+#include <string/stdstring.h>
 #include <retro_inline.h>
 #include <retro_miscellaneous.h>
 #include <encodings/crc32.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 /* Only for MAX_WBITS */
 #include <zlib.h>
 
@@ -41,6 +47,37 @@
 #define END_OF_CENTRAL_DIR_SIGNATURE 0x06054b50
 #endif
 
+#ifndef LOCAL_FILE_HEADER_SIGNATURE
+#define LOCAL_FILE_HEADER_SIGNATURE 0x04034b50
+#endif
+
+/* End of central directory record, followed by a comment
+ * of up to 64 KB */
+#define ZIP_FOOTER_SIZE      22
+#define ZIP_FOOTER_MAX_SIZE  (ZIP_FOOTER_SIZE + 0xFFFF)
+
+#define ZIP_HASH_CHUNK_SIZE  (64 * 1024)
+
+typedef struct
+{
+   uint32_t offset;
+   uint32_t csize;
+   uint32_t size;
+   unsigned cmode;
+} zip_member_t;
+
+typedef struct
+{
+   const char *path;
+   zip_member_t *members;
+   uint32_t *crcs;
+   size_t count;
+   size_t next;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+} zip_hash_state_t;
+
 static INLINE uint32_t read_le(const uint8_t *data, unsigned size)
 {
    unsigned i;
@@ -380,6 +417,344 @@ static int zip_parse_file_iterate_step(file_archive_transfer_t *state,
    return 1;
 }
 
+/* Reads the central directory of a ZIP archive from the end
+ * of the file, without touching the files themselves. */
+static uint8_t *zip_read_directory(const char *path, uint32_t *len)
+{
+   int64_t size;
+   int64_t tail_size;
+   uint32_t dir_offset;
+   const uint8_t *footer = NULL;
+   uint8_t *tail         = NULL;
+   uint8_t *directory    = NULL;
+   RFILE *file           = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return NULL;
+
+   size = filestream_get_size(file);
+
+   if (size < ZIP_FOOTER_SIZE)
+      goto end;
+
+   tail_size = MIN(size, ZIP_FOOTER_MAX_SIZE);
+
+   if (!(tail = (uint8_t*)malloc((size_t)tail_size)))
+      goto end;
+
+   if (     filestream_seek(file, size - tail_size,
+            RETRO_VFS_SEEK_POSITION_START) != 0
+         || filestream_read(file, tail, tail_size) != tail_size)
+      goto end;
+
+   for (footer = tail + tail_size - ZIP_FOOTER_SIZE; ; footer--)
+   {
+      if (read_le(footer, 4) == END_OF_CENTRAL_DIR_SIGNATURE)
+      {
+         unsigned comment_len = read_le(footer + 20, 2);
+         if (footer + ZIP_FOOTER_SIZE + comment_len == tail + tail_size)
+            break;
+      }
+
+      if (footer == tail)
+         goto end;
+   }
+
+   *len       = read_le(footer + 12, 4); /* size of the central directory */
+   dir_offset = read_le(footer + 16, 4); /* offset of the central directory */
+
+   if ((int64_t)dir_offset + *len > size - (tail + tail_size - footer))
+      goto end;
+
+   if (!(directory = (uint8_t*)malloc(*len ? *len : 1)))
+      goto end;
+
+   /* Small archives fit in what was already read */
+   if ((int64_t)dir_offset >= size - tail_size)
+      memcpy(directory, tail + (dir_offset - (size - tail_size)), *len);
+   else if (filestream_seek(file, dir_offset,
+            RETRO_VFS_SEEK_POSITION_START) != 0
+         || filestream_read(file, directory, *len) != (int64_t)*len)
+   {
+      free(directory);
+      directory = NULL;
+   }
+
+end:
+   free(tail);
+   filestream_close(file);
+   return directory;
+}
+
+static int zip_parse_directory(const char *path, const char *valid_exts,
+      struct archive_extract_userdata *userdata, file_archive_file_cb file_cb)
+{
+   char filename[PATH_MAX_LENGTH];
+   uint32_t len             = 0;
+   int ret                  = 0;
+   uint8_t *directory       = zip_read_directory(path, &len);
+   const uint8_t *entry     = directory;
+   const uint8_t *end       = directory + len;
+
+   if (!directory)
+      return -1;
+
+   while (end - entry >= 46
+         && read_le(entry, 4) == CENTRAL_FILE_HEADER_SIGNATURE)
+   {
+      unsigned cmode         = read_le(entry + 10, 2); /* compression mode, 0 = store, 8 = deflate */
+      uint32_t checksum      = read_le(entry + 16, 4); /* CRC32 */
+      uint32_t csize         = read_le(entry + 20, 4); /* compressed size */
+      uint32_t size          = read_le(entry + 24, 4); /* uncompressed size */
+      uint32_t namelength    = read_le(entry + 28, 2); /* file name length */
+      uint32_t extralength   = read_le(entry + 30, 2); /* extra field length */
+      uint32_t commentlength = read_le(entry + 32, 2); /* file comment length */
+
+      if (     namelength >= PATH_MAX_LENGTH
+            || (uint32_t)(end - entry) < 46 + namelength)
+      {
+         ret = -1;
+         break;
+      }
+
+      memcpy(filename, entry + 46, namelength); /* file name */
+      filename[namelength]          = '\0';
+
+      userdata->extracted_file_path = filename;
+      userdata->crc                 = checksum;
+
+      if (file_cb && !file_cb(filename, valid_exts, NULL, cmode,
+               csize, size, checksum, userdata))
+         break;
+
+      entry += 46 + namelength + extralength + commentlength;
+   }
+
+   userdata->extracted_file_path = NULL;
+
+   free(directory);
+   return ret;
+}
+
+/* Returns the CRC32 of the contents of @member, reading and
+ * inflating it in chunks */
+static bool zip_hash_member(RFILE *file, const zip_member_t *member,
+      uint8_t *in, uint8_t *out, uint32_t *crc)
+{
+   uint8_t header[30];
+   uint32_t left     = member->csize;
+   uint32_t in_left  = 0;
+   uint32_t out_pos  = 0;
+   void *stream      = NULL;
+   bool ret          = false;
+
+   *crc = 0;
+
+   if (     filestream_seek(file, member->offset,
+            RETRO_VFS_SEEK_POSITION_START) != 0
+         || filestream_read(file, header, sizeof(header)) != sizeof(header)
+         || read_le(header, 4) != LOCAL_FILE_HEADER_SIGNATURE)
+      return false;
+
+   if (filestream_seek(file, (int64_t)member->offset + sizeof(header)
+            + read_le(header + 26, 2)  /* file name length */
+            + read_le(header + 28, 2), /* extra field length */
+            RETRO_VFS_SEEK_POSITION_START) != 0)
+      return false;
+
+   if (member->cmode == ARCHIVE_MODE_UNCOMPRESSED)
+   {
+      while (left)
+      {
+         uint32_t len = MIN(left, ZIP_HASH_CHUNK_SIZE);
+
+         if (filestream_read(file, in, len) != len)
+            return false;
+
+         *crc  = encoding_crc32(*crc, in, len);
+         left -= len;
+      }
+
+      return true;
+   }
+
+   if (member->cmode != ARCHIVE_MODE_COMPRESSED)
+      return false;
+
+   if (!(stream = zlib_inflate_backend.stream_new()))
+      return false;
+
+   if (zlib_inflate_backend.define)
+      zlib_inflate_backend.define(stream, "window_bits", (uint32_t)-MAX_WBITS);
+
+   zlib_inflate_backend.set_out(stream, out, ZIP_HASH_CHUNK_SIZE);
+
+   for (;;)
+   {
+      uint32_t rd = 0;
+      uint32_t wn = 0;
+      enum trans_stream_error terror = TRANS_STREAM_ERROR_NONE;
+      bool zstatus;
+
+      if (in_left == 0 && left)
+      {
+         in_left = MIN(left, ZIP_HASH_CHUNK_SIZE);
+
+         if (filestream_read(file, in, in_left) != in_left)
+            break;
+
+         left -= in_left;
+         zlib_inflate_backend.set_in(stream, in, in_left);
+      }
+
+      zstatus  = zlib_inflate_backend.trans(stream, false, &rd, &wn, &terror);
+
+      if (!zstatus && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
+         break;
+
+      *crc     = encoding_crc32(*crc, out + out_pos, wn);
+      out_pos += wn;
+      in_left -= rd;
+
+      if (zstatus && terror == TRANS_STREAM_ERROR_NONE)
+      {
+         ret = true;
+         break;
+      }
+
+      if (out_pos == ZIP_HASH_CHUNK_SIZE)
+      {
+         zlib_inflate_backend.set_out(stream, out, ZIP_HASH_CHUNK_SIZE);
+         out_pos = 0;
+      }
+      /* Truncated */
+      else if (rd == 0 && wn == 0 && in_left == 0 && left == 0)
+         break;
+   }
+
+   zlib_inflate_backend.stream_free(stream);
+   return ret;
+}
+
+static void zip_hash_worker(void *data)
+{
+   zip_hash_state_t *state = (zip_hash_state_t*)data;
+   uint8_t *in             = (uint8_t*)malloc(ZIP_HASH_CHUNK_SIZE);
+   uint8_t *out            = (uint8_t*)malloc(ZIP_HASH_CHUNK_SIZE);
+   RFILE *file             = filestream_open(state->path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!in || !out || !file)
+      goto end;
+
+   for (;;)
+   {
+      size_t i;
+
+#ifdef HAVE_THREADS
+      slock_lock(state->lock);
+#endif
+      i = state->next++;
+#ifdef HAVE_THREADS
+      slock_unlock(state->lock);
+#endif
+
+      if (i >= state->count)
+         break;
+
+      if (state->members[i].csize == 0 && state->members[i].size == 0)
+         continue;
+
+      if (!zip_hash_member(file, &state->members[i], in, out,
+               &state->crcs[i]))
+         state->crcs[i] = 0;
+   }
+
+end:
+   if (file)
+      filestream_close(file);
+   free(in);
+   free(out);
+}
+
+static bool zip_hash_files(const char *path,
+      const struct string_list *names, uint32_t *crcs)
+{
+   size_t i;
+   zip_hash_state_t state;
+   uint32_t len                     = 0;
+   uint8_t *directory               = zip_read_directory(path, &len);
+   const uint8_t *entry             = directory;
+   const uint8_t *end               = directory + len;
+   struct file_archive_name *sorted = NULL;
+
+   if (!directory)
+      return false;
+
+   if (!(sorted = file_archive_sort_names(names)))
+   {
+      free(directory);
+      return false;
+   }
+
+   state.path    = path;
+   state.crcs    = crcs;
+   state.count   = names->size;
+   state.next    = 0;
+   state.members = (zip_member_t*)calloc(names->size, sizeof(*state.members));
+
+   if (!state.members)
+   {
+      free(sorted);
+      free(directory);
+      return false;
+   }
+
+   /* Files not found hash as empty */
+   while (end - entry >= 46
+         && read_le(entry, 4) == CENTRAL_FILE_HEADER_SIGNATURE)
+   {
+      uint32_t namelength    = read_le(entry + 28, 2);
+      uint32_t extralength   = read_le(entry + 30, 2);
+      uint32_t commentlength = read_le(entry + 32, 2);
+
+      if ((uint32_t)(end - entry) < 46 + namelength)
+         break;
+
+      for (i = file_archive_find_name(sorted, names->size,
+               (const char*)entry + 46, namelength);
+            i < names->size && sorted[i].len == namelength
+            && !memcmp(sorted[i].name, entry + 46, namelength); i++)
+      {
+         zip_member_t *member = &state.members[sorted[i].index];
+
+         member->cmode  = read_le(entry + 10, 2);
+         member->csize  = read_le(entry + 20, 4);
+         member->size   = read_le(entry + 24, 4);
+         member->offset = read_le(entry + 42, 4);
+      }
+
+      entry += 46 + namelength + extralength + commentlength;
+   }
+
+   free(sorted);
+   free(directory);
+
+#ifdef HAVE_THREADS
+   state.lock = slock_new();
+#endif
+
+   file_archive_run_workers(zip_hash_worker, &state, state.count);
+
+#ifdef HAVE_THREADS
+   slock_free(state.lock);
+#endif
+
+   free(state.members);
+   return true;
+}
+
 const struct file_archive_file_backend zlib_backend = {
    zlib_stream_new,
    zlib_stream_free,
@@ -389,5 +764,7 @@ const struct file_archive_file_backend zlib_backend = {
    zip_file_read,
    zip_parse_file_init,
    zip_parse_file_iterate_step,
+   zip_parse_directory,
+   zip_hash_files,
    "zlib"
 };
@@ -173,6 +173,34 @@ int32_t path_get_size(const char *path)
    return -1;
 }
 
+/**
+ * path_get_size_mtime:
+ * @path               : path
+ * @size               : size of the file
+ * @mtime              : last modification time of the file, in seconds
+ *
+ * Gets the size and modification time of a file, which is
+ * enough to tell whether a file changed for caching purposes.
+ *
+ * Returns: true (1) if successful, false (0) on error or
+ * on platforms without modification times.
+ */
+bool path_get_size_mtime(const char *path, int64_t *size, int64_t *mtime)
+{
+#if defined(VITA) || defined(PSP) || defined(PS2) || defined(ORBIS) || defined(__CELLOS_LV2__) || defined(_XBOX)
+   return false;
+#else
+   struct stat buf;
+
+   if (!path || !*path || stat(path, &buf) != 0)
+      return false;
+
+   *size  = (int64_t)buf.st_size;
+   *mtime = (int64_t)buf.st_mtime;
+   return true;
+#endif
+}
+
 /**
  * path_mkdir:
  * @dir                : directory
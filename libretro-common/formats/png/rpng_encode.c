@@ -24,9 +24,23 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <zlib.h>
+
+#include <retro_inline.h>
 #include <encodings/crc32.h>
+#include <features/features_cpu.h>
 #include <streams/file_stream.h>
-#include <streams/trans_stream.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define RPNG_ENCODE_NEON
+#include <arm_neon.h>
+#endif
 
 #include "rpng_internal.h"
 
@@ -147,9 +161,37 @@ static void copy_bgr24_line(uint8_t *dst, const uint8_t *src, unsigned width)
 
 static unsigned count_sad(const uint8_t *data, size_t size)
 {
-   size_t i;
+   size_t i     = 0;
    unsigned cnt = 0;
-   for (i = 0; i < size; i++)
+#if defined(__SSE2__)
+   __m128i zero = _mm_setzero_si128();
+   __m128i sum  = zero;
+
+   for (; i + 16 <= size; i += 16)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+      /* abs((int8_t)v) as unsigned is min(v, -v) */
+      v         = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+      sum       = _mm_add_epi64(sum, _mm_sad_epu8(v, zero));
+   }
+
+   cnt = _mm_cvtsi128_si32(sum) + _mm_cvtsi128_si32(_mm_srli_si128(sum, 8));
+#elif defined(RPNG_ENCODE_NEON)
+   uint32x4_t sum = vdupq_n_u32(0);
+
+   for (; i + 16 <= size; i += 16)
+   {
+      /* abs(-128) wraps to 0x80, which is 128 as unsigned */
+      uint8x16_t v = vreinterpretq_u8_s8(
+            vabsq_s8(vld1q_s8((const int8_t*)data + i)));
+      sum          = vpadalq_u16(sum, vpaddlq_u8(v));
+   }
+
+   cnt = vgetq_lane_u32(sum, 0) + vgetq_lane_u32(sum, 1)
+      + vgetq_lane_u32(sum, 2) + vgetq_lane_u32(sum, 3);
+#endif
+
+   for (; i < size; i++)
    {
       if (data[i])
          cnt += abs((int8_t)data[i]);
@@ -160,9 +202,18 @@ static unsigned count_sad(const uint8_t *data, size_t size)
 static unsigned filter_up(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0;
    width *= bpp;
-   for (i = 0; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+#elif defined(RPNG_ENCODE_NEON)
+   for (; i + 16 <= width; i += 16)
+      vst1q_u8(target + i, vsubq_u8(vld1q_u8(line + i), vld1q_u8(prev + i)));
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - prev[i];
 
    return count_sad(target, width);
@@ -175,7 +226,17 @@ static unsigned filter_sub(uint8_t *target, const uint8_t *line,
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i];
-   for (i = bpp; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_loadu_si128((const __m128i*)(line + i - bpp))));
+#elif defined(RPNG_ENCODE_NEON)
+   for (; i + 16 <= width; i += 16)
+      vst1q_u8(target + i, vsubq_u8(vld1q_u8(line + i),
+               vld1q_u8(line + i - bpp)));
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - line[i - bpp];
 
    return count_sad(target, width);
@@ -185,59 +246,419 @@ static unsigned filter_avg(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
    unsigned i;
+#if defined(__SSE2__)
+   __m128i one = _mm_set1_epi8(1);
+#endif
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - (prev[i] >> 1);
-   for (i = bpp; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+   {
+      __m128i a   = _mm_loadu_si128((const __m128i*)(line + i - bpp));
+      __m128i b   = _mm_loadu_si128((const __m128i*)(prev + i));
+      /* _mm_avg_epu8 rounds up, PNG rounds down */
+      __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), one));
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)), avg));
+   }
+#elif defined(RPNG_ENCODE_NEON)
+   for (; i + 16 <= width; i += 16)
+      vst1q_u8(target + i, vsubq_u8(vld1q_u8(line + i),
+               vhaddq_u8(vld1q_u8(line + i - bpp), vld1q_u8(prev + i))));
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - ((line[i - bpp] + prev[i]) >> 1);
 
    return count_sad(target, width);
 }
 
+#if defined(__SSE2__)
+static INLINE __m128i paeth_sse2(__m128i a, __m128i b, __m128i c)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i bc   = _mm_sub_epi16(b, c);
+   __m128i ac   = _mm_sub_epi16(a, c);
+   __m128i abc  = _mm_add_epi16(bc, ac);
+   __m128i pa   = _mm_max_epi16(bc,  _mm_sub_epi16(zero, bc));
+   __m128i pb   = _mm_max_epi16(ac,  _mm_sub_epi16(zero, ac));
+   __m128i pc   = _mm_max_epi16(abc, _mm_sub_epi16(zero, abc));
+   __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb),
+         _mm_cmpgt_epi16(pa, pc));
+   __m128i use_c = _mm_cmpgt_epi16(pb, pc);
+   __m128i pred  = _mm_or_si128(_mm_and_si128(use_c, c),
+         _mm_andnot_si128(use_c, b));
+
+   return _mm_or_si128(_mm_and_si128(not_a, pred),
+         _mm_andnot_si128(not_a, a));
+}
+#elif defined(RPNG_ENCODE_NEON)
+static INLINE uint8x8_t paeth_neon(uint8x8_t a, uint8x8_t b, uint8x8_t c)
+{
+   uint16x8_t pa   = vabdl_u8(b, c);
+   uint16x8_t pb   = vabdl_u8(a, c);
+   uint16x8_t pc   = vreinterpretq_u16_s16(vabsq_s16(vsubq_s16(
+               vreinterpretq_s16_u16(vaddl_u8(a, b)),
+               vreinterpretq_s16_u16(vshll_n_u8(c, 1)))));
+   uint16x8_t is_a = vandq_u16(vcleq_u16(pa, pb), vcleq_u16(pa, pc));
+   uint8x8_t pred  = vbsl_u8(vmovn_u16(vcleq_u16(pb, pc)), b, c);
+
+   return vbsl_u8(vmovn_u16(is_a), a, pred);
+}
+#endif
+
 static unsigned filter_paeth(uint8_t *target,
       const uint8_t *line, const uint8_t *prev,
       unsigned width, unsigned bpp)
 {
    unsigned i;
+#if defined(__SSE2__)
+   __m128i zero = _mm_setzero_si128();
+#endif
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - paeth(0, prev[i], 0);
-   for (i = bpp; i < width; i++)
+#if defined(__SSE2__)
+   for (; i + 16 <= width; i += 16)
+   {
+      __m128i a  = _mm_loadu_si128((const __m128i*)(line + i - bpp));
+      __m128i b  = _mm_loadu_si128((const __m128i*)(prev + i));
+      __m128i c  = _mm_loadu_si128((const __m128i*)(prev + i - bpp));
+      __m128i lo = paeth_sse2(_mm_unpacklo_epi8(a, zero),
+            _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+      __m128i hi = paeth_sse2(_mm_unpackhi_epi8(a, zero),
+            _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+      _mm_storeu_si128((__m128i*)(target + i), _mm_sub_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_packus_epi16(lo, hi)));
+   }
+#elif defined(RPNG_ENCODE_NEON)
+   for (; i + 8 <= width; i += 8)
+      vst1_u8(target + i, vsub_u8(vld1_u8(line + i),
+               paeth_neon(vld1_u8(line + i - bpp), vld1_u8(prev + i),
+                  vld1_u8(prev + i - bpp))));
+#endif
+   for (; i < width; i++)
       target[i] = line[i] - paeth(line[i - bpp], prev[i], prev[i - bpp]);
 
    return count_sad(target, width);
 }
 
+/* Strips are filtered and deflated on their own thread, then joined
+ * into a single zlib stream. Each strip but the last ends on a sync
+ * flush so the raw deflate streams can be concatenated, and is primed
+ * with the tail of the previous strip so compression barely suffers. */
+#define RPNG_MAX_WORKERS    8
+#define RPNG_MIN_STRIP_SIZE (128 * 1024)
+#define RPNG_DICT_SIZE      32768
+
+struct rpng_strip
+{
+   uint8_t *deflated;
+   size_t deflated_size;
+   unsigned first_row;
+   unsigned num_rows;
+   uint32_t adler;
+};
+
+struct rpng_encoder
+{
+   const uint8_t *data;
+   uint8_t *encode_buf;
+   struct rpng_strip *strips;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+   size_t line_size;
+   unsigned width;
+   unsigned pitch;
+   unsigned bpp;
+   unsigned num_strips;
+   unsigned next;
+   int level;
+   bool error;
+};
+
+static struct rpng_strip *rpng_encoder_next_strip(struct rpng_encoder *enc)
+{
+   struct rpng_strip *strip = NULL;
+
+#ifdef HAVE_THREADS
+   if (enc->lock)
+      slock_lock(enc->lock);
+#endif
+   if (!enc->error && enc->next < enc->num_strips)
+      strip = &enc->strips[enc->next++];
+#ifdef HAVE_THREADS
+   if (enc->lock)
+      slock_unlock(enc->lock);
+#endif
+
+   return strip;
+}
+
+static void rpng_encoder_fail(struct rpng_encoder *enc)
+{
+#ifdef HAVE_THREADS
+   if (enc->lock)
+      slock_lock(enc->lock);
+#endif
+   enc->error = true;
+#ifdef HAVE_THREADS
+   if (enc->lock)
+      slock_unlock(enc->lock);
+#endif
+}
+
+static void rpng_encoder_copy_line(const struct rpng_encoder *enc,
+      uint8_t *dst, unsigned row)
+{
+   const uint8_t *src = enc->data + (size_t)row * enc->pitch;
+
+   if (enc->bpp == sizeof(uint32_t))
+      copy_argb_line(dst, (const uint32_t*)src, enc->width);
+   else
+      copy_bgr24_line(dst, src, enc->width);
+}
+
+static void rpng_filter_worker(void *data)
+{
+   struct rpng_encoder *enc = (struct rpng_encoder*)data;
+   struct rpng_strip *strip = NULL;
+   unsigned width           = enc->width;
+   unsigned bpp             = enc->bpp;
+   size_t   size            = width * bpp;
+   uint8_t *rgba_line       = (uint8_t*)malloc(size);
+   uint8_t *prev_encoded    = (uint8_t*)malloc(size);
+   uint8_t *up_filtered     = (uint8_t*)malloc(size);
+   uint8_t *sub_filtered    = (uint8_t*)malloc(size);
+   uint8_t *avg_filtered    = (uint8_t*)malloc(size);
+   uint8_t *paeth_filtered  = (uint8_t*)malloc(size);
+
+   if (!rgba_line || !prev_encoded || !up_filtered ||
+         !sub_filtered || !avg_filtered || !paeth_filtered)
+   {
+      rpng_encoder_fail(enc);
+      goto end;
+   }
+
+   while ((strip = rpng_encoder_next_strip(enc)))
+   {
+      unsigned h;
+      uint8_t *encode_target = enc->encode_buf +
+         strip->first_row * enc->line_size;
+
+      /* The up, avg and paeth filters look at the unfiltered row
+       * above, which belongs to the previous strip */
+      if (strip->first_row)
+         rpng_encoder_copy_line(enc, prev_encoded, strip->first_row - 1);
+      else
+         memset(prev_encoded, 0, size);
+
+      for (h = strip->first_row; h < strip->first_row + strip->num_rows;
+            h++, encode_target += size)
+      {
+         rpng_encoder_copy_line(enc, rgba_line, h);
+
+         /* Try every filtering method, and choose the method
+          * which has most entries as zero.
+          *
+          * This is probably not very optimal, but it's very
+          * simple to implement.
+          */
+         {
+            uint8_t *tmp;
+            unsigned none_score  = count_sad(rgba_line, size);
+            unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
+            unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
+            unsigned avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
+            unsigned paeth_score = filter_paeth(paeth_filtered, rgba_line, prev_encoded, width, bpp);
+
+            uint8_t filter       = 0;
+            unsigned min_sad     = none_score;
+            const uint8_t *chosen_filtered = rgba_line;
+
+            if (sub_score < min_sad)
+            {
+               filter = 1;
+               chosen_filtered = sub_filtered;
+               min_sad = sub_score;
+            }
+
+            if (up_score < min_sad)
+            {
+               filter = 2;
+               chosen_filtered = up_filtered;
+               min_sad = up_score;
+            }
+
+            if (avg_score < min_sad)
+            {
+               filter = 3;
+               chosen_filtered = avg_filtered;
+               min_sad = avg_score;
+            }
+
+            if (paeth_score < min_sad)
+            {
+               filter = 4;
+               chosen_filtered = paeth_filtered;
+            }
+
+            *encode_target++ = filter;
+            memcpy(encode_target, chosen_filtered, size);
+
+            tmp          = prev_encoded;
+            prev_encoded = rgba_line;
+            rgba_line    = tmp;
+         }
+      }
+   }
+
+end:
+   free(rgba_line);
+   free(prev_encoded);
+   free(up_filtered);
+   free(sub_filtered);
+   free(avg_filtered);
+   free(paeth_filtered);
+}
+
+/* Adler-32 of the concatenation of two buffers, given the checksum
+ * of each and the length of the second. Not every zlib build that
+ * ships with RetroArch provides adler32_combine. */
+static uint32_t rpng_adler32_combine(uint32_t adler1, uint32_t adler2,
+      size_t len2)
+{
+   const uint32_t base = 65521;
+   uint32_t rem        = (uint32_t)(len2 % base);
+   uint32_t sum1       = adler1 & 0xffff;
+   uint32_t sum2       = (rem * sum1) % base;
+
+   sum1 += (adler2 & 0xffff) + base - 1;
+   sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + base - rem;
+   if (sum1 >= base)
+      sum1 -= base;
+   if (sum1 >= base)
+      sum1 -= base;
+   if (sum2 >= (base << 1))
+      sum2 -= (base << 1);
+   if (sum2 >= base)
+      sum2 -= base;
+   return sum1 | (sum2 << 16);
+}
+
+static bool rpng_deflate_strip(struct rpng_encoder *enc,
+      struct rpng_strip *strip)
+{
+   z_stream z;
+   int zret;
+   bool last          = strip == &enc->strips[enc->num_strips - 1];
+   size_t offset      = strip->first_row * enc->line_size;
+   size_t size        = strip->num_rows  * enc->line_size;
+   size_t dict_size   = offset < RPNG_DICT_SIZE ? offset : RPNG_DICT_SIZE;
+   uint8_t *in        = enc->encode_buf + offset;
+
+   memset(&z, 0, sizeof(z));
+   if (deflateInit2(&z, enc->level, Z_DEFLATED, -MAX_WBITS, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK)
+      return false;
+
+   if (dict_size)
+      deflateSetDictionary(&z, in - dict_size, (uInt)dict_size);
+
+   /* deflateBound does not count the sync flush marker */
+   strip->deflated_size = deflateBound(&z, (uLong)size) + 16;
+   strip->deflated      = (uint8_t*)malloc(strip->deflated_size);
+   if (!strip->deflated)
+   {
+      deflateEnd(&z);
+      return false;
+   }
+
+   z.next_in   = in;
+   z.avail_in  = (uInt)size;
+   z.next_out  = strip->deflated;
+   z.avail_out = (uInt)strip->deflated_size;
+   zret        = deflate(&z, last ? Z_FINISH : Z_SYNC_FLUSH);
+
+   strip->deflated_size -= z.avail_out;
+   strip->adler          = (uint32_t)adler32(adler32(0L, Z_NULL, 0),
+         in, (uInt)size);
+   deflateEnd(&z);
+
+   if (last)
+      return zret == Z_STREAM_END;
+   return zret == Z_OK && z.avail_in == 0 && z.avail_out != 0;
+}
+
+static void rpng_deflate_worker(void *data)
+{
+   struct rpng_encoder *enc = (struct rpng_encoder*)data;
+   struct rpng_strip *strip = NULL;
+
+   while ((strip = rpng_encoder_next_strip(enc)))
+   {
+      if (!rpng_deflate_strip(enc, strip))
+         rpng_encoder_fail(enc);
+   }
+}
+
+static bool rpng_encoder_run(struct rpng_encoder *enc,
+      void (*worker)(void *data))
+{
+#ifdef HAVE_THREADS
+   unsigned i;
+   sthread_t *threads[RPNG_MAX_WORKERS];
+
+   enc->next = 0;
+
+   /* the calling thread is a worker too */
+   for (i = 1; i < enc->num_strips; i++)
+      threads[i] = sthread_create(worker, enc);
+
+   worker(enc);
+
+   for (i = 1; i < enc->num_strips; i++)
+      if (threads[i])
+         sthread_join(threads[i]);
+#else
+   enc->next = 0;
+   worker(enc);
+#endif
+
+   return !enc->error;
+}
+
 static bool rpng_save_image(const char *path,
       const uint8_t *data,
-      unsigned width, unsigned height, unsigned pitch, unsigned bpp)
+      unsigned width, unsigned height, unsigned pitch, unsigned bpp,
+      int level)
 {
-   unsigned h;
+   unsigned i;
    bool ret = true;
    struct png_ihdr ihdr = {0};
+   struct rpng_encoder enc;
+   struct rpng_strip strips[RPNG_MAX_WORKERS];
 
-   const struct trans_stream_backend *stream_backend = NULL;
    size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
-   uint8_t *up_filtered    = NULL;
-   uint8_t *sub_filtered   = NULL;
-   uint8_t *avg_filtered   = NULL;
-   uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
-   void *stream            = NULL;
-   uint32_t total_in       = 0;
-   uint32_t total_out      = 0;
+   size_t idat_size        = 0;
+   uint8_t *idat           = NULL;
+   uint8_t *idat_target    = NULL;
+   uint8_t zlib_header[2];
+   uint32_t adler          = 0;
+   unsigned num_strips     = 1;
    RFILE *file             = filestream_open(path,
          RETRO_VFS_FILE_ACCESS_WRITE,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   memset(&enc, 0, sizeof(enc));
+   memset(strips, 0, sizeof(strips));
+
    if (!file)
       GOTO_END_ERROR();
 
-   stream_backend = trans_stream_get_zlib_deflate_backend();
-
    if (filestream_write(file, png_magic, sizeof(png_magic)) != sizeof(png_magic))
       GOTO_END_ERROR();
 
@@ -249,108 +670,81 @@ static bool rpng_save_image(const char *path,
       GOTO_END_ERROR();
 
    encode_buf_size = (width * bpp + 1) * height;
-   encode_buf = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
 
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
-
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
-
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+#ifdef HAVE_THREADS
+   num_strips = cpu_features_get_core_amount();
+   if (num_strips > RPNG_MAX_WORKERS)
+      num_strips = RPNG_MAX_WORKERS;
+   if (num_strips > encode_buf_size / RPNG_MIN_STRIP_SIZE)
+      num_strips = (unsigned)(encode_buf_size / RPNG_MIN_STRIP_SIZE);
+   if (num_strips > height)
+      num_strips = height;
+   if (num_strips < 1)
+      num_strips = 1;
+#endif
+
+   for (i = 0; i < num_strips; i++)
    {
-      if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
-      else
-         copy_bgr24_line(rgba_line, data, width);
-
-      /* Try every filtering method, and choose the method
-       * which has most entries as zero.
-       *
-       * This is probably not very optimal, but it's very
-       * simple to implement.
-       */
-      {
-         unsigned none_score  = count_sad(rgba_line, width * bpp);
-         unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
-         unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
-         unsigned avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
-         unsigned paeth_score = filter_paeth(paeth_filtered, rgba_line, prev_encoded, width, bpp);
-
-         uint8_t filter       = 0;
-         unsigned min_sad     = none_score;
-         const uint8_t *chosen_filtered = rgba_line;
-
-         if (sub_score < min_sad)
-         {
-            filter = 1;
-            chosen_filtered = sub_filtered;
-            min_sad = sub_score;
-         }
-
-         if (up_score < min_sad)
-         {
-            filter = 2;
-            chosen_filtered = up_filtered;
-            min_sad = up_score;
-         }
-
-         if (avg_score < min_sad)
-         {
-            filter = 3;
-            chosen_filtered = avg_filtered;
-            min_sad = avg_score;
-         }
-
-         if (paeth_score < min_sad)
-         {
-            filter = 4;
-            chosen_filtered = paeth_filtered;
-         }
+      strips[i].first_row = (unsigned)(((uint64_t)height * i) / num_strips);
+      strips[i].num_rows  = (unsigned)(((uint64_t)height * (i + 1))
+            / num_strips) - strips[i].first_row;
+   }
 
-         *encode_target++ = filter;
-         memcpy(encode_target, chosen_filtered, width * bpp);
+   enc.data       = data;
+   enc.strips     = strips;
+   enc.num_strips = num_strips;
+   enc.line_size  = width * bpp + 1;
+   enc.width      = width;
+   enc.pitch      = pitch;
+   enc.bpp        = bpp;
+   enc.level      = level;
+   enc.encode_buf = (uint8_t*)malloc(encode_buf_size);
+   if (!enc.encode_buf)
+      GOTO_END_ERROR();
 
-         memcpy(prev_encoded, rgba_line, width * bpp);
-      }
-   }
+#ifdef HAVE_THREADS
+   if (num_strips > 1 && !(enc.lock = slock_new()))
+      GOTO_END_ERROR();
+#endif
 
-   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
-   if (!deflate_buf)
+   /* Strips are deflated only once all of them are filtered,
+    * as each one uses the end of the previous one as dictionary */
+   if (!rpng_encoder_run(&enc, rpng_filter_worker))
       GOTO_END_ERROR();
+   if (!rpng_encoder_run(&enc, rpng_deflate_worker))
+      GOTO_END_ERROR();
+
+   /* zlib header for a 32K window, FLEVEL taken from the level
+    * the way zlib fills it in */
+   zlib_header[0] = 0x78;
+   zlib_header[1] = (level < 2 ? 0 : level < 6 ? 1 : level == 6 ? 2 : 3) << 6;
+   zlib_header[1] += 31 - ((zlib_header[0] << 8) + zlib_header[1]) % 31;
 
-   stream = stream_backend->stream_new();
+   idat_size = 8 + sizeof(zlib_header) + 4;
+   for (i = 0; i < num_strips; i++)
+      idat_size += strips[i].deflated_size;
 
-   if (!stream)
+   idat = (uint8_t*)malloc(idat_size);
+   if (!idat)
       GOTO_END_ERROR();
 
-   stream_backend->set_in(
-         stream,
-         encode_buf,
-         (unsigned)encode_buf_size);
-   stream_backend->set_out(
-         stream,
-         deflate_buf + 8,
-         (unsigned)(encode_buf_size * 2));
+   idat_target = idat + 8;
+   memcpy(idat_target, zlib_header, sizeof(zlib_header));
+   idat_target += sizeof(zlib_header);
 
-   if (!stream_backend->trans(stream, true, &total_in, &total_out, NULL))
+   adler = 1;
+   for (i = 0; i < num_strips; i++)
    {
-      GOTO_END_ERROR();
+      memcpy(idat_target, strips[i].deflated, strips[i].deflated_size);
+      idat_target += strips[i].deflated_size;
+      adler        = rpng_adler32_combine(adler, strips[i].adler,
+            strips[i].num_rows * enc.line_size);
    }
+   dword_write_be(idat_target, adler);
 
-   memcpy(deflate_buf + 4, "IDAT", 4);
-   dword_write_be(deflate_buf + 0,        ((uint32_t)total_out));
-   if (!png_write_idat(file, deflate_buf, ((size_t)total_out + 8)))
+   memcpy(idat + 4, "IDAT", 4);
+   dword_write_be(idat + 0, (uint32_t)(idat_size - 8));
+   if (!png_write_idat(file, idat, idat_size))
       GOTO_END_ERROR();
 
    if (!png_write_iend(file))
@@ -359,23 +753,14 @@ static bool rpng_save_image(const char *path,
 end:
    if (file)
       filestream_close(file);
-   free(encode_buf);
-   free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
-
-   if (stream_backend)
-   {
-      if (stream)
-      {
-         if (stream_backend->stream_free)
-            stream_backend->stream_free(stream);
-      }
-   }
+   for (i = 0; i < RPNG_MAX_WORKERS; i++)
+      free(strips[i].deflated);
+#ifdef HAVE_THREADS
+   if (enc.lock)
+      slock_free(enc.lock);
+#endif
+   free(enc.encode_buf);
+   free(idat);
    return ret;
 }
 
@@ -383,12 +768,19 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, sizeof(uint32_t));
+         width, height, pitch, sizeof(uint32_t), Z_BEST_COMPRESSION);
 }
 
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch)
 {
    return rpng_save_image(path, (const uint8_t*)data,
-         width, height, pitch, 3);
+         width, height, pitch, 3, Z_BEST_COMPRESSION);
+}
+
+bool rpng_save_image_bgr24_fast(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch)
+{
+   return rpng_save_image(path, (const uint8_t*)data,
+         width, height, pitch, 3, Z_BEST_SPEED);
 }
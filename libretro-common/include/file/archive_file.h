@@ -40,6 +40,7 @@
 RETRO_BEGIN_DECLS
 
 struct archive_extract_userdata;
+struct string_list;
 
 enum file_archive_transfer_type
 {
@@ -143,6 +144,18 @@ struct file_archive_file_backend
       const char *valid_exts,
       struct archive_extract_userdata *userdata,
       file_archive_file_cb file_cb);
+   /* Calls file_cb for every file with only what the directory
+    * of the archive tells (cdata is NULL), without reading the
+    * files themselves. Returns -1 on error. */
+   int (*archive_parse_directory)(const char *path,
+      const char *valid_exts,
+      struct archive_extract_userdata *userdata,
+      file_archive_file_cb file_cb);
+   /* Decompresses the files @names and stores the CRC32 of
+    * their contents in @crcs, 0 for files which couldn't be
+    * read. Returns false if the archive couldn't be read. */
+   bool (*archive_hash_files)(const char *path,
+      const struct string_list *names, uint32_t *crcs);
    const char *ident;
 };
 
@@ -208,6 +221,70 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
  **/
 uint32_t file_archive_get_file_crc32(const char *path);
 
+/**
+ * file_archive_get_file_crc32s:
+ * @path                         : filename path of archive
+ * @names                        : paths of files inside the archive
+ * @crcs                         : CRC32 of each file of @names
+ *
+ * Gets the CRC32 of several files of an archive, reading the
+ * directory of the archive only once. Files the directory has
+ * no CRC32 for are decompressed and hashed, several at once
+ * when threads are available.
+ *
+ * Returns: true (1) if the archive could be read, otherwise
+ * false (0). The CRC32 of files not found in the archive is 0.
+ **/
+bool file_archive_get_file_crc32s(const char *path,
+      const struct string_list *names, uint32_t *crcs);
+
+/**
+ * file_archive_run_workers:
+ * @worker                       : function pulling jobs from @data
+ * @data                         : jobs shared by the workers
+ * @num_jobs                     : number of jobs
+ *
+ * Runs @worker on as many threads as useful for @num_jobs
+ * jobs, the calling thread included, and waits for them.
+ * Without threads @worker only runs on the calling thread.
+ **/
+void file_archive_run_workers(void (*worker)(void *data), void *data,
+      size_t num_jobs);
+
+struct file_archive_name
+{
+   const char *name;
+   size_t len;
+   /* Position of the name in the list it was sorted from */
+   size_t index;
+};
+
+/**
+ * file_archive_sort_names:
+ * @names                        : names to look up
+ *
+ * Sorts @names once so that the names of the files of an
+ * archive can be looked up in it with file_archive_find_name.
+ *
+ * Returns: array of @names->size entries, to be freed by the
+ * caller, or NULL on failure.
+ **/
+struct file_archive_name *file_archive_sort_names(
+      const struct string_list *names);
+
+/**
+ * file_archive_find_name:
+ * @sorted                       : names sorted by file_archive_sort_names
+ * @count                        : number of entries in @sorted
+ * @name                         : name to look for, not NUL terminated
+ * @len                          : length of @name
+ *
+ * Returns: position in @sorted of the first entry equal to
+ * @name, the others follow it, otherwise @count.
+ **/
+size_t file_archive_find_name(const struct file_archive_name *sorted,
+      size_t count, const char *name, size_t len);
+
 extern const struct file_archive_file_backend zlib_backend;
 extern const struct file_archive_file_backend sevenzip_backend;
 
@@ -56,6 +56,12 @@ bool rpng_save_image_argb(const char *path, const uint32_t *data,
 bool rpng_save_image_bgr24(const char *path, const uint8_t *data,
       unsigned width, unsigned height, unsigned pitch);
 
+/* Same as rpng_save_image_bgr24, trading file size for encode time.
+ * Meant for images written in the middle of gameplay, such as
+ * savestate thumbnails. */
+bool rpng_save_image_bgr24_fast(const char *path, const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch);
+
 RETRO_END_DECLS
 
 #endif
@@ -23,6 +23,8 @@
 #ifndef __LIBRETRO_SDK_DIR_LIST_H
 #define __LIBRETRO_SDK_DIR_LIST_H
 
+#include <stdint.h>
+
 #include <retro_common_api.h>
 
 #include <lists/string_list.h>
@@ -82,6 +84,38 @@ void dir_list_sort(struct string_list *list, bool dir_first);
  **/
 void dir_list_free(struct string_list *list);
 
+/**
+ * dir_list_cache_init:
+ *
+ * Sets up the process-wide cache of directory listings.
+ * Must be called once at startup, before other threads list
+ * directories. Until then listings aren't cached.
+ **/
+void dir_list_cache_init(void);
+
+/**
+ * dir_list_cache_changed:
+ * @dir        : directory path.
+ * @generation : generation returned by the previous call for
+ *               this directory, 0 if there was none.
+ *
+ * Tells whether the contents of a directory may have changed
+ * since an earlier call. Listings are cached process-wide, so
+ * this is cheap, and rescans can skip the directories which
+ * didn't change.
+ *
+ * Returns: true (1) if the directory may have changed,
+ * otherwise false (0).
+ **/
+bool dir_list_cache_changed(const char *dir, uint64_t *generation);
+
+/**
+ * dir_list_cache_deinit:
+ *
+ * Frees the process-wide cache of directory listings.
+ **/
+void dir_list_cache_deinit(void);
+
 RETRO_END_DECLS
 
 #endif
@@ -21,6 +21,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 
 #if defined(_WIN32) && defined(_XBOX)
 #include <xtl.h>
@@ -28,6 +29,18 @@
 #include <windows.h>
 #endif
 
+#ifdef __linux__
+#include <linux/version.h>
+/* inotify API was added in 2.6.13 */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(2,6,13)
+#define DIR_LIST_CACHE_INOTIFY
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+#endif
+
 #include <lists/dir_list.h>
 #include <lists/string_list.h>
 #include <file/file_path.h>
@@ -38,6 +51,509 @@
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+/* Process-wide cache of the raw contents of directories.
+ *
+ * Only directories watched by inotify are cached, a listing is
+ * used until an entry of its directory is reported as created,
+ * deleted or moved. Size and modification time alone can't be
+ * trusted, FAT and exFAT only keep the latter to two seconds and
+ * some file systems don't update it for every change, so without
+ * a watch directories are read each time.
+ *
+ * Every detected change bumps a generation counter, which lets
+ * callers ask whether a directory changed since they last looked.
+ *
+ * dir_list_cache_init() must be called before any other thread
+ * lists directories, until then nothing is cached. */
+
+#define DIR_LIST_CACHE_MAX_DIRS 128
+
+typedef struct dir_list_cache_listing
+{
+   char *names;
+   size_t *offsets;
+   bool *is_dir;
+   size_t count;
+   unsigned refs;
+} dir_list_cache_listing_t;
+
+typedef struct
+{
+   char *path;
+   /* NULL once invalidated, the directory is still tracked */
+   dir_list_cache_listing_t *listing;
+   int64_t size;
+   int64_t mtime;
+   /* Generation of the last change */
+   uint64_t changed;
+   uint64_t used;
+   int wd;
+   bool include_hidden;
+} dir_list_cache_dir_t;
+
+static dir_list_cache_dir_t dir_list_cache_dirs[DIR_LIST_CACHE_MAX_DIRS];
+static size_t dir_list_cache_count      = 0;
+static uint64_t dir_list_cache_gen      = 0;
+static uint64_t dir_list_cache_clock    = 0;
+static bool dir_list_cache_initialized  = false;
+static int dir_list_cache_inotify_fd    = -1;
+#ifdef HAVE_THREADS
+static slock_t *dir_list_cache_lock     = NULL;
+#endif
+
+static void dir_list_cache_lock_acquire(void)
+{
+#ifdef HAVE_THREADS
+   if (dir_list_cache_lock)
+      slock_lock(dir_list_cache_lock);
+#endif
+}
+
+static void dir_list_cache_lock_release(void)
+{
+#ifdef HAVE_THREADS
+   if (dir_list_cache_lock)
+      slock_unlock(dir_list_cache_lock);
+#endif
+}
+
+static void dir_list_cache_listing_release(dir_list_cache_listing_t *listing)
+{
+   if (!listing || --listing->refs)
+      return;
+
+   free(listing->names);
+   free(listing->offsets);
+   free(listing->is_dir);
+   free(listing);
+}
+
+/* Reads a directory, returns NULL on error */
+static dir_list_cache_listing_t *dir_list_cache_listing_read(
+      const char *dir, bool include_hidden)
+{
+   size_t names_size              = 0;
+   size_t names_capacity          = 4096;
+   size_t capacity                = 64;
+   dir_list_cache_listing_t *listing = NULL;
+   struct RDIR *entry             = retro_opendir_include_hidden(
+         dir, include_hidden);
+
+   if (!entry || retro_dirent_error(entry))
+      goto error;
+
+   if (!(listing = (dir_list_cache_listing_t*)calloc(1, sizeof(*listing))))
+      goto error;
+
+   listing->refs    = 1;
+   listing->names   = (char*)malloc(names_capacity);
+   listing->offsets = (size_t*)malloc(capacity * sizeof(*listing->offsets));
+   listing->is_dir  = (bool*)malloc(capacity * sizeof(*listing->is_dir));
+
+   if (!listing->names || !listing->offsets || !listing->is_dir)
+      goto error;
+
+   while (retro_readdir(entry))
+   {
+      const char *name = retro_dirent_get_name(entry);
+      size_t len       = strlen(name) + 1;
+
+      if (!strcmp(name, ".") || !strcmp(name, ".."))
+         continue;
+
+      if (listing->count == capacity)
+      {
+         size_t *offsets;
+         bool *is_dir;
+
+         capacity <<= 1;
+
+         if (!(offsets = (size_t*)realloc(listing->offsets,
+                     capacity * sizeof(*offsets))))
+            goto error;
+         listing->offsets = offsets;
+
+         if (!(is_dir = (bool*)realloc(listing->is_dir,
+                     capacity * sizeof(*is_dir))))
+            goto error;
+         listing->is_dir = is_dir;
+      }
+
+      if (names_size + len > names_capacity)
+      {
+         char *names;
+
+         while (names_size + len > names_capacity)
+            names_capacity <<= 1;
+
+         if (!(names = (char*)realloc(listing->names, names_capacity)))
+            goto error;
+         listing->names = names;
+      }
+
+      memcpy(listing->names + names_size, name, len);
+      listing->offsets[listing->count] = names_size;
+      listing->is_dir[listing->count]  = retro_dirent_is_dir(entry, NULL);
+      listing->count++;
+      names_size                      += len;
+   }
+
+   retro_closedir(entry);
+   return listing;
+
+error:
+   if (entry)
+      retro_closedir(entry);
+   if (listing)
+   {
+      listing->refs = 1;
+      dir_list_cache_listing_release(listing);
+   }
+   return NULL;
+}
+
+/**
+ * dir_list_cache_init:
+ *
+ * Sets up the directory cache.
+ **/
+void dir_list_cache_init(void)
+{
+   if (dir_list_cache_initialized)
+      return;
+
+#ifdef HAVE_THREADS
+   dir_list_cache_lock        = slock_new();
+#endif
+
+#ifdef DIR_LIST_CACHE_INOTIFY
+   dir_list_cache_inotify_fd  = inotify_init();
+
+   if (dir_list_cache_inotify_fd >= 0)
+   {
+      int flags = fcntl(dir_list_cache_inotify_fd, F_GETFL);
+
+      fcntl(dir_list_cache_inotify_fd, F_SETFD, FD_CLOEXEC);
+
+      if (fcntl(dir_list_cache_inotify_fd, F_SETFL, flags | O_NONBLOCK))
+      {
+         close(dir_list_cache_inotify_fd);
+         dir_list_cache_inotify_fd = -1;
+      }
+   }
+#endif
+
+   dir_list_cache_initialized = true;
+}
+
+static void dir_list_cache_invalidate_dir(dir_list_cache_dir_t *cached)
+{
+   dir_list_cache_listing_release(cached->listing);
+   cached->listing = NULL;
+   cached->changed = ++dir_list_cache_gen;
+}
+
+static void dir_list_cache_remove_dir(size_t i)
+{
+   dir_list_cache_dir_t *cached = &dir_list_cache_dirs[i];
+
+#ifdef DIR_LIST_CACHE_INOTIFY
+   if (cached->wd >= 0)
+   {
+      size_t j;
+      bool shared = false;
+
+      /* Watches are per inode, a directory listed with and
+       * without hidden files shares its watch */
+      for (j = 0; j < dir_list_cache_count; j++)
+         if (j != i && dir_list_cache_dirs[j].wd == cached->wd)
+            shared = true;
+
+      if (!shared)
+         inotify_rm_watch(dir_list_cache_inotify_fd, cached->wd);
+   }
+#endif
+
+   dir_list_cache_listing_release(cached->listing);
+   free(cached->path);
+
+   *cached = dir_list_cache_dirs[--dir_list_cache_count];
+}
+
+/* Applies the changes reported by inotify since the last call */
+static void dir_list_cache_poll(void)
+{
+#ifdef DIR_LIST_CACHE_INOTIFY
+   char buffer[4096];
+   ssize_t length;
+
+   if (dir_list_cache_inotify_fd < 0)
+      return;
+
+   while ((length = read(dir_list_cache_inotify_fd,
+               buffer, sizeof(buffer))) > 0)
+   {
+      ssize_t i = 0;
+
+      while (i + (ssize_t)sizeof(struct inotify_event) <= length)
+      {
+         size_t j;
+         const struct inotify_event *event =
+            (const struct inotify_event*)&buffer[i];
+
+         for (j = 0; j < dir_list_cache_count; j++)
+         {
+            dir_list_cache_dir_t *cached = &dir_list_cache_dirs[j];
+
+            if (!(event->mask & IN_Q_OVERFLOW) && cached->wd != event->wd)
+               continue;
+
+            dir_list_cache_invalidate_dir(cached);
+
+            if (event->mask & IN_IGNORED)
+               cached->wd = -1;
+         }
+
+         i += sizeof(struct inotify_event) + event->len;
+      }
+   }
+#endif
+}
+
+static dir_list_cache_dir_t *dir_list_cache_find(const char *dir,
+      bool include_hidden)
+{
+   size_t i;
+
+   for (i = 0; i < dir_list_cache_count; i++)
+   {
+      dir_list_cache_dir_t *cached = &dir_list_cache_dirs[i];
+
+      if (cached->include_hidden == include_hidden
+            && string_is_equal(cached->path, dir))
+         return cached;
+   }
+
+   return NULL;
+}
+
+/* Starts tracking a directory, evicting the least recently used */
+static dir_list_cache_dir_t *dir_list_cache_add(const char *dir,
+      bool include_hidden)
+{
+   dir_list_cache_dir_t *cached = NULL;
+
+   if (dir_list_cache_count == DIR_LIST_CACHE_MAX_DIRS)
+   {
+      size_t i;
+      size_t lru = 0;
+
+      for (i = 1; i < dir_list_cache_count; i++)
+         if (dir_list_cache_dirs[i].used < dir_list_cache_dirs[lru].used)
+            lru = i;
+
+      dir_list_cache_remove_dir(lru);
+   }
+
+   cached                 = &dir_list_cache_dirs[dir_list_cache_count];
+   memset(cached, 0, sizeof(*cached));
+
+   if (!(cached->path = strdup(dir)))
+      return NULL;
+
+   cached->include_hidden = include_hidden;
+   cached->size           = -1;
+   cached->mtime          = -1;
+   cached->changed        = ++dir_list_cache_gen;
+   cached->wd             = -1;
+
+#ifdef DIR_LIST_CACHE_INOTIFY
+   if (dir_list_cache_inotify_fd >= 0)
+      cached->wd          = inotify_add_watch(dir_list_cache_inotify_fd, dir,
+            IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO
+            | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+#endif
+
+   dir_list_cache_count++;
+   return cached;
+}
+
+/* Compares a tracked directory with its current state */
+static void dir_list_cache_validate(dir_list_cache_dir_t *cached,
+      int64_t size, int64_t mtime)
+{
+   if (cached->size != size || cached->mtime != mtime)
+   {
+      dir_list_cache_invalidate_dir(cached);
+      cached->size  = size;
+      cached->mtime = mtime;
+   }
+}
+
+/* Returns a reference to the listing of a directory,
+ * or NULL if it can't be read */
+static dir_list_cache_listing_t *dir_list_cache_acquire(const char *dir,
+      bool include_hidden)
+{
+   int64_t size                      = 0;
+   int64_t mtime                     = 0;
+   dir_list_cache_dir_t *cached      = NULL;
+   dir_list_cache_listing_t *listing = NULL;
+
+   /* Can't tell when such a directory changes */
+   if (     !dir_list_cache_initialized
+         || dir_list_cache_inotify_fd < 0
+         || !path_get_size_mtime(dir, &size, &mtime))
+      return dir_list_cache_listing_read(dir, include_hidden);
+
+   dir_list_cache_lock_acquire();
+
+   dir_list_cache_poll();
+
+   if (!(cached = dir_list_cache_find(dir, include_hidden)))
+      cached = dir_list_cache_add(dir, include_hidden);
+
+   if (cached)
+   {
+      dir_list_cache_validate(cached, size, mtime);
+      cached->used = ++dir_list_cache_clock;
+
+      if (cached->listing && cached->wd >= 0)
+      {
+         listing = cached->listing;
+         listing->refs++;
+      }
+   }
+
+   dir_list_cache_lock_release();
+
+   if (listing)
+      return listing;
+
+   /* Read without holding the lock, the directory is already
+    * watched so changes made while reading it aren't lost */
+   listing = dir_list_cache_listing_read(dir, include_hidden);
+
+   if (!listing)
+      return NULL;
+
+   dir_list_cache_lock_acquire();
+
+   dir_list_cache_poll();
+
+   /* Only keep it if the directory didn't change meanwhile */
+   if (     (cached = dir_list_cache_find(dir, include_hidden))
+         && !cached->listing
+         && cached->wd >= 0
+         && cached->size  == size
+         && cached->mtime == mtime)
+   {
+      cached->listing = listing;
+      listing->refs++;
+   }
+
+   dir_list_cache_lock_release();
+
+   return listing;
+}
+
+/**
+ * dir_list_cache_changed:
+ * @dir        : directory path.
+ * @generation : generation returned by the previous call for
+ *               this directory, 0 if there was none.
+ *
+ * Tells whether the contents of a directory may have changed
+ * since an earlier call, so that rescans can skip directories
+ * which didn't. Directories which aren't tracked yet, or can't
+ * be, are always reported as changed.
+ *
+ * Returns: true (1) if the directory may have changed,
+ * otherwise false (0). @generation is set to the current
+ * generation in both cases.
+ **/
+bool dir_list_cache_changed(const char *dir, uint64_t *generation)
+{
+   size_t i;
+   int64_t size                 = 0;
+   int64_t mtime                = 0;
+   bool tracked                 = false;
+   bool changed                 = false;
+
+   if (     !dir_list_cache_initialized
+         || dir_list_cache_inotify_fd < 0
+         || !path_get_size_mtime(dir, &size, &mtime))
+   {
+      *generation               = dir_list_cache_gen;
+      return true;
+   }
+
+   dir_list_cache_lock_acquire();
+
+   dir_list_cache_poll();
+
+   for (i = 0; i < dir_list_cache_count; i++)
+   {
+      dir_list_cache_dir_t *cached = &dir_list_cache_dirs[i];
+
+      if (!string_is_equal(cached->path, dir))
+         continue;
+
+      dir_list_cache_validate(cached, size, mtime);
+
+      tracked = true;
+      changed = changed || cached->changed > *generation || cached->wd < 0;
+   }
+
+   /* Start tracking it, the caller is about to look at it */
+   if (!tracked)
+   {
+      dir_list_cache_dir_t *cached = dir_list_cache_add(dir, false);
+
+      if (cached)
+         dir_list_cache_validate(cached, size, mtime);
+
+      changed   = true;
+   }
+
+   *generation  = dir_list_cache_gen;
+
+   dir_list_cache_lock_release();
+
+   return changed;
+}
+
+/**
+ * dir_list_cache_deinit:
+ *
+ * Frees the directory cache.
+ **/
+void dir_list_cache_deinit(void)
+{
+   if (!dir_list_cache_initialized)
+      return;
+
+   while (dir_list_cache_count)
+      dir_list_cache_remove_dir(dir_list_cache_count - 1);
+
+#ifdef DIR_LIST_CACHE_INOTIFY
+   if (dir_list_cache_inotify_fd >= 0)
+      close(dir_list_cache_inotify_fd);
+   dir_list_cache_inotify_fd  = -1;
+#endif
+
+#ifdef HAVE_THREADS
+   slock_free(dir_list_cache_lock);
+   dir_list_cache_lock        = NULL;
+#endif
+
+   dir_list_cache_initialized = false;
+}
+
 static int qstrcmp_plain(const void *a_, const void *b_)
 {
    const struct string_list_elem *a = (const struct string_list_elem*)a_;
@@ -105,26 +621,26 @@ static int dir_list_read(const char *dir,
       bool include_dirs, bool include_hidden,
       bool include_compressed, bool recursive)
 {
-   struct RDIR *entry = retro_opendir_include_hidden(dir, include_hidden);
+   size_t i;
+   dir_list_cache_listing_t *listing = dir_list_cache_acquire(
+         dir, include_hidden);
 
-   if (!entry || retro_dirent_error(entry))
-      goto error;
+   if (!listing)
+      return -1;
 
-   while (retro_readdir(entry))
+   for (i = 0; i < listing->count; i++)
    {
       union string_list_elem_attr attr;
       char file_path[PATH_MAX_LENGTH];
-      const char *name                = retro_dirent_get_name(entry);
+      const char *name                = listing->names + listing->offsets[i];
 
       if (!include_hidden && *name == '.')
          continue;
-      if (!strcmp(name, ".") || !strcmp(name, ".."))
-         continue;
 
       file_path[0] = '\0';
       fill_pathname_join(file_path, dir, name, sizeof(file_path));
 
-      if (retro_dirent_is_dir(entry, NULL))
+      if (listing->is_dir[i])
       {
          if (recursive)
             dir_list_read(file_path, list, ext_list, include_dirs,
@@ -166,13 +682,16 @@ static int dir_list_read(const char *dir,
          goto error;
    }
 
-   retro_closedir(entry);
+   dir_list_cache_lock_acquire();
+   dir_list_cache_listing_release(listing);
+   dir_list_cache_lock_release();
 
    return 0;
 
 error:
-   if (entry)
-      retro_closedir(entry);
+   dir_list_cache_lock_acquire();
+   dir_list_cache_listing_release(listing);
+   dir_list_cache_lock_release();
    return -1;
 }
 
@@ -27,13 +27,38 @@
 #include <boolean.h>
 
 #include <streams/chd_stream.h>
+#include <compat/posix_string.h>
 #include <retro_endianness.h>
 #include <libchdr/chd.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #define SECTOR_SIZE 2352
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
 
+/* Decompressed hunks kept per stream, allocated as they get used */
+#define CHDSTREAM_CACHE_HUNKS 16
+/* Hunks decompressed ahead of sequential reads, leaves two
+ * cache slots free for the current hunk and the caller */
+#define CHDSTREAM_READAHEAD_HUNKS 4
+
+/* One decompressed hunk held by the stream's hunk cache */
+typedef struct chdstream_hunk
+{
+   uint8_t *data;
+   /* Hunk number held in data */
+   uint32_t hunknum;
+   /* LRU stamp, larger is more recent */
+   uint32_t last_used;
+   /* data holds hunknum */
+   bool valid;
+   /* hunknum is being decompressed into data */
+   bool pending;
+} chdstream_hunk_t;
+
 struct chdstream
 {
    chd_file *chd;
@@ -55,8 +80,33 @@ struct chdstream
    size_t offset;
    /* Loaded hunk number */
    int32_t hunknum;
-   /* Loaded hunk */
+   /* Loaded hunk, points into the cache slot of hunknum */
    uint8_t *hunkmem;
+   /* Previously loaded hunk number, used to detect sequential access */
+   int32_t last_hunknum;
+   /* Decompressed hunk cache, least recently used slot is evicted */
+   chdstream_hunk_t *cache;
+   unsigned cache_size;
+   /* Cache slot of hunknum, never evicted by the read-ahead worker */
+   int current;
+   uint32_t clock;
+#ifdef HAVE_THREADS
+   /* The worker is only started once reads turn out sequential,
+    * streams opened for a few sectors don't pay for it */
+   char *path;
+   bool readahead_tried;
+   /* Second handle on the same file, so the worker can decompress
+    * while the caller decompresses or copies out of the cache */
+   chd_file *readahead_chd;
+   sthread_t *readahead_thread;
+   slock_t *lock;
+   scond_t *cond;
+   /* Hunks the worker should decompress, [next, end) */
+   uint32_t readahead_next;
+   uint32_t readahead_end;
+   unsigned readahead;
+   bool quit;
+#endif
 };
 
 typedef struct metadata {
@@ -199,6 +249,217 @@ chdstream_find_track(chd_file *fd, int32_t track, metadata_t *meta)
    return chdstream_find_track_number(fd, track, meta);
 }
 
+static void chdstream_lock(chdstream_t *stream)
+{
+#ifdef HAVE_THREADS
+   if (stream->lock)
+      slock_lock(stream->lock);
+#endif
+}
+
+static void chdstream_unlock(chdstream_t *stream)
+{
+#ifdef HAVE_THREADS
+   if (stream->lock)
+      slock_unlock(stream->lock);
+#endif
+}
+
+static void chdstream_wait(chdstream_t *stream)
+{
+#ifdef HAVE_THREADS
+   scond_wait(stream->cond, stream->lock);
+#endif
+}
+
+static void chdstream_signal(chdstream_t *stream)
+{
+#ifdef HAVE_THREADS
+   if (stream->cond)
+      scond_broadcast(stream->cond);
+#endif
+}
+
+/* Decompresses a hunk into dest, which may be a cache slot. Must be
+ * called without the stream lock held. */
+static bool
+chdstream_decompress_hunk(chdstream_t *stream, chd_file *chd,
+      uint32_t hunknum, uint8_t *dest)
+{
+   uint32_t i;
+   uint32_t count;
+   uint16_t *array;
+
+   if (chd_read(chd, hunknum, dest) != CHDERR_NONE)
+      return false;
+
+   if (stream->swab)
+   {
+      count = chd_get_header(chd)->hunkbytes / 2;
+      array = (uint16_t*)dest;
+      for (i = 0; i < count; ++i)
+         array[i] = SWAP16(array[i]);
+   }
+
+   return true;
+}
+
+/* Returns the slot holding or receiving hunknum, or NULL.
+ * Must be called with the stream lock held. */
+static chdstream_hunk_t *
+chdstream_cache_find(chdstream_t *stream, uint32_t hunknum)
+{
+   unsigned i;
+
+   for (i = 0; i < stream->cache_size; i++)
+   {
+      chdstream_hunk_t *slot = &stream->cache[i];
+      if ((slot->valid || slot->pending) && slot->hunknum == hunknum)
+         return slot;
+   }
+
+   return NULL;
+}
+
+/* Returns an empty slot, else the least recently used one that is
+ * neither being filled nor the current hunk, or NULL. Empty slots
+ * get their buffer here. Must be called with the stream lock held. */
+static chdstream_hunk_t *
+chdstream_cache_victim(chdstream_t *stream)
+{
+   unsigned i;
+   chdstream_hunk_t *victim = NULL;
+
+   for (i = 0; i < stream->cache_size; i++)
+   {
+      chdstream_hunk_t *slot = &stream->cache[i];
+
+      if (slot->pending || (int)i == stream->current)
+         continue;
+      if (!slot->data && !(slot->data = (uint8_t*)malloc(
+                  chd_get_header(stream->chd)->hunkbytes)))
+         continue;
+      if (!slot->valid)
+         return slot;
+      if (!victim || slot->last_used < victim->last_used)
+         victim = slot;
+   }
+
+   return victim;
+}
+
+#ifdef HAVE_THREADS
+static void chdstream_readahead_thread(void *data)
+{
+   chdstream_t *stream = (chdstream_t*)data;
+   uint32_t hunkcount  = chd_get_header(stream->readahead_chd)->totalhunks;
+
+   slock_lock(stream->lock);
+
+   for (;;)
+   {
+      bool ok;
+      uint32_t hunknum;
+      chdstream_hunk_t *slot = NULL;
+
+      while (!stream->quit &&
+            stream->readahead_next >= stream->readahead_end)
+         scond_wait(stream->cond, stream->lock);
+
+      if (stream->quit)
+         break;
+
+      hunknum = stream->readahead_next++;
+
+      if (hunknum >= hunkcount)
+      {
+         stream->readahead_next = stream->readahead_end;
+         continue;
+      }
+
+      if (chdstream_cache_find(stream, hunknum))
+         continue;
+
+      /* Nothing left to evict, wait for the next request */
+      if (!(slot = chdstream_cache_victim(stream)))
+      {
+         stream->readahead_next = stream->readahead_end;
+         continue;
+      }
+
+      slot->hunknum = hunknum;
+      slot->valid   = false;
+      slot->pending = true;
+      slock_unlock(stream->lock);
+
+      ok = chdstream_decompress_hunk(stream, stream->readahead_chd,
+            hunknum, slot->data);
+
+      slock_lock(stream->lock);
+      slot->pending   = false;
+      slot->valid     = ok;
+      slot->last_used = ++stream->clock;
+      scond_broadcast(stream->cond);
+   }
+
+   slock_unlock(stream->lock);
+}
+
+static void chdstream_readahead_start(chdstream_t *stream)
+{
+   stream->readahead_tried = true;
+   stream->readahead       = CHDSTREAM_READAHEAD_HUNKS;
+
+   if (!stream->path || chd_open(stream->path, CHD_OPEN_READ, NULL,
+            &stream->readahead_chd)
+         != CHDERR_NONE)
+   {
+      stream->readahead_chd = NULL;
+      return;
+   }
+
+   stream->lock = slock_new();
+   stream->cond = scond_new();
+
+   if (stream->lock && stream->cond)
+      stream->readahead_thread = sthread_create(
+            chdstream_readahead_thread, stream);
+
+   if (!stream->readahead_thread)
+   {
+      if (stream->cond)
+         scond_free(stream->cond);
+      if (stream->lock)
+         slock_free(stream->lock);
+      chd_close(stream->readahead_chd);
+      stream->cond          = NULL;
+      stream->lock          = NULL;
+      stream->readahead_chd = NULL;
+   }
+}
+
+static void chdstream_readahead_stop(chdstream_t *stream)
+{
+   if (!stream->readahead_thread)
+      return;
+
+   slock_lock(stream->lock);
+   stream->quit = true;
+   scond_broadcast(stream->cond);
+   slock_unlock(stream->lock);
+
+   sthread_join(stream->readahead_thread);
+   scond_free(stream->cond);
+   slock_free(stream->lock);
+   chd_close(stream->readahead_chd);
+
+   stream->readahead_thread = NULL;
+   stream->cond             = NULL;
+   stream->lock             = NULL;
+   stream->readahead_chd    = NULL;
+}
+#endif
+
 chdstream_t *chdstream_open(const char *path, int32_t track)
 {
    metadata_t meta;
@@ -218,11 +479,17 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    if (!stream)
       goto error;
 
-   hd              = chd_get_header(chd);
-   stream->hunkmem = (uint8_t*)malloc(hd->hunkbytes);
-   if (!stream->hunkmem)
+   hd                 = chd_get_header(chd);
+   stream->cache_size = CHDSTREAM_CACHE_HUNKS;
+   stream->cache      = (chdstream_hunk_t*)
+      calloc(stream->cache_size, sizeof(*stream->cache));
+   if (!stream->cache)
       goto error;
 
+#ifdef HAVE_THREADS
+   stream->path       = strdup(path);
+#endif
+
    if (!strcmp(meta.type, "MODE1_RAW"))
    {
       stream->frame_size = SECTOR_SIZE;
@@ -259,6 +526,8 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
       (size_t) meta.frames * stream->frame_size;
    stream->offset          = 0;
    stream->hunknum         = -1;
+   stream->last_hunknum    = -1;
+   stream->current         = -1;
 
    return stream;
 
@@ -274,10 +543,20 @@ error:
 
 void chdstream_close(chdstream_t *stream)
 {
+   unsigned i;
+
    if (stream)
    {
-      if (stream->hunkmem)
-         free(stream->hunkmem);
+#ifdef HAVE_THREADS
+      chdstream_readahead_stop(stream);
+      free(stream->path);
+#endif
+      if (stream->cache)
+      {
+         for (i = 0; i < stream->cache_size; i++)
+            free(stream->cache[i].data);
+         free(stream->cache);
+      }
       if (stream->chd)
          chd_close(stream->chd);
       free(stream);
@@ -287,27 +566,80 @@ void chdstream_close(chdstream_t *stream)
 static bool
 chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
 {
-   chd_error err;
-   uint16_t *array;
-   uint32_t i;
-   uint32_t count;
+   chdstream_hunk_t *slot = NULL;
 
-   if (hunknum == stream->hunknum)
+   if ((int32_t)hunknum == stream->hunknum)
       return true;
 
-   err = chd_read(stream->chd, hunknum, stream->hunkmem);
-   if (err != CHDERR_NONE)
-      return false;
+#ifdef HAVE_THREADS
+   /* First step to the next hunk */
+   if (     !stream->readahead_tried
+         && stream->last_hunknum >= 0
+         && (int32_t)hunknum == stream->last_hunknum + 1)
+      chdstream_readahead_start(stream);
+#endif
 
-   if (stream->swab)
+   chdstream_lock(stream);
+
+   /* Wait for the read-ahead worker if it is decompressing this hunk */
+   while ((slot = chdstream_cache_find(stream, hunknum)) && slot->pending)
+      chdstream_wait(stream);
+
+   stream->current = -1;
+   stream->hunknum = -1;
+   stream->hunkmem = NULL;
+
+   if (!slot)
    {
-      count = chd_get_header(stream->chd)->hunkbytes / 2;
-      array = (uint16_t*) stream->hunkmem;
-      for (i = 0; i < count; ++i)
-         array[i] = SWAP16(array[i]);
+      bool ok;
+
+      /* The worker fills one slot at a time, so there is always a
+       * victim here unless no buffer could be allocated */
+      if (!(slot = chdstream_cache_victim(stream)))
+      {
+         chdstream_unlock(stream);
+         return false;
+      }
+
+      slot->hunknum = hunknum;
+      slot->valid   = false;
+      slot->pending = true;
+      chdstream_unlock(stream);
+
+      ok = chdstream_decompress_hunk(stream, stream->chd,
+            hunknum, slot->data);
+
+      chdstream_lock(stream);
+      slot->pending = false;
+      slot->valid   = ok;
+      chdstream_signal(stream);
+
+      if (!ok)
+      {
+         chdstream_unlock(stream);
+         return false;
+      }
    }
 
+   slot->last_used = ++stream->clock;
+   stream->current = (int)(slot - stream->cache);
    stream->hunknum = hunknum;
+   stream->hunkmem = slot->data;
+
+#ifdef HAVE_THREADS
+   /* Sequential access, have the worker decompress the next hunks */
+   if (stream->readahead_thread &&
+         (int32_t)hunknum == stream->last_hunknum + 1)
+   {
+      stream->readahead_next = hunknum + 1;
+      stream->readahead_end  = hunknum + 1 + stream->readahead;
+      scond_broadcast(stream->cond);
+   }
+#endif
+
+   stream->last_hunknum = hunknum;
+
+   chdstream_unlock(stream);
    return true;
 }
 
@@ -31,8 +31,12 @@
 #include <rhash.h>
 
 #include <retro_assert.h>
+#include <retro_endianness.h>
 #include <string/stdstring.h>
 #include <streams/file_stream.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "libretrodb.h"
 
@@ -50,7 +54,6 @@ typedef enum
 
 typedef enum
 {
-   DAT_CONVERTER_TOKEN_LIST,
    DAT_CONVERTER_STRING_LIST,
    DAT_CONVERTER_MAP_LIST,
    DAT_CONVERTER_LIST_LIST,
@@ -67,8 +70,6 @@ typedef struct
 typedef struct dat_converter_map_t dat_converter_map_t;
 typedef struct dat_converter_list_t dat_converter_list_t;
 typedef union dat_converter_list_item_t dat_converter_list_item_t;
-typedef struct dat_converter_search_tree_t dat_converter_search_tree_t;
-typedef struct dat_converter_bt_node_t dat_converter_bt_node_t;
 
 struct dat_converter_map_t
 {
@@ -86,7 +87,10 @@ struct dat_converter_list_t
 {
    dat_converter_list_enum type;
    dat_converter_list_item_t* values;
-   dat_converter_bt_node_t* bt_root;
+   /* Open addressing table of the indices of the keyed
+    * values of a map list, -1 for empty slots */
+   int* index;
+   int index_capacity;
    int count;
    int capacity;
 };
@@ -95,18 +99,9 @@ union dat_converter_list_item_t
 {
    const char* string;
    dat_converter_map_t map;
-   dat_converter_token_t token;
    dat_converter_list_t* list;
 };
 
-struct dat_converter_bt_node_t
-{
-   int index;
-   uint32_t hash;
-   dat_converter_bt_node_t* right;
-   dat_converter_bt_node_t* left;
-};
-
 static dat_converter_list_t* dat_converter_list_create(
       dat_converter_list_enum type)
 {
@@ -115,23 +110,14 @@ static dat_converter_list_t* dat_converter_list_create(
    list->type                 = type;
    list->count                = 0;
    list->capacity             = (1 << 2);
-   list->bt_root              = NULL;
+   list->index                = NULL;
+   list->index_capacity       = 0;
    list->values               = (dat_converter_list_item_t*)malloc(
          sizeof(*list->values) * list->capacity);
 
    return list;
 }
 
-static void dat_converter_bt_node_free(dat_converter_bt_node_t* node)
-{
-   if (!node)
-      return;
-
-   dat_converter_bt_node_free(node->left);
-   dat_converter_bt_node_free(node->right);
-   free(node);
-}
-
 static void dat_converter_list_free(dat_converter_list_t* list)
 {
    if (!list)
@@ -148,55 +134,81 @@ static void dat_converter_list_free(dat_converter_list_t* list)
          if (list->values[list->count].map.type == DAT_CONVERTER_LIST_MAP)
             dat_converter_list_free(list->values[list->count].map.value.list);
       }
-      dat_converter_bt_node_free(list->bt_root);
       break;
    default:
       break;
    }
 
+   free(list->index);
    free(list->values);
    free(list);
 }
 static void dat_converter_list_append(dat_converter_list_t* dst, void* item);
 
-static dat_converter_bt_node_t* dat_converter_bt_node_insert(
-      dat_converter_list_t* list,
-      dat_converter_bt_node_t** node,
-      dat_converter_map_t* map)
+/* Returns the slot of the index table for the key of @map */
+static int* dat_converter_list_find(dat_converter_list_t* list,
+      const dat_converter_map_t* map)
 {
-   retro_assert(map->key);
-   retro_assert(list->type == DAT_CONVERTER_MAP_LIST);
+   int mask = list->index_capacity - 1;
+   int slot = map->hash & mask;
 
-   if (!*node)
+   for (;;)
    {
-      *node = calloc(1, sizeof(dat_converter_bt_node_t));
-      return *node;
+      int* index = &list->index[slot];
+
+      if (*index < 0)
+         return index;
+
+      if (list->values[*index].map.hash == map->hash
+            && string_is_equal(list->values[*index].map.key, map->key))
+         return index;
+
+      slot = (slot + 1) & mask;
    }
+}
 
-   int diff = (*node)->hash - map->hash;
+static void dat_converter_list_grow_index(dat_converter_list_t* list)
+{
+   int i;
+   int* old_index     = list->index;
+   int old_capacity   = list->index_capacity;
 
-   if (!diff)
-      diff = strcmp(list->values[(*node)->index].map.key, map->key);
+   list->index_capacity = old_capacity ? old_capacity << 1 : (1 << 4);
+   list->index          = malloc(sizeof(*list->index) * list->index_capacity);
 
-   if (diff < 0)
-      return dat_converter_bt_node_insert(list, &(*node)->left, map);
-   else if (diff > 0)
-      return dat_converter_bt_node_insert(list, &(*node)->right, map);
+   for (i = 0; i < list->index_capacity; i++)
+      list->index[i] = -1;
 
-   /* found match */
+   for (i = 0; i < old_capacity; i++)
+      if (old_index[i] >= 0)
+         *dat_converter_list_find(list,
+               &list->values[old_index[i]].map) = old_index[i];
 
-   if (list->values[(*node)->index].map.type == DAT_CONVERTER_LIST_MAP)
+   free(old_index);
+}
+
+/* Merges @map into the value with the same key, if there's one */
+static bool dat_converter_list_merge(dat_converter_list_t* list,
+      int* index, dat_converter_map_t* map)
+{
+   retro_assert(map->key);
+   retro_assert(list->type == DAT_CONVERTER_MAP_LIST);
+
+   if (*index < 0)
+      return false;
+
+   if (list->values[*index].map.type == DAT_CONVERTER_LIST_MAP)
    {
       if (map->type == DAT_CONVERTER_LIST_MAP)
       {
          int i;
 
-         retro_assert(list->values[(*node)->index].map.value.list->type
+         retro_assert(list->values[*index].map.value.list->type
                == map->value.list->type);
 
          for (i = 0; i < map->value.list->count; i++)
             dat_converter_list_append(
-                  list->values[(*node)->index].map.value.list,
+                  list->values[*index].map.value.list,
                   &map->value.list->values[i]);
 
          /* set count to 0 to prevent freeing the child nodes */
@@ -205,9 +217,9 @@ static dat_converter_bt_node_t* dat_converter_bt_node_insert(
       }
    }
    else
-      list->values[(*node)->index].map = *map;
+      list->values[*index].map = *map;
 
-   return NULL;
+   return true;
 }
 
 static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
@@ -219,12 +231,6 @@ static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
    }
    switch (dst->type)
    {
-   case DAT_CONVERTER_TOKEN_LIST:
-   {
-      dat_converter_token_t* token = (dat_converter_token_t*) item;
-      dst->values[dst->count].token = *token;
-      break;
-   }
    case DAT_CONVERTER_STRING_LIST:
    {
       char* str = (char*) item;
@@ -238,16 +244,20 @@ static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
          dst->values[dst->count].map = *map;
       else
       {
+         int* index;
+
+         /* Keep the table at most half full */
+         if ((dst->count + 1) * 2 > dst->index_capacity)
+            dat_converter_list_grow_index(dst);
+
          map->hash = djb2_calculate(map->key);
-         dat_converter_bt_node_t* new_node =
-            dat_converter_bt_node_insert(dst, &dst->bt_root, map);
+         index     = dat_converter_list_find(dst, map);
 
-         if (!new_node)
+         if (dat_converter_list_merge(dst, index, map))
             return;
 
          dst->values[dst->count].map = *map;
-         new_node->index = dst->count;
-         new_node->hash = map->hash;
+         *index = dst->count;
       }
       break;
    }
@@ -263,23 +273,34 @@ static void dat_converter_list_append(dat_converter_list_t* dst, void* item)
    dst->count++;
 }
 
-static dat_converter_list_t* dat_converter_lexer(
-      char* src, const char* dat_path)
+/* Tokens are read one at a time from the DAT, which is
+ * tokenized in place. A token is only handed out once the
+ * following one was found, at which point it's terminated. */
+typedef struct
 {
-   dat_converter_list_t* token_list =
-      dat_converter_list_create(DAT_CONVERTER_TOKEN_LIST);
-   dat_converter_token_t token      = {NULL, 1, 1, dat_path};
-   bool quoted_token                = false;
+   char* src;
+   dat_converter_token_t current;
+   dat_converter_token_t next;
+   dat_converter_token_t position;
+   bool quoted;
+} dat_converter_lexer_t;
+
+/* Scans up to the start of the next token */
+static bool dat_converter_lexer_scan(dat_converter_lexer_t* lexer,
+      dat_converter_token_t* out)
+{
+   char* src                    = lexer->src;
+   dat_converter_token_t* token = &lexer->position;
 
    while (*src)
    {
-      if ((!quoted_token && (*src == '\t' || *src == ' ')) || (*src == '\r'))
+      if ((!lexer->quoted && (*src == '\t' || *src == ' ')) || (*src == '\r'))
       {
          *src = '\0';
          src++;
-         token.column++;
-         token.label = NULL;
-         quoted_token = false;
+         token->column++;
+         token->label = NULL;
+         lexer->quoted = false;
          continue;
       }
 
@@ -287,10 +308,10 @@ static dat_converter_list_t* dat_converter_lexer(
       {
          *src = '\0';
          src++;
-         token.column = 1;
-         token.line_no++;
-         token.label = NULL;
-         quoted_token = false;
+         token->column = 1;
+         token->line_no++;
+         token->label = NULL;
+         lexer->quoted = false;
          continue;
       }
 
@@ -298,100 +319,126 @@ static dat_converter_list_t* dat_converter_lexer(
       {
          *src = '\0';
          src++;
-         token.column++;
-         quoted_token = !quoted_token;
-         token.label = NULL;
+         token->column++;
+         lexer->quoted = !lexer->quoted;
+         token->label = NULL;
 
-         if (quoted_token)
+         if (lexer->quoted)
          {
-            token.label = src;
-            dat_converter_list_append(token_list, &token);
+            token->label = src;
+            *out         = *token;
+            lexer->src   = src;
+            return true;
          }
 
          continue;
       }
 
-      if (!token.label)
+      if (!token->label)
       {
-         token.label = src;
-         dat_converter_list_append(token_list, &token);
+         token->label = src;
+         *out         = *token;
+         lexer->src   = src + 1;
+         token->column++;
+         return true;
       }
 
       src++;
-      token.column++;
+      token->column++;
+   }
+
+   lexer->src = src;
+   return false;
+}
+
+static void dat_converter_lexer_advance(dat_converter_lexer_t* lexer)
+{
+   lexer->current = lexer->next;
+
+   if (!dat_converter_lexer_scan(lexer, &lexer->next))
+   {
+      lexer->next       = lexer->position;
+      lexer->next.label = NULL;
    }
+}
+
+static void dat_converter_lexer_init(dat_converter_lexer_t* lexer,
+      char* src, const char* dat_path)
+{
+   dat_converter_token_t token = {NULL, 1, 1, dat_path};
 
-   token.label = NULL;
-   dat_converter_list_append(token_list, &token);
+   lexer->src      = src;
+   lexer->position = token;
+   lexer->quoted   = false;
 
-   return token_list;
+   dat_converter_lexer_advance(lexer);
+   dat_converter_lexer_advance(lexer);
 }
 
 static dat_converter_list_t* dat_parser_table(
-      dat_converter_list_item_t** start_token)
+      dat_converter_lexer_t* lexer)
 {
    dat_converter_list_t* parsed_table =
       dat_converter_list_create(DAT_CONVERTER_MAP_LIST);
    dat_converter_map_t map            = {0};
-   dat_converter_list_item_t* current = *start_token;
+   dat_converter_token_t start_token  = lexer->current;
 
-   while (current->token.label)
+   while (lexer->current.label)
    {
 
       if (!map.key)
       {
-         if (string_is_equal(current->token.label, ")"))
+         if (string_is_equal(lexer->current.label, ")"))
          {
-            current++;
-            *start_token = current;
+            dat_converter_lexer_advance(lexer);
             return parsed_table;
          }
-         else if (string_is_equal(current->token.label, "("))
+         else if (string_is_equal(lexer->current.label, "("))
          {
             printf("%s:%d:%d: fatal error: Unexpected '(' instead of key\n",
-                   current->token.fname,
-                   current->token.line_no,
-                   current->token.column);
+                   lexer->current.fname,
+                   lexer->current.line_no,
+                   lexer->current.column);
             dat_converter_exit(1);
          }
          else
          {
-            map.key = current->token.label;
-            current++;
+            map.key = lexer->current.label;
+            dat_converter_lexer_advance(lexer);
          }
       }
       else
       {
-         if (string_is_equal(current->token.label, "("))
+         if (string_is_equal(lexer->current.label, "("))
          {
-            current++;
+            dat_converter_lexer_advance(lexer);
             map.type = DAT_CONVERTER_LIST_MAP;
-            map.value.list = dat_parser_table(&current);
+            map.value.list = dat_parser_table(lexer);
             dat_converter_list_append(parsed_table, &map);
          }
-         else if (string_is_equal(current->token.label, ")"))
+         else if (string_is_equal(lexer->current.label, ")"))
          {
             printf("%s:%d:%d: fatal error: Unexpected ')' instead of value\n",
-                   current->token.fname,
-                   current->token.line_no,
-                   current->token.column);
+                   lexer->current.fname,
+                   lexer->current.line_no,
+                   lexer->current.column);
             dat_converter_exit(1);
          }
          else
          {
             map.type = DAT_CONVERTER_STRING_MAP;
-            map.value.string = current->token.label;
+            map.value.string = lexer->current.label;
             dat_converter_list_append(parsed_table, &map);
-            current++;
+            dat_converter_lexer_advance(lexer);
          }
          map.key = NULL;
       }
    }
 
    printf("%s:%d:%d: fatal error: Missing ')' for '('\n",
-          (*start_token)->token.fname,
-          (*start_token)->token.line_no,
-          (*start_token)->token.column);
+          start_token.fname,
+          start_token.line_no,
+          start_token.column);
    dat_converter_exit(1);
 
    /* unreached */
@@ -485,11 +532,10 @@ static const char* dat_converter_get_match(
 
 static dat_converter_list_t* dat_converter_parser(
       dat_converter_list_t* target,
-      dat_converter_list_t* lexer_list,
+      dat_converter_lexer_t* lexer,
       dat_converter_match_key_t* match_key)
 {
    dat_converter_map_t map;
-   dat_converter_list_item_t* current = lexer_list->values;
    bool skip                          = true;
    bool warning_displayed             = false;
 
@@ -506,21 +552,21 @@ static dat_converter_list_t* dat_converter_parser(
       dat_converter_list_append(target, &map);
    }
 
-   while (current->token.label)
+   while (lexer->current.label)
    {
       if (!map.key)
       {
-         if (string_is_equal(current->token.label, "game"))
+         if (string_is_equal(lexer->current.label, "game"))
             skip = false;
-         map.key = current->token.label;
-         current++;
+         map.key = lexer->current.label;
+         dat_converter_lexer_advance(lexer);
       }
       else
       {
-         if (string_is_equal(current->token.label, "("))
+         if (string_is_equal(lexer->current.label, "("))
          {
-            current++;
-            map.value.list = dat_parser_table(&current);
+            dat_converter_lexer_advance(lexer);
+            map.value.list = dat_parser_table(lexer);
             if (!skip)
             {
                if (match_key)
@@ -537,7 +583,7 @@ static dat_converter_list_t* dat_converter_parser(
                            printf("%s.", match_key->value);
                            match_key = match_key->next;
                         }
-                        printf("%s' on line %d\n", match_key->value, current->token.line_no);
+                        printf("%s' on line %d\n", match_key->value, lexer->current.line_no);
                         warning_displayed = true;
                      }
                      skip = true;
@@ -560,10 +606,10 @@ static dat_converter_list_t* dat_converter_parser(
          else
          {
             printf("%s:%d:%d: fatal error: Expected '(' found '%s'\n",
-                   current->token.fname,
-                   current->token.line_no,
-                   current->token.column,
-                   current->token.label);
+                   lexer->current.fname,
+                   lexer->current.line_no,
+                   lexer->current.column,
+                   lexer->current.label);
             dat_converter_exit(1);
          }
       }
@@ -629,6 +675,127 @@ dat_converter_rdb_mappings_t rdb_mappings[] =
 dat_converter_match_key_t* rdb_mappings_mk[(sizeof(rdb_mappings)
       / sizeof(*rdb_mappings))] = {0};
 
+/* Longest key libretrodb_find_entry and indexed queries can look up */
+#define DAT_CONVERTER_INDEX_MAX_KEY_SIZE 256
+
+typedef struct
+{
+   uint8_t* key;
+   uint64_t key_size;
+   uint64_t offset;
+} dat_converter_index_entry_t;
+
+/* Index built while the records are written. Keys of different
+ * sizes (serials) are zero padded to the longest one when the
+ * index is written, the sort order is the same either way */
+typedef struct
+{
+   const char* rdb_key;
+   dat_converter_index_entry_t* entries;
+   uint64_t key_size;
+   uint64_t count;
+   uint64_t capacity;
+   bool disabled;
+} dat_converter_index_t;
+
+typedef struct
+{
+   dat_converter_list_item_t* current_item;
+   RFILE* rdb_file;
+   dat_converter_index_t indices[2];
+} dat_converter_provider_t;
+
+static int dat_converter_index_entry_compare(const void* a, const void* b)
+{
+   const dat_converter_index_entry_t* x = (const dat_converter_index_entry_t*)a;
+   const dat_converter_index_entry_t* y = (const dat_converter_index_entry_t*)b;
+   uint64_t size = x->key_size < y->key_size ? x->key_size : y->key_size;
+   int cmp       = memcmp(x->key, y->key, (size_t)size);
+
+   if (cmp)
+      return cmp;
+   if (x->key_size != y->key_size)
+      return x->key_size < y->key_size ? -1 : 1;
+   return 0;
+}
+
+static void dat_converter_index_add(dat_converter_index_t* index,
+      const void* key, uint64_t key_size, uint64_t offset)
+{
+   dat_converter_index_entry_t* entry;
+
+   /* a record can map more than one dat key to the same field,
+    * the first one is what lookups find */
+   if (index->disabled || !key_size
+         || (index->count && index->entries[index->count - 1].offset == offset))
+      return;
+
+   if (key_size > DAT_CONVERTER_INDEX_MAX_KEY_SIZE)
+   {
+      printf("Not writing index '%s', its keys are too long\n",
+            index->rdb_key);
+      index->disabled = true;
+      return;
+   }
+
+   if (index->count == index->capacity)
+   {
+      index->capacity = index->capacity ? index->capacity << 1 : (1 << 10);
+      index->entries  = (dat_converter_index_entry_t*)realloc(index->entries,
+            index->capacity * sizeof(*index->entries));
+   }
+
+   entry           = &index->entries[index->count++];
+   entry->key      = (uint8_t*)malloc((size_t)key_size);
+   entry->key_size = key_size;
+   entry->offset   = offset;
+   memcpy(entry->key, key, (size_t)key_size);
+
+   if (key_size > index->key_size)
+      index->key_size = key_size;
+}
+
+static void dat_converter_index_write(dat_converter_index_t* index,
+      RFILE* rdb_file)
+{
+   uint64_t i;
+
+   if (!index->disabled && index->count)
+   {
+      uint64_t entry_size = index->key_size + sizeof(uint64_t);
+      uint8_t* entries    = (uint8_t*)calloc((size_t)index->count,
+            (size_t)entry_size);
+
+      printf("Writing index '%s'...\n", index->rdb_key);
+
+      qsort(index->entries, (size_t)index->count, sizeof(*index->entries),
+            dat_converter_index_entry_compare);
+
+      /* key, zero padded, followed by the big-endian record offset */
+      for (i = 0; i < index->count; i++)
+      {
+         uint8_t* entry  = entries + i * entry_size;
+         uint64_t offset = swap_if_little64(index->entries[i].offset);
+
+         memcpy(entry, index->entries[i].key,
+               (size_t)index->entries[i].key_size);
+         memcpy(entry + index->key_size, &offset, sizeof(uint64_t));
+      }
+
+      filestream_seek(rdb_file, 0, RETRO_VFS_SEEK_POSITION_END);
+      if (libretrodb_write_index(rdb_file, index->rdb_key,
+               index->key_size, entries, index->count) < 0)
+         printf("Could not write index '%s'\n", index->rdb_key);
+
+      free(entries);
+   }
+
+   for (i = 0; i < index->count; i++)
+      free(index->entries[i].key);
+   free(index->entries);
+   index->entries = NULL;
+}
+
 static void dat_converter_value_provider_init(void)
 {
    int i;
@@ -645,10 +812,13 @@ static void dat_converter_value_provider_free(void)
    }
 }
 static int dat_converter_value_provider(
-      dat_converter_list_item_t** current_item, struct rmsgpack_dom_value* out)
+      dat_converter_provider_t* ctx, struct rmsgpack_dom_value* out)
 {
-   int i;
-   struct rmsgpack_dom_pair* current = NULL;
+   int i, j;
+   dat_converter_list_item_t** current_item = &ctx->current_item;
+   struct rmsgpack_dom_pair* current        = NULL;
+   /* the record is written right after being provided */
+   uint64_t offset                          = filestream_tell(ctx->rdb_file);
 
    out->type          = RDT_MAP;
    out->val.map.len   = 0;
@@ -736,6 +906,13 @@ static int dat_converter_value_provider(
          retro_assert(0);
          break;
       }
+
+      for (j = 0; j < (sizeof(ctx->indices) / sizeof(*ctx->indices)); j++)
+         if (string_is_equal(rdb_mappings[i].rdb_key, ctx->indices[j].rdb_key))
+            dat_converter_index_add(&ctx->indices[j],
+                  current->value.val.binary.buff,
+                  current->value.val.binary.len, offset);
+
       current++;
    }
 
@@ -743,10 +920,111 @@ static int dat_converter_value_provider(
    return 0;
 }
 
+typedef struct
+{
+   const char* path;
+   char* buffer;
+   dat_converter_list_t* list;
+} dat_converter_job_t;
+
+typedef struct
+{
+   dat_converter_job_t* jobs;
+   int count;
+   int next;
+   dat_converter_match_key_t* match_key;
+#ifdef HAVE_THREADS
+   slock_t* lock;
+#endif
+} dat_converter_queue_t;
+
+static void dat_converter_job_run(dat_converter_job_t* job,
+      dat_converter_match_key_t* match_key)
+{
+   size_t dat_file_size;
+   dat_converter_lexer_t lexer;
+   FILE* dat_file = fopen(job->path, "r");
+
+   if (!dat_file)
+   {
+      printf("could not open dat file '%s': %s\n",
+            job->path, strerror(errno));
+      dat_converter_exit(1);
+   }
+
+   fseek(dat_file, 0, SEEK_END);
+   dat_file_size = ftell(dat_file);
+   fseek(dat_file, 0, SEEK_SET);
+   job->buffer = (char*)malloc(dat_file_size + 1);
+   dat_file_size = fread(job->buffer, 1, dat_file_size, dat_file);
+   fclose(dat_file);
+   job->buffer[dat_file_size] = '\0';
+
+   printf("Parsing dat file '%s'...\n", job->path);
+   dat_converter_lexer_init(&lexer, job->buffer, job->path);
+   job->list = dat_converter_parser(NULL, &lexer, match_key);
+}
+
+static void dat_converter_worker(void* data)
+{
+   dat_converter_queue_t* queue = (dat_converter_queue_t*)data;
+
+   for (;;)
+   {
+      int job;
+
+#ifdef HAVE_THREADS
+      slock_lock(queue->lock);
+#endif
+      job = queue->next++;
+#ifdef HAVE_THREADS
+      slock_unlock(queue->lock);
+#endif
+
+      if (job >= queue->count)
+         break;
+
+      dat_converter_job_run(&queue->jobs[job], queue->match_key);
+   }
+}
+
+/* Parses the dat files, one job per file */
+static void dat_converter_run_jobs(dat_converter_queue_t* queue)
+{
+#ifdef HAVE_THREADS
+   int i;
+   sthread_t* threads[8];
+   int num_threads = queue->count;
+
+   if (num_threads > (int)(sizeof(threads) / sizeof(*threads)))
+      num_threads = sizeof(threads) / sizeof(*threads);
+
+   queue->lock = slock_new();
+
+   /* the calling thread is a worker too */
+   for (i = 1; i < num_threads; i++)
+      threads[i] = sthread_create(dat_converter_worker, queue);
+
+   dat_converter_worker(queue);
+
+   for (i = 1; i < num_threads; i++)
+      if (threads[i])
+         sthread_join(threads[i]);
+
+   slock_free(queue->lock);
+#else
+   dat_converter_worker(queue);
+#endif
+}
+
 int main(int argc, char** argv)
 {
+   int i, j;
    const char* rdb_path;
-   dat_converter_match_key_t* match_key = NULL;
+   dat_converter_queue_t queue;
+   dat_converter_provider_t provider;
+   dat_converter_match_key_t* match_key  = NULL;
+   dat_converter_list_t* dat_parser_list = NULL;
    RFILE* rdb_file;
 
    if (argc < 2)
@@ -768,43 +1046,35 @@ int main(int argc, char** argv)
       argv++;
    }
 
-   int dat_count                         = argc;
-   char** dat_buffers                    = (char**)
-      malloc(dat_count * sizeof(*dat_buffers));
-   char** dat_buffer                     = dat_buffers;
-   dat_converter_list_t* dat_parser_list = NULL;
+   queue.jobs      = (dat_converter_job_t*)calloc(argc, sizeof(*queue.jobs));
+   queue.count     = argc;
+   queue.next      = 0;
+   queue.match_key = match_key;
 
-   while (argc)
+   for (i = 0; i < argc; i++)
+      queue.jobs[i].path = argv[i];
+
+   dat_converter_run_jobs(&queue);
+
+   /* Merge in command line order, so later files still
+    * override earlier ones. Each list starts with a
+    * sentinel, only the first one is kept. */
+   for (i = 0; i < queue.count; i++)
    {
-      size_t dat_file_size;
-      dat_converter_list_t* dat_lexer_list = NULL;
-      FILE* dat_file                       = fopen(*argv, "r");
+      dat_converter_list_t* list = queue.jobs[i].list;
 
-      if (!dat_file)
+      if (!dat_parser_list)
       {
-         printf("could not open dat file '%s': %s\n",
-               *argv, strerror(errno));
-         dat_converter_exit(1);
+         dat_parser_list = list;
+         continue;
       }
 
-      fseek(dat_file, 0, SEEK_END);
-      dat_file_size = ftell(dat_file);
-      fseek(dat_file, 0, SEEK_SET);
-      *dat_buffer = (char*)malloc(dat_file_size + 1);
-      fread(*dat_buffer, 1, dat_file_size, dat_file);
-      fclose(dat_file);
-      (*dat_buffer)[dat_file_size] = '\0';
-
-      printf("Parsing dat file '%s'...\n", *argv);
-      dat_lexer_list  = dat_converter_lexer(*dat_buffer, *argv);
-      dat_parser_list = dat_converter_parser(
-            dat_parser_list, dat_lexer_list, match_key);
+      for (j = 1; j < list->count; j++)
+         dat_converter_list_append(dat_parser_list, &list->values[j].map);
 
-      dat_converter_list_free(dat_lexer_list);
-
-      argc--;
-      argv++;
-      dat_buffer++;
+      /* set count to 0 to prevent freeing the child nodes */
+      list->count = 0;
+      dat_converter_list_free(list);
    }
 
    rdb_file = filestream_open(rdb_path,
@@ -821,22 +1091,31 @@ int main(int argc, char** argv)
       dat_converter_exit(1);
    }
 
-   dat_converter_list_item_t* current_item =
-      &dat_parser_list->values[dat_parser_list->count];
+   memset(&provider, 0, sizeof(provider));
+   provider.current_item       = dat_parser_list
+      ? &dat_parser_list->values[dat_parser_list->count]
+      : NULL;
+   provider.rdb_file           = rdb_file;
+   provider.indices[0].rdb_key = "crc";
+   provider.indices[1].rdb_key = "serial";
 
    dat_converter_value_provider_init();
-   libretrodb_create(rdb_file,
-         (libretrodb_value_provider)&dat_converter_value_provider,
-         &current_item);
+   if (dat_parser_list)
+      libretrodb_create(rdb_file,
+            (libretrodb_value_provider)&dat_converter_value_provider,
+            &provider);
    dat_converter_value_provider_free();
 
+   for (i = 0; i < (sizeof(provider.indices) / sizeof(*provider.indices)); i++)
+      dat_converter_index_write(&provider.indices[i], rdb_file);
+
    filestream_close(rdb_file);
 
    dat_converter_list_free(dat_parser_list);
 
-   while (dat_count--)
-      free(dat_buffers[dat_count]);
-   free(dat_buffers);
+   for (i = 0; i < queue.count; i++)
+      free(queue.jobs[i].buffer);
+   free(queue.jobs);
 
    dat_converter_match_key_free(match_key);
 
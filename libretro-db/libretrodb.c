@@ -46,9 +46,13 @@
 
 #define MAGIC_NUMBER "RARCHDB"
 
+/* Maximum number of keys a single predicate can be
+ * looked up with through an index */
+#define LIBRETRODB_MAX_INDEX_KEYS 64
+
 struct node_iter_ctx
 {
-	libretrodb_t *db;
+	RFILE *fd;
 	libretrodb_index_t *idx;
 };
 
@@ -86,6 +90,16 @@ struct libretrodb_cursor
 	int eof;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
+	/* Set when the query is answered through an index,
+	 * in which case only the records at @offsets are read */
+	int is_indexed;
+	uint64_t *offsets;
+	size_t num_offsets;
+	size_t next_offset;
+	/* Copy of the database read by libretrodb_cursor_map */
+	uint8_t *data;
+	struct rmsgpack_dom_buf view;
+	rmsgpack_dom_arena_t *arena;
 };
 
 static struct rmsgpack_dom_value sentinal;
@@ -173,8 +187,7 @@ int libretrodb_create(RFILE *fd, libretrodb_value_provider value_provider,
    if ((rv = rmsgpack_dom_write(fd, &sentinal)) < 0)
       goto clean;
 
-   header.metadata_offset = swap_if_little64(filestream_seek(
-            fd, 0, RETRO_VFS_SEEK_POSITION_CURRENT));
+   header.metadata_offset = swap_if_little64(filestream_tell(fd));
    md.count = item_count;
    libretrodb_write_metadata(fd, &md);
    filestream_seek(fd, root, RETRO_VFS_SEEK_POSITION_START);
@@ -238,7 +251,7 @@ int libretrodb_open(const char *path, libretrodb_t *db)
       goto error;
    }
 
-   if (strncmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)) != 0)
+   if (memcmp(header.magic_number, MAGIC_NUMBER, sizeof(MAGIC_NUMBER)-1) != 0)
    {
       rv = -EINVAL;
       goto error;
@@ -265,93 +278,286 @@ error:
    return rv;
 }
 
-static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
-      libretrodb_index_t *idx)
+static int libretrodb_find_index(libretrodb_t *db, RFILE *fd,
+      const char *index_name, libretrodb_index_t *idx)
 {
-   ssize_t eof    = filestream_get_size(db->fd);
-   ssize_t offset = filestream_seek(db->fd,
+   ssize_t eof    = filestream_get_size(fd);
+   ssize_t offset = filestream_seek(fd,
          (ssize_t)db->first_index_offset,
          RETRO_VFS_SEEK_POSITION_START);
 
    /* TODO: this should use filestream_eof instead */
    while (offset < eof)
    {
-      libretrodb_read_index_header(db->fd, idx);
+      if (libretrodb_read_index_header(fd, idx) < 0)
+         return -1;
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
+      if (string_is_equal(index_name, idx->name))
          return 0;
 
-      filestream_seek(db->fd, (ssize_t)idx->next,
+      filestream_seek(fd, (ssize_t)idx->next,
             RETRO_VFS_SEEK_POSITION_CURRENT);
-      offset = filestream_tell(db->fd);
+      offset = filestream_tell(fd);
    }
 
    return -1;
 }
 
-static int binsearch(const void *buff, const void *item,
-      uint64_t count, uint8_t field_size, uint64_t *offset)
+/* Index entries are stored sorted by key, each entry being
+ * the key followed by the big-endian offset of the record. */
+static int libretrodb_index_read_entry(RFILE *fd, uint64_t data_offset,
+      const libretrodb_index_t *idx, uint64_t entry, uint8_t *buff)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = memcmp(current, item, field_size);
+   ssize_t entry_size = (ssize_t)(idx->key_size + sizeof(uint64_t));
 
-   if (rv == 0)
+   if (filestream_seek(fd, (ssize_t)(data_offset + entry * entry_size),
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -1;
+
+   if (filestream_read(fd, buff, entry_size) != entry_size)
+      return -1;
+
+   return 0;
+}
+
+/**
+ * libretrodb_index_lookup:
+ * @fd                  : File to read the index from.
+ * @data_offset         : Offset of the first index entry.
+ * @idx                 : Index header.
+ * @key                 : Key to look for, @idx->key_size bytes.
+ * @offsets             : Array the record offsets are appended to.
+ * @count               : Number of offsets in @offsets.
+ * @cap                 : Capacity of @offsets.
+ *
+ * Binary searches the index on disk for all entries with @key.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+static int libretrodb_index_lookup(RFILE *fd, uint64_t data_offset,
+      const libretrodb_index_t *idx, const uint8_t *key,
+      uint64_t **offsets, size_t *count, size_t *cap)
+{
+   uint8_t entry[256 + sizeof(uint64_t)];
+   uint64_t entry_size  = idx->key_size + sizeof(uint64_t);
+   uint64_t num_entries = entry_size ? idx->next / entry_size : 0;
+   uint64_t lo          = 0;
+   uint64_t hi          = num_entries;
+
+   if (idx->key_size == 0 || idx->key_size > 256)
+      return -EINVAL;
+
+   /* Find the first entry which isn't smaller than the key */
+   while (lo < hi)
    {
-      *offset = *(uint64_t *)(current + field_size);
-      return 0;
+      uint64_t mid = lo + (hi - lo) / 2;
+
+      if (libretrodb_index_read_entry(fd, data_offset, idx, mid, entry) < 0)
+         return -errno;
+
+      if (memcmp(entry, key, (size_t)idx->key_size) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
    }
 
-   if (count == 0)
-      return -1;
+   for (; lo < num_entries; lo++)
+   {
+      uint64_t offset;
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+      if (libretrodb_index_read_entry(fd, data_offset, idx, lo, entry) < 0)
+         return -errno;
+
+      if (memcmp(entry, key, (size_t)idx->key_size) != 0)
+         break;
+
+      if (*count == *cap)
+      {
+         size_t new_cap         = *cap ? *cap * 2 : 16;
+         uint64_t *new_offsets  = (uint64_t*)
+            realloc(*offsets, new_cap * sizeof(uint64_t));
+
+         if (!new_offsets)
+            return -ENOMEM;
+
+         *offsets = new_offsets;
+         *cap     = new_cap;
+      }
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+      memcpy(&offset, entry + idx->key_size, sizeof(uint64_t));
+      (*offsets)[(*count)++] = swap_if_little64(offset);
+   }
+
+   return 0;
 }
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       const void *key, struct rmsgpack_dom_value *out)
 {
    libretrodb_index_t idx;
+   uint64_t data_offset;
+   uint64_t *offsets = NULL;
+   size_t count      = 0;
+   size_t cap        = 0;
    int rv;
-   void *buff;
-   uint64_t offset;
-   ssize_t bufflen, nread = 0;
 
-   if (libretrodb_find_index(db, index_name, &idx) < 0)
+   if (libretrodb_find_index(db, db->fd, index_name, &idx) < 0)
       return -1;
 
-   bufflen = idx.next;
-   buff = malloc(bufflen);
+   data_offset = filestream_tell(db->fd);
 
-   if (!buff)
-      return -ENOMEM;
+   rv = libretrodb_index_lookup(db->fd, data_offset, &idx,
+         (const uint8_t*)key, &offsets, &count, &cap);
+
+   if (rv == 0 && count == 0)
+      rv = -1;
+
+   if (rv == 0)
+   {
+      filestream_seek(db->fd, (ssize_t)offsets[0],
+            RETRO_VFS_SEEK_POSITION_START);
+      rv = rmsgpack_dom_read(db->fd, out);
+   }
+
+   free(offsets);
+   return rv;
+}
+
+static int libretrodb_offset_cmp(const void *a, const void *b)
+{
+   uint64_t x = *(const uint64_t*)a;
+   uint64_t y = *(const uint64_t*)b;
+
+   if (x < y)
+      return -1;
+   if (x > y)
+      return 1;
+   return 0;
+}
+
+/**
+ * libretrodb_cursor_plan:
+ * @cursor              : Handle to database cursor.
+ *
+ * Looks for a top-level equality predicate of the cursor's
+ * query on a field which has an index named after it. If one is
+ * found, the offsets of all records which can match are looked
+ * up in the index and only those are read (and still filtered
+ * by the whole query) by libretrodb_cursor_read_item. Otherwise
+ * the cursor falls back to scanning every record.
+ **/
+static void libretrodb_cursor_plan(libretrodb_cursor_t *cursor)
+{
+   unsigned i;
+   int num_keys;
+   const struct rmsgpack_dom_value *field = NULL;
+   const struct rmsgpack_dom_value *keys[LIBRETRODB_MAX_INDEX_KEYS];
 
-   while (nread < bufflen)
+   for (i = 0; (num_keys = libretrodb_query_get_keys(cursor->query, i,
+               &field, keys, LIBRETRODB_MAX_INDEX_KEYS)) >= 0; i++)
    {
-      void *buff_ = (uint64_t *)buff + nread;
-      rv = (int)filestream_read(db->fd, buff_, bufflen - nread);
+      int j;
+      libretrodb_index_t idx;
+      uint64_t data_offset;
+      size_t count      = 0;
+      size_t cap        = 0;
+      uint64_t *offsets = NULL;
+
+      if (num_keys == 0 || field->type != RDT_STRING)
+         continue;
 
-      if (rv <= 0)
+      /* Indices only hold binary keys */
+      for (j = 0; j < num_keys; j++)
+         if (keys[j]->type != RDT_BINARY)
+            break;
+
+      if (j < num_keys)
+         continue;
+
+      if (libretrodb_find_index(cursor->db, cursor->fd,
+               field->val.string.buff, &idx) < 0)
+         continue;
+
+      data_offset = filestream_tell(cursor->fd);
+
+      for (j = 0; j < num_keys; j++)
       {
-         free(buff);
-         return -errno;
+         uint8_t key[256];
+         uint32_t len = keys[j]->val.binary.len;
+
+         /* Shorter keys are stored zero padded, longer
+          * ones can't match anything */
+         if (len > idx.key_size || idx.key_size > sizeof(key))
+            continue;
+
+         memset(key, 0, (size_t)idx.key_size);
+         memcpy(key, keys[j]->val.binary.buff, len);
+
+         if (libretrodb_index_lookup(cursor->fd, data_offset, &idx,
+                  key, &offsets, &count, &cap) < 0)
+            break;
+      }
+
+      if (j < num_keys)
+      {
+         free(offsets);
+         continue;
+      }
+
+      /* Read the records in file order, once each */
+      if (count > 1)
+      {
+         size_t k, n = 1;
+
+         qsort(offsets, count, sizeof(uint64_t), libretrodb_offset_cmp);
+
+         for (k = 1; k < count; k++)
+            if (offsets[k] != offsets[n - 1])
+               offsets[n++] = offsets[k];
+
+         count = n;
       }
-      nread += rv;
+
+      cursor->is_indexed  = 1;
+      cursor->offsets     = offsets;
+      cursor->num_offsets = count;
+      cursor->next_offset = 0;
+      break;
    }
+}
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
-   free(buff);
+/* Reads the database into memory, for libretrodb_cursor_read_item_view */
+static int libretrodb_cursor_load(libretrodb_cursor_t *cursor)
+{
+   int64_t size = filestream_get_size(cursor->fd);
+   int64_t pos  = filestream_tell(cursor->fd);
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset,
-            RETRO_VFS_SEEK_POSITION_START);
+   if (size <= 0 || pos < 0 || pos > size)
+      return -EINVAL;
+
+   if (!cursor->data)
+   {
+      /* One spare byte for terminating the last value */
+      if (!(cursor->data = (uint8_t*)malloc((size_t)size + 1)))
+         return -ENOMEM;
+   }
+
+   if (filestream_seek(cursor->fd, 0, RETRO_VFS_SEEK_POSITION_START) < 0
+         || filestream_read(cursor->fd, cursor->data, size) != size)
+   {
+      free(cursor->data);
+      cursor->data = NULL;
+      return -EIO;
+   }
+
+   filestream_seek(cursor->fd, pos, RETRO_VFS_SEEK_POSITION_START);
+   rmsgpack_dom_buf_init(&cursor->view, cursor->data,
+         (size_t)size, (size_t)(cursor->db->root + sizeof(libretrodb_header_t)));
+
+   if (cursor->arena)
+      rmsgpack_dom_arena_reset(cursor->arena);
 
-   return rmsgpack_dom_read(db->fd, out);
+   return 0;
 }
 
 /**
@@ -364,12 +570,80 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
-   cursor->eof = 0;
+   cursor->eof         = 0;
+   cursor->next_offset = 0;
+
+   /* Values were terminated in place, so start from a fresh copy */
+   if (cursor->data && libretrodb_cursor_load(cursor) < 0)
+      return -1;
+
    return (int)filestream_seek(cursor->fd,
          (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
          RETRO_VFS_SEEK_POSITION_START);
 }
 
+int libretrodb_cursor_map(libretrodb_cursor_t *cursor)
+{
+   if (!cursor->arena && !(cursor->arena = rmsgpack_dom_arena_new()))
+      return -ENOMEM;
+
+   return libretrodb_cursor_load(cursor);
+}
+
+int libretrodb_cursor_read_item_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+   struct rmsgpack_dom_arena_mark mark;
+
+   if (cursor->eof)
+      return EOF;
+
+   if (!cursor->data)
+      return -EINVAL;
+
+retry:
+   if (cursor->is_indexed)
+   {
+      if (cursor->next_offset >= cursor->num_offsets)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      /* Offsets are sorted, so this only ever moves forward */
+      cursor->view.pos = (size_t)cursor->offsets[cursor->next_offset++];
+   }
+
+   rmsgpack_dom_arena_mark(cursor->arena, &mark);
+
+   if ((rv = rmsgpack_dom_read_buf(&cursor->view, cursor->arena, out)) < 0)
+      return rv;
+
+   if (out->type == RDT_NULL)
+   {
+      cursor->eof = 1;
+      return EOF;
+   }
+
+   if (cursor->query)
+   {
+      if (!libretrodb_query_filter(cursor->query, out))
+      {
+         rmsgpack_dom_arena_release(cursor->arena, &mark);
+         goto retry;
+      }
+   }
+
+   return 0;
+}
+
+void libretrodb_cursor_release_views(libretrodb_cursor_t *cursor)
+{
+   if (cursor->arena)
+      rmsgpack_dom_arena_reset(cursor->arena);
+}
+
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out)
 {
@@ -379,6 +653,19 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       return EOF;
 
 retry:
+   if (cursor->is_indexed)
+   {
+      if (cursor->next_offset >= cursor->num_offsets)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+
+      filestream_seek(cursor->fd,
+            (ssize_t)cursor->offsets[cursor->next_offset++],
+            RETRO_VFS_SEEK_POSITION_START);
+   }
+
    rv = rmsgpack_dom_read(cursor->fd, out);
    if (rv < 0)
       return rv;
@@ -401,6 +688,36 @@ retry:
    return 0;
 }
 
+uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor)
+{
+   if (cursor->is_indexed)
+      return (cursor->next_offset < cursor->num_offsets)
+         ? cursor->offsets[cursor->next_offset] : 0;
+
+   if (cursor->data)
+      return cursor->view.pos;
+
+   return (uint64_t)filestream_tell(cursor->fd);
+}
+
+int libretrodb_cursor_read_item_at(libretrodb_cursor_t *cursor,
+      uint64_t offset, struct rmsgpack_dom_value *out)
+{
+   int rv;
+
+   if (filestream_seek(cursor->fd, (ssize_t)offset,
+            RETRO_VFS_SEEK_POSITION_START) < 0)
+      return -EINVAL;
+
+   if ((rv = rmsgpack_dom_read(cursor->fd, out)) < 0)
+      return rv;
+
+   if (out->type == RDT_NULL)
+      return EOF;
+
+   return 0;
+}
+
 /**
  * libretrodb_cursor_close:
  * @cursor              : Handle to database cursor.
@@ -418,11 +735,26 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
-   cursor->is_valid = 0;
-   cursor->eof      = 1;
-   cursor->fd       = NULL;
-   cursor->db       = NULL;
-   cursor->query    = NULL;
+   if (cursor->offsets)
+      free(cursor->offsets);
+
+   if (cursor->data)
+      free(cursor->data);
+
+   if (cursor->arena)
+      rmsgpack_dom_arena_free(cursor->arena);
+
+   cursor->is_valid    = 0;
+   cursor->eof         = 1;
+   cursor->fd          = NULL;
+   cursor->db          = NULL;
+   cursor->query       = NULL;
+   cursor->is_indexed  = 0;
+   cursor->offsets     = NULL;
+   cursor->num_offsets = 0;
+   cursor->next_offset = 0;
+   cursor->data        = NULL;
+   cursor->arena       = NULL;
 }
 
 /**
@@ -449,14 +781,23 @@ int libretrodb_cursor_open(libretrodb_t *db, libretrodb_cursor_t *cursor,
    if (!fd)
       return -errno;
 
-   cursor->fd       = fd;
-   cursor->db       = db;
-   cursor->is_valid = 1;
-   libretrodb_cursor_reset(cursor);
-   cursor->query    = q;
+   cursor->fd          = fd;
+   cursor->db          = db;
+   cursor->is_valid    = 1;
+   cursor->is_indexed  = 0;
+   cursor->offsets     = NULL;
+   cursor->num_offsets = 0;
+   cursor->data        = NULL;
+   cursor->arena       = NULL;
+   cursor->query       = q;
 
    if (q)
+   {
       libretrodb_query_inc_ref(q);
+      libretrodb_cursor_plan(cursor);
+   }
+
+   libretrodb_cursor_reset(cursor);
 
    return 0;
 }
@@ -465,21 +806,17 @@ static int node_iter(void *value, void *ctx)
 {
    struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
 
-   if (filestream_write(nictx->db->fd, value,
+   if (filestream_write(nictx->fd, value,
             (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
       return 0;
 
    return -1;
 }
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
-{
-   return filestream_tell(db->fd);
-}
-
 static int node_compare(const void *a, const void *b, void *ctx)
 {
-   return memcmp(a, b, *(uint8_t *)ctx);
+   /* Equal keys are ordered by record offset */
+   return memcmp(a, b, *(uint8_t *)ctx + sizeof(uint64_t));
 }
 
 int libretrodb_create_index(libretrodb_t *db,
@@ -491,10 +828,11 @@ int libretrodb_create_index(libretrodb_t *db,
    struct rmsgpack_dom_value item;
    libretrodb_cursor_t cur          = {0};
    struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
+   RFILE *out                       = NULL;
+   uint8_t *buff                    = NULL;
+   uint64_t count                   = 0;
+   uint64_t item_loc                = 0;
    uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
    bintree_t *tree                  = bintree_new(node_compare, &field_size);
 
    item.type                        = RDT_NULL;
@@ -506,8 +844,12 @@ int libretrodb_create_index(libretrodb_t *db,
    key.val.string.len  = (uint32_t)strlen(field_name);
    key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
 
+   item_loc            = filestream_tell(cur.fd);
+
    while (libretrodb_cursor_read_item(&cur, &item) == 0)
    {
+      uint64_t item_loc_be;
+
       if (item.type != RDT_MAP)
       {
          printf("Only map keys are supported\n");
@@ -516,64 +858,72 @@ int libretrodb_create_index(libretrodb_t *db,
 
       field = rmsgpack_dom_value_map_value(&item, &key);
 
-      if (!field)
+      /* Records without the field can't match
+       * an equality lookup on it anyway */
+      if (field)
       {
-         printf("field not found in item\n");
-         goto clean;
-      }
-
-      if (field->type != RDT_BINARY)
-      {
-         printf("field is not binary\n");
-         goto clean;
+         if (field->type != RDT_BINARY)
+         {
+            printf("field is not binary\n");
+            goto clean;
+         }
+
+         if (field->val.binary.len == 0)
+         {
+            printf("field is empty\n");
+            goto clean;
+         }
+
+         if (field_size == 0)
+            field_size = field->val.binary.len;
+         else if (field->val.binary.len != field_size)
+         {
+            printf("field is not of correct size\n");
+            goto clean;
+         }
+
+         buff = (uint8_t*)malloc(field_size + sizeof(uint64_t));
+         if (!buff)
+            goto clean;
+
+         item_loc_be = swap_if_little64(item_loc);
+         memcpy(buff, field->val.binary.buff, field_size);
+         memcpy(buff + field_size, &item_loc_be, sizeof(uint64_t));
+
+         if (bintree_insert(tree, buff) != 0)
+            goto clean;
+
+         buff = NULL;
+         count++;
       }
 
-      if (field->val.binary.len == 0)
-      {
-         printf("field is empty\n");
-         goto clean;
-      }
-
-      if (field_size == 0)
-         field_size = field->val.binary.len;
-      else if (field->val.binary.len != field_size)
-      {
-         printf("field is not of correct size\n");
-         goto clean;
-      }
-
-      buff = malloc(field_size + sizeof(uint64_t));
-      if (!buff)
-         goto clean;
-
-      memcpy(buff, field->val.binary.buff, field_size);
+      rmsgpack_dom_value_free(&item);
+      item_loc = filestream_tell(cur.fd);
+   }
 
-      buff_u64 = (uint64_t *)buff + field_size;
+   if (count == 0)
+   {
+      printf("field not found in any item\n");
+      goto clean;
+   }
 
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+   out = filestream_open(db->path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
-      if (bintree_insert(tree, buff) != 0)
-      {
-         printf("Value is not unique: ");
-         rmsgpack_dom_value_print(field);
-         printf("\n");
-         goto clean;
-      }
-      buff     = NULL;
-      rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
-   }
+   if (!out)
+      goto clean;
 
-   filestream_seek(db->fd, 0, RETRO_VFS_SEEK_POSITION_END);
+   filestream_seek(out, 0, RETRO_VFS_SEEK_POSITION_END);
 
    strncpy(idx.name, name, 50);
 
    idx.name[49] = '\0';
    idx.key_size = field_size;
-   idx.next     = db->count * (field_size + sizeof(uint64_t));
-   libretrodb_write_index_header(db->fd, &idx);
+   idx.next     = count * (field_size + sizeof(uint64_t));
+   libretrodb_write_index_header(out, &idx);
 
-   nictx.db  = db;
+   nictx.fd  = out;
    nictx.idx = &idx;
    bintree_iterate(tree, node_iter, &nictx);
 
@@ -581,6 +931,8 @@ clean:
    rmsgpack_dom_value_free(&item);
    if (buff)
       free(buff);
+   if (out)
+      filestream_close(out);
    if (cur.is_valid)
       libretrodb_cursor_close(&cur);
    if (tree)
@@ -589,6 +941,24 @@ clean:
    return 0;
 }
 
+int libretrodb_write_index(RFILE *fd, const char *name,
+      uint64_t key_size, const void *entries, uint64_t count)
+{
+   libretrodb_index_t idx;
+   ssize_t size = (ssize_t)(count * (key_size + sizeof(uint64_t)));
+
+   strlcpy(idx.name, name, sizeof(idx.name));
+   idx.key_size = key_size;
+   idx.next     = (uint64_t)size;
+
+   libretrodb_write_index_header(fd, &idx);
+
+   if (filestream_write(fd, entries, size) != size)
+      return -EIO;
+
+   return 0;
+}
+
 libretrodb_cursor_t *libretrodb_cursor_new(void)
 {
    libretrodb_cursor_t *dbc = (libretrodb_cursor_t*)
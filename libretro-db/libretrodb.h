@@ -57,6 +57,23 @@ int libretrodb_create_index(libretrodb_t *db, const char *name,
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
         const void *key, struct rmsgpack_dom_value *out);
 
+/**
+ * libretrodb_write_index:
+ * @fd                  : Database file, positioned at its end.
+ * @name                : Name of the index.
+ * @key_size            : Size of the keys, shorter ones are zero padded.
+ * @entries             : @count entries, each made of a key followed by
+ *                        the big-endian offset of its item, sorted.
+ * @count               : Number of entries.
+ *
+ * Appends an index to a database created by libretrodb_create,
+ * without reading the database back like libretrodb_create_index.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_write_index(RFILE *fd, const char *name,
+      uint64_t key_size, const void *entries, uint64_t count);
+
 libretrodb_t *libretrodb_new(void);
 
 void libretrodb_free(libretrodb_t *db);
@@ -105,6 +122,65 @@ void libretrodb_query_free(void *q);
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out);
 
+/**
+ * libretrodb_cursor_map:
+ * @cursor              : Handle to database cursor.
+ *
+ * Reads the whole database into memory, so that items can be read
+ * with libretrodb_cursor_read_item_view.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int libretrodb_cursor_map(libretrodb_cursor_t *cursor);
+
+/**
+ * libretrodb_cursor_read_item_view:
+ * @cursor              : Handle to a mapped database cursor.
+ * @out                 : Item read.
+ *
+ * Like libretrodb_cursor_read_item, but strings and binaries point
+ * into the cursor's copy of the database, and maps and arrays are
+ * allocated from the cursor's arena. Items stay valid until
+ * libretrodb_cursor_release_views, libretrodb_cursor_reset or
+ * libretrodb_cursor_close, and must not be passed to
+ * rmsgpack_dom_value_free.
+ *
+ * Returns: 0 if successful, otherwise EOF or negative.
+ **/
+int libretrodb_cursor_read_item_view(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out);
+
+/**
+ * libretrodb_cursor_release_views:
+ * @cursor              : Handle to a mapped database cursor.
+ *
+ * Releases all the items read with libretrodb_cursor_read_item_view.
+ **/
+void libretrodb_cursor_release_views(libretrodb_cursor_t *cursor);
+
+/**
+ * libretrodb_cursor_tell:
+ * @cursor              : Handle to database cursor.
+ *
+ * Returns: offset of the item the next call to
+ * libretrodb_cursor_read_item will start looking at.
+ **/
+uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor);
+
+/**
+ * libretrodb_cursor_read_item_at:
+ * @cursor              : Handle to database cursor.
+ * @offset              : Offset of the item, see libretrodb_cursor_tell.
+ * @out                 : Item read.
+ *
+ * Reads the item at @offset, without applying the cursor's query.
+ * A cursor opened without a query continues iterating after it.
+ *
+ * Returns: 0 if successful, otherwise EOF or negative.
+ **/
+int libretrodb_cursor_read_item_at(libretrodb_cursor_t *cursor,
+      uint64_t offset, struct rmsgpack_dom_value *out);
+
 RETRO_END_DECLS
 
 #endif
@@ -969,6 +969,62 @@ void libretrodb_query_inc_ref(libretrodb_query_t *q)
       rq->ref_count += 1;
 }
 
+/**
+ * libretrodb_query_get_keys:
+ * @q                   : Compiled query.
+ * @idx                 : Index of the top-level predicate to look at.
+ * @field               : Returns the name of the field the predicate is on.
+ * @keys                : Returns the values the field can be equal to.
+ * @max_keys            : Size of @keys.
+ *
+ * Checks whether predicate @idx of a table query is a plain
+ * equality, i.e. {field:value} or {field:or(value, ...)}, so that
+ * it can be answered through an index instead of a full scan.
+ *
+ * Returns: -1 if there is no predicate @idx, 0 if it is not a plain
+ * equality, otherwise the number of keys written to @keys.
+ **/
+int libretrodb_query_get_keys(libretrodb_query_t *q, unsigned idx,
+      const struct rmsgpack_dom_value **field,
+      const struct rmsgpack_dom_value **keys, unsigned max_keys)
+{
+   unsigned i;
+   const struct argument *arg  = NULL;
+   const struct invocation *inv = NULL;
+   struct invocation *root     = &((struct query *)q)->root;
+
+   if (root->func != query_func_all_map || idx * 2 + 1 >= root->argc)
+      return -1;
+
+   if (root->argv[idx * 2].type != AT_VALUE)
+      return 0;
+
+   *field = &root->argv[idx * 2].a.value;
+   arg    = &root->argv[idx * 2 + 1];
+
+   if (arg->type == AT_VALUE)
+   {
+      if (max_keys < 1)
+         return 0;
+      keys[0] = &arg->a.value;
+      return 1;
+   }
+
+   inv = &arg->a.invocation;
+
+   if (inv->func != query_func_operator_or || inv->argc > max_keys)
+      return 0;
+
+   for (i = 0; i < inv->argc; i++)
+   {
+      if (inv->argv[i].type != AT_VALUE)
+         return 0;
+      keys[i] = &inv->argv[i].a.value;
+   }
+
+   return (int)inv->argc;
+}
+
 int libretrodb_query_filter(libretrodb_query_t *q,
       struct rmsgpack_dom_value *v)
 {
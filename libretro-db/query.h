@@ -38,6 +38,10 @@ void libretrodb_query_dec_ref(libretrodb_query_t *q);
 
 int libretrodb_query_filter(libretrodb_query_t *q, struct rmsgpack_dom_value *v);
 
+int libretrodb_query_get_keys(libretrodb_query_t *q, unsigned idx,
+      const struct rmsgpack_dom_value **field,
+      const struct rmsgpack_dom_value **keys, unsigned max_keys);
+
 RETRO_END_DECLS
 
 #endif
@@ -503,3 +503,335 @@ clean:
    rmsgpack_dom_value_free(&map);
    return 0;
 }
+
+#define ARENA_CHUNK_SIZE   (64 * 1024)
+#define ARENA_ALIGN(x)     (((x) + 15) & ~((size_t)15))
+
+struct rmsgpack_dom_arena_chunk
+{
+   struct rmsgpack_dom_arena_chunk *prev;
+   size_t size;
+   size_t used;
+};
+
+#define ARENA_HEADER_SIZE  ARENA_ALIGN(sizeof(struct rmsgpack_dom_arena_chunk))
+
+struct rmsgpack_dom_arena
+{
+   struct rmsgpack_dom_arena_chunk *chunk;
+};
+
+rmsgpack_dom_arena_t *rmsgpack_dom_arena_new(void)
+{
+   return (rmsgpack_dom_arena_t*)calloc(1, sizeof(rmsgpack_dom_arena_t));
+}
+
+void rmsgpack_dom_arena_free(rmsgpack_dom_arena_t *arena)
+{
+   if (!arena)
+      return;
+
+   while (arena->chunk)
+   {
+      struct rmsgpack_dom_arena_chunk *prev = arena->chunk->prev;
+      free(arena->chunk);
+      arena->chunk = prev;
+   }
+
+   free(arena);
+}
+
+void *rmsgpack_dom_arena_alloc(rmsgpack_dom_arena_t *arena, size_t size)
+{
+   struct rmsgpack_dom_arena_chunk *chunk = arena->chunk;
+
+   size = ARENA_ALIGN(size);
+
+   if (!chunk || chunk->size - chunk->used < size)
+   {
+      size_t chunk_size = size > ARENA_CHUNK_SIZE ? size : ARENA_CHUNK_SIZE;
+
+      chunk = (struct rmsgpack_dom_arena_chunk*)
+         malloc(ARENA_HEADER_SIZE + chunk_size);
+
+      if (!chunk)
+         return NULL;
+
+      chunk->prev  = arena->chunk;
+      chunk->size  = chunk_size;
+      chunk->used  = 0;
+      arena->chunk = chunk;
+   }
+
+   chunk->used += size;
+   return (uint8_t*)chunk + ARENA_HEADER_SIZE + chunk->used - size;
+}
+
+void rmsgpack_dom_arena_mark(rmsgpack_dom_arena_t *arena,
+      struct rmsgpack_dom_arena_mark *mark)
+{
+   mark->chunk = arena->chunk;
+   mark->used  = arena->chunk ? arena->chunk->used : 0;
+}
+
+void rmsgpack_dom_arena_release(rmsgpack_dom_arena_t *arena,
+      const struct rmsgpack_dom_arena_mark *mark)
+{
+   while (arena->chunk && (void*)arena->chunk != mark->chunk)
+   {
+      struct rmsgpack_dom_arena_chunk *prev = arena->chunk->prev;
+      free(arena->chunk);
+      arena->chunk = prev;
+   }
+
+   if (arena->chunk)
+      arena->chunk->used = mark->used;
+}
+
+void rmsgpack_dom_arena_reset(rmsgpack_dom_arena_t *arena)
+{
+   /* Keep the last chunk around for the next values */
+   if (!arena->chunk)
+      return;
+
+   while (arena->chunk->prev)
+   {
+      struct rmsgpack_dom_arena_chunk *prev = arena->chunk->prev->prev;
+      free(arena->chunk->prev);
+      arena->chunk->prev = prev;
+   }
+
+   arena->chunk->used = 0;
+}
+
+void rmsgpack_dom_buf_init(struct rmsgpack_dom_buf *buf,
+      uint8_t *buff, size_t len, size_t pos)
+{
+   buf->buff      = buff;
+   buf->len       = len;
+   buf->pos       = pos;
+   buf->saved_pos = (size_t)-1;
+   buf->saved     = 0;
+}
+
+static int dom_buf_read_byte(struct rmsgpack_dom_buf *buf, uint8_t *out)
+{
+   if (buf->pos >= buf->len)
+      return -EINVAL;
+
+   *out = (buf->pos == buf->saved_pos) ? buf->saved : buf->buff[buf->pos];
+   buf->pos++;
+   return 0;
+}
+
+static int dom_buf_read_uint(struct rmsgpack_dom_buf *buf,
+      uint64_t *out, size_t size)
+{
+   size_t i;
+   uint64_t value = 0;
+
+   if (buf->len - buf->pos < size)
+      return -EINVAL;
+
+   /* Can't start at saved_pos, this follows a type byte */
+   for (i = 0; i < size; i++)
+      value = (value << 8) | buf->buff[buf->pos + i];
+
+   buf->pos += size;
+   *out      = value;
+   return 0;
+}
+
+/* Points @out at the next @len bytes, terminated in place */
+static int dom_buf_read_view(struct rmsgpack_dom_buf *buf,
+      uint32_t len, char **out)
+{
+   size_t end;
+
+   if (buf->len - buf->pos < len)
+      return -EINVAL;
+
+   end            = buf->pos + len;
+   *out           = (char*)buf->buff + buf->pos;
+   buf->saved_pos = end;
+   buf->saved     = buf->buff[end];
+   buf->buff[end] = '\0';
+   buf->pos       = end;
+   return 0;
+}
+
+static int dom_buf_read(struct rmsgpack_dom_buf *buf,
+      rmsgpack_dom_arena_t *arena, struct rmsgpack_dom_value *out,
+      unsigned depth)
+{
+   int rv;
+   uint8_t type;
+   uint32_t i;
+   uint64_t tmp = 0;
+
+   if (depth >= MAX_DEPTH)
+      return -ENOMEM;
+
+   if ((rv = dom_buf_read_byte(buf, &type)) < 0)
+      return rv;
+
+   if (type < 0x80)
+   {
+      out->type     = RDT_INT;
+      out->val.int_ = type;
+      return 0;
+   }
+   else if (type < 0x90)
+   {
+      tmp = type - 0x80;
+      goto map;
+   }
+   else if (type < 0xa0)
+   {
+      tmp = type - 0x90;
+      goto array;
+   }
+   else if (type < 0xc0)
+   {
+      out->type           = RDT_STRING;
+      out->val.string.len = type - 0xa0;
+      return dom_buf_read_view(buf, out->val.string.len,
+            &out->val.string.buff);
+   }
+   else if (type > 0xdf)
+   {
+      out->type     = RDT_INT;
+      out->val.int_ = type - 0xff - 1;
+      return 0;
+   }
+
+   switch (type)
+   {
+      case 0xc0:
+         out->type = RDT_NULL;
+         return 0;
+      case 0xc2:
+      case 0xc3:
+         out->type      = RDT_BOOL;
+         out->val.bool_ = type - 0xc2;
+         return 0;
+      case 0xc4:
+      case 0xc5:
+      case 0xc6:
+         if ((rv = dom_buf_read_uint(buf, &tmp, 1 << (type - 0xc4))) < 0)
+            return rv;
+         out->type           = RDT_BINARY;
+         out->val.binary.len = (uint32_t)tmp;
+         return dom_buf_read_view(buf, out->val.binary.len,
+               &out->val.binary.buff);
+      case 0xcc:
+      case 0xcd:
+      case 0xce:
+      case 0xcf:
+         if ((rv = dom_buf_read_uint(buf, &tmp, 1 << (type - 0xcc))) < 0)
+            return rv;
+         out->type      = RDT_UINT;
+         out->val.uint_ = tmp;
+         return 0;
+      case 0xd0:
+      case 0xd1:
+      case 0xd2:
+      case 0xd3:
+         {
+            unsigned bits = 8 << (type - 0xd0);
+
+            if ((rv = dom_buf_read_uint(buf, &tmp, bits / 8)) < 0)
+               return rv;
+
+            /* Sign extend */
+            if (bits < 64 && (tmp & (UINT64_C(1) << (bits - 1))))
+               tmp |= ~UINT64_C(0) << bits;
+
+            out->type     = RDT_INT;
+            out->val.int_ = (int64_t)tmp;
+         }
+         return 0;
+      case 0xd9:
+      case 0xda:
+      case 0xdb:
+         if ((rv = dom_buf_read_uint(buf, &tmp, 1 << (type - 0xd9))) < 0)
+            return rv;
+         out->type           = RDT_STRING;
+         out->val.string.len = (uint32_t)tmp;
+         return dom_buf_read_view(buf, out->val.string.len,
+               &out->val.string.buff);
+      case 0xdc:
+      case 0xdd:
+         if ((rv = dom_buf_read_uint(buf, &tmp, 2 << (type - 0xdc))) < 0)
+            return rv;
+         goto array;
+      case 0xde:
+      case 0xdf:
+         if ((rv = dom_buf_read_uint(buf, &tmp, 2 << (type - 0xde))) < 0)
+            return rv;
+         goto map;
+      default:
+         return -EINVAL;
+   }
+
+map:
+   /* Every pair takes at least two bytes */
+   if (tmp > (buf->len - buf->pos) / 2)
+      return -EINVAL;
+
+   out->type          = RDT_MAP;
+   out->val.map.len   = (uint32_t)tmp;
+   out->val.map.items = NULL;
+
+   if (tmp)
+   {
+      out->val.map.items = (struct rmsgpack_dom_pair*)
+         rmsgpack_dom_arena_alloc(arena,
+               (size_t)tmp * sizeof(struct rmsgpack_dom_pair));
+      if (!out->val.map.items)
+         return -ENOMEM;
+   }
+
+   for (i = 0; i < out->val.map.len; i++)
+   {
+      if ((rv = dom_buf_read(buf, arena,
+                  &out->val.map.items[i].key, depth + 1)) < 0)
+         return rv;
+      if ((rv = dom_buf_read(buf, arena,
+                  &out->val.map.items[i].value, depth + 1)) < 0)
+         return rv;
+   }
+
+   return 0;
+
+array:
+   if (tmp > buf->len - buf->pos)
+      return -EINVAL;
+
+   out->type            = RDT_ARRAY;
+   out->val.array.len   = (uint32_t)tmp;
+   out->val.array.items = NULL;
+
+   if (tmp)
+   {
+      out->val.array.items = (struct rmsgpack_dom_value*)
+         rmsgpack_dom_arena_alloc(arena,
+               (size_t)tmp * sizeof(struct rmsgpack_dom_value));
+      if (!out->val.array.items)
+         return -ENOMEM;
+   }
+
+   for (i = 0; i < out->val.array.len; i++)
+      if ((rv = dom_buf_read(buf, arena,
+                  &out->val.array.items[i], depth + 1)) < 0)
+         return rv;
+
+   return 0;
+}
+
+int rmsgpack_dom_read_buf(struct rmsgpack_dom_buf *buf,
+      rmsgpack_dom_arena_t *arena, struct rmsgpack_dom_value *out)
+{
+   out->type = RDT_NULL;
+   return dom_buf_read(buf, arena, out, 0);
+}
@@ -24,6 +24,7 @@
 #define __LIBRETRODB_MSGPACK_DOM_H__
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include <retro_common_api.h>
 #include <streams/file_stream.h>
@@ -95,6 +96,63 @@ int rmsgpack_dom_write(RFILE *fd, const struct rmsgpack_dom_value *obj);
 
 int rmsgpack_dom_read_into(RFILE *fd, ...);
 
+/* Bump allocator for values read with rmsgpack_dom_read_buf,
+ * which are released all at once instead of one by one */
+typedef struct rmsgpack_dom_arena rmsgpack_dom_arena_t;
+
+struct rmsgpack_dom_arena_mark
+{
+   void *chunk;
+   size_t used;
+};
+
+rmsgpack_dom_arena_t *rmsgpack_dom_arena_new(void);
+
+void rmsgpack_dom_arena_free(rmsgpack_dom_arena_t *arena);
+
+void *rmsgpack_dom_arena_alloc(rmsgpack_dom_arena_t *arena, size_t size);
+
+/* Releases everything allocated from @arena */
+void rmsgpack_dom_arena_reset(rmsgpack_dom_arena_t *arena);
+
+/* Releases everything allocated from @arena since @mark was taken */
+void rmsgpack_dom_arena_mark(rmsgpack_dom_arena_t *arena,
+      struct rmsgpack_dom_arena_mark *mark);
+void rmsgpack_dom_arena_release(rmsgpack_dom_arena_t *arena,
+      const struct rmsgpack_dom_arena_mark *mark);
+
+/* Msgpack data in memory, see rmsgpack_dom_read_buf */
+struct rmsgpack_dom_buf
+{
+   uint8_t *buff;     /* @len bytes, plus one spare */
+   size_t len;
+   size_t pos;
+   size_t saved_pos;  /* byte overwritten by the last terminator */
+   uint8_t saved;
+};
+
+void rmsgpack_dom_buf_init(struct rmsgpack_dom_buf *buf,
+      uint8_t *buff, size_t len, size_t pos);
+
+/**
+ * rmsgpack_dom_read_buf:
+ * @buf                 : Data to read from, at @buf->pos.
+ * @arena               : Arena map and array items are allocated from.
+ * @out                 : Value read.
+ *
+ * Reads a value without copying strings and binaries, which point
+ * into @buf->buff and stay valid as long as it does. They're still
+ * NUL-terminated: the terminator overwrites the first byte of the
+ * following value, which is kept aside until it's read. Because of
+ * this, @buf->pos can only be moved forward between reads.
+ *
+ * @out must not be passed to rmsgpack_dom_value_free.
+ *
+ * Returns: 0 if successful, otherwise negative.
+ **/
+int rmsgpack_dom_read_buf(struct rmsgpack_dom_buf *buf,
+      rmsgpack_dom_arena_t *arena, struct rmsgpack_dom_value *out);
+
 RETRO_END_DECLS
 
 #endif
@@ -32,6 +32,14 @@
 #include "../config.h"
 #endif
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifdef HAVE_MENU
 #include "../menu/menu_driver.h"
 #include "../menu/widgets/menu_input_dialog.h"
@@ -966,19 +974,283 @@ int cheat_manager_search_eqminus(rarch_setting_t *setting, bool wraparound)
    return cheat_manager_search(CHEAT_SEARCH_TYPE_EQMINUS);
 }
 
+/* Regions at least this large are searched
+ * by several threads at once */
+#define CHEAT_SEARCH_THREADED_MIN_SIZE (1024 * 1024)
+#define CHEAT_SEARCH_MAX_THREADS       8
+
+typedef struct cheat_manager_search_job
+{
+   enum cheat_search_type search_type;
+   unsigned start;
+   unsigned end;
+   unsigned bytes_per_item;
+   unsigned bits;
+   unsigned mask;
+   unsigned eliminated;
+} cheat_manager_search_job_t;
+
+static INLINE unsigned cheat_manager_search_load(const uint8_t *p,
+      unsigned bytes_per_item, bool big_endian)
+{
+   switch (bytes_per_item)
+   {
+      case 2:
+         return big_endian
+            ? ((unsigned)p[0] << 8) | p[1]
+            : p[0] | ((unsigned)p[1] << 8);
+      case 4:
+         return big_endian
+            ? ((unsigned)p[0] << 24) | ((unsigned)p[1] << 16)
+            | ((unsigned)p[2] << 8)  | p[3]
+            : p[0] | ((unsigned)p[1] << 8)
+            | ((unsigned)p[2] << 16) | ((unsigned)p[3] << 24);
+      default:
+         break;
+   }
+
+   return p[0];
+}
+
+static INLINE bool cheat_manager_search_compare(
+      enum cheat_search_type search_type,
+      unsigned curr_subval, unsigned prev_subval)
+{
+   switch (search_type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         return (curr_subval == cheat_manager_state.search_exact_value);
+      case CHEAT_SEARCH_TYPE_LT:
+         return (curr_subval < prev_subval);
+      case CHEAT_SEARCH_TYPE_GT:
+         return (curr_subval > prev_subval);
+      case CHEAT_SEARCH_TYPE_LTE:
+         return (curr_subval <= prev_subval);
+      case CHEAT_SEARCH_TYPE_GTE:
+         return (curr_subval >= prev_subval);
+      case CHEAT_SEARCH_TYPE_EQ:
+         return (curr_subval == prev_subval);
+      case CHEAT_SEARCH_TYPE_NEQ:
+         return (curr_subval != prev_subval);
+      case CHEAT_SEARCH_TYPE_EQPLUS:
+         return (curr_subval == prev_subval + cheat_manager_state.search_eqplus_value);
+      case CHEAT_SEARCH_TYPE_EQMINUS:
+         return (curr_subval == prev_subval - cheat_manager_state.search_eqminus_value);
+   }
+
+   return false;
+}
+
+/* Compares a single item at @idx and clears its
+ * match flags if it doesn't match anymore.
+ * Returns the number of eliminated matches. */
+static unsigned cheat_manager_search_item(
+      const cheat_manager_search_job_t *job, unsigned idx,
+      unsigned curr_val, unsigned prev_val)
+{
+   unsigned byte_part;
+   unsigned eliminated = 0;
+   uint8_t *matches    = cheat_manager_state.matches + idx;
+
+   if (job->bits == 8)
+   {
+      if (*matches && !cheat_manager_search_compare(job->search_type,
+               curr_val, prev_val))
+      {
+         memset(matches, 0, job->bytes_per_item);
+         eliminated++;
+      }
+      return eliminated;
+   }
+
+   for (byte_part = 0; byte_part < 8 / job->bits; byte_part++)
+   {
+      unsigned part_mask   = job->mask << (byte_part * job->bits);
+      unsigned curr_subval = (curr_val >> (byte_part * job->bits)) & job->mask;
+      unsigned prev_subval = (prev_val >> (byte_part * job->bits)) & job->mask;
+
+      if ((*matches & part_mask) && !cheat_manager_search_compare(
+               job->search_type, curr_subval, prev_subval))
+      {
+         *matches = *matches & ((~part_mask) & 0xFF);
+         eliminated++;
+      }
+   }
+
+   return eliminated;
+}
+
+#if defined(__SSE2__)
+/* Compares 16 8-bit items at once. Only handles the search
+ * types which can be expressed as unsigned byte compares,
+ * returns false for the others. */
+static bool cheat_manager_search_block_sse2(
+      cheat_manager_search_job_t *job,
+      const uint8_t *curr, const uint8_t *prev, uint8_t *matches)
+{
+   __m128i match;
+   unsigned eliminated;
+   __m128i c     = _mm_loadu_si128((const __m128i*)curr);
+   __m128i p     = _mm_loadu_si128((const __m128i*)prev);
+   __m128i m     = _mm_loadu_si128((const __m128i*)matches);
+   __m128i ones  = _mm_set1_epi8((char)0xFF);
+   __m128i eq    = _mm_cmpeq_epi8(c, p);
+
+   switch (job->search_type)
+   {
+      case CHEAT_SEARCH_TYPE_EXACT:
+         if (cheat_manager_state.search_exact_value > 0xFF)
+            match = _mm_setzero_si128();
+         else
+            match = _mm_cmpeq_epi8(c,
+                  _mm_set1_epi8((char)cheat_manager_state.search_exact_value));
+         break;
+      case CHEAT_SEARCH_TYPE_EQ:
+         match = eq;
+         break;
+      case CHEAT_SEARCH_TYPE_NEQ:
+         match = _mm_xor_si128(eq, ones);
+         break;
+      case CHEAT_SEARCH_TYPE_LTE:
+         match = _mm_cmpeq_epi8(_mm_min_epu8(c, p), c);
+         break;
+      case CHEAT_SEARCH_TYPE_GTE:
+         match = _mm_cmpeq_epi8(_mm_max_epu8(c, p), c);
+         break;
+      case CHEAT_SEARCH_TYPE_LT:
+         match = _mm_andnot_si128(eq, _mm_cmpeq_epi8(_mm_min_epu8(c, p), c));
+         break;
+      case CHEAT_SEARCH_TYPE_GT:
+         match = _mm_andnot_si128(eq, _mm_cmpeq_epi8(_mm_max_epu8(c, p), c));
+         break;
+      default:
+         return false;
+   }
+
+   /* Items which were still matching, but don't anymore */
+   eliminated = ~_mm_movemask_epi8(_mm_cmpeq_epi8(m, _mm_setzero_si128()))
+      & ~_mm_movemask_epi8(match) & 0xFFFF;
+
+   for (; eliminated; eliminated &= eliminated - 1)
+      job->eliminated++;
+
+   _mm_storeu_si128((__m128i*)matches, _mm_and_si128(m, match));
+
+   return true;
+}
+#endif
+
+/* Reads the item at @idx when it straddles two memory
+ * regions, one byte at a time. */
+static unsigned cheat_manager_search_load_split(unsigned idx,
+      unsigned bytes_per_item, bool big_endian)
+{
+   unsigned i;
+   uint8_t buf[4];
+
+   for (i = 0; i < bytes_per_item; i++)
+   {
+      unsigned char *curr = NULL;
+      unsigned offset     = translate_address(idx + i, &curr);
+
+      buf[i]              = curr ? curr[idx + i - offset] : 0;
+   }
+
+   return cheat_manager_search_load(buf, bytes_per_item, big_endian);
+}
+
+static void cheat_manager_search_range(void *data)
+{
+   cheat_manager_search_job_t *job = (cheat_manager_search_job_t*)data;
+   const uint8_t *prev             = cheat_manager_state.prev_memory_buf;
+   uint8_t *matches                = cheat_manager_state.matches;
+   bool big_endian                 = cheat_manager_state.big_endian;
+   unsigned bytes_per_item         = job->bytes_per_item;
+   unsigned region                 = 0;
+   unsigned region_start           = 0;
+   unsigned idx                    = job->start;
+
+   while (idx < job->end)
+   {
+      const uint8_t *curr;
+      unsigned region_end;
+      unsigned block_end;
+
+      while (region < cheat_manager_state.num_memory_buffers &&
+            idx >= region_start + cheat_manager_state.memory_size_list[region])
+      {
+         region_start += cheat_manager_state.memory_size_list[region];
+         region++;
+      }
+
+      if (region >= cheat_manager_state.num_memory_buffers)
+         break;
+
+      curr       = cheat_manager_state.memory_buf_list[region] - region_start;
+      region_end = region_start + cheat_manager_state.memory_size_list[region];
+      block_end  = MIN(region_end, job->end);
+
+      /* Items fully contained in this region */
+      while (idx + bytes_per_item <= block_end)
+      {
+         uint64_t word;
+
+         /* Skip over runs of items which have already been
+          * eliminated by earlier searches */
+         if (!(idx & 7) && idx + 8 <= block_end)
+         {
+            memcpy(&word, matches + idx, sizeof(word));
+            if (!word)
+            {
+               idx += 8;
+               continue;
+            }
+         }
+
+#if defined(__SSE2__)
+         if (bytes_per_item == 1 && job->bits == 8 && idx + 16 <= block_end)
+         {
+            if (cheat_manager_search_block_sse2(job,
+                     curr + idx, prev + idx, matches + idx))
+            {
+               idx += 16;
+               continue;
+            }
+         }
+#endif
+
+         job->eliminated += cheat_manager_search_item(job, idx,
+               cheat_manager_search_load(curr + idx, bytes_per_item, big_endian),
+               cheat_manager_search_load(prev + idx, bytes_per_item, big_endian));
+         idx += bytes_per_item;
+      }
+
+      /* Item straddling the end of this region, a partial
+       * item at the very end of memory is never searched */
+      if (idx < block_end)
+      {
+         if (idx + bytes_per_item > job->end)
+            break;
+
+         job->eliminated += cheat_manager_search_item(job, idx,
+               cheat_manager_search_load_split(idx, bytes_per_item, big_endian),
+               cheat_manager_search_load(prev + idx, bytes_per_item, big_endian));
+         idx += bytes_per_item;
+      }
+   }
+}
+
 int cheat_manager_search(enum cheat_search_type search_type)
 {
    char msg[100];
-   unsigned char *curr = cheat_manager_state.curr_memory_buf;
-   unsigned char *prev = cheat_manager_state.prev_memory_buf;
-   unsigned int idx = 0;
-   unsigned int curr_val = 0;
-   unsigned int prev_val = 0;
+   cheat_manager_search_job_t jobs[CHEAT_SEARCH_MAX_THREADS];
    unsigned int mask = 0;
    unsigned int bytes_per_item = 1;
    unsigned int bits = 8;
    unsigned int offset = 0;
    unsigned int i = 0;
+   unsigned int num_jobs = 1;
+   unsigned int eliminated = 0;
    bool refresh = false;
 
    if (cheat_manager_state.num_memory_buffers == 0)
@@ -989,95 +1261,61 @@ int cheat_manager_search(enum cheat_search_type search_type)
 
    cheat_manager_setup_search_meta(cheat_manager_state.search_bit_size, &bytes_per_item, &mask, &bits);
 
-   /* little endian FF000000 = 256 */
-   for (idx = 0; idx < cheat_manager_state.total_memory_size; idx = idx + bytes_per_item)
+#ifdef HAVE_THREADS
+   if (cheat_manager_state.total_memory_size >= CHEAT_SEARCH_THREADED_MIN_SIZE)
    {
-      unsigned byte_part;
+      num_jobs = cpu_features_get_core_amount();
+      num_jobs = MAX(1, MIN(num_jobs, CHEAT_SEARCH_MAX_THREADS));
+   }
+#endif
 
-      offset = translate_address(idx, &curr);
+   /* Split the memory into chunks on 16-byte boundaries,
+    * so that every item belongs to exactly one chunk */
+   for (i = 0; i < num_jobs; i++)
+   {
+      unsigned chunk = ((cheat_manager_state.total_memory_size / num_jobs) + 15) & ~15U;
+
+      jobs[i].search_type    = search_type;
+      jobs[i].start          = MIN(i * chunk, cheat_manager_state.total_memory_size);
+      jobs[i].end            = (i == num_jobs - 1)
+         ? cheat_manager_state.total_memory_size
+         : MIN((i + 1) * chunk, cheat_manager_state.total_memory_size);
+      jobs[i].bytes_per_item = bytes_per_item;
+      jobs[i].bits           = bits;
+      jobs[i].mask           = mask;
+      jobs[i].eliminated     = 0;
+   }
 
-      switch (bytes_per_item)
-      {
-      case 2:
-         curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256) + *(curr + idx + 1 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256);
-         prev_val = cheat_manager_state.big_endian ?
-               (*(prev + idx) * 256) + *(prev + idx + 1) :
-               *(prev + idx) + (*(prev + idx + 1) * 256);
-         break;
-      case 4:
-         curr_val = cheat_manager_state.big_endian ?
-               (*(curr + idx - offset) * 256 * 256 * 256) + (*(curr + idx + 1 - offset) * 256 * 256) + (*(curr + idx + 2 - offset) * 256) + *(curr + idx + 3 - offset) :
-               *(curr + idx - offset) + (*(curr + idx + 1 - offset) * 256) + (*(curr + idx + 2 - offset) * 256 * 256) + (*(curr + idx + 3 - offset) * 256 * 256 * 256);
-         prev_val = cheat_manager_state.big_endian ?
-               (*(prev + idx) * 256 * 256 * 256) + (*(prev + idx + 1) * 256 * 256) + (*(prev + idx + 2) * 256) + *(prev + idx + 3) :
-               *(prev + idx) + (*(prev + idx + 1) * 256) + (*(prev + idx + 2) * 256 * 256) + (*(prev + idx + 3) * 256 * 256 * 256);
-         break;
-      case 1:
-      default:
-         curr_val = *(curr - offset + idx);
-         prev_val = *(prev + idx);
-         break;
-      }
+#ifdef HAVE_THREADS
+   if (num_jobs > 1)
+   {
+      sthread_t *threads[CHEAT_SEARCH_MAX_THREADS] = {NULL};
 
-      for (byte_part = 0; byte_part < 8 / bits; byte_part++)
-      {
-         unsigned int curr_subval = (curr_val >> (byte_part * bits)) & mask;
-         unsigned int prev_subval = (prev_val >> (byte_part * bits)) & mask;
-         unsigned int prev_match;
+      for (i = 1; i < num_jobs; i++)
+         threads[i] = sthread_create(cheat_manager_search_range, &jobs[i]);
 
-         if (bits < 8)
-            prev_match = *(cheat_manager_state.matches + idx) & (mask << (byte_part * bits));
-         else
-            prev_match = *(cheat_manager_state.matches + idx);
+      cheat_manager_search_range(&jobs[0]);
 
-         if (prev_match > 0)
-         {
-            bool match = false;
-            switch (search_type)
-            {
-            case CHEAT_SEARCH_TYPE_EXACT:
-               match = (curr_subval == cheat_manager_state.search_exact_value);
-               break;
-            case CHEAT_SEARCH_TYPE_LT:
-               match = (curr_subval < prev_subval);
-               break;
-            case CHEAT_SEARCH_TYPE_GT:
-               match = (curr_subval > prev_subval);
-               break;
-            case CHEAT_SEARCH_TYPE_LTE:
-               match = (curr_subval <= prev_subval);
-               break;
-            case CHEAT_SEARCH_TYPE_GTE:
-               match = (curr_subval >= prev_subval);
-               break;
-            case CHEAT_SEARCH_TYPE_EQ:
-               match = (curr_subval == prev_subval);
-               break;
-            case CHEAT_SEARCH_TYPE_NEQ:
-               match = (curr_subval != prev_subval);
-               break;
-            case CHEAT_SEARCH_TYPE_EQPLUS:
-               match = (curr_subval == prev_subval + cheat_manager_state.search_eqplus_value);
-               break;
-            case CHEAT_SEARCH_TYPE_EQMINUS:
-               match = (curr_subval == prev_subval - cheat_manager_state.search_eqminus_value);
-               break;
-            }
-            if (!match)
-            {
-               if (bits < 8)
-                  *(cheat_manager_state.matches + idx) = *(cheat_manager_state.matches + idx) &
-                        ((~(mask << (byte_part * bits))) & 0xFF);
-               else
-                  memset(cheat_manager_state.matches + idx, 0, bytes_per_item);
-               if (cheat_manager_state.num_matches > 0)
-                  cheat_manager_state.num_matches--;
-            }
-         }
+      for (i = 1; i < num_jobs; i++)
+      {
+         /* Fall back to searching the chunk on this thread */
+         if (threads[i])
+            sthread_join(threads[i]);
+         else
+            cheat_manager_search_range(&jobs[i]);
       }
    }
+   else
+#endif
+      cheat_manager_search_range(&jobs[0]);
+
+   for (i = 0; i < num_jobs; i++)
+      eliminated += jobs[i].eliminated;
+
+   if (eliminated > cheat_manager_state.num_matches)
+      cheat_manager_state.num_matches = 0;
+   else
+      cheat_manager_state.num_matches -= eliminated;
 
    offset = 0;
 
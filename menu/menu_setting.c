@@ -5133,55 +5133,135 @@ int menu_action_handle_setting(rarch_setting_t *setting,
    return -1;
 }
 
-static rarch_setting_t *menu_setting_find_internal(rarch_setting_t *setting,
-      const char *label)
+/* Lookup indices over the settings list, built once
+ * per list by menu_setting_index_build so that
+ * menu_setting_find/menu_setting_find_enum do not have
+ * to walk the whole list.
+ *
+ * Both indices only hold the first setting of type
+ * ST_GROUP or lower for a given label/enum, which is the
+ * one a linear search would return. */
+typedef struct menu_setting_index
 {
-   rarch_setting_t **list = &setting;
+   rarch_setting_t *list;
+   rarch_setting_t **by_enum;
+   rarch_setting_t **by_label;
+   uint32_t *label_hashes;
+   size_t label_mask;
+} menu_setting_index_t;
 
-   for (; setting_get_type(setting) != ST_NONE; (*list = *list + 1))
+static menu_setting_index_t menu_setting_idx;
+
+static void menu_setting_index_free(void)
+{
+   if (menu_setting_idx.by_enum)
+      free(menu_setting_idx.by_enum);
+   if (menu_setting_idx.by_label)
+      free(menu_setting_idx.by_label);
+   if (menu_setting_idx.label_hashes)
+      free(menu_setting_idx.label_hashes);
+
+   menu_setting_idx.list         = NULL;
+   menu_setting_idx.by_enum      = NULL;
+   menu_setting_idx.by_label     = NULL;
+   menu_setting_idx.label_hashes = NULL;
+   menu_setting_idx.label_mask   = 0;
+}
+
+static bool menu_setting_index_build(rarch_setting_t *list)
+{
+   size_t count          = 0;
+   size_t cap            = 1;
+   rarch_setting_t *setting;
+
+   menu_setting_index_free();
+
+   for (setting = list; setting_get_type(setting) != ST_NONE; setting++)
+      count++;
+
+   while (cap < count * 2)
+      cap <<= 1;
+
+   menu_setting_idx.by_enum      = (rarch_setting_t**)
+      calloc(MSG_LAST, sizeof(*menu_setting_idx.by_enum));
+   menu_setting_idx.by_label     = (rarch_setting_t**)
+      calloc(cap, sizeof(*menu_setting_idx.by_label));
+   menu_setting_idx.label_hashes = (uint32_t*)
+      calloc(cap, sizeof(*menu_setting_idx.label_hashes));
+
+   if (  !menu_setting_idx.by_enum
+      || !menu_setting_idx.by_label
+      || !menu_setting_idx.label_hashes)
    {
-      const char *name              = setting->name;
-      const char *short_description = setting->short_description;
+      menu_setting_index_free();
+      return false;
+   }
 
-      if (
-            string_is_equal(label, name) &&
-            (setting_get_type(setting) <= ST_GROUP))
+   menu_setting_idx.label_mask   = cap - 1;
+
+   for (setting = list; setting_get_type(setting) != ST_NONE; setting++)
+   {
+      if (setting_get_type(setting) > ST_GROUP)
+         continue;
+
+      if (     (unsigned)setting->enum_idx < MSG_LAST
+            && !menu_setting_idx.by_enum[setting->enum_idx])
+         menu_setting_idx.by_enum[setting->enum_idx] = setting;
+
+      if (!string_is_empty(setting->name))
       {
-         if (string_is_empty(short_description))
-            break;
+         uint32_t hash = msg_hash_calculate(setting->name);
+         size_t   i    = hash & menu_setting_idx.label_mask;
 
-         if (setting->read_handler)
-            setting->read_handler(setting);
+         while (menu_setting_idx.by_label[i])
+         {
+            if (     menu_setting_idx.label_hashes[i] == hash
+                  && string_is_equal(
+                     menu_setting_idx.by_label[i]->name, setting->name))
+               break;
+            i = (i + 1) & menu_setting_idx.label_mask;
+         }
 
-         return setting;
+         if (!menu_setting_idx.by_label[i])
+         {
+            menu_setting_idx.by_label[i]     = setting;
+            menu_setting_idx.label_hashes[i] = hash;
+         }
       }
    }
 
-   return NULL;
+   menu_setting_idx.list = list;
+
+   return true;
 }
 
-static rarch_setting_t *menu_setting_find_internal_enum(rarch_setting_t *setting,
-     enum msg_hash_enums enum_idx)
+static rarch_setting_t *menu_setting_index_find(const char *label)
 {
-   rarch_setting_t **list = &setting;
-   for (; setting_get_type(setting) != ST_NONE; (*list = *list + 1))
-   {
-      if (setting->enum_idx == enum_idx && setting_get_type(setting) <= ST_GROUP)
-      {
-         const char *short_description = setting->short_description;
-         if (string_is_empty(short_description))
-            return NULL;
-
-         if (setting->read_handler)
-            setting->read_handler(setting);
+   uint32_t hash = msg_hash_calculate(label);
+   size_t   i    = hash & menu_setting_idx.label_mask;
 
-         return setting;
-      }
+   while (menu_setting_idx.by_label[i])
+   {
+      if (     menu_setting_idx.label_hashes[i] == hash
+            && string_is_equal(menu_setting_idx.by_label[i]->name, label))
+         return menu_setting_idx.by_label[i];
+      i = (i + 1) & menu_setting_idx.label_mask;
    }
 
    return NULL;
 }
 
+static rarch_setting_t *menu_setting_find_internal(rarch_setting_t *setting)
+{
+   if (!setting || string_is_empty(setting->short_description))
+      return NULL;
+
+   if (setting->read_handler)
+      setting->read_handler(setting);
+
+   return setting;
+}
+
 /**
  * menu_setting_find:
  * @settings           : pointer to settings
@@ -5193,7 +5273,9 @@ static rarch_setting_t *menu_setting_find_internal_enum(rarch_setting_t *setting
  **/
 rarch_setting_t *menu_setting_find(const char *label)
 {
+   static struct retro_perf_counter menu_setting_find_perf = {0};
    rarch_setting_t *setting = NULL;
+   bool is_perfcnt_enable   = false;
 
    if (!label)
       return NULL;
@@ -5202,21 +5284,56 @@ rarch_setting_t *menu_setting_find(const char *label)
 
    if (!setting)
       return NULL;
-   return menu_setting_find_internal(setting, label);
+
+   is_perfcnt_enable = rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL);
+
+   performance_counter_init(menu_setting_find_perf, "menu_setting_find");
+   performance_counter_start_plus(is_perfcnt_enable, menu_setting_find_perf);
+
+   if (menu_setting_idx.list != setting)
+      menu_setting_index_build(setting);
+
+   setting = menu_setting_idx.list
+      ? menu_setting_find_internal(menu_setting_index_find(label))
+      : NULL;
+
+   performance_counter_stop_plus(is_perfcnt_enable, menu_setting_find_perf);
+
+   return setting;
 }
 
 rarch_setting_t *menu_setting_find_enum(enum msg_hash_enums enum_idx)
 {
+   static struct retro_perf_counter menu_setting_find_enum_perf = {0};
    rarch_setting_t *setting = NULL;
+   bool is_perfcnt_enable   = false;
 
-   if (enum_idx == 0)
+   if (enum_idx == 0 || (unsigned)enum_idx >= MSG_LAST)
       return NULL;
 
    menu_entries_ctl(MENU_ENTRIES_CTL_SETTINGS_GET, &setting);
 
    if (!setting)
       return NULL;
-   return menu_setting_find_internal_enum(setting, enum_idx);
+
+   is_perfcnt_enable = rarch_ctl(RARCH_CTL_IS_PERFCNT_ENABLE, NULL);
+
+   performance_counter_init(menu_setting_find_enum_perf,
+         "menu_setting_find_enum");
+   performance_counter_start_plus(is_perfcnt_enable,
+         menu_setting_find_enum_perf);
+
+   if (menu_setting_idx.list != setting)
+      menu_setting_index_build(setting);
+
+   setting = menu_setting_idx.list
+      ? menu_setting_find_internal(menu_setting_idx.by_enum[enum_idx])
+      : NULL;
+
+   performance_counter_stop_plus(is_perfcnt_enable,
+         menu_setting_find_enum_perf);
+
+   return setting;
 }
 
 int menu_setting_set_flags(rarch_setting_t *setting)
@@ -5710,6 +5827,11 @@ void general_write_handler(rarch_setting_t *setting)
       case MENU_ENUM_LABEL_INPUT_POLL_TYPE_BEHAVIOR:
          core_set_poll_type((unsigned int*)setting->value.target.integer);
          break;
+      case MENU_ENUM_LABEL_USER_LANGUAGE:
+         /* Written in place, this updates the strings */
+         msg_hash_set_uint(MSG_HASH_USER_LANGUAGE,
+               *setting->value.target.unsigned_integer);
+         break;
       case MENU_ENUM_LABEL_VIDEO_SCALE_INTEGER:
          {
             video_viewport_t vp;
@@ -7726,6 +7848,21 @@ static bool setting_append_list(
                   general_read_handler,
                   SD_FLAG_NONE);
 
+            CONFIG_BOOL(
+                  list, list_info,
+                  &settings->bools.scan_incremental,
+                  MENU_ENUM_LABEL_SCAN_INCREMENTAL,
+                  MENU_ENUM_LABEL_VALUE_SCAN_INCREMENTAL,
+                  scan_incremental,
+                  MENU_ENUM_LABEL_VALUE_OFF,
+                  MENU_ENUM_LABEL_VALUE_ON,
+                  &group_info,
+                  &subgroup_info,
+                  parent_group,
+                  general_write_handler,
+                  general_read_handler,
+                  SD_FLAG_NONE);
+
             END_SUB_GROUP(list, list_info, parent_group);
             END_GROUP(list, list_info, parent_group);
          }
@@ -14744,6 +14881,9 @@ void menu_setting_free(rarch_setting_t *setting)
    if (!setting)
       return;
 
+   if (menu_setting_idx.list == setting)
+      menu_setting_index_free();
+
    list                   = (rarch_setting_t**)&setting;
 
    /* Free data which was previously tagged */
@@ -14969,6 +15109,8 @@ bool menu_setting_ctl(enum menu_setting_ctl_state state, void *data)
             if (!setting)
                return false;
             *setting = menu_setting_new();
+            if (*setting)
+               menu_setting_index_build(*setting);
          }
          break;
       case MENU_SETTING_CTL_ACTION_RIGHT:
@@ -102,12 +102,13 @@ int menu_hash_get_help_enum(enum msg_hash_enums msg, char *s, size_t len)
 #endif
 }
 
-const char *msg_hash_to_str(enum msg_hash_enums msg)
+static const char *msg_hash_to_str_lang(enum msg_hash_enums msg,
+      unsigned lang)
 {
    const char *ret = NULL;
 
 #ifdef HAVE_LANGEXTRA
-   switch (uint_user_language)
+   switch (lang)
    {
       case RETRO_LANGUAGE_FRENCH:
          ret = msg_hash_to_str_fr(msg);
@@ -174,6 +175,48 @@ const char *msg_hash_to_str(enum msg_hash_enums msg)
    return msg_hash_to_str_us(msg);
 }
 
+/* Enum-indexed string table for the current user language,
+ * with the fallback to US English already resolved, so that
+ * lookups do not have to go through the per-language switch
+ * statements every time.
+ * It is only built by msg_hash_set_uint, from the main thread.
+ * Lookups in another language, or while it is being built,
+ * go through the switch statements. Strings formatted on
+ * every lookup aren't in it, as they share one buffer. */
+static const char *msg_hash_table[MSG_LAST];
+static unsigned msg_hash_table_lang = RETRO_LANGUAGE_LAST;
+
+static void msg_hash_table_build(unsigned lang)
+{
+   unsigned i;
+
+   msg_hash_table_lang = RETRO_LANGUAGE_LAST;
+
+   for (i = 0; i < MSG_LAST; i++)
+   {
+      if (     i >= MENU_ENUM_LABEL_INPUT_HOTKEY_BIND_BEGIN
+            && i <= MENU_ENUM_LABEL_INPUT_HOTKEY_BIND_END)
+         msg_hash_table[i] = NULL;
+      else
+         msg_hash_table[i] = msg_hash_to_str_lang(
+               (enum msg_hash_enums)i, lang);
+   }
+
+   msg_hash_table_lang = lang;
+}
+
+const char *msg_hash_to_str(enum msg_hash_enums msg)
+{
+   unsigned lang = uint_user_language;
+
+   if (     (unsigned)msg < MSG_LAST
+         && msg_hash_table_lang == lang
+         && msg_hash_table[msg])
+      return msg_hash_table[msg];
+
+   return msg_hash_to_str_lang(msg, lang);
+}
+
 uint32_t msg_hash_calculate(const char *s)
 {
    return djb2_calculate(s);
@@ -443,6 +486,7 @@ void msg_hash_set_uint(enum msg_hash_action type, unsigned val)
    {
       case MSG_HASH_USER_LANGUAGE:
          uint_user_language = val;
+         msg_hash_table_build(val);
          break;
       case MSG_HASH_NONE:
          break;
@@ -347,6 +347,8 @@ enum msg_hash_enums
    MSG_LIBRETRO_ABI_BREAK,
    MSG_DETECTED_VIEWPORT_OF,
    MSG_RECORDING_TO,
+   MSG_SAVING_REPLAY_TO,
+   MSG_REPLAY_BUFFER_NOT_RUNNING,
    MSG_HW_RENDERED_MUST_USE_POSTSHADED_RECORDING,
    MSG_VIEWPORT_SIZE_CALCULATION_FAILED,
    MSG_AUTOSAVE_FAILED,
@@ -446,6 +448,7 @@ enum msg_hash_enums
    MENU_LABEL(MENU_XMB_ANIMATION_MOVE_UP_DOWN),
    MENU_LABEL(MENU_XMB_ANIMATION_OPENING_MAIN_MENU),
    MENU_LABEL(SCAN_WITHOUT_CORE_MATCH),
+   MENU_LABEL(SCAN_INCREMENTAL),
    MENU_LABEL(STREAMING_TITLE),
    MENU_LABEL(STREAMING_MODE),
    MENU_LABEL(VIDEO_RECORD_QUALITY),
@@ -748,6 +751,7 @@ enum msg_hash_enums
    MENU_ENUM_LABEL_VALUE_INPUT_META_UI_COMPANION_TOGGLE,
    MENU_ENUM_LABEL_VALUE_INPUT_META_RECORDING_TOGGLE,
    MENU_ENUM_LABEL_VALUE_INPUT_META_STREAMING_TOGGLE,
+   MENU_ENUM_LABEL_VALUE_INPUT_META_REPLAY_SAVE,
    MENU_ENUM_LABEL_VALUE_INPUT_META_AI_SERVICE,
    MENU_ENUM_LABEL_VALUE_INPUT_META_MENU_TOGGLE,
 
@@ -0,0 +1,600 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <net/net_compat.h>
+#include <net/net_socket.h>
+
+#include "net_memwatch.h"
+
+#include "../core.h"
+#include "../retroarch.h"
+#include "../verbosity.h"
+
+#define NET_MEMWATCH_MAX_CLIENTS 4
+#define NET_MEMWATCH_MAX_WATCHES 1024
+#define NET_MEMWATCH_MAX_LENGTH  0x10000
+/* No more ranges are queued for a client with this much unsent */
+#define NET_MEMWATCH_MAX_PENDING (1 << 20)
+
+struct net_memwatch_range
+{
+   /* Contents last sent to the client */
+   uint8_t *snapshot;
+   uint32_t id;
+   uint32_t region;
+   uint32_t offset;
+   uint32_t length;
+};
+
+struct net_memwatch_client
+{
+   int fd;
+
+   struct net_memwatch_range *watches;
+   unsigned num_watches;
+   /* Where the next update starts, so that every range gets its turn */
+   unsigned next_watch;
+
+   uint8_t request[NET_MEMWATCH_REQUEST_SIZE];
+   size_t request_size;
+
+   uint8_t *out;
+   size_t out_size;
+   size_t out_sent;
+   size_t out_cap;
+};
+
+struct net_memwatch
+{
+   int listen_fd;
+   struct net_memwatch_client clients[NET_MEMWATCH_MAX_CLIENTS];
+};
+
+static void net_memwatch_put_u32(uint8_t *out, uint32_t value)
+{
+   out[0] = (uint8_t)(value);
+   out[1] = (uint8_t)(value >> 8);
+   out[2] = (uint8_t)(value >> 16);
+   out[3] = (uint8_t)(value >> 24);
+}
+
+static uint32_t net_memwatch_get_u32(const uint8_t *in)
+{
+   return (uint32_t)in[0]
+      | ((uint32_t)in[1] << 8)
+      | ((uint32_t)in[2] << 16)
+      | ((uint32_t)in[3] << 24);
+}
+
+static size_t net_memwatch_put_varint(uint8_t *out, size_t value)
+{
+   size_t len = 0;
+
+   while (value >= 0x80)
+   {
+      out[len++] = (uint8_t)(value | 0x80);
+      value    >>= 7;
+   }
+
+   out[len++] = (uint8_t)value;
+   return len;
+}
+
+/* Upper bound of net_memwatch_encode's output */
+#define NET_MEMWATCH_ENCODE_BOUND(len) ((len) * 3 + 16)
+
+/* XORs @data against @snapshot, run-length codes the result into
+ * @out and updates @snapshot. Returns the encoded size. */
+static size_t net_memwatch_encode(uint8_t *out,
+      uint8_t *snapshot, const uint8_t *data, size_t length)
+{
+   size_t i   = 0;
+   size_t pos = 0;
+
+   while (i < length)
+   {
+      size_t j;
+      size_t skip = i;
+      size_t start;
+
+      while (i < length && snapshot[i] == data[i])
+         i++;
+
+      if (i == length)
+         break;
+
+      start = i;
+
+      for (;;)
+      {
+         while (i < length && snapshot[i] != data[i])
+            i++;
+
+         /* A new run costs at least two bytes,
+          * so gaps shorter than that are cheaper as literals */
+         if (     (i + 1 < length && snapshot[i + 1] != data[i + 1])
+               || (i + 2 < length && snapshot[i + 2] != data[i + 2]))
+         {
+            i++;
+            continue;
+         }
+
+         break;
+      }
+
+      pos += net_memwatch_put_varint(out + pos, start - skip);
+      pos += net_memwatch_put_varint(out + pos, i - start);
+
+      for (j = start; j < i; j++)
+         out[pos++] = snapshot[j] ^ data[j];
+   }
+
+   memcpy(snapshot, data, length);
+   return pos;
+}
+
+static const uint8_t *net_memwatch_resolve(uint32_t region,
+      uint32_t offset, uint32_t length)
+{
+   size_t size         = 0;
+   const uint8_t *data = NULL;
+
+   if (region >= NET_MEMWATCH_REGION_MMAP)
+   {
+      const struct retro_memory_descriptor *desc = NULL;
+      rarch_system_info_t *system                = runloop_get_system_info();
+      unsigned index                             = region - NET_MEMWATCH_REGION_MMAP;
+
+      if (!system || index >= system->mmaps.num_descriptors)
+         return NULL;
+
+      desc = &system->mmaps.descriptors[index].core;
+      if (!desc->ptr)
+         return NULL;
+
+      data = (const uint8_t*)desc->ptr + desc->offset;
+      size = desc->len;
+   }
+   else
+   {
+      retro_ctx_memory_info_t mem_info;
+
+      mem_info.id   = region;
+      mem_info.data = NULL;
+      mem_info.size = 0;
+
+      core_get_memory(&mem_info);
+
+      data = (const uint8_t*)mem_info.data;
+      size = mem_info.size;
+   }
+
+   if (!data || offset > size || length > size - offset)
+      return NULL;
+
+   return data + offset;
+}
+
+static bool net_memwatch_reserve(struct net_memwatch_client *client,
+      size_t len)
+{
+   uint8_t *tmp;
+   size_t new_cap;
+
+   if (client->out_size + len <= client->out_cap)
+      return true;
+
+   /* Drop what was sent already before growing */
+   if (client->out_sent)
+   {
+      memmove(client->out, client->out + client->out_sent,
+            client->out_size - client->out_sent);
+      client->out_size -= client->out_sent;
+      client->out_sent  = 0;
+
+      if (client->out_size + len <= client->out_cap)
+         return true;
+   }
+
+   new_cap = client->out_cap ? client->out_cap : 4096;
+   while (new_cap < client->out_size + len)
+      new_cap *= 2;
+
+   tmp = (uint8_t*)realloc(client->out, new_cap);
+   if (!tmp)
+      return false;
+
+   client->out     = tmp;
+   client->out_cap = new_cap;
+   return true;
+}
+
+static bool net_memwatch_queue_message(struct net_memwatch_client *client,
+      uint8_t type, const void *payload, uint32_t size)
+{
+   uint8_t *out;
+
+   if (!net_memwatch_reserve(client, 8 + size))
+      return false;
+
+   out    = client->out + client->out_size;
+   out[0] = type;
+   out[1] = out[2] = out[3] = 0;
+   net_memwatch_put_u32(out + 4, size);
+   memcpy(out + 8, payload, size);
+
+   client->out_size += 8 + size;
+   return true;
+}
+
+static void net_memwatch_unwatch(struct net_memwatch_client *client,
+      unsigned i)
+{
+   free(client->watches[i].snapshot);
+   client->watches[i] = client->watches[--client->num_watches];
+}
+
+static void net_memwatch_close_client(struct net_memwatch_client *client)
+{
+   while (client->num_watches)
+      net_memwatch_unwatch(client, 0);
+
+   if (client->fd >= 0)
+      socket_close(client->fd);
+
+   free(client->watches);
+   free(client->out);
+
+   memset(client, 0, sizeof(*client));
+   client->fd = -1;
+}
+
+static bool net_memwatch_watch(struct net_memwatch_client *client,
+      uint32_t id, uint32_t region, uint32_t offset, uint32_t length)
+{
+   unsigned i;
+   uint8_t *snapshot                = NULL;
+   struct net_memwatch_range *range = NULL;
+
+   if (!length || length > NET_MEMWATCH_MAX_LENGTH)
+      return false;
+
+   if (!net_memwatch_resolve(region, offset, length))
+      return false;
+
+   /* Watching an id again replaces its range */
+   for (i = 0; i < client->num_watches; i++)
+   {
+      if (client->watches[i].id == id)
+      {
+         net_memwatch_unwatch(client, i);
+         break;
+      }
+   }
+
+   if (client->num_watches >= NET_MEMWATCH_MAX_WATCHES)
+      return false;
+
+   if (!client->watches)
+   {
+      client->watches = (struct net_memwatch_range*)calloc(
+            NET_MEMWATCH_MAX_WATCHES, sizeof(*client->watches));
+      if (!client->watches)
+         return false;
+   }
+
+   /* Starts out as zeroes so the first update sends everything */
+   snapshot = (uint8_t*)calloc(1, length);
+   if (!snapshot)
+      return false;
+
+   range           = &client->watches[client->num_watches++];
+   range->snapshot = snapshot;
+   range->id       = id;
+   range->region   = region;
+   range->offset   = offset;
+   range->length   = length;
+   return true;
+}
+
+static bool net_memwatch_handle_request(struct net_memwatch_client *client)
+{
+   unsigned i;
+   const uint8_t *req = client->request;
+   uint32_t id        = net_memwatch_get_u32(req + 4);
+
+   switch (req[0])
+   {
+      case NET_MEMWATCH_WATCH:
+         if (!net_memwatch_watch(client, id,
+                  net_memwatch_get_u32(req + 8),
+                  net_memwatch_get_u32(req + 12),
+                  net_memwatch_get_u32(req + 16)))
+         {
+            uint8_t payload[4];
+            net_memwatch_put_u32(payload, id);
+            return net_memwatch_queue_message(client,
+                  NET_MEMWATCH_WATCH_FAILED, payload, sizeof(payload));
+         }
+         break;
+      case NET_MEMWATCH_UNWATCH:
+         for (i = 0; i < client->num_watches; i++)
+         {
+            if (client->watches[i].id == id)
+            {
+               net_memwatch_unwatch(client, i);
+               break;
+            }
+         }
+         break;
+      case NET_MEMWATCH_UNWATCH_ALL:
+         while (client->num_watches)
+            net_memwatch_unwatch(client, 0);
+         break;
+      default:
+         return false;
+   }
+
+   return true;
+}
+
+static bool net_memwatch_read(struct net_memwatch_client *client)
+{
+   for (;;)
+   {
+      bool error  = false;
+      ssize_t ret = socket_receive_all_nonblocking(client->fd, &error,
+            client->request + client->request_size,
+            NET_MEMWATCH_REQUEST_SIZE - client->request_size);
+
+      if (error)
+         return false;
+
+      if (ret <= 0)
+         return true;
+
+      client->request_size += ret;
+
+      if (client->request_size == NET_MEMWATCH_REQUEST_SIZE)
+      {
+         client->request_size = 0;
+         if (!net_memwatch_handle_request(client))
+            return false;
+      }
+   }
+}
+
+/* Queues one update with every changed range of @client */
+static bool net_memwatch_queue_update(struct net_memwatch_client *client,
+      uint64_t frame)
+{
+   unsigned i;
+   size_t header;
+   uint8_t *out   = NULL;
+   unsigned first = 0;
+   bool changed   = false;
+
+   if (!client->num_watches)
+      return true;
+
+   /* The snapshots only advance with what was queued,
+    * so skipped frames are folded into the next update */
+   if (client->out_size - client->out_sent > NET_MEMWATCH_MAX_PENDING)
+      return true;
+
+   if (client->next_watch < client->num_watches)
+      first = client->next_watch;
+
+   if (!net_memwatch_reserve(client, 16))
+      return false;
+
+   /* Relative to what is unsent, reserving may drop the sent part */
+   header = client->out_size - client->out_sent;
+   out    = client->out + client->out_size;
+   out[0] = NET_MEMWATCH_UPDATE;
+   out[1] = out[2] = out[3] = 0;
+   net_memwatch_put_u32(out + 8,  (uint32_t)frame);
+   net_memwatch_put_u32(out + 12, (uint32_t)(frame >> 32));
+   client->out_size += 16;
+
+   for (i = 0; i < client->num_watches; i++)
+   {
+      size_t size;
+      unsigned index                   = (first + i) % client->num_watches;
+      struct net_memwatch_range *range = &client->watches[index];
+      const uint8_t *data              = NULL;
+
+      /* The ranges left out keep their snapshot,
+       * their changes go with a later update */
+      if (client->out_size - client->out_sent > NET_MEMWATCH_MAX_PENDING)
+      {
+         client->next_watch = index;
+         break;
+      }
+
+      data = net_memwatch_resolve(range->region, range->offset,
+            range->length);
+
+      if (!data || !memcmp(range->snapshot, data, range->length))
+         continue;
+
+      if (!net_memwatch_reserve(client,
+               8 + NET_MEMWATCH_ENCODE_BOUND(range->length)))
+         return false;
+
+      size = net_memwatch_encode(client->out + client->out_size + 8,
+            range->snapshot, data, range->length);
+
+      net_memwatch_put_u32(client->out + client->out_size, range->id);
+      net_memwatch_put_u32(client->out + client->out_size + 4, (uint32_t)size);
+      client->out_size += 8 + size;
+      changed           = true;
+   }
+
+   /* Nothing to tell, take the header back */
+   if (!changed)
+   {
+      client->out_size = client->out_sent + header;
+      return true;
+   }
+
+   out = client->out + client->out_sent + header;
+   net_memwatch_put_u32(out + 4,
+         (uint32_t)(client->out_size - client->out_sent - header - 8));
+   return true;
+}
+
+static bool net_memwatch_flush(struct net_memwatch_client *client)
+{
+   ssize_t sent;
+
+   if (client->out_sent == client->out_size)
+      return true;
+
+   sent = socket_send_all_nonblocking(client->fd,
+         client->out + client->out_sent,
+         client->out_size - client->out_sent, true);
+
+   if (sent < 0)
+      return false;
+
+   client->out_sent += sent;
+
+   if (client->out_sent == client->out_size)
+      client->out_sent = client->out_size = 0;
+
+   return true;
+}
+
+static void net_memwatch_accept(net_memwatch_t *handle)
+{
+   for (;;)
+   {
+      unsigned i;
+      int fd = (int)accept(handle->listen_fd, NULL, NULL);
+
+      if (fd < 0)
+         return;
+
+      for (i = 0; i < NET_MEMWATCH_MAX_CLIENTS; i++)
+         if (handle->clients[i].fd < 0)
+            break;
+
+      if (i == NET_MEMWATCH_MAX_CLIENTS || !socket_nonblock(fd))
+      {
+         RARCH_WARN("[memwatch] Rejecting client, too many connections.\n");
+         socket_close(fd);
+         continue;
+      }
+
+#if defined(IPPROTO_TCP) && defined(TCP_NODELAY)
+      {
+         int flag = 1;
+         setsockopt(fd, IPPROTO_TCP, TCP_NODELAY,
+               (const char*)&flag, sizeof(int));
+      }
+#endif
+
+      handle->clients[i].fd = fd;
+      RARCH_LOG("[memwatch] Client connected.\n");
+   }
+}
+
+net_memwatch_t *net_memwatch_new(uint16_t port)
+{
+   unsigned i;
+   struct addrinfo *res   = NULL;
+   net_memwatch_t *handle = (net_memwatch_t*)calloc(1, sizeof(*handle));
+
+   if (!handle)
+      return NULL;
+
+   for (i = 0; i < NET_MEMWATCH_MAX_CLIENTS; i++)
+      handle->clients[i].fd = -1;
+
+   /* Core memory is only offered to local tools */
+   handle->listen_fd = socket_init((void**)&res, port,
+         "127.0.0.1", SOCKET_TYPE_STREAM);
+
+   if (handle->listen_fd < 0)
+      goto error;
+
+   if (     !socket_bind(handle->listen_fd, (void*)res)
+         || listen(handle->listen_fd, NET_MEMWATCH_MAX_CLIENTS) < 0
+         || !socket_nonblock(handle->listen_fd))
+      goto error;
+
+   freeaddrinfo_retro(res);
+
+   RARCH_LOG("[memwatch] Listening on 127.0.0.1:%hu.\n",
+         (unsigned short)port);
+   return handle;
+
+error:
+   RARCH_ERR("[memwatch] Failed to listen on port %hu.\n",
+         (unsigned short)port);
+   if (res)
+      freeaddrinfo_retro(res);
+   net_memwatch_free(handle);
+   return NULL;
+}
+
+void net_memwatch_free(net_memwatch_t *handle)
+{
+   unsigned i;
+
+   if (!handle)
+      return;
+
+   for (i = 0; i < NET_MEMWATCH_MAX_CLIENTS; i++)
+      if (handle->clients[i].fd >= 0)
+         net_memwatch_close_client(&handle->clients[i]);
+
+   if (handle->listen_fd >= 0)
+      socket_close(handle->listen_fd);
+
+   free(handle);
+}
+
+void net_memwatch_update(net_memwatch_t *handle, uint64_t frame)
+{
+   unsigned i;
+
+   if (!handle)
+      return;
+
+   net_memwatch_accept(handle);
+
+   for (i = 0; i < NET_MEMWATCH_MAX_CLIENTS; i++)
+   {
+      struct net_memwatch_client *client = &handle->clients[i];
+
+      if (client->fd < 0)
+         continue;
+
+      if (     !net_memwatch_read(client)
+            || !net_memwatch_queue_update(client, frame)
+            || !net_memwatch_flush(client))
+      {
+         RARCH_LOG("[memwatch] Client disconnected.\n");
+         net_memwatch_close_client(client);
+      }
+   }
+}
@@ -0,0 +1,85 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __NET_MEMWATCH_H
+#define __NET_MEMWATCH_H
+
+#include <stdint.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* Memory watch protocol, a binary alternative to READ_CORE_RAM for
+ * tools that follow many addresses every frame. Clients connect over
+ * TCP to localhost, register ranges once and then receive the ranges
+ * that changed after every frame. All integers are little endian.
+ *
+ * Client requests are NET_MEMWATCH_REQUEST_SIZE bytes each:
+ *   u8  type      NET_MEMWATCH_WATCH, _UNWATCH or _UNWATCH_ALL
+ *   u8  reserved[3]
+ *   u32 id        chosen by the client, names the range in updates
+ *   u32 region    RETRO_MEMORY_* id, or NET_MEMWATCH_REGION_MMAP + n
+ *                 for memory descriptor n of the core's memory map
+ *   u32 offset
+ *   u32 length
+ *
+ * Server messages start with an 8 byte header:
+ *   u8  type      NET_MEMWATCH_UPDATE or NET_MEMWATCH_WATCH_FAILED
+ *   u8  reserved[3]
+ *   u32 size      of the payload following the header
+ *
+ * NET_MEMWATCH_WATCH_FAILED carries the u32 id of the rejected range.
+ *
+ * NET_MEMWATCH_UPDATE carries a u64 frame number, then for each
+ * changed range its u32 id, u32 encoded size and the encoded bytes.
+ * The encoding is the XOR of the new contents against the previously
+ * sent ones (zeroes for a new range), run-length coded as pairs of
+ * LEB128 varints (zero bytes to skip, literal bytes to XOR) each
+ * followed by the literal bytes. Trailing zero bytes are omitted. */
+
+#define NET_MEMWATCH_REQUEST_SIZE   20
+
+#define NET_MEMWATCH_WATCH          0x01
+#define NET_MEMWATCH_UNWATCH        0x02
+#define NET_MEMWATCH_UNWATCH_ALL    0x03
+
+#define NET_MEMWATCH_UPDATE         0x81
+#define NET_MEMWATCH_WATCH_FAILED   0x82
+
+#define NET_MEMWATCH_REGION_MMAP    0x100
+
+typedef struct net_memwatch net_memwatch_t;
+
+net_memwatch_t *net_memwatch_new(uint16_t port);
+
+void net_memwatch_free(net_memwatch_t *handle);
+
+/**
+ * net_memwatch_update:
+ * @handle           : memory watch server handle.
+ * @frame            : number of the frame that just ran.
+ *
+ * Accepts new clients, reads their requests and sends every
+ * client the watched ranges that changed since its last update.
+ * Never blocks, slow clients receive combined updates later.
+ **/
+void net_memwatch_update(net_memwatch_t *handle, uint64_t frame);
+
+RETRO_END_DECLS
+
+#endif
@@ -57,6 +57,7 @@ bool netplay_delta_frame_ready(netplay_t *netplay, struct delta_frame *delta,
    delta->used = true;
    delta->frame = frame;
    delta->crc = 0;
+   delta->have_state = false;
    for (i = 0; i < MAX_INPUT_DEVICES; i++)
    {
       clear_input(delta->resolved_input[i]);
@@ -254,6 +254,7 @@ static bool get_self_input_state(netplay_t *netplay)
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
          netplay_send_cur_input(netplay, &netplay->connections[i]);
    }
+   netplay_spectate_cur_input(netplay);
 
    /* Handle any delayed state changes */
    if (netplay->is_server)
@@ -312,6 +313,9 @@ static bool netplay_poll(void)
    if (res == -1)
       goto catastrophe;
 
+   /* Repeat our recent input, and that we forward, over UDP */
+   netplay_udp_send(netplay_data);
+
    /* Resolve and/or simulate the input if we don't have real input */
    netplay_resolve_input(netplay_data, netplay_data->run_ptr, false);
 
@@ -336,6 +340,7 @@ static bool netplay_poll(void)
       int input_latency_frames_min = settings->uints.netplay_input_latency_frames_min -
             (settings->bools.run_ahead_enabled ? settings->uints.run_ahead_frames : 0);
       int input_latency_frames_max = input_latency_frames_min + settings->uints.netplay_input_latency_frames_range;
+      int udp_latency_frames       = netplay_udp_latency_frames(netplay_data);
 
       /* Assume we need a couple frames worth of time to actually run the
        * current frame */
@@ -345,7 +350,20 @@ static bool netplay_poll(void)
          frames_per_frame = 0;
 
       /* Shall we adjust our latency? */
-      if (netplay_data->stateless_mode)
+      if (udp_latency_frames >= 0)
+      {
+         /* Follow the network delay measured over UDP */
+         if (udp_latency_frames < input_latency_frames_min)
+            udp_latency_frames = input_latency_frames_min;
+         else if (udp_latency_frames > input_latency_frames_max)
+            udp_latency_frames = input_latency_frames_max;
+
+         if (netplay_data->input_latency_frames < udp_latency_frames)
+            netplay_data->input_latency_frames++;
+         else if (netplay_data->input_latency_frames > udp_latency_frames)
+            netplay_data->input_latency_frames--;
+      }
+      else if (netplay_data->stateless_mode)
       {
          /* In stateless mode, we adjust up if we're "close" and down if we
           * have a lot of slack */
@@ -1013,6 +1031,8 @@ static void netplay_frontend_paused(netplay_t *netplay, bool paused)
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active && connection->shared)
+         continue;
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
       {
          if (paused)
@@ -1026,6 +1046,19 @@ static void netplay_frontend_paused(netplay_t *netplay, bool paused)
          netplay_send_flush(&connection->send_packet_buffer, connection->fd, true);
       }
    }
+
+   if (paused)
+      netplay_spectate_send(netplay, NETPLAY_CMD_PAUSE,
+         netplay->nick, NETPLAY_NICK_LEN);
+   else
+      netplay_spectate_send(netplay, NETPLAY_CMD_RESUME, NULL, 0);
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active && connection->shared)
+         netplay_spectate_flush(netplay, connection);
+   }
 }
 
 /**
@@ -1126,13 +1159,17 @@ void netplay_post_frame(netplay_t *netplay)
    retro_assert(netplay);
    netplay_update_unread_ptr(netplay);
    netplay_sync_post_frame(netplay, false);
+   netplay_spectate_post_frame(netplay);
 
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection->active &&
-          !netplay_send_flush(&connection->send_packet_buffer, connection->fd,
-            false))
+      if (!connection->active)
+         continue;
+      if (connection->shared ?
+            !netplay_spectate_flush(netplay, connection) :
+            !netplay_send_flush(&connection->send_packet_buffer,
+               connection->fd, false))
          netplay_hangup(netplay, connection);
    }
 
@@ -1226,13 +1263,24 @@ void netplay_send_savestate(netplay_t *netplay,
       struct netplay_connection *connection = &netplay->connections[i];
       if (!connection->active ||
           connection->mode < NETPLAY_CONNECTION_CONNECTED ||
-          connection->compression_supported != cx) continue;
+          connection->compression_supported != cx ||
+          connection->shared) continue;
 
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, header,
             sizeof(header)) ||
           !netplay_send(&connection->send_packet_buffer, connection->fd,
             netplay->zbuffer, wn))
          netplay_hangup(netplay, connection);
+      else
+         netplay_udp_cmd_sent(connection, NETPLAY_CMD_LOAD_SAVESTATE);
+   }
+
+   if (netplay->spectate.compression == cx)
+   {
+      netplay_spectate_send_raw(netplay, NETPLAY_CMD_LOAD_SAVESTATE, header,
+            sizeof(header));
+      netplay_spectate_send_raw(netplay, NETPLAY_CMD_LOAD_SAVESTATE,
+            netplay->zbuffer, wn);
    }
 }
 
@@ -1267,6 +1315,7 @@ void netplay_load_savestate(netplay_t *netplay,
                return;
             tmp_serial_info.data_const = tmp_serial_info.data;
             serial_info = &tmp_serial_info;
+            netplay->buffer[netplay->run_ptr].have_state = true;
          }
          else
          {
@@ -1274,6 +1323,7 @@ void netplay_load_savestate(netplay_t *netplay,
             {
                memcpy(netplay->buffer[netplay->run_ptr].state,
                      serial_info->data_const, serial_info->size);
+               netplay->buffer[netplay->run_ptr].have_state = true;
             }
          }
       }
@@ -1325,12 +1375,17 @@ static void netplay_core_reset(netplay_t *netplay)
    {
       struct netplay_connection *connection = &netplay->connections[i];
       if (!connection->active ||
-            connection->mode < NETPLAY_CONNECTION_CONNECTED) continue;
+            connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+            connection->shared) continue;
 
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmd,
                sizeof(cmd)))
          netplay_hangup(netplay, connection);
+      else
+         netplay_udp_cmd_sent(connection, NETPLAY_CMD_RESET);
    }
+
+   netplay_spectate_send_raw(netplay, NETPLAY_CMD_RESET, cmd, sizeof(cmd));
 }
 
 /**
@@ -1513,13 +1568,19 @@ bool init_netplay(void *direct_host, const char *server, unsigned port)
             : server_port_deferred   ) : (port != 0 ? port : RARCH_DEFAULT_PORT),
          settings->bools.netplay_stateless_mode,
          settings->ints.netplay_check_frames,
+         settings->uints.netplay_state_interval,
          &cbs,
          settings->bools.netplay_nat_traversal && !settings->bools.netplay_use_mitm_server,
 #ifdef HAVE_DISCORD
          discord_get_own_username() ? discord_get_own_username() :
 #endif
          settings->paths.username,
-         quirks);
+         quirks,
+         /* Relayed connections can't be reached over UDP */
+         (settings->bools.netplay_udp_enable &&
+          (netplay_is_client || !settings->bools.netplay_use_mitm_server))
+            ? settings->uints.netplay_udp_redundancy : 0,
+         settings->bools.netplay_shared_spectator_stream);
 
    if (netplay_data)
    {
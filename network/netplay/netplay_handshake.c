@@ -210,7 +210,8 @@ bool netplay_handshake_init_send(netplay_t *netplay,
 
    header[0] = htonl(netplay_magic);
    header[1] = htonl(netplay_platform_magic());
-   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED);
+   header[2] = htonl(NETPLAY_COMPRESSION_SUPPORTED |
+         ((netplay->udp_fd >= 0) ? NETPLAY_FEATURE_UDP_INPUT : 0));
    header[3] = 0;
    header[4] = htonl(NETPLAY_PROTOCOL_VERSION);
    header[5] = htonl(netplay_impl_magic());
@@ -372,6 +373,10 @@ bool netplay_handshake_init(netplay_t *netplay,
       goto error;
    }
 
+   /* Check whether we can both send input over UDP */
+   connection->udp_supported = netplay->udp_fd >= 0 &&
+      (ntohl(header[2]) & NETPLAY_FEATURE_UDP_INPUT);
+
    /* Check what compression is supported */
    compression  = ntohl(header[2]);
    compression &= NETPLAY_COMPRESSION_SUPPORTED;
@@ -474,8 +479,8 @@ static void netplay_handshake_ready(netplay_t *netplay,
 
       RARCH_LOG("%s %u\n", msg_hash_to_str(MSG_CONNECTION_SLOT), slot);
 
-      /* Send them the savestate */
-      if (!(netplay->quirks &
+      /* Send them the savestate, unless they got the keyframe */
+      if (!connection->shared && !(netplay->quirks &
                (NETPLAY_QUIRK_NO_SAVESTATES|NETPLAY_QUIRK_NO_TRANSMISSION)))
          netplay->force_send_savestate = true;
    }
@@ -490,6 +495,17 @@ static void netplay_handshake_ready(netplay_t *netplay,
    RARCH_LOG("%s\n", msg);
    runloop_msg_queue_push(msg, 1, 180, false, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
 
+   /* Tell them where to send their input over UDP. Spectators on the shared
+    * stream are only told once they leave it. */
+   if (connection->udp_supported)
+   {
+      if (simple_rand_next == 1)
+         simple_srand((unsigned int) time(NULL));
+      connection->udp_token = simple_rand_uint32() | 1;
+      if (!connection->shared)
+         netplay_udp_send_info(netplay, connection, connection->udp_token);
+   }
+
    /* Unstall if we were waiting for this */
    if (netplay->stall == NETPLAY_STALL_NO_CONNECTION)
        netplay->stall = NETPLAY_STALL_NONE;
@@ -559,8 +575,11 @@ bool netplay_handshake_sync(netplay_t *netplay,
    retro_ctx_memory_info_t mem_info;
    uint32_t client_num        = 0;
    uint32_t device            = 0;
+   uint32_t sync_frame        = netplay->self_frame_count;
    size_t nicklen, nickmangle = 0;
    bool nick_matched          = false;
+   bool shared                = netplay_spectate_can_attach(netplay,
+         connection, &sync_frame);
 
    autosave_lock();
    mem_info.id = RETRO_MEMORY_SAVE_RAM;
@@ -584,7 +603,7 @@ bool netplay_handshake_sync(netplay_t *netplay,
 
          /* And finally, sram */
          + mem_info.size);
-   cmd[2]     = htonl(netplay->self_frame_count);
+   cmd[2]     = htonl(sync_frame);
    client_num = (uint32_t)(connection - netplay->connections + 1);
 
    if (netplay->local_paused || netplay->remote_paused)
@@ -660,15 +679,21 @@ bool netplay_handshake_sync(netplay_t *netplay,
    /* And finally, the SRAM */
    autosave_lock();
    if (!netplay_send(&connection->send_packet_buffer, connection->fd,
-            mem_info.data, mem_info.size) ||
-         !netplay_send_flush(&connection->send_packet_buffer, connection->fd,
-            false))
+            mem_info.data, mem_info.size))
    {
       autosave_unlock();
       return false;
    }
    autosave_unlock();
 
+   /* Spectators can start from the keyframe and read the shared stream */
+   if (shared && !netplay_spectate_attach(netplay, connection))
+      return false;
+
+   if (!netplay_send_flush(&connection->send_packet_buffer, connection->fd,
+         false))
+      return false;
+
    /* Now we're ready! */
    connection->mode = NETPLAY_CONNECTION_SPECTATING;
    netplay_handshake_ready(netplay, connection);
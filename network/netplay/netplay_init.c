@@ -228,9 +228,6 @@ static bool init_socket(netplay_t *netplay, void *direct_host,
    if (!init_tcp_socket(netplay, direct_host, server, port))
       return false;
 
-   if (netplay->is_server && netplay->nat_traversal)
-      netplay_init_nat_traversal(netplay);
-
    return true;
 }
 
@@ -385,6 +382,9 @@ static bool netplay_init_buffers(netplay_t *netplay)
    if (netplay->is_server)
       netplay->buffer_size *= 2;
 
+   /* Plus the frames back to the last saved state */
+   netplay->buffer_size += netplay->state_interval - 1;
+
    delta_frames = (struct delta_frame*)calloc(netplay->buffer_size,
          sizeof(*delta_frames));
 
@@ -406,10 +406,13 @@ static bool netplay_init_buffers(netplay_t *netplay)
  * @port                 : Port of server.
  * @stateless_mode       : Shall we use stateless mode?
  * @check_frames         : Frequency with which to check CRCs.
+ * @state_interval       : Save the state every this many frames.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
  * @nick                 : Nickname of user.
  * @quirks               : Netplay quirks required for this session.
+ * @udp_redundancy       : Frames of input per UDP packet, 0 for TCP only.
+ * @shared_spectators    : Feed spectators from one shared stream.
  *
  * Creates a new netplay handle. A NULL server means we're
  * hosting.
@@ -417,15 +420,16 @@ static bool netplay_init_buffers(netplay_t *netplay)
  * Returns: new netplay data.
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
-   bool stateless_mode, int check_frames,
+   bool stateless_mode, int check_frames, unsigned state_interval,
    const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
-   uint64_t quirks)
+   uint64_t quirks, unsigned udp_redundancy, bool shared_spectators)
 {
    netplay_t *netplay = (netplay_t*)calloc(1, sizeof(*netplay));
    if (!netplay)
       return NULL;
 
    netplay->listen_fd            = -1;
+   netplay->udp_fd               = -1;
    netplay->tcp_port             = port;
    netplay->cbs                  = *cb;
    netplay->is_server            = (direct_host == NULL && server == NULL);
@@ -433,6 +437,10 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
    netplay->nat_traversal        = netplay->is_server ? nat_traversal : false;
    netplay->stateless_mode       = stateless_mode;
    netplay->check_frames         = check_frames;
+   /* Bounded, the frames back to the last state take buffer space */
+   netplay->state_interval       = state_interval ?
+      ((state_interval > NETPLAY_MAX_STALL_FRAMES) ?
+       NETPLAY_MAX_STALL_FRAMES : state_interval) : 1;
    netplay->crc_validity_checked = false;
    netplay->crcs_valid           = true;
    netplay->quirks               = quirks;
@@ -468,6 +476,18 @@ netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
       return NULL;
    }
 
+   /* Before the handshake, which advertises it */
+   netplay_udp_init(netplay, netplay->is_server ?
+         netplay->listen_fd : netplay->connections[0].fd, udp_redundancy);
+
+   /* After the UDP socket, so that its port gets forwarded too */
+   if (netplay->is_server && netplay->nat_traversal)
+      netplay_init_nat_traversal(netplay);
+
+   if (netplay->is_server && shared_spectators &&
+       !netplay_spectate_init(netplay))
+      RARCH_WARN("[netplay] Failed to set up the shared spectator stream.\n");
+
    if (netplay->is_server)
    {
       /* Clients get device info from the server */
@@ -513,6 +533,9 @@ error:
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   netplay_udp_deinit(netplay);
+   netplay_spectate_deinit(netplay);
+
    if (netplay->connections && netplay->connections[0].fd >= 0)
       socket_close(netplay->connections[0].fd);
 
@@ -533,6 +556,9 @@ void netplay_free(netplay_t *netplay)
    if (netplay->listen_fd >= 0)
       socket_close(netplay->listen_fd);
 
+   netplay_udp_deinit(netplay);
+   netplay_spectate_deinit(netplay);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
@@ -135,6 +135,7 @@ void netplay_hangup(netplay_t *netplay, struct netplay_connection *connection)
 
    socket_close(connection->fd);
    connection->active = false;
+   connection->shared = false;
    netplay_deinit_socket_buffer(&connection->send_packet_buffer);
    netplay_deinit_socket_buffer(&connection->recv_packet_buffer);
 
@@ -223,13 +224,14 @@ void netplay_delayed_state_change(netplay_t *netplay)
    }
 }
 
-/* Send the specified input data */
-static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
-      struct netplay_connection *only, struct netplay_connection *except,
-      uint32_t client_num, bool slave)
-{
 #define BUFSZ 16 /* FIXME: Arbitrary restriction */
-   uint32_t buffer[BUFSZ], devices, device;
+
+/* Encode the specified input data, returns the number of words used */
+static size_t encode_input_frame(netplay_t *netplay,
+      struct delta_frame *dframe, uint32_t client_num, bool slave,
+      uint32_t *buffer)
+{
+   uint32_t devices, device;
    size_t bufused, i;
 
    /* Set up the basic buffer */
@@ -258,6 +260,19 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
    }
    buffer[1] = htonl((bufused-2) * sizeof(uint32_t));
 
+   return bufused;
+}
+
+/* Send the specified input data */
+static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
+      struct netplay_connection *only, struct netplay_connection *except,
+      uint32_t client_num, bool slave)
+{
+   uint32_t buffer[BUFSZ];
+   size_t i;
+   size_t bufused = encode_input_frame(netplay, dframe, client_num, slave,
+         buffer);
+
 #ifdef DEBUG_NETPLAY_STEPS
    RARCH_LOG("[netplay] Sending input for client %u\n", (unsigned) client_num);
    print_state(netplay);
@@ -265,7 +280,8 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
 
    if (only)
    {
-      if (!netplay_send(&only->send_packet_buffer, only->fd, buffer, bufused*sizeof(uint32_t)))
+      if ((only->shared && !netplay_spectate_detach(netplay, only)) ||
+          !netplay_send(&only->send_packet_buffer, only->fd, buffer, bufused*sizeof(uint32_t)))
       {
          netplay_hangup(netplay, only);
          return false;
@@ -276,7 +292,7 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
       for (i = 0; i < netplay->connections_size; i++)
       {
          struct netplay_connection *connection = &netplay->connections[i];
-         if (connection == except) continue;
+         if (connection == except || connection->shared) continue;
          if (connection->active &&
              connection->mode >= NETPLAY_CONNECTION_CONNECTED &&
              (connection->mode != NETPLAY_CONNECTION_PLAYING ||
@@ -287,10 +303,24 @@ static bool send_input_frame(netplay_t *netplay, struct delta_frame *dframe,
                netplay_hangup(netplay, connection);
          }
       }
+
+      netplay_spectate_send_raw(netplay, NETPLAY_CMD_INPUT, buffer,
+            bufused*sizeof(uint32_t));
    }
 
    return true;
-#undef BUFSZ
+}
+
+/**
+ * netplay_forward_input
+ *
+ * Send a client's input for a frame to every connection but the one it came
+ * from.
+ */
+void netplay_forward_input(netplay_t *netplay, struct delta_frame *dframe,
+   struct netplay_connection *except, uint32_t client_num)
+{
+   send_input_frame(netplay, dframe, NULL, except, client_num, false);
 }
 
 /**
@@ -306,6 +336,10 @@ bool netplay_send_cur_input(netplay_t *netplay,
    uint32_t from_client, to_client;
    struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
 
+   /* They read it from the shared spectator stream */
+   if (connection->shared)
+      return true;
+
    if (netplay->is_server)
    {
       to_client = (uint32_t)(connection - netplay->connections + 1);
@@ -355,6 +389,47 @@ bool netplay_send_cur_input(netplay_t *netplay,
    return true;
 }
 
+/**
+ * netplay_spectate_cur_input
+ *
+ * Add the current input frame to the shared spectator stream, as
+ * netplay_send_cur_input would send it to any spectator.
+ */
+void netplay_spectate_cur_input(netplay_t *netplay)
+{
+   uint32_t buffer[BUFSZ];
+   uint32_t from_client;
+   struct delta_frame *dframe = &netplay->buffer[netplay->self_ptr];
+
+   if (!netplay->spectate.enabled)
+      return;
+
+   for (from_client = 1; from_client < MAX_CLIENTS; from_client++)
+   {
+      if ((netplay->connected_players & (1<<from_client)) &&
+          dframe->have_real[from_client])
+         netplay_spectate_send_raw(netplay, NETPLAY_CMD_INPUT, buffer,
+               encode_input_frame(netplay, dframe, from_client, false,
+                  buffer) * sizeof(uint32_t));
+   }
+
+   if (netplay->self_mode != NETPLAY_CONNECTION_PLAYING)
+   {
+      uint32_t payload = htonl(netplay->self_frame_count);
+      netplay_spectate_send(netplay, NETPLAY_CMD_NOINPUT, &payload,
+            sizeof(payload));
+   }
+
+   if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING
+         || netplay->self_mode == NETPLAY_CONNECTION_SLAVE)
+      netplay_spectate_send_raw(netplay, NETPLAY_CMD_INPUT, buffer,
+            encode_input_frame(netplay, dframe, netplay->self_client_num,
+               netplay->self_mode == NETPLAY_CONNECTION_SLAVE,
+               buffer) * sizeof(uint32_t));
+}
+
+#undef BUFSZ
+
 /**
  * netplay_send_raw_cmd
  *
@@ -371,6 +446,9 @@ bool netplay_send_raw_cmd(netplay_t *netplay,
    cmdbuf[0] = htonl(cmd);
    cmdbuf[1] = htonl(size);
 
+   if (connection->shared && !netplay_spectate_detach(netplay, connection))
+      return false;
+
    if (!netplay_send(&connection->send_packet_buffer, connection->fd, cmdbuf,
          sizeof(cmdbuf)))
       return false;
@@ -379,6 +457,8 @@ bool netplay_send_raw_cmd(netplay_t *netplay,
       if (!netplay_send(&connection->send_packet_buffer, connection->fd, data, size))
          return false;
 
+   netplay_udp_cmd_sent(connection, cmd);
+
    return true;
 }
 
@@ -393,10 +473,16 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
    size_t size)
 {
    size_t i;
+
+   /* The stream is for everyone, so they can't be on it anymore */
+   if (except && except->shared &&
+       !netplay_spectate_detach(netplay, except))
+      netplay_hangup(netplay, except);
+
    for (i = 0; i < netplay->connections_size; i++)
    {
       struct netplay_connection *connection = &netplay->connections[i];
-      if (connection == except)
+      if (connection == except || connection->shared)
          continue;
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
       {
@@ -404,6 +490,8 @@ void netplay_send_raw_cmd_all(netplay_t *netplay,
             netplay_hangup(netplay, connection);
       }
    }
+
+   netplay_spectate_send(netplay, cmd, data, size);
 }
 
 /**
@@ -422,8 +510,10 @@ static void netplay_send_flush_all(netplay_t *netplay,
          continue;
       if (connection->active && connection->mode >= NETPLAY_CONNECTION_CONNECTED)
       {
-         if (!netplay_send_flush(&connection->send_packet_buffer,
-            connection->fd, true))
+         if (connection->shared ?
+               !netplay_spectate_flush(netplay, connection) :
+               !netplay_send_flush(&connection->send_packet_buffer,
+                  connection->fd, true))
             netplay_hangup(netplay, connection);
       }
    }
@@ -451,10 +541,12 @@ bool netplay_cmd_crc(netplay_t *netplay, struct delta_frame *delta)
    for (i = 0; i < netplay->connections_size; i++)
    {
       if (netplay->connections[i].active &&
+            !netplay->connections[i].shared &&
             netplay->connections[i].mode >= NETPLAY_CONNECTION_CONNECTED)
          success = netplay_send_raw_cmd(netplay, &netplay->connections[i],
             NETPLAY_CMD_CRC, payload, sizeof(payload)) && success;
    }
+   netplay_spectate_send(netplay, NETPLAY_CMD_CRC, payload, sizeof(payload));
    return success;
 }
 
@@ -1527,9 +1619,10 @@ static bool netplay_get_cmd(netplay_t *netplay,
                tmp_ptr = PREV_PTR(tmp_ptr);
             } while (tmp_ptr != netplay->run_ptr);
 
-            if (!found)
+            if (!found || (buffer[0] <= netplay->other_frame_count &&
+                     !netplay->buffer[tmp_ptr].have_state))
             {
-               /* Oh well, we got rid of it! */
+               /* Oh well, we got rid of it (or never saved it)! */
                break;
             }
 
@@ -1695,6 +1788,7 @@ static bool netplay_get_cmd(netplay_t *netplay,
                   (unsigned)netplay->state_size);
                ctrans->decompression_backend->trans(ctrans->decompression_stream,
                   true, &rd, &wn, NULL);
+               netplay->buffer[load_ptr].have_state = true;
 
                /* Force a rewind to the relevant frame */
                netplay->force_rewind = true;
@@ -1832,11 +1926,33 @@ static bool netplay_get_cmd(netplay_t *netplay,
             break;
          }
 
+      case NETPLAY_CMD_UDP_INFO:
+         {
+            uint32_t payload[2];
+
+            if (cmd_size != sizeof(payload) || !connection->udp_supported)
+            {
+               RARCH_ERR("NETPLAY_CMD_UDP_INFO unexpected.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            RECV(payload, sizeof(payload))
+            {
+               RARCH_ERR("Failed to receive NETPLAY_CMD_UDP_INFO payload.\n");
+               return netplay_cmd_nak(netplay, connection);
+            }
+
+            netplay_udp_set_peer(netplay, connection, ntohl(payload[0]),
+                  ntohl(payload[1]));
+            break;
+         }
+
       default:
          RARCH_ERR("%s.\n", msg_hash_to_str(MSG_UNKNOWN_NETPLAY_COMMAND_RECEIVED));
          return netplay_cmd_nak(netplay, connection);
    }
 
+   netplay_udp_cmd_received(connection, cmd);
    netplay_recv_flush(&connection->recv_packet_buffer);
    netplay->timeout_cnt = 0;
    if (had_input)
@@ -1880,6 +1996,10 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
 
       netplay->timeout_cnt++;
 
+      /* Input sent over UDP may be ahead of the connections */
+      if (netplay_udp_poll(netplay))
+         had_input = true;
+
       /* Read input from each connection */
       for (i = 0; i < netplay->connections_size; i++)
       {
@@ -1901,6 +2021,7 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
          {
             fd_set fds;
             struct timeval tv = {0};
+            int nfds          = max_fd;
             tv.tv_usec = RETRY_MS * 1000;
 
             FD_ZERO(&fds);
@@ -1910,8 +2031,14 @@ int netplay_poll_net_input(netplay_t *netplay, bool block)
                if (connection->active)
                   FD_SET(connection->fd, &fds);
             }
+            if (netplay->udp_fd >= 0)
+            {
+               FD_SET(netplay->udp_fd, &fds);
+               if (netplay->udp_fd >= nfds)
+                  nfds = netplay->udp_fd + 1;
+            }
 
-            if (socket_select(max_fd, &fds, NULL, NULL, &tv) < 0)
+            if (socket_select(nfds, &fds, NULL, NULL, &tv) < 0)
                return -1;
 
             RARCH_LOG("[netplay] Network is stalling at frame %u, count %u of %d ...\n",
@@ -2043,11 +2170,13 @@ void netplay_announce_nat_traversal(netplay_t *netplay)
 /**
  * netplay_init_nat_traversal
  *
- * Initialize the NAT traversal library and try to open a port
+ * Initialize the NAT traversal library and try to open the TCP port,
+ * and the UDP input port if there is one
  */
 void netplay_init_nat_traversal(netplay_t *netplay)
 {
    memset(&netplay->nat_traversal_state, 0, sizeof(netplay->nat_traversal_state));
    netplay->nat_traversal_task_oustanding = true;
-   task_push_netplay_nat_traversal(&netplay->nat_traversal_state, netplay->tcp_port);
+   task_push_netplay_nat_traversal(&netplay->nat_traversal_state,
+         netplay->tcp_port, netplay->udp_fd >= 0 ? netplay->udp_port : 0);
 }
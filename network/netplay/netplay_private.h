@@ -56,6 +56,10 @@ typedef uint32_t client_bitmap_t;
 #define NETPLAY_FRAME_RUN_TIME_WINDOW  120
 #define NETPLAY_MAX_REQ_STALL_TIME     60
 #define NETPLAY_MAX_REQ_STALL_FREQUENCY 120
+#define NETPLAY_ROLLBACK_REPORT_FRAMES 600
+
+/* How often the shared spectator stream gets a new keyframe */
+#define NETPLAY_SPECTATE_KEYFRAME_FRAMES 300
 
 #define PREV_PTR(x) ((x) == 0 ? netplay->buffer_size - 1 : (x) - 1)
 #define NEXT_PTR(x) ((x + 1) % netplay->buffer_size)
@@ -95,6 +99,13 @@ typedef uint32_t client_bitmap_t;
 #define NETPLAY_COMPRESSION_SUPPORTED 0
 #endif
 
+/* Optional features, advertised in the upper half of the compression word of
+ * the connection header. Older versions only look at the compression bits. */
+#define NETPLAY_FEATURE_UDP_INPUT (1<<16)
+
+/* Most frames of input repeated in each UDP packet */
+#define NETPLAY_UDP_MAX_REDUNDANCY 32
+
 enum netplay_cmd
 {
    /* Basic commands */
@@ -175,7 +186,10 @@ enum netplay_cmd
    /* CMD_CFG streamlines sending multiple
       configurations. This acknowledges
       each one individually */
-   NETPLAY_CMD_CFG_ACK        = 0x0062
+   NETPLAY_CMD_CFG_ACK        = 0x0062,
+
+   /* Port and token to send UDP input packets with */
+   NETPLAY_CMD_UDP_INFO       = 0x0063
 };
 
 #define NETPLAY_CMD_SYNC_BIT_PAUSED    (1U<<31)
@@ -295,6 +309,9 @@ struct delta_frame
    /* The serialized state of the core at this frame, before input */
    void *state;
 
+   /* Is state valid? With a state interval, most frames aren't saved */
+   bool have_state;
+
    /* The CRC-32 of the serialized state if we've calculated it, else 0 */
    uint32_t crc;
 
@@ -369,6 +386,32 @@ struct netplay_connection
    /* For the server: When was the last time we requested this client to stall?
     * For the client: How many frames of stall do we have left? */
    uint32_t stall_frame;
+
+   /* UDP input (see netplay_udp.c). Does the peer support it, have we sent
+    * them our token and have they sent us theirs? */
+   bool udp_supported, udp_info_sent, udp_info_received;
+
+   /* The token we expect in their packets, and the one we put in ours */
+   uint32_t udp_token, udp_peer_token;
+
+   /* Commands read and sent since the tokens were exchanged */
+   uint32_t udp_epoch_in, udp_epoch_out;
+
+   /* Where to send our packets, updated from the ones we receive */
+   struct sockaddr_storage udp_addr;
+   socklen_t udp_addr_size;
+
+   /* Their last send time to echo back, and when it arrived */
+   uint32_t udp_echo_time;
+   retro_time_t udp_echo_received;
+
+   /* Smoothed round trip time and its variation in usec, 0 if unknown */
+   retro_time_t udp_rtt, udp_rtt_var;
+
+   /* Server only: is this spectator fed from the shared spectator stream (see
+    * netplay_spectate.c), and how far into it have we sent? */
+   bool shared;
+   uint64_t shared_pos;
 };
 
 /* Compression transcoder */
@@ -380,6 +423,42 @@ struct compression_transcoder
    void *decompression_stream;
 };
 
+/* Where the shared spectator stream was when we started a frame */
+struct netplay_spectate_frame
+{
+   bool used;
+   uint32_t frame;
+   uint32_t tag;
+   uint64_t pos;
+};
+
+/* Shared spectator stream (server only) */
+struct netplay_spectate
+{
+   bool enabled;
+
+   /* Compression of the keyframes */
+   uint32_t compression;
+
+   /* The stream, starting at absolute position base */
+   uint8_t *data;
+   size_t size, capacity;
+   uint64_t base;
+
+   /* End of the last command that changes the sync info */
+   uint64_t barrier;
+
+   /* Per buffer frame */
+   struct netplay_spectate_frame *frames;
+
+   /* Encoded LOAD_SAVESTATE to send to joining spectators, 0 size if none */
+   uint8_t *keyframe;
+   size_t keyframe_size;
+   uint32_t keyframe_frame;
+   uint32_t keyframe_tag;
+   uint64_t keyframe_pos;
+};
+
 struct netplay
 {
    /* Are we the server? */
@@ -444,6 +523,13 @@ struct netplay
    /* TCP port (only set if serving) */
    uint16_t tcp_port;
 
+   /* UDP socket for input, -1 if input only goes over TCP */
+   int udp_fd;
+   uint16_t udp_port;
+
+   /* Frames of input repeated in every UDP packet */
+   unsigned udp_redundancy;
+
    /* NAT traversal info (if NAT traversal is used and serving) */
    bool nat_traversal, nat_traversal_task_oustanding;
    struct natt_status nat_traversal_state;
@@ -541,6 +627,22 @@ struct netplay
    int frame_run_time_ptr;
    retro_time_t frame_run_time_sum, frame_run_time_avg;
 
+   /* Save the state only every this many frames, and rewind to the nearest
+    * saved frame when replaying */
+   unsigned state_interval;
+
+   /* Rollbacks over the last rollback_report_frames frames: how many, how
+    * many frames of bad input they undid, how many frames they replayed and
+    * how long it took */
+   uint32_t rollback_count;
+   uint32_t rollback_depth_sum, rollback_depth_max;
+   uint32_t rollback_replayed;
+   retro_time_t rollback_time_sum, rollback_time_max;
+   uint32_t rollback_report_frames;
+
+   /* Input and commands encoded once for every spectator */
+   struct netplay_spectate spectate;
+
    /* Latency frames; positive to hide network latency, negative to hide input latency */
    int input_latency_frames;
 
@@ -775,10 +877,13 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  * @port                 : Port of server.
  * @stateless_mode       : Shall we run in stateless mode?
  * @check_frames         : Frequency with which to check CRCs.
+ * @state_interval       : Save the state every this many frames.
  * @cb                   : Libretro callbacks.
  * @nat_traversal        : If true, attempt NAT traversal.
  * @nick                 : Nickname of user.
  * @quirks               : Netplay quirks required for this session.
+ * @udp_redundancy       : Frames of input per UDP packet, 0 for TCP only.
+ * @shared_spectators    : Feed spectators from one shared stream.
  *
  * Creates a new netplay handle. A NULL server means we're
  * hosting.
@@ -786,9 +891,9 @@ bool netplay_wait_and_init_serialization(netplay_t *netplay);
  * Returns: new netplay data.
  */
 netplay_t *netplay_new(void *direct_host, const char *server, uint16_t port,
-   bool stateless_mode, int check_frames,
+   bool stateless_mode, int check_frames, unsigned state_interval,
    const struct retro_callbacks *cb, bool nat_traversal, const char *nick,
-   uint64_t quirks);
+   uint64_t quirks, unsigned udp_redundancy, bool shared_spectators);
 
 /**
  * netplay_free
@@ -827,6 +932,13 @@ void netplay_delayed_state_change(netplay_t *netplay);
 bool netplay_send_cur_input(netplay_t *netplay,
    struct netplay_connection *connection);
 
+/**
+ * netplay_spectate_cur_input
+ *
+ * Add the current input frame to the shared spectator stream.
+ */
+void netplay_spectate_cur_input(netplay_t *netplay);
+
 /**
  * netplay_send_raw_cmd
  *
@@ -838,6 +950,15 @@ bool netplay_send_raw_cmd(netplay_t *netplay,
    struct netplay_connection *connection, uint32_t cmd, const void *data,
    size_t size);
 
+/**
+ * netplay_forward_input
+ *
+ * Send a client's input for a frame to every connection but the one it came
+ * from.
+ */
+void netplay_forward_input(netplay_t *netplay, struct delta_frame *dframe,
+   struct netplay_connection *except, uint32_t client_num);
+
 /**
  * netplay_send_raw_cmd_all
  *
@@ -904,7 +1025,8 @@ void netplay_announce_nat_traversal(netplay_t *netplay);
 /**
  * netplay_init_nat_traversal
  *
- * Initialize the NAT traversal library and try to open a port
+ * Initialize the NAT traversal library and try to open the TCP port,
+ * and the UDP input port if there is one
  */
 void netplay_init_nat_traversal(netplay_t *netplay);
 
@@ -977,4 +1099,174 @@ bool netplay_sync_pre_frame(netplay_t *netplay);
  */
 void netplay_sync_post_frame(netplay_t *netplay, bool stalled);
 
+/***************************************************************
+ * NETPLAY-UDP.C
+ **************************************************************/
+
+/**
+ * netplay_udp_init
+ * @netplay              : pointer to netplay object
+ * @tcp_fd               : TCP socket to match the address family of
+ * @redundancy           : frames of input to repeat in each packet
+ *
+ * Open the UDP socket used to send input ahead of the TCP stream.
+ * The host binds it to the TCP port number when that is free.
+ *
+ * Returns true if UDP input is available.
+ */
+bool netplay_udp_init(netplay_t *netplay, int tcp_fd, unsigned redundancy);
+
+/**
+ * netplay_udp_deinit
+ *
+ * Close the UDP socket.
+ */
+void netplay_udp_deinit(netplay_t *netplay);
+
+/**
+ * netplay_udp_send_info
+ *
+ * Send the UDP_INFO command telling the peer how to reach us.
+ */
+bool netplay_udp_send_info(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t token);
+
+/**
+ * netplay_udp_set_peer
+ *
+ * Handle the peer's UDP_INFO command.
+ */
+void netplay_udp_set_peer(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t port, uint32_t token);
+
+/**
+ * netplay_udp_cmd_sent
+ *
+ * Account for a command sent on the connection.
+ */
+void netplay_udp_cmd_sent(struct netplay_connection *connection, uint32_t cmd);
+
+/**
+ * netplay_udp_cmd_received
+ *
+ * Account for a command read from the connection.
+ */
+void netplay_udp_cmd_received(struct netplay_connection *connection,
+   uint32_t cmd);
+
+/**
+ * netplay_udp_send
+ *
+ * Send the recent input frames to every peer that supports UDP input.
+ */
+void netplay_udp_send(netplay_t *netplay);
+
+/**
+ * netplay_udp_poll
+ *
+ * Read any pending UDP packets.
+ *
+ * Returns true if new input was read.
+ */
+bool netplay_udp_poll(netplay_t *netplay);
+
+/**
+ * netplay_udp_latency_frames
+ *
+ * Frames of input latency needed to hide the network delay measured over
+ * UDP.
+ *
+ * Returns the number of frames, or -1 if nothing was measured yet.
+ */
+int netplay_udp_latency_frames(netplay_t *netplay);
+
+/***************************************************************
+ * NETPLAY-SPECTATE.C
+ **************************************************************/
+
+/**
+ * netplay_spectate_init
+ * @netplay              : pointer to netplay object
+ *
+ * Start the shared spectator stream. Server only.
+ *
+ * Returns true if successful.
+ */
+bool netplay_spectate_init(netplay_t *netplay);
+
+/**
+ * netplay_spectate_deinit
+ *
+ * Free the shared spectator stream.
+ */
+void netplay_spectate_deinit(netplay_t *netplay);
+
+/**
+ * netplay_spectate_send
+ *
+ * Append a command to the shared spectator stream.
+ */
+void netplay_spectate_send(netplay_t *netplay, uint32_t cmd,
+   const void *data, size_t size);
+
+/**
+ * netplay_spectate_send_raw
+ *
+ * Append an already encoded command, or part of one, to the shared
+ * spectator stream.
+ */
+void netplay_spectate_send_raw(netplay_t *netplay, uint32_t cmd,
+   const void *data, size_t size);
+
+/**
+ * netplay_spectate_can_attach
+ *
+ * Check whether a joining spectator can be synced to the keyframe.
+ *
+ * Returns true if it can, with the keyframe's frame in frame.
+ */
+bool netplay_spectate_can_attach(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t *frame);
+
+/**
+ * netplay_spectate_attach
+ *
+ * Send the keyframe and put the connection on the shared stream.
+ */
+bool netplay_spectate_attach(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_spectate_detach
+ *
+ * Take the connection off the shared stream, so that something can be sent
+ * to it alone.
+ */
+bool netplay_spectate_detach(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_spectate_flush
+ *
+ * Send what we can of the shared stream to the connection.
+ *
+ * Returns false only on socket failures.
+ */
+bool netplay_spectate_flush(netplay_t *netplay,
+   struct netplay_connection *connection);
+
+/**
+ * netplay_spectate_frame
+ *
+ * Remember where the stream is as we start reading input for a new frame.
+ */
+void netplay_spectate_frame(netplay_t *netplay);
+
+/**
+ * netplay_spectate_post_frame
+ *
+ * Take a new keyframe if it's time to.
+ */
+void netplay_spectate_post_frame(netplay_t *netplay);
+
 #endif
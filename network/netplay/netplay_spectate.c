@@ -0,0 +1,470 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Shared spectator stream.
+ *
+ * Every spectator is sent the same commands, so the server encodes them once
+ * into an append-only stream and each spectator's socket is fed from it at
+ * its own position, instead of each command being encoded and buffered once
+ * per connection. Positions in the stream are absolute byte counts; only the
+ * part some reader still needs is kept.
+ *
+ * A joining spectator doesn't get a savestate of its own, which would also
+ * make every other peer reload. Every NETPLAY_SPECTATE_KEYFRAME_FRAMES frames
+ * the server compresses a state it knows to be correct into a keyframe. The
+ * spectator is synced to the keyframe's frame, sent the keyframe, and then
+ * reads the stream from where that frame started: nothing about a later
+ * frame is sent before then, and older input is skipped as a duplicate.
+ *
+ * Commands other than input and CRCs change what the sync info describes, so
+ * a keyframe can't be used if one was sent after it. Neither can it if the
+ * players changed since, even before the change was announced.
+ *
+ * Anything sent to one spectator alone takes it off the shared stream: the
+ * part it hasn't read is copied into its own buffer first, and it is served
+ * like any other connection from then on.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <encodings/crc32.h>
+
+#include "netplay_private.h"
+
+/* Stream data kept for slow spectators, beyond which they are dropped */
+#define NETPLAY_SPECTATE_MAX_SIZE (64*1024*1024)
+
+/**
+ * netplay_spectate_tag
+ *
+ * Tag of the players and devices described by the sync info.
+ */
+static uint32_t netplay_spectate_tag(netplay_t *netplay)
+{
+   uint32_t tag = encoding_crc32(0L,
+         (const unsigned char*)netplay->device_clients,
+         sizeof(netplay->device_clients));
+   tag = encoding_crc32(tag,
+         (const unsigned char*)netplay->config_devices,
+         sizeof(netplay->config_devices));
+   tag = encoding_crc32(tag,
+         (const unsigned char*)netplay->device_share_modes,
+         sizeof(netplay->device_share_modes));
+   return tag ^ netplay->connected_players ^ (netplay->connected_slaves << 16);
+}
+
+/**
+ * netplay_spectate_init
+ * @netplay              : pointer to netplay object
+ *
+ * Start the shared spectator stream. Server only.
+ *
+ * Returns true if successful.
+ */
+bool netplay_spectate_init(netplay_t *netplay)
+{
+   struct netplay_spectate *spectate = &netplay->spectate;
+
+   spectate->frames = (struct netplay_spectate_frame*)
+      calloc(netplay->buffer_size, sizeof(*spectate->frames));
+   if (!spectate->frames)
+      return false;
+
+   spectate->compression = NETPLAY_COMPRESSION_SUPPORTED;
+   spectate->enabled     = true;
+   return true;
+}
+
+/**
+ * netplay_spectate_deinit
+ * @netplay              : pointer to netplay object
+ *
+ * Free the shared spectator stream.
+ */
+void netplay_spectate_deinit(netplay_t *netplay)
+{
+   struct netplay_spectate *spectate = &netplay->spectate;
+
+   free(spectate->data);
+   free(spectate->frames);
+   free(spectate->keyframe);
+   memset(spectate, 0, sizeof(*spectate));
+}
+
+/* Drop the data no reader needs anymore */
+static void netplay_spectate_trim(netplay_t *netplay)
+{
+   size_t i;
+   struct netplay_spectate *spectate = &netplay->spectate;
+   uint64_t end                      = spectate->base + spectate->size;
+   uint64_t keep                     = spectate->keyframe_size ?
+      spectate->keyframe_pos : end;
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (connection->active && connection->shared &&
+          connection->shared_pos < keep)
+         keep = connection->shared_pos;
+   }
+
+   if (keep <= spectate->base)
+      return;
+
+   memmove(spectate->data, spectate->data + (keep - spectate->base),
+         (size_t)(end - keep));
+   spectate->size -= (size_t)(keep - spectate->base);
+   spectate->base  = keep;
+}
+
+/* Make room for len more bytes, dropping whoever lags too far behind */
+static bool netplay_spectate_reserve(netplay_t *netplay, size_t len)
+{
+   size_t i;
+   size_t capacity;
+   uint8_t *data;
+   struct netplay_spectate *spectate = &netplay->spectate;
+
+   if (spectate->size + len <= spectate->capacity)
+      return true;
+
+   netplay_spectate_trim(netplay);
+
+   if (spectate->size + len > NETPLAY_SPECTATE_MAX_SIZE)
+   {
+      uint64_t keep = spectate->base + spectate->size + len -
+         NETPLAY_SPECTATE_MAX_SIZE;
+
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+         if (connection->active && connection->shared &&
+             connection->shared_pos < keep)
+         {
+            RARCH_WARN("[netplay] Spectator fell too far behind.\n");
+            netplay_hangup(netplay, connection);
+         }
+      }
+      if (spectate->keyframe_pos < keep)
+         spectate->keyframe_size = 0;
+
+      netplay_spectate_trim(netplay);
+   }
+
+   if (spectate->size + len <= spectate->capacity)
+      return true;
+
+   capacity = spectate->capacity ? spectate->capacity : 4096;
+   while (capacity < spectate->size + len)
+      capacity *= 2;
+
+   data = (uint8_t*)realloc(spectate->data, capacity);
+   if (!data)
+      return false;
+
+   spectate->data     = data;
+   spectate->capacity = capacity;
+   return true;
+}
+
+/**
+ * netplay_spectate_send_raw
+ * @netplay              : pointer to netplay object
+ * @cmd                  : command being sent
+ * @data                 : encoded command, or part of it
+ * @size                 : size of data
+ *
+ * Append to the shared spectator stream.
+ */
+void netplay_spectate_send_raw(netplay_t *netplay, uint32_t cmd,
+   const void *data, size_t size)
+{
+   size_t i;
+   struct netplay_spectate *spectate = &netplay->spectate;
+
+   if (!spectate->enabled)
+      return;
+
+   if (!netplay_spectate_reserve(netplay, size))
+   {
+      /* The stream is broken, so is everyone reading it */
+      RARCH_ERR("[netplay] Failed to grow the spectator stream.\n");
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+         if (connection->active && connection->shared)
+            netplay_hangup(netplay, connection);
+      }
+      netplay_spectate_deinit(netplay);
+      return;
+   }
+
+   memcpy(spectate->data + spectate->size, data, size);
+   spectate->size += size;
+
+   if (cmd != NETPLAY_CMD_INPUT && cmd != NETPLAY_CMD_NOINPUT &&
+       cmd != NETPLAY_CMD_CRC)
+      spectate->barrier = spectate->base + spectate->size;
+}
+
+/**
+ * netplay_spectate_send
+ * @netplay              : pointer to netplay object
+ * @cmd                  : command to send
+ * @data                 : payload
+ * @size                 : size of the payload
+ *
+ * Append a command to the shared spectator stream.
+ */
+void netplay_spectate_send(netplay_t *netplay, uint32_t cmd,
+   const void *data, size_t size)
+{
+   uint32_t cmdbuf[2];
+
+   cmdbuf[0] = htonl(cmd);
+   cmdbuf[1] = htonl(size);
+
+   netplay_spectate_send_raw(netplay, cmd, cmdbuf, sizeof(cmdbuf));
+   if (size > 0)
+      netplay_spectate_send_raw(netplay, cmd, data, size);
+}
+
+/**
+ * netplay_spectate_can_attach
+ * @netplay              : pointer to netplay object
+ * @connection           : joining connection
+ *
+ * Check whether a joining spectator can be synced to the keyframe.
+ *
+ * Returns true if it can, with the keyframe's frame in frame.
+ */
+bool netplay_spectate_can_attach(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t *frame)
+{
+   struct netplay_spectate *spectate = &netplay->spectate;
+
+   if (!spectate->enabled || !spectate->keyframe_size ||
+       spectate->keyframe_pos < spectate->barrier ||
+       spectate->keyframe_tag != netplay_spectate_tag(netplay) ||
+       connection->compression_supported != spectate->compression)
+      return false;
+
+   *frame = spectate->keyframe_frame;
+   return true;
+}
+
+/**
+ * netplay_spectate_attach
+ * @netplay              : pointer to netplay object
+ * @connection           : joining connection, synced to the keyframe
+ *
+ * Send the keyframe and put the connection on the shared stream.
+ *
+ * Returns true if successful.
+ */
+bool netplay_spectate_attach(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   struct netplay_spectate *spectate = &netplay->spectate;
+
+   if (!netplay_send(&connection->send_packet_buffer, connection->fd,
+         spectate->keyframe, spectate->keyframe_size))
+      return false;
+
+   connection->shared     = true;
+   connection->shared_pos = spectate->keyframe_pos;
+   return true;
+}
+
+/**
+ * netplay_spectate_detach
+ * @netplay              : pointer to netplay object
+ * @connection           : connection on the shared stream
+ *
+ * Queue the rest of the shared stream on the connection's own buffer, so
+ * that something can be sent to it alone.
+ *
+ * Returns true if successful.
+ */
+bool netplay_spectate_detach(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   struct netplay_spectate *spectate = &netplay->spectate;
+   uint64_t end                      = spectate->base + spectate->size;
+
+   connection->shared = false;
+
+   if (connection->shared_pos < end &&
+       !netplay_send(&connection->send_packet_buffer, connection->fd,
+         spectate->data + (connection->shared_pos - spectate->base),
+         (size_t)(end - connection->shared_pos)))
+      return false;
+
+   if (connection->udp_supported &&
+       !netplay_udp_send_info(netplay, connection, connection->udp_token))
+      return false;
+
+   return true;
+}
+
+/**
+ * netplay_spectate_flush
+ * @netplay              : pointer to netplay object
+ * @connection           : connection on the shared stream
+ *
+ * Send what we can of the shared stream to the connection, after anything
+ * still in its own buffer.
+ *
+ * Returns false only on socket failures.
+ */
+bool netplay_spectate_flush(netplay_t *netplay,
+   struct netplay_connection *connection)
+{
+   ssize_t sent;
+   struct socket_buffer *sbuf        = &connection->send_packet_buffer;
+   struct netplay_spectate *spectate = &netplay->spectate;
+   uint64_t end                      = spectate->base + spectate->size;
+
+   if (!netplay_send_flush(sbuf, connection->fd, false))
+      return false;
+
+   /* The sync info and keyframe go first */
+   if (sbuf->start != sbuf->end || connection->shared_pos >= end)
+      return true;
+
+   sent = socket_send_all_nonblocking(connection->fd,
+         spectate->data + (connection->shared_pos - spectate->base),
+         (size_t)(end - connection->shared_pos), true);
+   if (sent < 0)
+      return false;
+
+   connection->shared_pos += sent;
+   return true;
+}
+
+/**
+ * netplay_spectate_frame
+ * @netplay              : pointer to netplay object
+ *
+ * Remember where the stream is as we start reading input for a new frame.
+ */
+void netplay_spectate_frame(netplay_t *netplay)
+{
+   struct netplay_spectate *spectate = &netplay->spectate;
+   struct netplay_spectate_frame *sframe;
+
+   if (!spectate->enabled)
+      return;
+
+   sframe        = &spectate->frames[netplay->self_ptr];
+   sframe->used  = true;
+   sframe->frame = netplay->self_frame_count;
+   sframe->pos   = spectate->base + spectate->size;
+   sframe->tag   = netplay_spectate_tag(netplay);
+}
+
+/**
+ * netplay_spectate_post_frame
+ * @netplay              : pointer to netplay object
+ *
+ * Take a new keyframe if it's time to.
+ */
+void netplay_spectate_post_frame(netplay_t *netplay)
+{
+   size_t i;
+   uint32_t rd, wn;
+   uint32_t header[4];
+   struct compression_transcoder *ctrans;
+   struct netplay_spectate *spectate = &netplay->spectate;
+   size_t ptr                        = netplay->other_ptr;
+   uint32_t frame                    = netplay->other_frame_count;
+
+   if (!spectate->enabled || !netplay->state_size ||
+       (netplay->quirks & (NETPLAY_QUIRK_NO_SAVESTATES |
+                           NETPLAY_QUIRK_NO_TRANSMISSION)))
+      return;
+
+   if (spectate->keyframe_size &&
+       spectate->keyframe_pos >= spectate->barrier &&
+       frame < spectate->keyframe_frame + NETPLAY_SPECTATE_KEYFRAME_FRAMES)
+      return;
+
+   ctrans = (spectate->compression == NETPLAY_COMPRESSION_ZLIB) ?
+      &netplay->compress_zlib : &netplay->compress_nil;
+
+   /* Only made once a peer has used this compression */
+   if (!ctrans->compression_stream)
+      return;
+
+   if (!spectate->keyframe)
+   {
+      spectate->keyframe = (uint8_t*)malloc(sizeof(header) +
+            netplay->zbuffer_size);
+      if (!spectate->keyframe)
+         return;
+   }
+
+   /* States up to the other frame are the real ones. Find the latest we
+    * saved, as long as its frame started after anything invalidating it. */
+   for (i = 0; ; i++)
+   {
+      struct delta_frame *delta             = &netplay->buffer[ptr];
+      struct netplay_spectate_frame *sframe = &spectate->frames[ptr];
+
+      if (i == netplay->buffer_size ||
+          (spectate->keyframe_size && frame <= spectate->keyframe_frame))
+         return;
+
+      if (delta->used && delta->frame == frame && delta->have_state)
+      {
+         if (!sframe->used || sframe->frame != frame ||
+             sframe->pos < spectate->barrier || sframe->pos < spectate->base)
+            return;
+         break;
+      }
+
+      if (frame == 0)
+         return;
+      ptr = PREV_PTR(ptr);
+      frame--;
+   }
+
+   ctrans->compression_backend->set_in(ctrans->compression_stream,
+      (const uint8_t*)netplay->buffer[ptr].state,
+      (uint32_t)netplay->state_size);
+   ctrans->compression_backend->set_out(ctrans->compression_stream,
+      spectate->keyframe + sizeof(header), (uint32_t)netplay->zbuffer_size);
+   if (!ctrans->compression_backend->trans(ctrans->compression_stream,
+         true, &rd, &wn, NULL))
+   {
+      spectate->keyframe_size = 0;
+      return;
+   }
+
+   header[0] = htonl(NETPLAY_CMD_LOAD_SAVESTATE);
+   header[1] = htonl(wn + 2*sizeof(uint32_t));
+   header[2] = htonl(frame);
+   header[3] = htonl(netplay->state_size);
+   memcpy(spectate->keyframe, header, sizeof(header));
+
+   spectate->keyframe_size  = sizeof(header) + wn;
+   spectate->keyframe_frame = frame;
+   spectate->keyframe_pos   = spectate->frames[ptr].pos;
+   spectate->keyframe_tag   = spectate->frames[ptr].tag;
+}
@@ -497,9 +497,103 @@ bool netplay_resolve_input(netplay_t *netplay, size_t sim_ptr, bool resim)
    return ret;
 }
 
+/**
+ * netplay_want_state
+ * @netplay              : pointer to netplay object
+ * @frame                : frame about to be run
+ *
+ * Whether to save the state before running this frame. Besides every
+ * state_interval-th frame, we save the frames whose CRC gets checked and the
+ * first frame run on predicted input, which is where the next rollback is
+ * most likely to start.
+ */
+static bool netplay_want_state(netplay_t *netplay, uint32_t frame)
+{
+   if (netplay->state_interval <= 1 ||
+       frame % netplay->state_interval == 0 ||
+       frame == netplay->unread_frame_count)
+      return true;
+   return netplay->check_frames &&
+      frame % abs(netplay->check_frames) == 0;
+}
+
+/**
+ * netplay_find_saved_state
+ * @netplay              : pointer to netplay object
+ *
+ * Moves the replay pointer back to the nearest frame with a saved state. If
+ * none is left in the buffer, the replay pointer is left alone.
+ *
+ * Returns true if a saved state was found.
+ */
+static bool netplay_find_saved_state(netplay_t *netplay)
+{
+   size_t i;
+   size_t ptr     = netplay->replay_ptr;
+   uint32_t frame = netplay->replay_frame_count;
+
+   for (i = 0; i < netplay->buffer_size; i++)
+   {
+      struct delta_frame *delta = &netplay->buffer[ptr];
+
+      if (!delta->used || delta->frame != frame)
+         break;
+
+      if (delta->have_state)
+      {
+         netplay->replay_ptr         = ptr;
+         netplay->replay_frame_count = frame;
+         return true;
+      }
+
+      if (frame == 0)
+         break;
+      ptr = PREV_PTR(ptr);
+      frame--;
+   }
+
+   return false;
+}
+
+/**
+ * netplay_report_rollbacks
+ * @netplay              : pointer to netplay object
+ *
+ * Counts a frame, and logs the rollback statistics every
+ * NETPLAY_ROLLBACK_REPORT_FRAMES frames.
+ */
+static void netplay_report_rollbacks(netplay_t *netplay)
+{
+   if (++netplay->rollback_report_frames < NETPLAY_ROLLBACK_REPORT_FRAMES)
+      return;
+
+   if (netplay->rollback_count)
+      RARCH_LOG("[netplay] %u rollbacks in %u frames: depth avg %u max %u, "
+            "%u frames replayed, %u usec replaying (max %u).\n",
+            netplay->rollback_count,
+            netplay->rollback_report_frames,
+            netplay->rollback_depth_sum / netplay->rollback_count,
+            netplay->rollback_depth_max,
+            netplay->rollback_replayed,
+            (unsigned)netplay->rollback_time_sum,
+            (unsigned)netplay->rollback_time_max);
+
+   netplay->rollback_report_frames = 0;
+   netplay->rollback_count        = 0;
+   netplay->rollback_depth_sum    = 0;
+   netplay->rollback_depth_max    = 0;
+   netplay->rollback_replayed     = 0;
+   netplay->rollback_time_sum     = 0;
+   netplay->rollback_time_max     = 0;
+}
+
 static void netplay_handle_frame_hash(netplay_t *netplay,
       struct delta_frame *delta)
 {
+   /* Frames we didn't save can't be checked */
+   if (!delta->have_state)
+      return;
+
    if (netplay->is_server)
    {
       if (netplay->check_frames &&
@@ -549,19 +643,32 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
    if (netplay_delta_frame_ready(netplay,
             &netplay->buffer[netplay->run_ptr], netplay->run_frame_count))
    {
+      struct delta_frame *delta = &netplay->buffer[netplay->run_ptr];
+      bool save                 = netplay->force_send_savestate ||
+         netplay_want_state(netplay, netplay->run_frame_count);
+
       serial_info.data_const = NULL;
-      serial_info.data       = netplay->buffer[netplay->run_ptr].state;
+      serial_info.data       = delta->state;
       serial_info.size       = netplay->state_size;
 
-      memset(serial_info.data, 0, serial_info.size);
+      delta->have_state      = false;
+
+      if (save)
+         memset(serial_info.data, 0, serial_info.size);
       if ((netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
             || netplay->run_frame_count == 0)
       {
          /* Don't serialize until it's safe */
       }
+      else if (!save)
+      {
+         /* A rollback to this frame starts from an earlier saved one */
+      }
       else if (!(netplay->quirks & NETPLAY_QUIRK_NO_SAVESTATES)
             && core_serialize(&serial_info))
       {
+         delta->have_state = true;
+
          if (netplay->force_send_savestate && !netplay->stall
                && !netplay->remote_paused)
          {
@@ -572,6 +679,7 @@ bool netplay_sync_pre_frame(netplay_t *netplay)
                memcpy(netplay->buffer[netplay->self_ptr].state,
                   netplay->buffer[netplay->run_ptr].state,
                   netplay->state_size);
+               netplay->buffer[netplay->self_ptr].have_state = true;
                netplay->run_ptr         = netplay->self_ptr;
                netplay->run_frame_count = netplay->self_frame_count;
             }
@@ -753,6 +861,7 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
    {
       netplay->self_ptr = NEXT_PTR(netplay->self_ptr);
       netplay->self_frame_count++;
+      netplay_spectate_frame(netplay);
    }
 
    /* Only relevant if we're connected and not in a desynching operation */
@@ -826,91 +935,140 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
        netplay->replay_frame_count < netplay->run_frame_count)
    {
       retro_ctx_serialize_info_t serial_info;
+      retro_time_t replay_start   = cpu_features_get_time_usec();
+      uint32_t rollback_depth     = netplay->run_frame_count -
+         netplay->replay_frame_count;
+      uint32_t bad_frame_count    = netplay->replay_frame_count;
+      uint32_t replay_frame_count;
 
       /* Replay frames. */
       netplay->is_replay = true;
 
-      /* If we have a keyboard device, we replay the previous frame's input
-       * just to assert that the keydown/keyup events work if the core
-       * translates them in that way */
-      if (netplay->have_updown_device)
+      /* Not every frame is saved, so start from the nearest one that is */
+      if (netplay_find_saved_state(netplay))
       {
-         netplay->replay_ptr = PREV_PTR(netplay->replay_ptr);
-         netplay->replay_frame_count--;
-         autosave_lock();
-         core_run();
-         autosave_unlock();
-         netplay->replay_ptr = NEXT_PTR(netplay->replay_ptr);
-         netplay->replay_frame_count++;
-      }
+         replay_frame_count = netplay->replay_frame_count;
 
-      if (netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
-         /* Make sure we're initialized before we start loading things */
-         netplay_wait_and_init_serialization(netplay);
+         /* If we have a keyboard device, we replay the previous frame's input
+          * just to assert that the keydown/keyup events work if the core
+          * translates them in that way */
+         if (netplay->have_updown_device)
+         {
+            netplay->replay_ptr = PREV_PTR(netplay->replay_ptr);
+            netplay->replay_frame_count--;
+            autosave_lock();
+            core_run();
+            autosave_unlock();
+            netplay->replay_ptr = NEXT_PTR(netplay->replay_ptr);
+            netplay->replay_frame_count++;
+         }
 
-      serial_info.data       = NULL;
-      serial_info.data_const = netplay->buffer[netplay->replay_ptr].state;
-      serial_info.size       = netplay->state_size;
+         if (netplay->quirks & NETPLAY_QUIRK_INITIALIZATION)
+            /* Make sure we're initialized before we start loading things */
+            netplay_wait_and_init_serialization(netplay);
 
-      if (!core_unserialize(&serial_info))
-      {
-         RARCH_ERR("Netplay savestate loading failed: Prepare for desync!\n");
-      }
+         serial_info.data       = NULL;
+         serial_info.data_const = netplay->buffer[netplay->replay_ptr].state;
+         serial_info.size       = netplay->state_size;
 
-      while (netplay->replay_frame_count < netplay->run_frame_count)
-      {
-         retro_time_t start, tm;
+         if (!core_unserialize(&serial_info))
+         {
+            RARCH_ERR("Netplay savestate loading failed: Prepare for desync!\n");
+         }
 
-         struct delta_frame *ptr = &netplay->buffer[netplay->replay_ptr];
-         serial_info.data       = ptr->state;
-         serial_info.size       = netplay->state_size;
-         serial_info.data_const = NULL;
+         while (netplay->replay_frame_count < netplay->run_frame_count)
+         {
+            retro_time_t start, tm;
 
-         start = cpu_features_get_time_usec();
+            struct delta_frame *ptr = &netplay->buffer[netplay->replay_ptr];
+            serial_info.data       = ptr->state;
+            serial_info.size       = netplay->state_size;
+            serial_info.data_const = NULL;
 
-         /* Remember the current state */
-         memset(serial_info.data, 0, serial_info.size);
-         core_serialize(&serial_info);
-         if (netplay->replay_frame_count < netplay->unread_frame_count)
-            netplay_handle_frame_hash(netplay, ptr);
+            start = cpu_features_get_time_usec();
+
+            /* Remember the current state, if we'd want to come back to it. The
+             * frames before the bad input are unchanged, hash included. */
+            if (netplay->replay_frame_count >= bad_frame_count)
+            {
+               if (netplay_want_state(netplay, netplay->replay_frame_count))
+               {
+                  memset(serial_info.data, 0, serial_info.size);
+                  ptr->have_state = core_serialize(&serial_info);
+               }
+               else
+                  ptr->have_state = false;
 
-         /* Re-simulate this frame's input */
-         netplay_resolve_input(netplay, netplay->replay_ptr, true);
+               if (netplay->replay_frame_count < netplay->unread_frame_count)
+                  netplay_handle_frame_hash(netplay, ptr);
+            }
 
-         autosave_lock();
-         core_run();
-         autosave_unlock();
-         netplay->replay_ptr = NEXT_PTR(netplay->replay_ptr);
-         netplay->replay_frame_count++;
+            /* Re-simulate this frame's input */
+            netplay_resolve_input(netplay, netplay->replay_ptr, true);
+
+            autosave_lock();
+            core_run();
+            autosave_unlock();
+            netplay->replay_ptr = NEXT_PTR(netplay->replay_ptr);
+            netplay->replay_frame_count++;
 
 #ifdef DEBUG_NONDETERMINISTIC_CORES
-         if (ptr->have_remote && netplay_delta_frame_ready(netplay, &netplay->buffer[netplay->replay_ptr], netplay->replay_frame_count))
-         {
-            RARCH_LOG("PRE  %u: %X\n", netplay->replay_frame_count-1, netplay_delta_frame_crc(netplay, ptr));
-            if (netplay->is_server)
-               RARCH_LOG("INP  %X %X\n", ptr->real_input_state[0], ptr->self_state[0]);
-            else
-               RARCH_LOG("INP  %X %X\n", ptr->self_state[0], ptr->real_input_state[0]);
-            ptr = &netplay->buffer[netplay->replay_ptr];
-            serial_info.data = ptr->state;
-            memset(serial_info.data, 0, serial_info.size);
-            core_serialize(&serial_info);
-            RARCH_LOG("POST %u: %X\n", netplay->replay_frame_count-1, netplay_delta_frame_crc(netplay, ptr));
-         }
+            if (ptr->have_remote && netplay_delta_frame_ready(netplay, &netplay->buffer[netplay->replay_ptr], netplay->replay_frame_count))
+            {
+               RARCH_LOG("PRE  %u: %X\n", netplay->replay_frame_count-1, netplay_delta_frame_crc(netplay, ptr));
+               if (netplay->is_server)
+                  RARCH_LOG("INP  %X %X\n", ptr->real_input_state[0], ptr->self_state[0]);
+               else
+                  RARCH_LOG("INP  %X %X\n", ptr->self_state[0], ptr->real_input_state[0]);
+               ptr = &netplay->buffer[netplay->replay_ptr];
+               serial_info.data = ptr->state;
+               memset(serial_info.data, 0, serial_info.size);
+               core_serialize(&serial_info);
+               RARCH_LOG("POST %u: %X\n", netplay->replay_frame_count-1, netplay_delta_frame_crc(netplay, ptr));
+            }
 #endif
 
-         /* Get our time window */
-         tm = cpu_features_get_time_usec() - start;
-         netplay->frame_run_time_sum -= netplay->frame_run_time[netplay->frame_run_time_ptr];
-         netplay->frame_run_time[netplay->frame_run_time_ptr] = tm;
-         netplay->frame_run_time_sum += tm;
-         netplay->frame_run_time_ptr++;
-         if (netplay->frame_run_time_ptr >= NETPLAY_FRAME_RUN_TIME_WINDOW)
-            netplay->frame_run_time_ptr = 0;
+            /* Get our time window */
+            tm = cpu_features_get_time_usec() - start;
+            netplay->frame_run_time_sum -= netplay->frame_run_time[netplay->frame_run_time_ptr];
+            netplay->frame_run_time[netplay->frame_run_time_ptr] = tm;
+            netplay->frame_run_time_sum += tm;
+            netplay->frame_run_time_ptr++;
+            if (netplay->frame_run_time_ptr >= NETPLAY_FRAME_RUN_TIME_WINDOW)
+               netplay->frame_run_time_ptr = 0;
+         }
+
+         /* Average our time */
+         netplay->frame_run_time_avg = netplay->frame_run_time_sum / NETPLAY_FRAME_RUN_TIME_WINDOW;
+
+         /* And keep statistics of the rollback */
+         {
+            retro_time_t replay_time = cpu_features_get_time_usec() - replay_start;
+
+            netplay->rollback_count++;
+            netplay->rollback_depth_sum += rollback_depth;
+            if (rollback_depth > netplay->rollback_depth_max)
+               netplay->rollback_depth_max = rollback_depth;
+            netplay->rollback_replayed += netplay->run_frame_count -
+               replay_frame_count;
+            netplay->rollback_time_sum += replay_time;
+            if (replay_time > netplay->rollback_time_max)
+               netplay->rollback_time_max = replay_time;
+         }
       }
+      else
+      {
+         /* Loading whatever is in that slot would only make it worse */
+         RARCH_WARN("[netplay] No saved state to replay frame %u from, "
+               "requesting a savestate.\n", bad_frame_count);
+         if (netplay->is_server)
+            netplay->force_send_savestate = true;
+         else
+            netplay_cmd_request_savestate(netplay);
 
-      /* Average our time */
-      netplay->frame_run_time_avg = netplay->frame_run_time_sum / NETPLAY_FRAME_RUN_TIME_WINDOW;
+         netplay->replay_ptr         = netplay->run_ptr;
+         netplay->replay_frame_count = netplay->run_frame_count;
+      }
 
       if (netplay->unread_frame_count < netplay->run_frame_count)
       {
@@ -926,6 +1084,9 @@ void netplay_sync_post_frame(netplay_t *netplay, bool stalled)
       netplay->force_rewind = false;
    }
 
+   if (!stalled)
+      netplay_report_rollbacks(netplay);
+
    if (netplay->is_server)
    {
       uint32_t client;
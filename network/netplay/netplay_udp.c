@@ -0,0 +1,729 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *  Copyright (C) 2016-2017 - Gregor Richards
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* UDP input.
+ *
+ * TCP still carries everything, input included. Input is also sent over UDP,
+ * each packet repeating the last few frames so that a lost packet is covered
+ * by the next one instead of waiting for a retransmission, and whichever
+ * copy arrives first is used. The TCP copy of input already read is then
+ * skipped like any other duplicate.
+ *
+ * Reading input early is only correct if no other command comes before it on
+ * the TCP stream. Both sides count the commands other than input sent after
+ * their UDP_INFO, each packet carries the sender's count, and the receiver
+ * only uses the input in it once it has read as many commands.
+ *
+ * Packets are made of 32-bit words in network order:
+ *  header: magic, token, command count, send time, echoed send time, time
+ *          since the echoed packet arrived, server's NOINPUT frame, blocks
+ *  blocks: client number, first frame, frames, words per frame, input
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+
+#include "netplay_private.h"
+
+#include "../../retroarch.h"
+
+#if defined(AF_INET6) && !defined(HAVE_SOCKET_LEGACY)
+#define HAVE_INET6 1
+#endif
+
+#define NETPLAY_UDP_MAGIC        0x52414E55 /* "RANU" */
+#define NETPLAY_UDP_HEADER_WORDS 8
+#define NETPLAY_UDP_BLOCK_WORDS  4
+
+/* Keeps packets below common MTUs */
+#define NETPLAY_UDP_MAX_WORDS    300
+
+/* Round trip times above this are measurement errors */
+#define NETPLAY_UDP_MAX_RTT      (5*1000*1000)
+
+static bool netplay_udp_set_port(struct sockaddr_storage *addr,
+      uint16_t port)
+{
+   switch (addr->ss_family)
+   {
+      case AF_INET:
+         ((struct sockaddr_in *) addr)->sin_port = htons(port);
+         return true;
+#ifdef HAVE_INET6
+      case AF_INET6:
+         ((struct sockaddr_in6 *) addr)->sin6_port = htons(port);
+         return true;
+#endif
+      default:
+         break;
+   }
+   return false;
+}
+
+/**
+ * netplay_udp_init
+ * @netplay              : pointer to netplay object
+ * @tcp_fd               : TCP socket to match the address family of
+ * @redundancy           : frames of input to repeat in each packet
+ *
+ * Open the UDP socket used to send input ahead of the TCP stream.
+ * The host binds it to the TCP port number when that is free.
+ *
+ * Returns true if UDP input is available.
+ */
+bool netplay_udp_init(netplay_t *netplay, int tcp_fd, unsigned redundancy)
+{
+   struct sockaddr_storage addr = {0};
+   socklen_t addr_size          = sizeof(addr);
+   int fd                       = -1;
+
+   netplay->udp_fd = -1;
+
+   if (!redundancy)
+      return false;
+
+   if (getsockname(tcp_fd, (struct sockaddr *) &addr, &addr_size) < 0)
+      goto error;
+
+   fd = socket(addr.ss_family, SOCK_DGRAM, 0);
+   if (fd < 0)
+      goto error;
+
+   /* Any address, any port */
+   switch (addr.ss_family)
+   {
+      case AF_INET:
+         ((struct sockaddr_in *) &addr)->sin_addr.s_addr = htonl(INADDR_ANY);
+         break;
+#ifdef HAVE_INET6
+      case AF_INET6:
+      {
+         struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) &addr;
+#if defined(_MSC_VER) && _MSC_VER <= 1200
+         IN6ADDR_SETANY(sin6);
+#else
+         sin6->sin6_addr           = in6addr_any;
+#endif
+#if defined(IPPROTO_IPV6) && defined(IPV6_V6ONLY)
+         {
+            /* IPv4 peers of an IPv6 server show up as mapped addresses */
+            int on = 0;
+            setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (const char*)&on,
+                  sizeof(on));
+         }
+#endif
+         break;
+      }
+#endif
+      default:
+         goto error;
+   }
+   /* The host listens on the same port number as for TCP, so
+    * forwarding that port number is enough to reach it */
+   netplay_udp_set_port(&addr, netplay->is_server ? netplay->tcp_port : 0);
+
+   if (bind(fd, (struct sockaddr *) &addr, addr_size) < 0)
+   {
+      if (!netplay->is_server)
+         goto error;
+
+      RARCH_WARN("[netplay] UDP port %hu is taken, using any port.\n",
+            (unsigned short) netplay->tcp_port);
+      netplay_udp_set_port(&addr, 0);
+      if (bind(fd, (struct sockaddr *) &addr, addr_size) < 0)
+         goto error;
+   }
+
+   if (!socket_nonblock(fd))
+      goto error;
+
+   /* Find out which port we got */
+   addr_size = sizeof(addr);
+   if (getsockname(fd, (struct sockaddr *) &addr, &addr_size) < 0)
+      goto error;
+
+   if (addr.ss_family == AF_INET)
+      netplay->udp_port = ntohs(((struct sockaddr_in *) &addr)->sin_port);
+#ifdef HAVE_INET6
+   else
+      netplay->udp_port = ntohs(((struct sockaddr_in6 *) &addr)->sin6_port);
+#endif
+
+   netplay->udp_fd         = fd;
+   netplay->udp_redundancy = (redundancy > NETPLAY_UDP_MAX_REDUNDANCY) ?
+      NETPLAY_UDP_MAX_REDUNDANCY : redundancy;
+
+   RARCH_LOG("[netplay] Sending input over UDP port %hu.\n",
+         (unsigned short) netplay->udp_port);
+   return true;
+
+error:
+   if (fd >= 0)
+      socket_close(fd);
+   RARCH_WARN("[netplay] Failed to open the UDP input socket, using TCP only.\n");
+   return false;
+}
+
+/**
+ * netplay_udp_deinit
+ *
+ * Close the UDP socket.
+ */
+void netplay_udp_deinit(netplay_t *netplay)
+{
+   if (netplay->udp_fd >= 0)
+      socket_close(netplay->udp_fd);
+   netplay->udp_fd = -1;
+}
+
+/**
+ * netplay_udp_send_info
+ *
+ * Send the UDP_INFO command telling the peer how to reach us.
+ */
+bool netplay_udp_send_info(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t token)
+{
+   uint32_t payload[2];
+
+   if (!connection->udp_supported || connection->udp_info_sent)
+      return true;
+
+   connection->udp_token = token;
+
+   payload[0] = htonl(netplay->udp_port);
+   payload[1] = htonl(token);
+   if (!netplay_send_raw_cmd(netplay, connection, NETPLAY_CMD_UDP_INFO,
+         payload, sizeof(payload)))
+      return false;
+
+   /* Our packets count the commands sent from here on */
+   connection->udp_epoch_out = 0;
+   connection->udp_info_sent = true;
+   return true;
+}
+
+/**
+ * netplay_udp_set_peer
+ *
+ * Handle the peer's UDP_INFO command.
+ */
+void netplay_udp_set_peer(netplay_t *netplay,
+   struct netplay_connection *connection, uint32_t port, uint32_t token)
+{
+   connection->udp_addr_size = sizeof(connection->udp_addr);
+
+   /* Their UDP socket is on the same host as their TCP one */
+   if (!port || port > 0xFFFF ||
+       getpeername(connection->fd, (struct sockaddr *) &connection->udp_addr,
+         &connection->udp_addr_size) < 0 ||
+       !netplay_udp_set_port(&connection->udp_addr, (uint16_t) port))
+   {
+      RARCH_WARN("[netplay] Unusable UDP address from peer, using TCP only.\n");
+      return;
+   }
+
+   connection->udp_peer_token    = token;
+   connection->udp_epoch_in      = 0;
+   connection->udp_info_received = true;
+}
+
+/* Everything but input can change which input comes next */
+static bool netplay_udp_cmd_counts(uint32_t cmd)
+{
+   return cmd != NETPLAY_CMD_INPUT &&
+          cmd != NETPLAY_CMD_NOINPUT &&
+          cmd != NETPLAY_CMD_UDP_INFO;
+}
+
+/**
+ * netplay_udp_cmd_sent
+ *
+ * Account for a command sent on the connection.
+ */
+void netplay_udp_cmd_sent(struct netplay_connection *connection, uint32_t cmd)
+{
+   if (connection->udp_info_sent && netplay_udp_cmd_counts(cmd))
+      connection->udp_epoch_out++;
+}
+
+/**
+ * netplay_udp_cmd_received
+ *
+ * Account for a command read from the connection.
+ */
+void netplay_udp_cmd_received(struct netplay_connection *connection,
+   uint32_t cmd)
+{
+   if (connection->udp_info_received && netplay_udp_cmd_counts(cmd))
+      connection->udp_epoch_in++;
+}
+
+/**
+ * netplay_udp_frame_input
+ *
+ * Copy a client's input for a recent frame, or just check that we have it if
+ * out is NULL.
+ */
+static bool netplay_udp_frame_input(netplay_t *netplay, uint32_t frame,
+      uint32_t client_num, uint32_t *out)
+{
+   size_t ptr;
+   uint32_t device, i;
+   struct delta_frame *dframe;
+   uint32_t devices = netplay->client_devices[client_num];
+
+   if (frame > netplay->self_frame_count ||
+       netplay->self_frame_count - frame >= netplay->buffer_size)
+      return false;
+
+   ptr    = (netplay->self_ptr + netplay->buffer_size -
+         (netplay->self_frame_count - frame)) % netplay->buffer_size;
+   dframe = &netplay->buffer[ptr];
+
+   if (!dframe->used || dframe->frame != frame ||
+       !dframe->have_real[client_num])
+      return false;
+
+   for (device = 0; device < MAX_INPUT_DEVICES; device++)
+   {
+      netplay_input_state_t istate;
+      if (!(devices & (1<<device)))
+         continue;
+      istate = dframe->real_input[device];
+      while (istate && (!istate->used || istate->client_num != client_num))
+         istate = istate->next;
+      if (!istate ||
+          istate->size != netplay_expected_input_size(netplay, 1 << device))
+         return false;
+      if (out)
+      {
+         for (i = 0; i < istate->size; i++)
+            *out++ = htonl(istate->data[i]);
+      }
+   }
+
+   return true;
+}
+
+/**
+ * netplay_udp_add_block
+ *
+ * Add the recent input of a client to a packet.
+ *
+ * Returns the number of words added.
+ */
+static size_t netplay_udp_add_block(netplay_t *netplay, uint32_t *buf,
+      size_t avail, uint32_t client_num)
+{
+   uint32_t first, last, frame;
+   size_t max_frames, frames = 0;
+   uint32_t words = netplay_expected_input_size(netplay,
+         netplay->client_devices[client_num]);
+
+   if (!words || avail <= NETPLAY_UDP_BLOCK_WORDS)
+      return 0;
+
+   max_frames = (avail - NETPLAY_UDP_BLOCK_WORDS) / words;
+   if (max_frames > netplay->udp_redundancy)
+      max_frames = netplay->udp_redundancy;
+
+   /* Only send what was already sent over TCP */
+   last = netplay->read_frame_count[client_num];
+   if (last > netplay->self_frame_count + 1)
+      last = netplay->self_frame_count + 1;
+
+   while (frames < max_frames && frames < last &&
+          netplay_udp_frame_input(netplay, last - frames - 1, client_num,
+            NULL))
+      frames++;
+
+   if (!frames)
+      return 0;
+
+   first  = last - (uint32_t) frames;
+   buf[0] = htonl(client_num);
+   buf[1] = htonl(first);
+   buf[2] = htonl((uint32_t) frames);
+   buf[3] = htonl(words);
+
+   buf   += NETPLAY_UDP_BLOCK_WORDS;
+   for (frame = first; frame < last; frame++, buf += words)
+      netplay_udp_frame_input(netplay, frame, client_num, buf);
+
+   return NETPLAY_UDP_BLOCK_WORDS + frames * words;
+}
+
+/**
+ * netplay_udp_send
+ *
+ * Send the recent input frames to every peer that supports UDP input.
+ */
+void netplay_udp_send(netplay_t *netplay)
+{
+   size_t i;
+   retro_time_t now;
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+
+   if (netplay->udp_fd < 0)
+      return;
+
+   now = cpu_features_get_time_usec();
+
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      uint32_t client_num;
+      size_t used                           = NETPLAY_UDP_HEADER_WORDS;
+      size_t added                          = 0;
+      uint32_t blocks                       = 0;
+      uint32_t to_client                    = (uint32_t)(i + 1);
+      struct netplay_connection *connection = &netplay->connections[i];
+
+      if (!connection->active ||
+          connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+          !connection->udp_info_sent || !connection->udp_info_received)
+         continue;
+
+      buf[0] = htonl(NETPLAY_UDP_MAGIC);
+      buf[1] = htonl(connection->udp_peer_token);
+      buf[2] = htonl(connection->udp_epoch_out);
+      buf[3] = htonl((uint32_t) now);
+      buf[4] = htonl(connection->udp_echo_time);
+      buf[5] = htonl(connection->udp_echo_time ?
+            (uint32_t) (now - connection->udp_echo_received) : 0);
+
+      /* A server that isn't playing sends NOINPUT up to its own frame */
+      buf[6] = htonl((netplay->is_server &&
+               netplay->self_mode != NETPLAY_CONNECTION_PLAYING) ?
+            netplay->self_frame_count + 1 : 0);
+
+      /* Our own input */
+      if (netplay->self_mode == NETPLAY_CONNECTION_PLAYING)
+      {
+         added = netplay_udp_add_block(netplay, buf + used,
+               NETPLAY_UDP_MAX_WORDS - used, netplay->self_client_num);
+         if (added)
+         {
+            used += added;
+            blocks++;
+         }
+      }
+
+      /* And the input we forward from the other players */
+      if (netplay->is_server)
+      {
+         for (client_num = 1; client_num < MAX_CLIENTS; client_num++)
+         {
+            if (client_num == to_client ||
+                client_num > netplay->connections_size ||
+                !(netplay->connected_players & (1<<client_num)) ||
+                (netplay->connected_slaves & (1<<client_num)) ||
+                netplay->connections[client_num-1].mode !=
+                  NETPLAY_CONNECTION_PLAYING)
+               continue;
+
+            added = netplay_udp_add_block(netplay, buf + used,
+                  NETPLAY_UDP_MAX_WORDS - used, client_num);
+            if (added)
+            {
+               used += added;
+               blocks++;
+            }
+         }
+      }
+
+      buf[7] = htonl(blocks);
+
+      /* Losing it is fine, that's what the redundancy is for */
+      sendto(netplay->udp_fd, (const char *) buf, used * sizeof(uint32_t), 0,
+            (struct sockaddr *) &connection->udp_addr,
+            connection->udp_addr_size);
+   }
+}
+
+/**
+ * netplay_udp_accepts
+ *
+ * Whether input of this client may come from this connection.
+ */
+static bool netplay_udp_accepts(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t client_num)
+{
+   if (client_num >= MAX_CLIENTS ||
+       !(netplay->connected_players & (1<<client_num)) ||
+       (netplay->connected_slaves & (1<<client_num)))
+      return false;
+
+   /* Servers only take a client's own input, from a playing connection */
+   if (netplay->is_server)
+      return connection->mode == NETPLAY_CONNECTION_PLAYING &&
+         client_num == (uint32_t)(connection - netplay->connections + 1);
+
+   return client_num != netplay->self_client_num;
+}
+
+/**
+ * netplay_udp_store_input
+ *
+ * Store the input of the next unread frame of a client, as reading it from
+ * the TCP stream would.
+ */
+static bool netplay_udp_store_input(netplay_t *netplay,
+      struct netplay_connection *connection, uint32_t client_num,
+      const uint32_t *data)
+{
+   uint32_t device, di;
+   uint32_t devices           = netplay->client_devices[client_num];
+   struct delta_frame *dframe = &netplay->buffer[netplay->read_ptr[client_num]];
+
+   if (!netplay_delta_frame_ready(netplay, dframe,
+            netplay->read_frame_count[client_num]))
+      return false;
+
+   for (device = 0; device < MAX_INPUT_DEVICES; device++)
+   {
+      netplay_input_state_t istate;
+      uint32_t dsize;
+      if (!(devices & (1<<device)))
+         continue;
+
+      dsize  = netplay_expected_input_size(netplay, 1 << device);
+      istate = netplay_input_state_for(&dframe->real_input[device],
+            client_num, dsize, false, false);
+      if (!istate)
+         return false;
+      for (di = 0; di < dsize; di++)
+         istate->data[di] = ntohl(*data++);
+   }
+   dframe->have_real[client_num] = true;
+
+   netplay->read_ptr[client_num] = NEXT_PTR(netplay->read_ptr[client_num]);
+   netplay->read_frame_count[client_num]++;
+
+   if (netplay->is_server)
+   {
+      /* Forward it on if it's past data */
+      if (dframe->frame <= netplay->self_frame_count)
+         netplay_forward_input(netplay, dframe, connection, client_num);
+   }
+   else if (client_num == 0)
+   {
+      netplay->server_ptr         = netplay->read_ptr[0];
+      netplay->server_frame_count = netplay->read_frame_count[0];
+   }
+
+   return true;
+}
+
+/**
+ * netplay_udp_read_packet
+ *
+ * Handle a packet from the connection.
+ *
+ * Returns true if new input was read.
+ */
+static bool netplay_udp_read_packet(netplay_t *netplay,
+      struct netplay_connection *connection, const uint32_t *buf,
+      size_t words)
+{
+   uint32_t blocks, noinput;
+   size_t pos         = NETPLAY_UDP_HEADER_WORDS;
+   uint32_t echo_time = ntohl(buf[4]);
+   retro_time_t now   = cpu_features_get_time_usec();
+   bool had_input     = false;
+
+   connection->udp_echo_time     = ntohl(buf[3]);
+   connection->udp_echo_received = now;
+
+   /* Estimate the round trip time like TCP does */
+   if (echo_time)
+   {
+      int32_t rtt = (int32_t) ((uint32_t) now - echo_time - ntohl(buf[5]));
+
+      if (rtt >= 0 && rtt < NETPLAY_UDP_MAX_RTT)
+      {
+         if (!connection->udp_rtt)
+         {
+            connection->udp_rtt     = rtt ? rtt : 1;
+            connection->udp_rtt_var = rtt / 2;
+         }
+         else
+         {
+            retro_time_t diff = connection->udp_rtt - rtt;
+            if (diff < 0)
+               diff = -diff;
+            connection->udp_rtt_var = (3 * connection->udp_rtt_var + diff) / 4;
+            connection->udp_rtt     = (7 * connection->udp_rtt + rtt) / 8;
+            if (!connection->udp_rtt)
+               connection->udp_rtt  = 1;
+         }
+      }
+   }
+
+   /* The input may only be read once we're at the same point of the stream */
+   if (!connection->udp_info_received ||
+       ntohl(buf[2]) != connection->udp_epoch_in)
+      return false;
+
+   noinput = ntohl(buf[6]);
+   if (!netplay->is_server && noinput > netplay->server_frame_count)
+   {
+      while (netplay->server_frame_count < noinput)
+      {
+         netplay->server_ptr = NEXT_PTR(netplay->server_ptr);
+         netplay->server_frame_count++;
+      }
+      had_input = true;
+   }
+
+   for (blocks = ntohl(buf[7]);
+        blocks && pos + NETPLAY_UDP_BLOCK_WORDS <= words;
+        blocks--)
+   {
+      uint32_t client_num  = ntohl(buf[pos]);
+      uint32_t frame       = ntohl(buf[pos + 1]);
+      uint32_t frames      = ntohl(buf[pos + 2]);
+      uint32_t size        = ntohl(buf[pos + 3]);
+      const uint32_t *data = buf + pos + NETPLAY_UDP_BLOCK_WORDS;
+
+      pos += NETPLAY_UDP_BLOCK_WORDS;
+      if (!size || frames > (words - pos) / size)
+         break;
+      pos += frames * size;
+
+      if (!netplay_udp_accepts(netplay, connection, client_num) ||
+          size != netplay_expected_input_size(netplay,
+            netplay->client_devices[client_num]))
+         continue;
+
+      for (; frames; frames--, frame++, data += size)
+      {
+         /* Already read, or a gap to wait for */
+         if (frame < netplay->read_frame_count[client_num])
+            continue;
+         if (frame > netplay->read_frame_count[client_num] ||
+             !netplay_udp_store_input(netplay, connection, client_num, data))
+            break;
+         had_input = true;
+      }
+   }
+
+   return had_input;
+}
+
+/**
+ * netplay_udp_poll
+ *
+ * Read any pending UDP packets.
+ *
+ * Returns true if new input was read.
+ */
+bool netplay_udp_poll(netplay_t *netplay)
+{
+   uint32_t buf[NETPLAY_UDP_MAX_WORDS];
+   bool had_input = false;
+
+   if (netplay->udp_fd < 0)
+      return false;
+
+   for (;;)
+   {
+      size_t i;
+      uint32_t token;
+      struct sockaddr_storage addr;
+      socklen_t addr_size = sizeof(addr);
+      ssize_t len         = recvfrom(netplay->udp_fd, (char *) buf,
+            sizeof(buf), 0, (struct sockaddr *) &addr, &addr_size);
+
+      if (len < 0)
+         break;
+
+      if (len < (ssize_t) (NETPLAY_UDP_HEADER_WORDS * sizeof(uint32_t)) ||
+          ntohl(buf[0]) != NETPLAY_UDP_MAGIC)
+         continue;
+
+      token = ntohl(buf[1]);
+      for (i = 0; i < netplay->connections_size; i++)
+      {
+         struct netplay_connection *connection = &netplay->connections[i];
+         if (!connection->active ||
+             connection->mode < NETPLAY_CONNECTION_CONNECTED ||
+             !connection->udp_info_sent || connection->udp_token != token)
+            continue;
+
+         /* Answer wherever it came from, in case of NAT */
+         if (connection->udp_info_received)
+         {
+            connection->udp_addr      = addr;
+            connection->udp_addr_size = addr_size;
+         }
+
+         if (netplay_udp_read_packet(netplay, connection, buf,
+                  len / sizeof(uint32_t)))
+            had_input = true;
+         break;
+      }
+   }
+
+   return had_input;
+}
+
+/**
+ * netplay_udp_latency_frames
+ *
+ * Frames of input latency needed to hide the network delay measured over
+ * UDP.
+ *
+ * Returns the number of frames, or -1 if nothing was measured yet.
+ */
+int netplay_udp_latency_frames(netplay_t *netplay)
+{
+   size_t i;
+   retro_time_t frame_usec              = 16666;
+   retro_time_t delay                   = -1;
+   struct retro_system_av_info *av_info = video_viewport_get_system_av_info();
+
+   if (netplay->udp_fd < 0)
+      return -1;
+
+   if (av_info && av_info->timing.fps > 0)
+      frame_usec = (retro_time_t) (1000000.0 / av_info->timing.fps);
+   if (frame_usec <= 0)
+      return -1;
+
+   /* The input has to reach the slowest player in time */
+   for (i = 0; i < netplay->connections_size; i++)
+   {
+      retro_time_t conn_delay;
+      struct netplay_connection *connection = &netplay->connections[i];
+      if (!connection->active ||
+          connection->mode != NETPLAY_CONNECTION_PLAYING ||
+          !connection->udp_rtt)
+         continue;
+
+      conn_delay = connection->udp_rtt / 2 + 2 * connection->udp_rtt_var;
+      if (conn_delay > delay)
+         delay = conn_delay;
+   }
+
+   if (delay < 0)
+      return -1;
+
+   return (int) ((delay + frame_usec - 1) / frame_usec);
+}
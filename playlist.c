@@ -29,6 +29,11 @@
 #include <file/file_path.h>
 #include <lists/string_list.h>
 #include <formats/jsonsax_full.h>
+#include <encodings/crc32.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #include "playlist.h"
 #include "verbosity.h"
@@ -39,21 +44,52 @@
 #define PLAYLIST_ENTRIES 6
 #endif
 
+typedef struct playlist_write_job playlist_write_job_t;
+
 struct content_playlist
 {
    bool modified;
+   /* Pushes and updates can be journaled instead of written */
+   bool journal_allowed;
+   unsigned journal_records;
    size_t size;
    size_t cap;
 
+   /* Size and CRC of the playlist file as last read or written */
+   int64_t file_size;
+   uint32_t file_crc;
+
+   /* Sidecar the entries were loaded from, entry strings
+    * pointing into its pool must not be freed */
+   void *cache;
+   char *pool;
+   size_t pool_size;
+
+#ifdef HAVE_THREADS
+   sthread_t *writer;
+#endif
+   /* Last write, until its result is known */
+   playlist_write_job_t *writer_job;
+
    char *conf_path;
    struct playlist_entry *entries;
 };
 
+typedef struct
+{
+   uint8_t *data;
+   size_t len;
+   size_t cap;
+   bool error;
+} playlist_buf_t;
+
 typedef struct
 {
    JSON_Parser parser;
    JSON_Writer writer;
    RFILE *file;
+   /* Output buffer used instead of the file when set */
+   playlist_buf_t *buf;
    playlist_t *playlist;
    struct playlist_entry *current_entry;
    unsigned array_depth;
@@ -240,6 +276,16 @@ void playlist_get_index(playlist_t *playlist,
    *entry = &playlist->entries[idx];
 }
 
+static void playlist_free_entry(playlist_t *playlist,
+      struct playlist_entry *entry);
+static void playlist_buf_append(playlist_buf_t *buf,
+      const void *data, size_t len);
+static void playlist_writer_join(playlist_t *playlist);
+static void playlist_journal_remove(playlist_t *playlist);
+static bool playlist_write(playlist_t *playlist, bool background);
+static void playlist_write_file_format(playlist_t *playlist,
+      bool background);
+
 /**
  * playlist_delete_index:
  * @playlist            : Playlist handle.
@@ -250,9 +296,11 @@ void playlist_get_index(playlist_t *playlist,
 void playlist_delete_index(playlist_t *playlist,
       size_t idx)
 {
-   if (!playlist)
+   if (!playlist || idx >= playlist->size)
       return;
 
+   playlist_free_entry(playlist, &playlist->entries[idx]);
+
    playlist->size     = playlist->size - 1;
 
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
@@ -288,6 +336,37 @@ void playlist_get_index_by_path(playlist_t *playlist,
    }
 }
 
+/**
+ * playlist_delete_by_path:
+ * @playlist            : Playlist handle.
+ * @search_path         : Content path.
+ *
+ * Deletes every entry with the content path @search_path.
+ **/
+void playlist_delete_by_path(playlist_t *playlist,
+      const char *search_path)
+{
+   size_t i;
+   char real_search_path[PATH_MAX_LENGTH];
+
+   real_search_path[0] = '\0';
+
+   if (!playlist || string_is_empty(search_path))
+      return;
+
+   /* Get 'real' search path */
+   strlcpy(real_search_path, search_path, sizeof(real_search_path));
+   path_resolve_realpath(real_search_path, sizeof(real_search_path));
+
+   for (i = 0; i < playlist->size; )
+   {
+      if (playlist_path_equal(real_search_path, playlist->entries[i].path))
+         playlist_delete_index(playlist, i);
+      else
+         i++;
+   }
+}
+
 bool playlist_entry_exists(playlist_t *playlist,
       const char *path,
       const char *crc32)
@@ -311,33 +390,48 @@ bool playlist_entry_exists(playlist_t *playlist,
    return false;
 }
 
+/**
+ * playlist_free_string:
+ * @playlist            : Playlist handle.
+ * @str                 : String of one of its entries.
+ *
+ * Frees @str unless it points into the sidecar the
+ * entries were loaded from.
+ **/
+static void playlist_free_string(playlist_t *playlist, char *str)
+{
+   if (!str)
+      return;
+
+   if (     playlist->pool
+         && str >= playlist->pool
+         && str <  playlist->pool + playlist->pool_size)
+      return;
+
+   free(str);
+}
+
 /**
  * playlist_free_entry:
+ * @playlist            : Playlist handle.
  * @entry               : Playlist entry handle.
  *
  * Frees playlist entry.
  **/
-static void playlist_free_entry(struct playlist_entry *entry)
+static void playlist_free_entry(playlist_t *playlist,
+      struct playlist_entry *entry)
 {
    if (!entry)
       return;
 
-   if (entry->path != NULL)
-      free(entry->path);
-   if (entry->label != NULL)
-      free(entry->label);
-   if (entry->core_path != NULL)
-      free(entry->core_path);
-   if (entry->core_name != NULL)
-      free(entry->core_name);
-   if (entry->db_name != NULL)
-      free(entry->db_name);
-   if (entry->crc32 != NULL)
-      free(entry->crc32);
-   if (entry->subsystem_ident != NULL)
-      free(entry->subsystem_ident);
-   if (entry->subsystem_name != NULL)
-      free(entry->subsystem_name);
+   playlist_free_string(playlist, entry->path);
+   playlist_free_string(playlist, entry->label);
+   playlist_free_string(playlist, entry->core_path);
+   playlist_free_string(playlist, entry->core_name);
+   playlist_free_string(playlist, entry->db_name);
+   playlist_free_string(playlist, entry->crc32);
+   playlist_free_string(playlist, entry->subsystem_ident);
+   playlist_free_string(playlist, entry->subsystem_name);
    if (entry->subsystem_roms != NULL)
       string_list_free(entry->subsystem_roms);
 
@@ -374,24 +468,21 @@ void playlist_update(playlist_t *playlist, size_t idx,
 
    if (update_entry->path && (update_entry->path != entry->path))
    {
-      if (entry->path != NULL)
-         free(entry->path);
+      playlist_free_string(playlist, entry->path);
       entry->path        = strdup(update_entry->path);
       playlist->modified = true;
    }
 
    if (update_entry->label && (update_entry->label != entry->label))
    {
-      if (entry->label != NULL)
-         free(entry->label);
+      playlist_free_string(playlist, entry->label);
       entry->label       = strdup(update_entry->label);
       playlist->modified = true;
    }
 
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
-      if (entry->core_path != NULL)
-         free(entry->core_path);
+      playlist_free_string(playlist, entry->core_path);
       entry->core_path   = NULL;
       entry->core_path   = strdup(update_entry->core_path);
       playlist->modified = true;
@@ -399,24 +490,21 @@ void playlist_update(playlist_t *playlist, size_t idx,
 
    if (update_entry->core_name && (update_entry->core_name != entry->core_name))
    {
-      if (entry->core_name != NULL)
-         free(entry->core_name);
+      playlist_free_string(playlist, entry->core_name);
       entry->core_name   = strdup(update_entry->core_name);
       playlist->modified = true;
    }
 
    if (update_entry->db_name && (update_entry->db_name != entry->db_name))
    {
-      if (entry->db_name != NULL)
-         free(entry->db_name);
+      playlist_free_string(playlist, entry->db_name);
       entry->db_name     = strdup(update_entry->db_name);
       playlist->modified = true;
    }
 
    if (update_entry->crc32 && (update_entry->crc32 != entry->crc32))
    {
-      if (entry->crc32 != NULL)
-         free(entry->crc32);
+      playlist_free_string(playlist, entry->crc32);
       entry->crc32       = strdup(update_entry->crc32);
       playlist->modified = true;
    }
@@ -435,8 +523,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
 
    if (update_entry->path && (update_entry->path != entry->path))
    {
-      if (entry->path != NULL)
-         free(entry->path);
+      playlist_free_string(playlist, entry->path);
       entry->path        = NULL;
       entry->path        = strdup(update_entry->path);
       playlist->modified = playlist->modified || register_update;
@@ -444,8 +531,7 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
 
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
    {
-      if (entry->core_path != NULL)
-         free(entry->core_path);
+      playlist_free_string(playlist, entry->core_path);
       entry->core_path   = NULL;
       entry->core_path   = strdup(update_entry->core_path);
       playlist->modified = playlist->modified || register_update;
@@ -584,7 +670,7 @@ bool playlist_push_runtime(playlist_t *playlist,
       struct playlist_entry *last_entry = &playlist->entries[playlist->cap - 1];
 
       if (last_entry)
-         playlist_free_entry(last_entry);
+         playlist_free_entry(playlist, last_entry);
       playlist->size--;
    }
 
@@ -797,7 +883,7 @@ bool playlist_push(playlist_t *playlist,
       struct playlist_entry *entry = &playlist->entries[playlist->cap - 1];
 
       if (entry)
-         playlist_free_entry(entry);
+         playlist_free_entry(playlist, entry);
       playlist->size--;
    }
 
@@ -866,6 +952,13 @@ static JSON_Writer_HandlerResult JSONOutputHandler(JSON_Writer writer, const cha
    JSONContext *context = (JSONContext*)JSON_Writer_GetUserData(writer);
 
    (void)writer; /* unused */
+
+   if (context->buf)
+   {
+      playlist_buf_append(context->buf, pBytes, length);
+      return context->buf->error ? JSON_Writer_Abort : JSON_Writer_Continue;
+   }
+
    return filestream_write(context->file, pBytes, length) == length ? JSON_Writer_Continue : JSON_Writer_Abort;
 }
 
@@ -895,7 +988,12 @@ void playlist_write_runtime_file(playlist_t *playlist)
    RFILE *file         = NULL;
    JSONContext context = {0};
 
-   if (!playlist || !playlist->modified)
+   if (!playlist)
+      return;
+
+   playlist_writer_join(playlist);
+
+   if (!playlist->modified)
       return;
 
    file = filestream_open(playlist->conf_path,
@@ -1107,325 +1205,1222 @@ void playlist_write_runtime_file(playlist_t *playlist)
    JSON_Writer_WriteNewLine(context.writer);
    JSON_Writer_Free(context.writer);
 
-   playlist->modified = false;
+   /* Journaled updates are part of what was just written, but
+    * its size and CRC aren't known */
+   playlist_journal_remove(playlist);
+   playlist->journal_allowed = false;
+   playlist->modified        = false;
 
    RARCH_LOG("Written to playlist file: %s\n", playlist->conf_path);
 end:
    filestream_close(file);
 }
 
-void playlist_write_file(playlist_t *playlist)
+/* Writes the entries of @playlist as JSON through @writer */
+static void playlist_write_json(playlist_t *playlist, JSON_Writer writer)
 {
    size_t i;
-   RFILE          *file = NULL;
-#ifdef RARCH_INTERNAL
-   settings_t *settings = config_get_ptr();
-#endif
-
-   if (!playlist || !playlist->modified)
-      return;
-
-   file = filestream_open(playlist->conf_path,
-         RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
-   if (!file)
-   {
-      RARCH_ERR("Failed to write to playlist file: %s\n", playlist->conf_path);
-      return;
-   }
+   JSON_Writer_WriteStartObject(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   JSON_Writer_WriteString(writer, "version",
+         STRLEN_CONST("version"), JSON_UTF8);
+   JSON_Writer_WriteColon(writer);
+   JSON_Writer_WriteSpace(writer, 1);
+   JSON_Writer_WriteString(writer, "1.0",
+         STRLEN_CONST("1.0"), JSON_UTF8);
+   JSON_Writer_WriteComma(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteSpace(writer, 2);
+   JSON_Writer_WriteString(writer, "items",
+         STRLEN_CONST("items"), JSON_UTF8);
+   JSON_Writer_WriteColon(writer);
+   JSON_Writer_WriteSpace(writer, 1);
+   JSON_Writer_WriteStartArray(writer);
+   JSON_Writer_WriteNewLine(writer);
 
-#ifdef RARCH_INTERNAL
-   if (settings->bools.playlist_use_old_format)
-   {
-      for (i = 0; i < playlist->size; i++)
-         filestream_printf(file, "%s\n%s\n%s\n%s\n%s\n%s\n",
-               playlist->entries[i].path    ? playlist->entries[i].path    : "",
-               playlist->entries[i].label   ? playlist->entries[i].label   : "",
-               playlist->entries[i].core_path,
-               playlist->entries[i].core_name,
-               playlist->entries[i].crc32   ? playlist->entries[i].crc32   : "",
-               playlist->entries[i].db_name ? playlist->entries[i].db_name : ""
-               );
-   }
-   else
-#endif
+   for (i = 0; i < playlist->size; i++)
    {
-      JSONContext context = {0};
-      context.writer      = JSON_Writer_Create(NULL);
-      context.file        = file;
-
-      if (!context.writer)
-      {
-         RARCH_ERR("Failed to create JSON writer\n");
-         goto end;
-      }
+      JSON_Writer_WriteSpace(writer, 4);
+      JSON_Writer_WriteStartObject(writer);
 
-      JSON_Writer_SetOutputEncoding(context.writer, JSON_UTF8);
-      JSON_Writer_SetOutputHandler(context.writer, &JSONOutputHandler);
-      JSON_Writer_SetUserData(context.writer, &context);
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 6);
+      JSON_Writer_WriteString(writer, "path",
+            STRLEN_CONST("path"), JSON_UTF8);
+      JSON_Writer_WriteColon(writer);
+      JSON_Writer_WriteSpace(writer, 1);
+      JSON_Writer_WriteString(writer,
+            playlist->entries[i].path 
+            ? playlist->entries[i].path 
+            : "",
+            playlist->entries[i].path 
+            ? strlen(playlist->entries[i].path) 
+            : 0,
+            JSON_UTF8);
+      JSON_Writer_WriteComma(writer);
+
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 6);
+      JSON_Writer_WriteString(writer, "label",
+            STRLEN_CONST("label"), JSON_UTF8);
+      JSON_Writer_WriteColon(writer);
+      JSON_Writer_WriteSpace(writer, 1);
+      JSON_Writer_WriteString(writer,
+            playlist->entries[i].label 
+            ? playlist->entries[i].label 
+            : "",
+            playlist->entries[i].label 
+            ? strlen(playlist->entries[i].label) 
+            : 0,
+            JSON_UTF8);
+      JSON_Writer_WriteComma(writer);
 
-      JSON_Writer_WriteStartObject(context.writer);
-      JSON_Writer_WriteNewLine(context.writer);
-      JSON_Writer_WriteSpace(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "version",
-            STRLEN_CONST("version"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      JSON_Writer_WriteSpace(context.writer, 1);
-      JSON_Writer_WriteString(context.writer, "1.0",
-            STRLEN_CONST("1.0"), JSON_UTF8);
-      JSON_Writer_WriteComma(context.writer);
-      JSON_Writer_WriteNewLine(context.writer);
-      JSON_Writer_WriteSpace(context.writer, 2);
-      JSON_Writer_WriteString(context.writer, "items",
-            STRLEN_CONST("items"), JSON_UTF8);
-      JSON_Writer_WriteColon(context.writer);
-      JSON_Writer_WriteSpace(context.writer, 1);
-      JSON_Writer_WriteStartArray(context.writer);
-      JSON_Writer_WriteNewLine(context.writer);
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 6);
+      JSON_Writer_WriteString(writer, "core_path",
+            STRLEN_CONST("core_path"), JSON_UTF8);
+      JSON_Writer_WriteColon(writer);
+      JSON_Writer_WriteSpace(writer, 1);
+      JSON_Writer_WriteString(writer,
+            playlist->entries[i].core_path,
+            strlen(playlist->entries[i].core_path), JSON_UTF8);
+      JSON_Writer_WriteComma(writer);
+
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 6);
+      JSON_Writer_WriteString(writer, "core_name",
+            STRLEN_CONST("core_name"), JSON_UTF8);
+      JSON_Writer_WriteColon(writer);
+      JSON_Writer_WriteSpace(writer, 1);
+      JSON_Writer_WriteString(writer,
+            playlist->entries[i].core_name,
+            strlen(playlist->entries[i].core_name), JSON_UTF8);
+      JSON_Writer_WriteComma(writer);
+
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 6);
+      JSON_Writer_WriteString(writer, "crc32",
+            STRLEN_CONST("crc32"), JSON_UTF8);
+      JSON_Writer_WriteColon(writer);
+      JSON_Writer_WriteSpace(writer, 1);
+      JSON_Writer_WriteString(writer, playlist->entries[i].crc32 ? playlist->entries[i].crc32 : "",
+            playlist->entries[i].crc32 
+            ? strlen(playlist->entries[i].crc32) 
+            : 0,
+            JSON_UTF8);
+      JSON_Writer_WriteComma(writer);
+
+      JSON_Writer_WriteNewLine(writer);
+      JSON_Writer_WriteSpace(writer, 6);
+      JSON_Writer_WriteString(writer, "db_name",
+            STRLEN_CONST("db_name"), JSON_UTF8);
+      JSON_Writer_WriteColon(writer);
+      JSON_Writer_WriteSpace(writer, 1);
+      JSON_Writer_WriteString(writer, playlist->entries[i].db_name ? playlist->entries[i].db_name : "",
+            playlist->entries[i].db_name 
+            ? strlen(playlist->entries[i].db_name) 
+            : 0,
+            JSON_UTF8);
 
-      for (i = 0; i < playlist->size; i++)
+      if (!string_is_empty(playlist->entries[i].subsystem_ident))
       {
-         JSON_Writer_WriteSpace(context.writer, 4);
-         JSON_Writer_WriteStartObject(context.writer);
-
-         JSON_Writer_WriteNewLine(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "path",
-               STRLEN_CONST("path"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteString(context.writer,
-               playlist->entries[i].path 
-               ? playlist->entries[i].path 
-               : "",
-               playlist->entries[i].path 
-               ? strlen(playlist->entries[i].path) 
+         JSON_Writer_WriteComma(writer);
+         JSON_Writer_WriteNewLine(writer);
+         JSON_Writer_WriteSpace(writer, 6);
+         JSON_Writer_WriteString(writer, "subsystem_ident",
+               STRLEN_CONST("subsystem_ident"), JSON_UTF8);
+         JSON_Writer_WriteColon(writer);
+         JSON_Writer_WriteSpace(writer, 1);
+         JSON_Writer_WriteString(writer, playlist->entries[i].subsystem_ident ? playlist->entries[i].subsystem_ident : "",
+               playlist->entries[i].subsystem_ident 
+               ? strlen(playlist->entries[i].subsystem_ident) 
                : 0,
                JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
+      }
 
-         JSON_Writer_WriteNewLine(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "label",
-               STRLEN_CONST("label"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteString(context.writer,
-               playlist->entries[i].label 
-               ? playlist->entries[i].label 
+      if (!string_is_empty(playlist->entries[i].subsystem_name))
+      {
+         JSON_Writer_WriteComma(writer);
+         JSON_Writer_WriteNewLine(writer);
+         JSON_Writer_WriteSpace(writer, 6);
+         JSON_Writer_WriteString(writer, "subsystem_name",
+               STRLEN_CONST("subsystem_name"), JSON_UTF8);
+         JSON_Writer_WriteColon(writer);
+         JSON_Writer_WriteSpace(writer, 1);
+         JSON_Writer_WriteString(writer,
+               playlist->entries[i].subsystem_name 
+               ? playlist->entries[i].subsystem_name 
                : "",
-               playlist->entries[i].label 
-               ? strlen(playlist->entries[i].label) 
-               : 0,
-               JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-
-         JSON_Writer_WriteNewLine(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "core_path",
-               STRLEN_CONST("core_path"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteString(context.writer,
-               playlist->entries[i].core_path,
-               strlen(playlist->entries[i].core_path), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-
-         JSON_Writer_WriteNewLine(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "core_name",
-               STRLEN_CONST("core_name"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteString(context.writer,
-               playlist->entries[i].core_name,
-               strlen(playlist->entries[i].core_name), JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
-
-         JSON_Writer_WriteNewLine(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "crc32",
-               STRLEN_CONST("crc32"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteString(context.writer, playlist->entries[i].crc32 ? playlist->entries[i].crc32 : "",
-               playlist->entries[i].crc32 
-               ? strlen(playlist->entries[i].crc32) 
-               : 0,
-               JSON_UTF8);
-         JSON_Writer_WriteComma(context.writer);
+               playlist->entries[i].subsystem_name 
+               ? strlen(playlist->entries[i].subsystem_name) 
+               : 0, JSON_UTF8);
+      }
 
-         JSON_Writer_WriteNewLine(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 6);
-         JSON_Writer_WriteString(context.writer, "db_name",
-               STRLEN_CONST("db_name"), JSON_UTF8);
-         JSON_Writer_WriteColon(context.writer);
-         JSON_Writer_WriteSpace(context.writer, 1);
-         JSON_Writer_WriteString(context.writer, playlist->entries[i].db_name ? playlist->entries[i].db_name : "",
-               playlist->entries[i].db_name 
-               ? strlen(playlist->entries[i].db_name) 
-               : 0,
-               JSON_UTF8);
+      if (  playlist->entries[i].subsystem_roms && 
+            playlist->entries[i].subsystem_roms->size > 0)
+      {
+         unsigned j;
 
-         if (!string_is_empty(playlist->entries[i].subsystem_ident))
+         JSON_Writer_WriteComma(writer);
+         JSON_Writer_WriteNewLine(writer);
+         JSON_Writer_WriteSpace(writer, 6);
+         JSON_Writer_WriteString(writer, "subsystem_roms",
+               STRLEN_CONST("subsystem_roms"), JSON_UTF8);
+         JSON_Writer_WriteColon(writer);
+         JSON_Writer_WriteSpace(writer, 1);
+         JSON_Writer_WriteStartArray(writer);
+         JSON_Writer_WriteNewLine(writer);
+
+         for (j = 0; j < playlist->entries[i].subsystem_roms->size; j++)
          {
-            JSON_Writer_WriteComma(context.writer);
-            JSON_Writer_WriteNewLine(context.writer);
-            JSON_Writer_WriteSpace(context.writer, 6);
-            JSON_Writer_WriteString(context.writer, "subsystem_ident",
-                  STRLEN_CONST("subsystem_ident"), JSON_UTF8);
-            JSON_Writer_WriteColon(context.writer);
-            JSON_Writer_WriteSpace(context.writer, 1);
-            JSON_Writer_WriteString(context.writer, playlist->entries[i].subsystem_ident ? playlist->entries[i].subsystem_ident : "",
-                  playlist->entries[i].subsystem_ident 
-                  ? strlen(playlist->entries[i].subsystem_ident) 
+            const struct string_list *roms = playlist->entries[i].subsystem_roms;
+            JSON_Writer_WriteSpace(writer, 8);
+            JSON_Writer_WriteString(writer,
+                  !string_is_empty(roms->elems[j].data) 
+                  ? roms->elems[j].data 
+                  : "",
+                  !string_is_empty(roms->elems[j].data) 
+                  ? strlen(roms->elems[j].data) 
                   : 0,
                   JSON_UTF8);
-         }
-
-         if (!string_is_empty(playlist->entries[i].subsystem_name))
-         {
-            JSON_Writer_WriteComma(context.writer);
-            JSON_Writer_WriteNewLine(context.writer);
-            JSON_Writer_WriteSpace(context.writer, 6);
-            JSON_Writer_WriteString(context.writer, "subsystem_name",
-                  STRLEN_CONST("subsystem_name"), JSON_UTF8);
-            JSON_Writer_WriteColon(context.writer);
-            JSON_Writer_WriteSpace(context.writer, 1);
-            JSON_Writer_WriteString(context.writer,
-                  playlist->entries[i].subsystem_name 
-                  ? playlist->entries[i].subsystem_name 
-                  : "",
-                  playlist->entries[i].subsystem_name 
-                  ? strlen(playlist->entries[i].subsystem_name) 
-                  : 0, JSON_UTF8);
-         }
 
-         if (  playlist->entries[i].subsystem_roms && 
-               playlist->entries[i].subsystem_roms->size > 0)
-         {
-            unsigned j;
-
-            JSON_Writer_WriteComma(context.writer);
-            JSON_Writer_WriteNewLine(context.writer);
-            JSON_Writer_WriteSpace(context.writer, 6);
-            JSON_Writer_WriteString(context.writer, "subsystem_roms",
-                  STRLEN_CONST("subsystem_roms"), JSON_UTF8);
-            JSON_Writer_WriteColon(context.writer);
-            JSON_Writer_WriteSpace(context.writer, 1);
-            JSON_Writer_WriteStartArray(context.writer);
-            JSON_Writer_WriteNewLine(context.writer);
-
-            for (j = 0; j < playlist->entries[i].subsystem_roms->size; j++)
+            if (j < playlist->entries[i].subsystem_roms->size - 1)
             {
-               const struct string_list *roms = playlist->entries[i].subsystem_roms;
-               JSON_Writer_WriteSpace(context.writer, 8);
-               JSON_Writer_WriteString(context.writer,
-                     !string_is_empty(roms->elems[j].data) 
-                     ? roms->elems[j].data 
-                     : "",
-                     !string_is_empty(roms->elems[j].data) 
-                     ? strlen(roms->elems[j].data) 
-                     : 0,
-                     JSON_UTF8);
-
-               if (j < playlist->entries[i].subsystem_roms->size - 1)
-               {
-                  JSON_Writer_WriteComma(context.writer);
-                  JSON_Writer_WriteNewLine(context.writer);
-               }
+               JSON_Writer_WriteComma(writer);
+               JSON_Writer_WriteNewLine(writer);
             }
-
-            JSON_Writer_WriteNewLine(context.writer);
-            JSON_Writer_WriteSpace(context.writer, 6);
-            JSON_Writer_WriteEndArray(context.writer);
          }
 
-         JSON_Writer_WriteNewLine(context.writer);
+         JSON_Writer_WriteNewLine(writer);
+         JSON_Writer_WriteSpace(writer, 6);
+         JSON_Writer_WriteEndArray(writer);
+      }
 
-         JSON_Writer_WriteSpace(context.writer, 4);
-         JSON_Writer_WriteEndObject(context.writer);
+      JSON_Writer_WriteNewLine(writer);
 
-         if (i < playlist->size - 1)
-            JSON_Writer_WriteComma(context.writer);
+      JSON_Writer_WriteSpace(writer, 4);
+      JSON_Writer_WriteEndObject(writer);
 
-         JSON_Writer_WriteNewLine(context.writer);
-      }
+      if (i < playlist->size - 1)
+         JSON_Writer_WriteComma(writer);
 
-      JSON_Writer_WriteSpace(context.writer, 2);
-      JSON_Writer_WriteEndArray(context.writer);
-      JSON_Writer_WriteNewLine(context.writer);
-      JSON_Writer_WriteEndObject(context.writer);
-      JSON_Writer_WriteNewLine(context.writer);
-      JSON_Writer_Free(context.writer);
+      JSON_Writer_WriteNewLine(writer);
    }
 
-   playlist->modified = false;
-
-   RARCH_LOG("Written to playlist file: %s\n", playlist->conf_path);
-end:
-   filestream_close(file);
+   JSON_Writer_WriteSpace(writer, 2);
+   JSON_Writer_WriteEndArray(writer);
+   JSON_Writer_WriteNewLine(writer);
+   JSON_Writer_WriteEndObject(writer);
+   JSON_Writer_WriteNewLine(writer);
 }
 
-/**
- * playlist_free:
- * @playlist            : Playlist handle.
+/* Playlists in the JSON format are backed by two more files:
  *
- * Frees playlist handle.
- */
-void playlist_free(playlist_t *playlist)
-{
-   size_t i;
+ * - A sidecar (<playlist>.cache) holding the entries as offsets
+ *   into a string pool, valid as long as the playlist file keeps
+ *   the size and modification time it records. Loading it takes a
+ *   single read, the entries then point straight into the pool.
+ * - A journal (<playlist>.journal) of the pushes and updates made
+ *   since the playlist file was written, replayed when loading, so
+ *   small updates such as history pushes don't rewrite the whole
+ *   file. Once it gets long the playlist file is written again, on
+ *   a thread when there are threads.
+ *
+ * Both are in native byte order. Journal strings are a length
+ * (~0 for NULL) followed by their bytes and a NUL. */
 
-   if (!playlist)
-      return;
+#define PLAYLIST_CACHE_MAGIC     "RAPLCACH"
+#define PLAYLIST_CACHE_VERSION   1
+#define PLAYLIST_JOURNAL_MAGIC   "RAPLJRNL"
+#define PLAYLIST_JOURNAL_VERSION 1
+#define PLAYLIST_JOURNAL_MAX     32
 
-   if (playlist->conf_path != NULL)
-      free(playlist->conf_path);
+enum playlist_journal_type
+{
+   PLAYLIST_JOURNAL_PUSH = 0,
+   PLAYLIST_JOURNAL_UPDATE
+};
 
-   playlist->conf_path = NULL;
+static const size_t playlist_entry_strings[] = {
+   offsetof(struct playlist_entry, path),
+   offsetof(struct playlist_entry, label),
+   offsetof(struct playlist_entry, core_path),
+   offsetof(struct playlist_entry, core_name),
+   offsetof(struct playlist_entry, db_name),
+   offsetof(struct playlist_entry, crc32),
+   offsetof(struct playlist_entry, subsystem_ident),
+   offsetof(struct playlist_entry, subsystem_name)
+};
 
-   for (i = 0; i < playlist->size; i++)
-   {
-      struct playlist_entry *entry = &playlist->entries[i];
+static const size_t playlist_entry_numbers[] = {
+   offsetof(struct playlist_entry, runtime_hours),
+   offsetof(struct playlist_entry, runtime_minutes),
+   offsetof(struct playlist_entry, runtime_seconds),
+   offsetof(struct playlist_entry, last_played_year),
+   offsetof(struct playlist_entry, last_played_month),
+   offsetof(struct playlist_entry, last_played_day),
+   offsetof(struct playlist_entry, last_played_hour),
+   offsetof(struct playlist_entry, last_played_minute),
+   offsetof(struct playlist_entry, last_played_second)
+};
 
-      if (entry)
-         playlist_free_entry(entry);
-   }
+#define PLAYLIST_ENTRY_STRING(entry, i) \
+   (*(char**)((uint8_t*)(entry) + playlist_entry_strings[i]))
+#define PLAYLIST_ENTRY_NUMBER(entry, i) \
+   (*(unsigned*)((uint8_t*)(entry) + playlist_entry_numbers[i]))
 
-   free(playlist->entries);
-   playlist->entries = NULL;
+typedef struct
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t count;
+   int64_t file_size;
+   int64_t file_mtime;
+   uint32_t file_crc;
+   uint32_t num_roms;
+   uint32_t pool_size;
+   uint32_t reserved;
+} playlist_cache_header_t;
 
-   free(playlist);
+typedef struct
+{
+   /* Offsets into the pool, 0 for NULL */
+   uint32_t strings[ARRAY_SIZE(playlist_entry_strings)];
+   /* Index of the first subsystem ROM in the ROM table */
+   uint32_t roms;
+   uint32_t num_roms;
+   uint32_t numbers[ARRAY_SIZE(playlist_entry_numbers)];
+} playlist_cache_entry_t;
+
+struct playlist_write_job
+{
+   char *path;
+   char *cache_path;
+   /* Contents of the playlist file, NULL to only write the sidecar */
+   void *data;
+   int64_t size;
+   uint32_t crc;
+   void *cache;
+   int64_t cache_size;
+   bool ok;
+};
+
+typedef struct
+{
+   const uint8_t *data;
+   size_t len;
+   size_t pos;
+   bool error;
+} playlist_reader_t;
+
+static void playlist_get_aux_path(playlist_t *playlist,
+      enum file_path_enum ext, char *s, size_t len)
+{
+   strlcpy(s, playlist->conf_path, len);
+   strlcat(s, file_path_str(ext), len);
 }
 
-/**
- * playlist_clear:
- * @playlist        	   : Playlist handle.
- *
- * Clears all playlist entries in playlist.
- **/
-void playlist_clear(playlist_t *playlist)
+static bool playlist_buf_reserve(playlist_buf_t *buf, size_t len)
 {
-   size_t i;
-   if (!playlist)
-      return;
+   size_t cap;
+   uint8_t *data;
 
-   for (i = 0; i < playlist->size; i++)
-   {
-      struct playlist_entry *entry = &playlist->entries[i];
+   if (buf->error)
+      return false;
 
-      if (entry)
-         playlist_free_entry(entry);
+   if (buf->cap - buf->len >= len)
+      return true;
+
+   cap = buf->cap ? buf->cap : 4096;
+   while (cap - buf->len < len)
+      cap *= 2;
+
+   if (!(data = (uint8_t*)realloc(buf->data, cap)))
+   {
+      buf->error = true;
+      return false;
    }
-   playlist->size = 0;
+
+   buf->data = data;
+   buf->cap  = cap;
+   return true;
 }
 
-/**
- * playlist_size:
- * @playlist        	   : Playlist handle.
- *
- * Gets size of playlist.
+static void playlist_buf_append(playlist_buf_t *buf,
+      const void *data, size_t len)
+{
+   if (!playlist_buf_reserve(buf, len))
+      return;
+
+   memcpy(buf->data + buf->len, data, len);
+   buf->len += len;
+}
+
+static void playlist_buf_append_uint(playlist_buf_t *buf, uint32_t val)
+{
+   playlist_buf_append(buf, &val, sizeof(val));
+}
+
+static void playlist_buf_append_string(playlist_buf_t *buf, const char *str)
+{
+   if (!str)
+   {
+      playlist_buf_append_uint(buf, (uint32_t)~0);
+      return;
+   }
+
+   playlist_buf_append_uint(buf, (uint32_t)strlen(str));
+   playlist_buf_append(buf, str, strlen(str) + 1);
+}
+
+static void playlist_read_bytes(playlist_reader_t *reader,
+      void *data, size_t len)
+{
+   if (reader->error || reader->len - reader->pos < len)
+   {
+      reader->error = true;
+      memset(data, 0, len);
+      return;
+   }
+
+   memcpy(data, reader->data + reader->pos, len);
+   reader->pos += len;
+}
+
+static uint32_t playlist_read_uint(playlist_reader_t *reader)
+{
+   uint32_t val;
+   playlist_read_bytes(reader, &val, sizeof(val));
+   return val;
+}
+
+/* Returns a pointer into the data being read */
+static const char *playlist_read_string(playlist_reader_t *reader)
+{
+   const char *str;
+   uint32_t len = playlist_read_uint(reader);
+
+   if (reader->error || len == (uint32_t)~0)
+      return NULL;
+
+   if (     reader->len - reader->pos <= len
+         || reader->data[reader->pos + len] != '\0')
+   {
+      reader->error = true;
+      return NULL;
+   }
+
+   str          = (const char*)reader->data + reader->pos;
+   reader->pos += len + 1;
+   return str;
+}
+
+static uint32_t playlist_cache_add_string(uint8_t *pool, size_t *pos,
+      const char *str)
+{
+   uint32_t offset = (uint32_t)*pos;
+   size_t len      = strlen(str) + 1;
+
+   memcpy(pool + *pos, str, len);
+   *pos += len;
+   return offset;
+}
+
+/* Lays the entries of @playlist out as a sidecar for a playlist
+ * file whose contents have the CRC @file_crc */
+static void *playlist_cache_build(playlist_t *playlist, uint32_t file_crc,
+      int64_t *len)
+{
+   size_t i, j;
+   size_t pool_size                = 1;
+   size_t num_roms                 = 0;
+   size_t pos                      = 1;
+   size_t rom                      = 0;
+   size_t total                    = 0;
+   uint8_t *data                   = NULL;
+   uint8_t *pool                   = NULL;
+   uint32_t *roms                  = NULL;
+   playlist_cache_header_t *header = NULL;
+   playlist_cache_entry_t *entries = NULL;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry = &playlist->entries[i];
+
+      for (j = 0; j < ARRAY_SIZE(playlist_entry_strings); j++)
+         if (PLAYLIST_ENTRY_STRING(entry, j))
+            pool_size += strlen(PLAYLIST_ENTRY_STRING(entry, j)) + 1;
+
+      if (entry->subsystem_roms)
+      {
+         for (j = 0; j < entry->subsystem_roms->size; j++)
+            pool_size += strlen(entry->subsystem_roms->elems[j].data) + 1;
+         num_roms += entry->subsystem_roms->size;
+      }
+   }
+
+   if (pool_size > UINT32_MAX)
+      return NULL;
+
+   total = sizeof(*header) + playlist->size * sizeof(*entries)
+      + num_roms * sizeof(*roms) + pool_size;
+
+   if (!(data = (uint8_t*)calloc(1, total)))
+      return NULL;
+
+   header  = (playlist_cache_header_t*)data;
+   entries = (playlist_cache_entry_t*)(header + 1);
+   roms    = (uint32_t*)(entries + playlist->size);
+   pool    = (uint8_t*)(roms + num_roms);
+
+   memcpy(header->magic, PLAYLIST_CACHE_MAGIC, sizeof(header->magic));
+   header->version   = PLAYLIST_CACHE_VERSION;
+   header->count     = (uint32_t)playlist->size;
+   header->file_crc  = file_crc;
+   header->num_roms  = (uint32_t)num_roms;
+   header->pool_size = (uint32_t)pool_size;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      const struct playlist_entry *entry = &playlist->entries[i];
+      playlist_cache_entry_t *out        = &entries[i];
+
+      for (j = 0; j < ARRAY_SIZE(playlist_entry_strings); j++)
+         if (PLAYLIST_ENTRY_STRING(entry, j))
+            out->strings[j] = playlist_cache_add_string(pool, &pos,
+                  PLAYLIST_ENTRY_STRING(entry, j));
+
+      for (j = 0; j < ARRAY_SIZE(playlist_entry_numbers); j++)
+         out->numbers[j] = PLAYLIST_ENTRY_NUMBER(entry, j);
+
+      out->roms = (uint32_t)rom;
+
+      if (entry->subsystem_roms)
+      {
+         out->num_roms = (uint32_t)entry->subsystem_roms->size;
+         for (j = 0; j < entry->subsystem_roms->size; j++)
+            roms[rom++] = playlist_cache_add_string(pool, &pos,
+                  entry->subsystem_roms->elems[j].data);
+      }
+   }
+
+   *len = (int64_t)total;
+   return data;
+}
+
+/* Loads the entries from the sidecar if it matches the playlist
+ * file, the strings are left in the pool */
+static bool playlist_cache_load(playlist_t *playlist,
+      int64_t file_size, int64_t file_mtime)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   size_t i, j;
+   void *buf                             = NULL;
+   int64_t len                           = 0;
+   const uint8_t *pool                   = NULL;
+   const uint32_t *roms                  = NULL;
+   const playlist_cache_entry_t *entries = NULL;
+   playlist_cache_header_t header;
+
+   playlist_get_aux_path(playlist, FILE_PATH_PLAYLIST_CACHE_EXTENSION,
+         cache_path, sizeof(cache_path));
+
+   if (!path_is_valid(cache_path)
+         || !filestream_read_file(cache_path, &buf, &len))
+      return false;
+
+   if ((size_t)len < sizeof(header))
+      goto error;
+
+   memcpy(&header, buf, sizeof(header));
+
+   if (     memcmp(header.magic, PLAYLIST_CACHE_MAGIC, sizeof(header.magic))
+         || header.version    != PLAYLIST_CACHE_VERSION
+         || header.file_size  != file_size
+         || header.file_mtime != file_mtime
+         || header.pool_size  == 0
+         || (uint64_t)len     <  sizeof(header)
+            + (uint64_t)header.count     * sizeof(*entries)
+            + (uint64_t)header.num_roms  * sizeof(*roms)
+            + header.pool_size)
+      goto error;
+
+   entries = (const playlist_cache_entry_t*)((const uint8_t*)buf
+         + sizeof(header));
+   roms    = (const uint32_t*)(entries + header.count);
+   pool    = (const uint8_t*)(roms + header.num_roms);
+
+   if (pool[header.pool_size - 1] != '\0')
+      goto error;
+
+   for (i = 0; i < header.num_roms; i++)
+      if (roms[i] == 0 || roms[i] >= header.pool_size)
+         goto error;
+
+   for (i = 0; i < header.count && playlist->size < playlist->cap; i++)
+   {
+      const playlist_cache_entry_t *in = &entries[i];
+      struct playlist_entry *entry     = &playlist->entries[playlist->size];
+
+      if (     in->num_roms > header.num_roms
+            || in->roms > header.num_roms - in->num_roms)
+         goto error;
+
+      for (j = 0; j < ARRAY_SIZE(playlist_entry_strings); j++)
+      {
+         if (in->strings[j] >= header.pool_size)
+            goto error;
+         PLAYLIST_ENTRY_STRING(entry, j) = in->strings[j]
+            ? (char*)pool + in->strings[j] : NULL;
+      }
+
+      for (j = 0; j < ARRAY_SIZE(playlist_entry_numbers); j++)
+         PLAYLIST_ENTRY_NUMBER(entry, j) = in->numbers[j];
+
+      if (in->num_roms)
+      {
+         union string_list_elem_attr attr = {0};
+
+         entry->subsystem_roms = string_list_new();
+
+         for (j = 0; j < in->num_roms; j++)
+            string_list_append(entry->subsystem_roms,
+                  (const char*)pool + roms[in->roms + j], attr);
+      }
+
+      playlist->size++;
+   }
+
+   playlist->cache     = buf;
+   playlist->pool      = (char*)pool;
+   playlist->pool_size = header.pool_size;
+   playlist->file_size = file_size;
+   playlist->file_crc  = header.file_crc;
+
+   return true;
+
+error:
+   RARCH_WARN("Ignoring invalid playlist cache \"%s\".\n", cache_path);
+
+   /* The strings of what was loaded point into the buffer */
+   for (i = 0; i < playlist->size; i++)
+   {
+      if (playlist->entries[i].subsystem_roms)
+         string_list_free(playlist->entries[i].subsystem_roms);
+      memset(&playlist->entries[i], 0, sizeof(playlist->entries[i]));
+   }
+   playlist->size = 0;
+
+   free(buf);
+   return false;
+}
+
+/* Writes @data to a temporary file first, so that the file at
+ * @path is never seen half written */
+static bool playlist_write_atomic(const char *path,
+      const void *data, int64_t size)
+{
+   char tmp_path[PATH_MAX_LENGTH];
+
+   strlcpy(tmp_path, path, sizeof(tmp_path));
+   strlcat(tmp_path, ".tmp", sizeof(tmp_path));
+
+   if (filestream_write_file(tmp_path, data, size))
+   {
+#ifdef _WIN32
+      filestream_delete(path);
+#endif
+      if (filestream_rename(tmp_path, path) == 0)
+         return true;
+      filestream_delete(tmp_path);
+   }
+
+   return filestream_write_file(path, data, size);
+}
+
+static void playlist_write_job_free(playlist_write_job_t *job)
+{
+   free(job->path);
+   free(job->cache_path);
+   free(job->data);
+   free(job->cache);
+   free(job);
+}
+
+static void playlist_write_job_run(playlist_write_job_t *job)
+{
+   job->ok = true;
+
+   if (job->data)
+   {
+      playlist_cache_header_t *header = (playlist_cache_header_t*)job->cache;
+
+      /* The sidecar can't be trusted while the playlist file
+       * changes, modification times are only down to the second */
+      filestream_delete(job->cache_path);
+
+      if (!playlist_write_atomic(job->path, job->data, job->size))
+      {
+         RARCH_ERR("Failed to write to playlist file: %s\n", job->path);
+         job->ok = false;
+         return;
+      }
+
+      RARCH_LOG("Written to playlist file: %s\n", job->path);
+
+      if (header && !path_get_size_mtime(job->path,
+               &header->file_size, &header->file_mtime))
+         return;
+   }
+
+   if (job->cache)
+      playlist_write_atomic(job->cache_path, job->cache, job->cache_size);
+}
+
+#ifdef HAVE_THREADS
+static void playlist_writer_thread(void *data)
+{
+   playlist_write_job_run((playlist_write_job_t*)data);
+}
+#endif
+
+/* Applies the result of a finished write. What the journal
+ * recorded is only dropped once it made it to the new file. */
+static bool playlist_writer_finish(playlist_t *playlist)
+{
+   playlist_write_job_t *job = playlist->writer_job;
+   bool ret                  = false;
+
+   if (!job)
+      return true;
+
+   playlist->writer_job = NULL;
+   ret                  = job->ok;
+
+   if (job->data)
+   {
+      if (job->ok)
+      {
+         playlist_journal_remove(playlist);
+         playlist->file_size       = job->size;
+         playlist->file_crc        = job->crc;
+         playlist->journal_allowed = true;
+      }
+      else
+         playlist->modified        = true;
+   }
+
+   playlist_write_job_free(job);
+   return ret;
+}
+
+static void playlist_writer_join(playlist_t *playlist)
+{
+#ifdef HAVE_THREADS
+   if (playlist->writer)
+      sthread_join(playlist->writer);
+   playlist->writer = NULL;
+#endif
+   playlist_writer_finish(playlist);
+}
+
+static bool playlist_writer_start(playlist_t *playlist,
+      playlist_write_job_t *job, bool background)
+{
+   playlist_writer_join(playlist);
+
+   playlist->writer_job = job;
+
+#ifdef HAVE_THREADS
+   if (background
+         && (playlist->writer = sthread_create(playlist_writer_thread, job)))
+      return true;
+#endif
+
+   playlist_write_job_run(job);
+   return playlist_writer_finish(playlist);
+}
+
+/* Writes the sidecar of what was just read from the playlist file */
+static void playlist_cache_save(playlist_t *playlist,
+      int64_t file_size, int64_t file_mtime)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   playlist_cache_header_t *header = NULL;
+   playlist_write_job_t *job       = (playlist_write_job_t*)
+      calloc(1, sizeof(*job));
+
+   if (!job)
+      return;
+
+   playlist_get_aux_path(playlist, FILE_PATH_PLAYLIST_CACHE_EXTENSION,
+         cache_path, sizeof(cache_path));
+
+   job->cache_path = strdup(cache_path);
+   job->cache      = playlist_cache_build(playlist, playlist->file_crc,
+         &job->cache_size);
+
+   if (!job->cache_path || !job->cache)
+   {
+      playlist_write_job_free(job);
+      return;
+   }
+
+   header             = (playlist_cache_header_t*)job->cache;
+   header->file_size  = file_size;
+   header->file_mtime = file_mtime;
+
+   playlist_writer_start(playlist, job, true);
+}
+
+static void playlist_journal_remove(playlist_t *playlist)
+{
+   char journal_path[PATH_MAX_LENGTH];
+
+   if (playlist->journal_records == 0)
+      return;
+
+   playlist_get_aux_path(playlist, FILE_PATH_PLAYLIST_JOURNAL_EXTENSION,
+         journal_path, sizeof(journal_path));
+   filestream_delete(journal_path);
+
+   playlist->journal_records = 0;
+}
+
+static void playlist_journal_add_entry(playlist_buf_t *buf,
+      const struct playlist_entry *entry)
+{
+   size_t i;
+
+   for (i = 0; i < ARRAY_SIZE(playlist_entry_strings); i++)
+      playlist_buf_append_string(buf, PLAYLIST_ENTRY_STRING(entry, i));
+
+   if (!entry->subsystem_roms)
+   {
+      playlist_buf_append_uint(buf, (uint32_t)~0);
+      return;
+   }
+
+   playlist_buf_append_uint(buf, (uint32_t)entry->subsystem_roms->size);
+
+   for (i = 0; i < entry->subsystem_roms->size; i++)
+      playlist_buf_append_string(buf, entry->subsystem_roms->elems[i].data);
+}
+
+/* Records a push or an update instead of writing the playlist
+ * file, returns false if the playlist file has to be written */
+static bool playlist_journal_append(playlist_t *playlist,
+      enum playlist_journal_type type, size_t idx,
+      const struct playlist_entry *entry)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   RFILE *file          = NULL;
+   playlist_buf_t buf   = {0};
+   bool ret             = false;
+#ifdef RARCH_INTERNAL
+   settings_t *settings = config_get_ptr();
+
+   /* Only the new format is journaled */
+   if (settings->bools.playlist_use_old_format)
+      return false;
+#endif
+
+   if (!playlist->journal_allowed)
+      return false;
+
+   playlist_get_aux_path(playlist, FILE_PATH_PLAYLIST_JOURNAL_EXTENSION,
+         journal_path, sizeof(journal_path));
+
+   if (playlist->journal_records == 0)
+   {
+      playlist_buf_append(&buf, PLAYLIST_JOURNAL_MAGIC, 8);
+      playlist_buf_append_uint(&buf, PLAYLIST_JOURNAL_VERSION);
+      playlist_buf_append(&buf, &playlist->file_size,
+            sizeof(playlist->file_size));
+      playlist_buf_append_uint(&buf, playlist->file_crc);
+   }
+
+   {
+      uint8_t record_type = (uint8_t)type;
+      playlist_buf_append(&buf, &record_type, sizeof(record_type));
+   }
+   playlist_buf_append_uint(&buf, (uint32_t)idx);
+   playlist_journal_add_entry(&buf, entry);
+
+   if (buf.error)
+      goto end;
+
+   if (playlist->journal_records == 0)
+      file = filestream_open(journal_path,
+            RETRO_VFS_FILE_ACCESS_WRITE,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   else if ((file = filestream_open(journal_path,
+               RETRO_VFS_FILE_ACCESS_READ_WRITE
+               | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      filestream_seek(file, 0, RETRO_VFS_SEEK_POSITION_END);
+
+   if (!file)
+      goto end;
+
+   ret = filestream_write(file, buf.data, buf.len) == (int64_t)buf.len;
+   filestream_close(file);
+
+   if (ret)
+      playlist->journal_records++;
+
+end:
+   free(buf.data);
+   return ret;
+}
+
+/* Reads an entry whose strings point into the journal */
+static bool playlist_journal_read_entry(playlist_reader_t *reader,
+      struct playlist_entry *entry)
+{
+   size_t i;
+   uint32_t num_roms;
+
+   for (i = 0; i < ARRAY_SIZE(playlist_entry_strings); i++)
+      PLAYLIST_ENTRY_STRING(entry, i) = (char*)playlist_read_string(reader);
+
+   num_roms = playlist_read_uint(reader);
+
+   if (reader->error || num_roms == (uint32_t)~0)
+      return !reader->error;
+
+   /* Every ROM takes more than a byte */
+   if (num_roms > reader->len - reader->pos)
+      return false;
+
+   entry->subsystem_roms = string_list_new();
+
+   for (i = 0; i < num_roms; i++)
+   {
+      union string_list_elem_attr attr = {0};
+      const char *rom                  = playlist_read_string(reader);
+
+      if (!rom)
+         return false;
+
+      string_list_append(entry->subsystem_roms, rom, attr);
+   }
+
+   return !reader->error;
+}
+
+/* Replays what was recorded since the playlist file was written */
+static void playlist_journal_replay(playlist_t *playlist)
+{
+   char journal_path[PATH_MAX_LENGTH];
+   char magic[8];
+   int64_t file_size          = 0;
+   void *buf                  = NULL;
+   int64_t len                = 0;
+   unsigned records           = 0;
+   bool complete              = false;
+   playlist_reader_t reader   = {0};
+
+   playlist_get_aux_path(playlist, FILE_PATH_PLAYLIST_JOURNAL_EXTENSION,
+         journal_path, sizeof(journal_path));
+
+   if (!path_is_valid(journal_path)
+         || !filestream_read_file(journal_path, &buf, &len))
+      return;
+
+   reader.data = (const uint8_t*)buf;
+   reader.len  = (size_t)len;
+
+   playlist_read_bytes(&reader, magic, sizeof(magic));
+
+   if (memcmp(magic, PLAYLIST_JOURNAL_MAGIC, sizeof(magic))
+         || playlist_read_uint(&reader) != PLAYLIST_JOURNAL_VERSION)
+      goto end;
+
+   playlist_read_bytes(&reader, &file_size, sizeof(file_size));
+
+   /* Written for another version of the playlist file */
+   if (     playlist_read_uint(&reader) != playlist->file_crc
+         || file_size != playlist->file_size
+         || reader.error)
+      goto end;
+
+   for (;;)
+   {
+      struct playlist_entry entry = {0};
+      uint8_t type                = 0;
+      uint32_t idx                = 0;
+      bool valid                  = false;
+
+      if (reader.pos == reader.len)
+      {
+         complete = true;
+         break;
+      }
+
+      playlist_read_bytes(&reader, &type, sizeof(type));
+      idx   = playlist_read_uint(&reader);
+      valid = playlist_journal_read_entry(&reader, &entry);
+
+      if (valid)
+      {
+         switch (type)
+         {
+            case PLAYLIST_JOURNAL_PUSH:
+               playlist_push(playlist, &entry);
+               break;
+            case PLAYLIST_JOURNAL_UPDATE:
+               if (idx < playlist->size)
+                  playlist_update(playlist, idx, &entry);
+               break;
+            default:
+               valid = false;
+               break;
+         }
+      }
+
+      if (entry.subsystem_roms)
+         string_list_free(entry.subsystem_roms);
+
+      if (!valid)
+         break;
+
+      records++;
+   }
+
+end:
+   free(buf);
+
+   playlist->journal_records = records;
+   playlist->modified        = false;
+
+   if (complete && records)
+      return;
+
+   /* Cut short by a crash, keep what could be replayed */
+   if (records)
+   {
+      RARCH_WARN("Playlist journal \"%s\" is incomplete.\n", journal_path);
+      playlist_write_file_format(playlist, true);
+      return;
+   }
+
+   /* Stale or empty */
+   playlist->journal_records = 0;
+   filestream_delete(journal_path);
+}
+
+static bool playlist_write(playlist_t *playlist, bool background)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   JSONContext context       = {0};
+   playlist_buf_t buf        = {0};
+   playlist_write_job_t *job = NULL;
+   uint32_t file_crc         = 0;
+
+   context.writer            = JSON_Writer_Create(NULL);
+   context.buf               = &buf;
+
+   if (!context.writer)
+   {
+      RARCH_ERR("Failed to create JSON writer\n");
+      return false;
+   }
+
+   JSON_Writer_SetOutputEncoding(context.writer, JSON_UTF8);
+   JSON_Writer_SetOutputHandler(context.writer, &JSONOutputHandler);
+   JSON_Writer_SetUserData(context.writer, &context);
+
+   playlist_write_json(playlist, context.writer);
+
+   if (JSON_Writer_GetError(context.writer) != JSON_Error_None || buf.error)
+   {
+      JSONLogError(&context);
+      JSON_Writer_Free(context.writer);
+      free(buf.data);
+      return false;
+   }
+
+   JSON_Writer_Free(context.writer);
+
+   if (!(job = (playlist_write_job_t*)calloc(1, sizeof(*job))))
+   {
+      free(buf.data);
+      return false;
+   }
+
+   playlist_get_aux_path(playlist, FILE_PATH_PLAYLIST_CACHE_EXTENSION,
+         cache_path, sizeof(cache_path));
+
+   file_crc        = encoding_crc32(0, buf.data, buf.len);
+   job->path       = strdup(playlist->conf_path);
+   job->cache_path = strdup(cache_path);
+   job->data       = buf.data;
+   job->size       = (int64_t)buf.len;
+   job->crc        = file_crc;
+   job->cache      = playlist_cache_build(playlist, file_crc,
+         &job->cache_size);
+
+   /* Changes from here on are not in the new file, set again
+    * if writing it fails */
+   playlist->modified = false;
+
+   return playlist_writer_start(playlist, job, background);
+}
+
+/* Records an update of @playlist made by @type in the journal,
+ * or writes the playlist file if that's not possible */
+static void playlist_write_update(playlist_t *playlist,
+      bool was_modified, enum playlist_journal_type type, size_t idx,
+      const struct playlist_entry *entry)
+{
+   if (was_modified || !playlist_journal_append(playlist, type, idx, entry))
+   {
+      playlist_write_file(playlist);
+      return;
+   }
+
+   playlist->modified = false;
+
+   if (playlist->journal_records >= PLAYLIST_JOURNAL_MAX)
+      playlist_write_file_format(playlist, true);
+}
+
+void playlist_write_file(playlist_t *playlist)
+{
+   if (!playlist)
+      return;
+
+   /* A failed write marks it modified again */
+   playlist_writer_join(playlist);
+
+   if (!playlist->modified)
+      return;
+
+   playlist_write_file_format(playlist, false);
+}
+
+/* Writes @playlist in the configured format, the JSON one on a
+ * thread if @background */
+static void playlist_write_file_format(playlist_t *playlist,
+      bool background)
+{
+#ifdef RARCH_INTERNAL
+   settings_t *settings = config_get_ptr();
+#endif
+
+   playlist_writer_join(playlist);
+
+#ifdef RARCH_INTERNAL
+   if (settings->bools.playlist_use_old_format)
+   {
+      size_t i;
+      char cache_path[PATH_MAX_LENGTH];
+      RFILE *file = filestream_open(playlist->conf_path,
+            RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+      if (!file)
+      {
+         RARCH_ERR("Failed to write to playlist file: %s\n", playlist->conf_path);
+         return;
+      }
+
+      for (i = 0; i < playlist->size; i++)
+         filestream_printf(file, "%s\n%s\n%s\n%s\n%s\n%s\n",
+               playlist->entries[i].path    ? playlist->entries[i].path    : "",
+               playlist->entries[i].label   ? playlist->entries[i].label   : "",
+               playlist->entries[i].core_path,
+               playlist->entries[i].core_name,
+               playlist->entries[i].crc32   ? playlist->entries[i].crc32   : "",
+               playlist->entries[i].db_name ? playlist->entries[i].db_name : ""
+               );
+
+      filestream_close(file);
+
+      /* Only the new format has a sidecar and a journal */
+      playlist_journal_remove(playlist);
+      playlist_get_aux_path(playlist, FILE_PATH_PLAYLIST_CACHE_EXTENSION,
+            cache_path, sizeof(cache_path));
+      filestream_delete(cache_path);
+
+      playlist->journal_allowed = false;
+      playlist->modified        = false;
+
+      RARCH_LOG("Written to playlist file: %s\n", playlist->conf_path);
+      return;
+   }
+#endif
+
+   playlist_write(playlist, background);
+}
+
+/**
+ * playlist_free:
+ * @playlist            : Playlist handle.
+ *
+ * Frees playlist handle.
+ */
+void playlist_free(playlist_t *playlist)
+{
+   size_t i;
+
+   if (!playlist)
+      return;
+
+   playlist_writer_join(playlist);
+
+   if (playlist->conf_path != NULL)
+      free(playlist->conf_path);
+
+   playlist->conf_path = NULL;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      struct playlist_entry *entry = &playlist->entries[i];
+
+      if (entry)
+         playlist_free_entry(playlist, entry);
+   }
+
+   free(playlist->entries);
+   playlist->entries = NULL;
+
+   free(playlist->cache);
+   playlist->cache   = NULL;
+   playlist->pool    = NULL;
+
+   free(playlist);
+}
+
+/**
+ * playlist_clear:
+ * @playlist        	   : Playlist handle.
+ *
+ * Clears all playlist entries in playlist.
+ **/
+void playlist_clear(playlist_t *playlist)
+{
+   size_t i;
+   if (!playlist)
+      return;
+
+   for (i = 0; i < playlist->size; i++)
+   {
+      struct playlist_entry *entry = &playlist->entries[i];
+
+      if (entry)
+         playlist_free_entry(playlist, entry);
+   }
+   playlist->size = 0;
+}
+
+/**
+ * playlist_size:
+ * @playlist        	   : Playlist handle.
+ *
+ * Gets size of playlist.
  * Returns: size of playlist.
  **/
 size_t playlist_size(playlist_t *playlist)
@@ -1711,63 +2706,61 @@ static bool playlist_read_file(
       playlist_t *playlist, const char *path)
 {
    unsigned i;
-   bool new_format = true;
-   RFILE *file = filestream_open(path,
-         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   int64_t file_size  = 0;
+   int64_t file_mtime = 0;
+   int64_t len        = 0;
+   void *data         = NULL;
+   bool new_format    = true;
+   bool has_mtime     = path_get_size_mtime(path, &file_size, &file_mtime);
+
+   if (has_mtime && playlist_cache_load(playlist, file_size, file_mtime))
+      goto replay;
 
    /* If playlist file does not exist,
     * create an empty playlist instead.
     */
-   if (!file)
-      return true;
-
-   /* Detect format of playlist */
-   {
-      char buf[16] = {0};
-      int64_t bytes_read = filestream_read(file, buf, 15);
+   if (!path_is_valid(path) || !filestream_read_file(path, &data, &len))
+      goto replay;
 
-      /* Empty playlist file */
-      if (bytes_read == 0)
-      {
-         filestream_close(file);
-         return true;
-      }
+   playlist->file_size = len;
+   playlist->file_crc  = encoding_crc32(0, (const uint8_t*)data, (size_t)len);
 
-      filestream_seek(file, 0, SEEK_SET);
+   /* Empty playlist file */
+   if (len == 0)
+      goto replay;
 
-      if (bytes_read == 15)
+   /* Detect format of playlist */
+   if (len >= 15)
+   {
+      if (!strncmp((const char*)data, "{\n  \"version\": ", 15))
       {
-         if (string_is_equal(buf, "{\n  \"version\": "))
-         {
-            /* new playlist format detected */
-            /*RARCH_LOG("New playlist format detected.\n");*/
-            new_format = true;
-         }
-         else
-         {
-            /* old playlist format detected */
-            /*RARCH_LOG("Old playlist format detected.\n");*/
-            new_format = false;
-         }
+         /* new playlist format detected */
+         /*RARCH_LOG("New playlist format detected.\n");*/
+         new_format = true;
       }
       else
       {
-         /* corrupt playlist? */
-         RARCH_ERR("Could not detect playlist format.\n");
+         /* old playlist format detected */
+         /*RARCH_LOG("Old playlist format detected.\n");*/
+         new_format = false;
       }
    }
+   else
+   {
+      /* corrupt playlist? */
+      RARCH_ERR("Could not detect playlist format.\n");
+   }
 
    if (new_format)
    {
       JSONContext context = {0};
       context.parser = JSON_Parser_Create(NULL);
-      context.file = file;
       context.playlist = playlist;
 
       if (!context.parser)
       {
          RARCH_ERR("Failed to create JSON parser\n");
-         goto end;
+         goto replay;
       }
 
 #if 0
@@ -1796,34 +2789,15 @@ static bool playlist_read_file(
       JSON_Parser_SetEndArrayHandler(context.parser,      &JSONEndArrayHandler);
       JSON_Parser_SetUserData(context.parser, &context);
 
-      while (!filestream_eof(file))
-      {
-         char chunk[4096] = {0};
-         int64_t length = filestream_read(file, chunk, sizeof(chunk));
-
-         if (!length && !filestream_eof(file))
-         {
-            RARCH_WARN("Could not read JSON input.\n");
-            JSON_Parser_Free(context.parser);
-            goto end;
-         }
-
-         if (!JSON_Parser_Parse(context.parser, chunk, length, JSON_False))
-         {
-            RARCH_WARN("Error parsing chunk:\n---snip---\n%s\n---snip---\n", chunk);
-            JSONLogError(&context);
-            JSON_Parser_Free(context.parser);
-            goto end;
-         }
-      }
-
-      if (!JSON_Parser_Parse(context.parser, NULL, 0, JSON_True))
+      /* The whole file is in memory, parse it in one go */
+      if (!JSON_Parser_Parse(context.parser,
+               (const char*)data, (size_t)len, JSON_True))
       {
          RARCH_WARN("Error parsing JSON.\n");
          JSONLogError(&context);
-         JSON_Parser_Free(context.parser);
-         goto end;
       }
+      else if (has_mtime)
+         playlist_cache_save(playlist, file_size, file_mtime);
 
       JSON_Parser_Free(context.parser);
 
@@ -1836,6 +2810,14 @@ static bool playlist_read_file(
    else
    {
       char buf[PLAYLIST_ENTRIES][1024] = {{0}};
+      RFILE *file = filestream_open(path,
+            RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+      /* Only the new format is journaled */
+      playlist->journal_allowed = false;
+
+      if (!file)
+         goto end;
 
       for (i = 0; i < PLAYLIST_ENTRIES; i++)
          buf[i][0] = '\0';
@@ -1850,7 +2832,7 @@ static bool playlist_read_file(
             *buf[i]     = '\0';
 
             if (!filestream_gets(file, buf[i], sizeof(buf[i])))
-               goto end;
+               goto old_end;
 
             /* Read playlist entry and terminate string with NUL character
              * regardless of Windows or Unix line endings
@@ -1879,10 +2861,18 @@ static bool playlist_read_file(
             entry->db_name   = strdup(buf[5]);
          playlist->size++;
       }
+
+old_end:
+      filestream_close(file);
+      goto end;
    }
 
+replay:
+   if (playlist->journal_allowed)
+      playlist_journal_replay(playlist);
+
 end:
-   filestream_close(file);
+   free(data);
    return true;
 }
 
@@ -1932,11 +2922,22 @@ playlist_t *playlist_init(const char *path, size_t size)
       return NULL;
    }
 
-   playlist->modified  = false;
-   playlist->size      = 0;
-   playlist->cap       = size;
-   playlist->conf_path = strdup(path);
-   playlist->entries   = entries;
+   playlist->modified        = false;
+   playlist->journal_allowed = true;
+   playlist->journal_records = 0;
+   playlist->size            = 0;
+   playlist->cap             = size;
+   playlist->file_size       = -1;
+   playlist->file_crc        = 0;
+   playlist->cache           = NULL;
+   playlist->pool            = NULL;
+   playlist->pool_size       = 0;
+#ifdef HAVE_THREADS
+   playlist->writer          = NULL;
+#endif
+   playlist->writer_job      = NULL;
+   playlist->conf_path       = strdup(path);
+   playlist->entries         = entries;
 
    playlist_read_file(playlist, path);
 
@@ -2031,14 +3032,21 @@ void command_playlist_push_write(
       playlist_t *playlist,
       const struct playlist_entry *entry)
 {
+   bool was_modified;
+
    if (!playlist)
       return;
 
+   /* Whether the last write made it */
+   playlist_writer_join(playlist);
+   was_modified = playlist->modified;
+
    if (playlist_push(
          playlist,
          entry
          ))
-      playlist_write_file(playlist);
+      playlist_write_update(playlist, was_modified,
+            PLAYLIST_JOURNAL_PUSH, 0, entry);
 }
 
 void command_playlist_update_write(
@@ -2046,17 +3054,23 @@ void command_playlist_update_write(
       size_t idx,
       const struct playlist_entry *entry)
 {
+   bool was_modified;
    playlist_t *playlist = plist ? plist : playlist_get_cached();
 
    if (!playlist)
       return;
 
+   playlist_writer_join(playlist);
+   was_modified = playlist->modified;
+
    playlist_update(
          playlist,
          idx,
          entry);
 
-   playlist_write_file(playlist);
+   if (playlist->modified)
+      playlist_write_update(playlist, was_modified,
+            PLAYLIST_JOURNAL_UPDATE, idx, entry);
 }
 
 bool playlist_index_is_valid(playlist_t *playlist, size_t idx,
@@ -149,6 +149,16 @@ void playlist_get_index_by_path(playlist_t *playlist,
       const char *search_path,
       const struct playlist_entry **entry);
 
+/**
+ * playlist_delete_by_path:
+ * @playlist            : Playlist handle.
+ * @search_path         : Content path.
+ *
+ * Deletes every entry with the content path @search_path.
+ **/
+void playlist_delete_by_path(playlist_t *playlist,
+      const char *search_path);
+
 bool playlist_entry_exists(playlist_t *playlist,
       const char *path,
       const char *crc32);
@@ -23,8 +23,10 @@
 #include <compat/strl.h>
 
 #include <boolean.h>
+#include <retro_miscellaneous.h>
 #include <queues/fifo_queue.h>
 #include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
 #include <file/config_file.h>
@@ -125,15 +127,80 @@ extern "C" {
 #define av_frame_free avcodec_free_frame
 #endif
 
+/* Frames the frontend hands over, each copied once into a pool slot */
+#define FFMPEG_FRAME_POOL_SIZE 8
+/* Converted frames, shared by the encode queue and duped frames */
+#define FFMPEG_CONV_FRAMES 4
+#define FFMPEG_MAX_SCALE_THREADS 8
+
+struct ff_frame_slot
+{
+   uint8_t *data;
+   /* Queued or being converted when non-zero */
+   unsigned refs;
+};
+
+struct ff_video_packet
+{
+   struct record_video_data attr;
+   int64_t pts;
+   /* Pool slot or converted frame, -1 for a dupe without one */
+   int index;
+};
+
+/* sws converts one horizontal band of the frame per thread */
+struct ff_scale_band
+{
+   struct SwsContext *sws;
+   sthread_t *thread;
+   struct ffmpeg *handle;
+   unsigned index;
+};
+
 struct ff_video_info
 {
    AVCodecContext *codec;
    AVCodec *encoder;
 
-   AVFrame *conv_frame;
-   uint8_t *conv_frame_buf;
+   AVFrame *conv_frames[FFMPEG_CONV_FRAMES];
+   uint8_t *conv_frame_bufs[FFMPEG_CONV_FRAMES];
+   unsigned conv_refs[FFMPEG_CONV_FRAMES];
+   /* Last converted frame, re-encoded for dupes */
+   int last_conv;
    int64_t frame_cnt;
 
+   /* Timestamp of the next frame, dropped frames leave a gap */
+   int64_t frame_pts;
+   unsigned frames_pushed;
+   unsigned frames_dropped;
+
+   struct ff_frame_slot slots[FFMPEG_FRAME_POOL_SIZE];
+   size_t slot_size;
+
+   /* Frontend -> conversion stage */
+   struct ff_video_packet queue[FFMPEG_FRAME_POOL_SIZE];
+   unsigned queue_read;
+   unsigned queue_count;
+
+   /* Conversion stage -> encoder */
+   struct ff_video_packet encode_queue[FFMPEG_CONV_FRAMES];
+   unsigned encode_read;
+   unsigned encode_count;
+
+   sthread_t *conv_thread;
+   scond_t *conv_cond;
+
+   struct ff_scale_band bands[FFMPEG_MAX_SCALE_THREADS];
+   unsigned num_bands;
+   slock_t *scale_lock;
+   scond_t *scale_cond;
+   scond_t *scale_done_cond;
+   const struct record_video_data *scale_vid;
+   AVFrame *scale_frame;
+   unsigned scale_generation;
+   unsigned scale_pending;
+   bool scale_quit;
+
    uint8_t *outbuf;
    size_t outbuf_size;
 
@@ -201,6 +268,41 @@ struct ff_muxer_info
    AVStream *vstream;
 };
 
+/* Encoded packets from a video keyframe up to the next one,
+ * the smallest unit a replay can start from. */
+struct ff_replay_segment
+{
+   /* Keyframe timestamp, in the video stream time base */
+   int64_t start_ts;
+   double start;
+   size_t packets;
+   size_t bytes;
+};
+
+/* Replay buffer, holds the encoded output instead of the muxer */
+struct ff_replay_info
+{
+   AVPacket *packets;
+   size_t packets_head;
+   size_t packets_count;
+   size_t packets_cap;
+
+   struct ff_replay_segment *segments;
+   size_t segments_head;
+   size_t segments_count;
+   size_t segments_cap;
+
+   size_t bytes;
+   size_t budget;
+   double length;
+   double newest;
+
+   slock_t *lock;
+   sthread_t *save_thread;
+   /* Set until the save thread is done, under @lock */
+   bool saving;
+};
+
 struct ff_config_param
 {
    config_file_t *conf;
@@ -209,6 +311,10 @@ struct ff_config_param
    char format[64];
    enum PixelFormat out_pix_fmt;
    unsigned threads;
+   /* FF_THREAD_FRAME and/or FF_THREAD_SLICE for the video encoder */
+   int thread_type;
+   /* Threads converting frames with libswscale, 0 for one per core */
+   unsigned scale_threads;
    unsigned frame_drop_ratio;
    unsigned sample_rate;
    float scale_factor;
@@ -231,6 +337,7 @@ typedef struct ffmpeg
    struct ff_video_info video;
    struct ff_audio_info audio;
    struct ff_muxer_info muxer;
+   struct ff_replay_info replay;
    struct ff_config_param config;
 
    struct record_params params;
@@ -239,8 +346,6 @@ typedef struct ffmpeg
    slock_t *cond_lock;
    slock_t *lock;
    fifo_buffer_t *audio_fifo;
-   fifo_buffer_t *video_fifo;
-   fifo_buffer_t *attr_fifo;
    sthread_t *thread;
 
    volatile bool alive;
@@ -422,6 +527,7 @@ static bool ffmpeg_init_audio(ffmpeg_t *handle)
 
 static bool ffmpeg_init_video(ffmpeg_t *handle)
 {
+   unsigned i;
    size_t size;
    struct ff_config_param *params  = &handle->config;
    struct ff_video_info *video     = &handle->video;
@@ -521,6 +627,11 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
    video->codec->pix_fmt             = video->pix_fmt;
 
    video->codec->thread_count = params->threads;
+   video->codec->thread_type  = params->thread_type;
+
+   /* Replays start on a keyframe, keep them about a second apart */
+   if (handle->replay.lock)
+      video->codec->gop_size  = (int)(param->fps + 0.5);
 
    if (params->video_qscale)
    {
@@ -546,15 +657,57 @@ static bool ffmpeg_init_video(ffmpeg_t *handle)
 
    size = avpicture_get_size(video->pix_fmt, param->out_width,
          param->out_height);
-   video->conv_frame_buf = (uint8_t*)av_malloc(size);
-   video->conv_frame = av_frame_alloc();
 
-   avpicture_fill((AVPicture*)video->conv_frame, video->conv_frame_buf,
-         video->pix_fmt, param->out_width, param->out_height);
+   for (i = 0; i < FFMPEG_CONV_FRAMES; i++)
+   {
+      video->conv_frame_bufs[i] = (uint8_t*)av_malloc(size);
+      video->conv_frames[i]     = av_frame_alloc();
+      if (!video->conv_frame_bufs[i] || !video->conv_frames[i])
+         return false;
+
+      avpicture_fill((AVPicture*)video->conv_frames[i],
+            video->conv_frame_bufs[i],
+            video->pix_fmt, param->out_width, param->out_height);
+
+      video->conv_frames[i]->width  = param->out_width;
+      video->conv_frames[i]->height = param->out_height;
+      video->conv_frames[i]->format = video->pix_fmt;
+   }
+   video->last_conv = -1;
 
-   video->conv_frame->width  = param->out_width;
-   video->conv_frame->height = param->out_height;
-   video->conv_frame->format = video->pix_fmt;
+   /* Frames are packed tightly, libretro tends to use a very large pitch */
+   video->slot_size = param->fb_width * param->fb_height * video->pix_size;
+   for (i = 0; i < FFMPEG_FRAME_POOL_SIZE; i++)
+   {
+      video->slots[i].data = (uint8_t*)av_malloc(video->slot_size);
+      if (!video->slots[i].data)
+         return false;
+   }
+
+   /* Frames that only need colour conversion are split into bands,
+    * see ffmpeg_scale_input */
+   video->num_bands = params->scale_threads ?
+      params->scale_threads : cpu_features_get_core_amount();
+   if (video->num_bands > FFMPEG_MAX_SCALE_THREADS)
+      video->num_bands = FFMPEG_MAX_SCALE_THREADS;
+   if (!video->use_sws || video->num_bands < 1)
+      video->num_bands = 1;
+   else
+   {
+      const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(video->pix_fmt);
+      int pal_flags                  = AV_PIX_FMT_FLAG_PAL;
+#ifdef AV_PIX_FMT_FLAG_PSEUDOPAL
+      pal_flags                     |= AV_PIX_FMT_FLAG_PSEUDOPAL;
+#endif
+      if (!desc || (desc->flags & pal_flags))
+         video->num_bands = 1;
+   }
+
+   for (i = 0; i < video->num_bands; i++)
+   {
+      video->bands[i].handle = handle;
+      video->bands[i].index  = i;
+   }
 
    return true;
 }
@@ -712,6 +865,14 @@ static bool ffmpeg_init_config_common(struct ff_config_param *params, unsigned p
          break;
    }
 
+   /* Frame threading delays output by a frame per thread,
+    * which streams can't afford */
+   if (preset >= RECORD_CONFIG_TYPE_STREAMING_LOW_QUALITY)
+      params->thread_type = FF_THREAD_SLICE;
+   else
+      params->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+   params->scale_threads  = params->threads;
+
    if (preset <= RECORD_CONFIG_TYPE_RECORDING_LOSSLESS_QUALITY)
    {
       if (!settings->bools.video_gpu_record)
@@ -793,6 +954,8 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
    params->out_pix_fmt      = PIX_FMT_NONE;
    params->scale_factor     = 1;
    params->threads          = 1;
+   params->thread_type      = FF_THREAD_FRAME | FF_THREAD_SLICE;
+   params->scale_threads    = 1;
    params->frame_drop_ratio = 1;
    params->audio_enable     = true;
 
@@ -815,6 +978,7 @@ static bool ffmpeg_init_config(struct ff_config_param *params,
          sizeof(params->format));
 
    config_get_uint(params->conf, "threads", &params->threads);
+   config_get_uint(params->conf, "scale_threads", &params->scale_threads);
 
    if (!config_get_uint(params->conf, "frame_drop_ratio",
             &params->frame_drop_ratio) || !params->frame_drop_ratio)
@@ -876,7 +1040,16 @@ static bool ffmpeg_init_muxer_pre(ffmpeg_t *handle)
    if (!ctx->oformat)
       return false;
 
-   if (avio_open(&ctx->pb, ctx->filename, AVIO_FLAG_WRITE) < 0)
+   /* A replay buffer only writes when the replay is saved */
+   if (handle->params.replay_length)
+   {
+      handle->replay.length = handle->params.replay_length;
+      handle->replay.budget = handle->params.replay_budget;
+      handle->replay.lock   = slock_new();
+      if (!handle->replay.lock)
+         return false;
+   }
+   else if (avio_open(&ctx->pb, ctx->filename, AVIO_FLAG_WRITE) < 0)
    {
       av_free(ctx);
       return false;
@@ -909,37 +1082,66 @@ static bool ffmpeg_init_muxer_post(ffmpeg_t *handle)
    av_dict_set(&handle->muxer.ctx->metadata, "title",
          "RetroArch Video Dump", 0);
 
+   /* Packets stay in the codec time base until a replay is saved */
+   if (handle->replay.lock)
+      return true;
+
    return avformat_write_header(handle->muxer.ctx, NULL) >= 0;
 }
 
 #define MAX_FRAMES 32
 
 static void ffmpeg_thread(void *data);
+static void ffmpeg_convert_thread(void *data);
+static void ffmpeg_scale_band_thread(void *data);
+static void ffmpeg_replay_free(struct ff_replay_info *replay);
 
 static bool init_thread(ffmpeg_t *handle)
 {
+   unsigned i;
+   struct ff_video_info *video = &handle->video;
+
    handle->lock = slock_new();
    handle->cond_lock = slock_new();
    handle->cond = scond_new();
    handle->audio_fifo = fifo_new(32000 * sizeof(int16_t) *
          handle->params.channels * MAX_FRAMES / 60); /* Some arbitrary max size. */
-   handle->attr_fifo = fifo_new(sizeof(struct record_video_data) * MAX_FRAMES);
-   handle->video_fifo = fifo_new(handle->params.fb_width * handle->params.fb_height *
-            handle->video.pix_size * MAX_FRAMES);
+   video->conv_cond = scond_new();
+
+   retro_assert(handle->lock && handle->cond_lock &&
+      handle->cond && handle->audio_fifo && video->conv_cond);
 
    handle->alive = true;
    handle->can_sleep = true;
-   handle->thread = sthread_create(ffmpeg_thread, handle);
 
-   retro_assert(handle->lock && handle->cond_lock &&
-      handle->cond && handle->audio_fifo &&
-      handle->attr_fifo && handle->video_fifo && handle->thread);
+   if (video->num_bands > 1)
+   {
+      video->scale_lock      = slock_new();
+      video->scale_cond      = scond_new();
+      video->scale_done_cond = scond_new();
+
+      retro_assert(video->scale_lock && video->scale_cond &&
+            video->scale_done_cond);
+
+      /* Band 0 is converted by the conversion thread itself */
+      for (i = 1; i < video->num_bands; i++)
+         video->bands[i].thread = sthread_create(
+               ffmpeg_scale_band_thread, &video->bands[i]);
+   }
+
+   video->conv_thread = sthread_create(ffmpeg_convert_thread, handle);
+   handle->thread     = sthread_create(ffmpeg_thread, handle);
+
+   retro_assert(video->conv_thread && handle->thread);
 
    return true;
 }
 
 static void deinit_thread(ffmpeg_t *handle)
 {
+   unsigned i;
+   struct ff_video_info *video = &handle->video;
+
    if (!handle->thread)
       return;
 
@@ -951,42 +1153,67 @@ static void deinit_thread(ffmpeg_t *handle)
    scond_signal(handle->cond);
    sthread_join(handle->thread);
 
-   slock_free(handle->lock);
-   slock_free(handle->cond_lock);
-   scond_free(handle->cond);
+   slock_lock(handle->lock);
+   scond_signal(video->conv_cond);
+   slock_unlock(handle->lock);
+   sthread_join(video->conv_thread);
+
+   if (video->scale_lock)
+   {
+      slock_lock(video->scale_lock);
+      video->scale_quit = true;
+      scond_broadcast(video->scale_cond);
+      slock_unlock(video->scale_lock);
+
+      for (i = 1; i < video->num_bands; i++)
+      {
+         if (video->bands[i].thread)
+            sthread_join(video->bands[i].thread);
+         video->bands[i].thread = NULL;
+      }
+   }
 
-   handle->thread = NULL;
+   handle->thread     = NULL;
+   video->conv_thread = NULL;
 }
 
 static void deinit_thread_buf(ffmpeg_t *handle)
 {
+   struct ff_video_info *video = &handle->video;
+
    if (handle->audio_fifo)
    {
       fifo_free(handle->audio_fifo);
       handle->audio_fifo = NULL;
    }
 
-   if (handle->attr_fifo)
-   {
-      fifo_free(handle->attr_fifo);
-      handle->attr_fifo = NULL;
-   }
-
-   if (handle->video_fifo)
-   {
-      fifo_free(handle->video_fifo);
-      handle->video_fifo = NULL;
-   }
+   slock_free(handle->lock);
+   slock_free(handle->cond_lock);
+   scond_free(handle->cond);
+   scond_free(video->conv_cond);
+   slock_free(video->scale_lock);
+   scond_free(video->scale_cond);
+   scond_free(video->scale_done_cond);
+
+   handle->lock           = NULL;
+   handle->cond_lock      = NULL;
+   handle->cond           = NULL;
+   video->conv_cond       = NULL;
+   video->scale_lock      = NULL;
+   video->scale_cond      = NULL;
+   video->scale_done_cond = NULL;
 }
 
 static void ffmpeg_free(void *data)
 {
+   unsigned i;
    ffmpeg_t *handle = (ffmpeg_t*)data;
    if (!handle)
       return;
 
    deinit_thread(handle);
    deinit_thread_buf(handle);
+   ffmpeg_replay_free(&handle->replay);
 
    if (handle->audio.codec)
    {
@@ -1002,14 +1229,24 @@ static void ffmpeg_free(void *data)
       av_free(handle->video.codec);
    }
 
-   av_frame_free(&handle->video.conv_frame);
-   av_free(handle->video.conv_frame_buf);
+   for (i = 0; i < FFMPEG_CONV_FRAMES; i++)
+   {
+      av_frame_free(&handle->video.conv_frames[i]);
+      av_free(handle->video.conv_frame_bufs[i]);
+   }
+
+   for (i = 0; i < FFMPEG_FRAME_POOL_SIZE; i++)
+      av_free(handle->video.slots[i].data);
 
    scaler_ctx_gen_reset(&handle->video.scaler);
 
    if (handle->video.sws)
       sws_freeContext(handle->video.sws);
 
+   for (i = 0; i < FFMPEG_MAX_SCALE_THREADS; i++)
+      if (handle->video.bands[i].sws)
+         sws_freeContext(handle->video.bands[i].sws);
+
    if (handle->config.conf)
       config_file_free(handle->config.conf);
    if (handle->config.video_opts)
@@ -1075,69 +1312,86 @@ error:
 static bool ffmpeg_push_video(void *data,
       const struct record_video_data *vid)
 {
-   unsigned y;
+   unsigned y, i;
    bool drop_frame;
-   struct record_video_data attr_data;
-   ffmpeg_t *handle = (ffmpeg_t*)data;
-   int       offset = 0;
+   struct ff_video_packet pkt;
+   struct ff_video_info *video = NULL;
+   ffmpeg_t *handle            = (ffmpeg_t*)data;
 
    if (!handle || !vid)
       return false;
 
-   drop_frame = handle->video.frame_drop_count++ %
-      handle->video.frame_drop_ratio;
+   video      = &handle->video;
+   drop_frame = video->frame_drop_count++ % video->frame_drop_ratio;
 
-   handle->video.frame_drop_count %= handle->video.frame_drop_ratio;
+   video->frame_drop_count %= video->frame_drop_ratio;
 
    if (drop_frame)
       return true;
 
-   for (;;)
-   {
-      unsigned avail;
-      slock_lock(handle->lock);
-      avail = fifo_write_avail(handle->attr_fifo);
-      slock_unlock(handle->lock);
+   if (!handle->alive)
+      return false;
 
-      if (!handle->alive)
-         return false;
+   pkt.attr  = *vid;
+   pkt.index = -1;
 
-      if (avail >= sizeof(*vid))
-         break;
+   if (pkt.attr.is_dupe)
+      pkt.attr.width = pkt.attr.height = pkt.attr.pitch = 0;
+   else
+      pkt.attr.pitch = pkt.attr.width * video->pix_size;
 
-      slock_lock(handle->cond_lock);
-      if (handle->can_sleep)
+   slock_lock(handle->lock);
+
+   pkt.pts = video->frame_pts++;
+   video->frames_pushed++;
+
+   if (!pkt.attr.is_dupe)
+   {
+      for (i = 0; i < FFMPEG_FRAME_POOL_SIZE; i++)
       {
-         handle->can_sleep = false;
-         scond_wait(handle->cond, handle->cond_lock);
-         handle->can_sleep = true;
+         if (!video->slots[i].refs)
+         {
+            pkt.index = i;
+            break;
+         }
       }
-      else
-         scond_signal(handle->cond);
+   }
 
-      slock_unlock(handle->cond_lock);
+   /* Never stall the emulation thread on the encoder. The frame is
+    * dropped instead, leaving a gap in the timestamps so audio stays
+    * in sync. */
+   if (     video->queue_count == FFMPEG_FRAME_POOL_SIZE
+         || (!pkt.attr.is_dupe && pkt.index < 0)
+         || (size_t)pkt.attr.pitch * pkt.attr.height > video->slot_size)
+   {
+      video->frames_dropped++;
+      slock_unlock(handle->lock);
+      return true;
    }
 
-   slock_lock(handle->lock);
+   if (pkt.index >= 0)
+      video->slots[pkt.index].refs = 1;
 
-   /* Tightly pack our frame to conserve memory.
-    * libretro tends to use a very large pitch.
-    */
-   attr_data = *vid;
+   slock_unlock(handle->lock);
 
-   if (attr_data.is_dupe)
-      attr_data.width = attr_data.height = attr_data.pitch = 0;
-   else
-      attr_data.pitch = attr_data.width * handle->video.pix_size;
+   /* The only copy of the frame, tightly packed into the pool slot */
+   if (pkt.index >= 0)
+   {
+      uint8_t *dst       = video->slots[pkt.index].data;
+      const uint8_t *src = (const uint8_t*)vid->data;
 
-   fifo_write(handle->attr_fifo, &attr_data, sizeof(attr_data));
+      for (y = 0; y < pkt.attr.height; y++, src += vid->pitch,
+            dst += pkt.attr.pitch)
+         memcpy(dst, src, pkt.attr.pitch);
 
-   for (y = 0; y < attr_data.height; y++, offset += vid->pitch)
-      fifo_write(handle->video_fifo,
-            (const uint8_t*)vid->data + offset, attr_data.pitch);
+      pkt.attr.data = video->slots[pkt.index].data;
+   }
 
+   slock_lock(handle->lock);
+   video->queue[(video->queue_read + video->queue_count++)
+      % FFMPEG_FRAME_POOL_SIZE] = pkt;
+   scond_signal(video->conv_cond);
    slock_unlock(handle->lock);
-   scond_signal(handle->cond);
 
    return true;
 }
@@ -1189,6 +1443,404 @@ static bool ffmpeg_push_audio(void *data,
    return true;
 }
 
+static bool ffmpeg_replay_reserve(void **buf, size_t *head,
+      size_t count, size_t *cap, size_t size)
+{
+   void *tmp;
+   size_t new_cap;
+
+   if (*head + count < *cap)
+      return true;
+
+   /* Reuse the space of evicted entries once it's worth the move */
+   if (*head && *head >= *cap / 2)
+   {
+      memmove(*buf, (uint8_t*)*buf + *head * size, count * size);
+      *head = 0;
+      return true;
+   }
+
+   new_cap = *cap ? *cap * 2 : 256;
+   tmp     = realloc(*buf, new_cap * size);
+   if (!tmp)
+      return false;
+
+   *buf = tmp;
+   *cap = new_cap;
+   return true;
+}
+
+/* Audio is encoded as soon as it arrives, video only after the
+ * conversion stage and the encoder delay. The audio of a new segment
+ * can therefore already sit at the end of the previous one; move it
+ * over, keeping the order of everything else. Called with the replay
+ * lock held and at least one segment. */
+static void ffmpeg_replay_split_audio(ffmpeg_t *handle, double start,
+      size_t *packets, size_t *bytes)
+{
+   size_t i;
+   struct ff_replay_info *replay = &handle->replay;
+   struct ff_replay_segment *prev = &replay->segments[
+      replay->segments_head + replay->segments_count - 1];
+   size_t end                    = replay->packets_head
+      + replay->packets_count;
+   /* Start of the audio moved so far */
+   size_t late                   = end - prev->packets;
+
+   *packets = 0;
+   *bytes   = 0;
+
+   for (i = end - prev->packets; i < end; i++)
+   {
+      AVPacket *pkt    = &replay->packets[i];
+      AVStream *stream = handle->muxer.ctx->streams[pkt->stream_index];
+      int64_t ts       = (pkt->pts != (int64_t)AV_NOPTS_VALUE)
+         ? pkt->pts : pkt->dts;
+
+      if (     stream != handle->muxer.vstream
+            && ts * av_q2d(stream->time_base) >= start)
+      {
+         (*packets)++;
+         *bytes += pkt->size;
+         continue;
+      }
+
+      if (i > late)
+      {
+         AVPacket tmp = *pkt;
+         memmove(&replay->packets[late + 1], &replay->packets[late],
+               (i - late) * sizeof(*pkt));
+         replay->packets[late] = tmp;
+      }
+      late++;
+   }
+
+   prev->packets -= *packets;
+   prev->bytes   -= *bytes;
+}
+
+/* Stores an encoded packet in the replay buffer. Runs on the
+ * encoder thread, saving a replay only takes references. */
+static bool ffmpeg_replay_push(ffmpeg_t *handle, AVPacket *pkt)
+{
+   void *buf;
+   AVPacket *dst;
+   struct ff_replay_segment *seg;
+   struct ff_replay_info *replay = &handle->replay;
+   AVStream *stream              = handle->muxer.ctx->streams[pkt->stream_index];
+   int64_t ts                    = (pkt->pts != (int64_t)AV_NOPTS_VALUE)
+      ? pkt->pts : pkt->dts;
+   double time                   = ts * av_q2d(stream->time_base);
+   bool ret                      = false;
+
+   slock_lock(replay->lock);
+
+   if (stream == handle->muxer.vstream && (pkt->flags & AV_PKT_FLAG_KEY))
+   {
+      size_t packets = 0;
+      size_t bytes   = 0;
+
+      buf = replay->segments;
+      if (!ffmpeg_replay_reserve(&buf, &replay->segments_head,
+               replay->segments_count, &replay->segments_cap,
+               sizeof(*replay->segments)))
+         goto end;
+      replay->segments = (struct ff_replay_segment*)buf;
+
+      if (replay->segments_count)
+         ffmpeg_replay_split_audio(handle, time, &packets, &bytes);
+
+      seg = &replay->segments[replay->segments_head + replay->segments_count++];
+      seg->start_ts = ts;
+      seg->start    = time;
+      seg->packets  = packets;
+      seg->bytes    = bytes;
+   }
+
+   /* Nothing before the first keyframe can be decoded */
+   if (!replay->segments_count)
+   {
+      ret = true;
+      goto end;
+   }
+
+   buf = replay->packets;
+   if (!ffmpeg_replay_reserve(&buf, &replay->packets_head,
+            replay->packets_count, &replay->packets_cap,
+            sizeof(*replay->packets)))
+      goto end;
+   replay->packets = (AVPacket*)buf;
+
+   dst = &replay->packets[replay->packets_head + replay->packets_count];
+   if (av_packet_ref(dst, pkt) < 0)
+      goto end;
+
+   replay->packets_count++;
+
+   seg = &replay->segments[replay->segments_head + replay->segments_count - 1];
+   seg->packets++;
+   seg->bytes    += pkt->size;
+   replay->bytes += pkt->size;
+
+   if (time > replay->newest)
+      replay->newest = time;
+
+   /* Evict whole segments while the rest still covers the replay
+    * length, or while over budget. The newest segment always stays,
+    * so the budget can be exceeded by up to one keyframe interval. */
+   while (replay->segments_count > 1)
+   {
+      size_t i;
+      struct ff_replay_segment *first =
+         &replay->segments[replay->segments_head];
+
+      if (     replay->bytes <= replay->budget
+            && replay->newest - first[1].start < replay->length)
+         break;
+
+      for (i = 0; i < first->packets; i++)
+         av_packet_unref(&replay->packets[replay->packets_head + i]);
+
+      replay->packets_head  += first->packets;
+      replay->packets_count -= first->packets;
+      replay->bytes         -= first->bytes;
+      replay->segments_head++;
+      replay->segments_count--;
+   }
+
+   ret = true;
+
+end:
+   slock_unlock(replay->lock);
+   return ret;
+}
+
+static void ffmpeg_replay_free(struct ff_replay_info *replay)
+{
+   size_t i;
+
+   if (replay->save_thread)
+      sthread_join(replay->save_thread);
+
+   for (i = 0; i < replay->packets_count; i++)
+      av_packet_unref(&replay->packets[replay->packets_head + i]);
+
+   free(replay->packets);
+   free(replay->segments);
+   slock_free(replay->lock);
+
+   memset(replay, 0, sizeof(*replay));
+}
+
+static int ffmpeg_write_packet(ffmpeg_t *handle, AVPacket *pkt)
+{
+   if (handle->replay.lock)
+      return ffmpeg_replay_push(handle, pkt) ? 0 : -1;
+   return av_interleaved_write_frame(handle->muxer.ctx, pkt);
+}
+
+struct ff_replay_job
+{
+   ffmpeg_t *handle;
+   AVPacket *packets;
+   size_t count;
+   int64_t start_ts;
+   char path[PATH_MAX_LENGTH];
+};
+
+static AVStream *ffmpeg_replay_new_stream(AVFormatContext *out,
+      AVCodec *encoder, AVCodecContext *codec)
+{
+   AVStream *stream = avformat_new_stream(out, encoder);
+
+   if (!stream)
+      return NULL;
+
+#if LIBAVFORMAT_VERSION_INT >= AV_VERSION_INT(57, 33, 100)
+   if (avcodec_parameters_from_context(stream->codecpar, codec) < 0)
+      return NULL;
+#else
+   if (avcodec_copy_context(stream->codec, codec) < 0)
+      return NULL;
+#endif
+
+   stream->time_base           = codec->time_base;
+   stream->sample_aspect_ratio = codec->sample_aspect_ratio;
+   return stream;
+}
+
+/* Muxes the packets of a replay into a new file. The codec contexts
+ * are only read, their parameters don't change once opened. */
+static void ffmpeg_replay_save_thread(void *data)
+{
+   size_t i;
+   struct ff_replay_job *job     = (struct ff_replay_job*)data;
+   ffmpeg_t *handle              = job->handle;
+   struct ff_replay_info *replay = &handle->replay;
+   AVFormatContext *src          = handle->muxer.ctx;
+   AVFormatContext *out          = avformat_alloc_context();
+   bool ok                       = false;
+
+   if (!out)
+      goto end;
+
+   out->oformat = src->oformat;
+   av_strlcpy(out->filename, job->path, sizeof(out->filename));
+
+   if (!ffmpeg_replay_new_stream(out,
+            handle->video.encoder, handle->video.codec))
+      goto end;
+
+   if (handle->config.audio_enable && !ffmpeg_replay_new_stream(out,
+            handle->audio.encoder, handle->audio.codec))
+      goto end;
+
+   av_dict_set(&out->metadata, "title", "RetroArch Replay", 0);
+
+   if (avio_open(&out->pb, job->path, AVIO_FLAG_WRITE) < 0)
+      goto end;
+
+   if (avformat_write_header(out, NULL) < 0)
+      goto end;
+
+   for (i = 0; i < job->count; i++)
+   {
+      AVPacket *pkt  = &job->packets[i];
+      AVStream *in   = src->streams[pkt->stream_index];
+      /* Make the file start at zero */
+      int64_t offset = av_rescale_q(job->start_ts,
+            handle->muxer.vstream->time_base, in->time_base);
+
+      if (pkt->pts != (int64_t)AV_NOPTS_VALUE)
+         pkt->pts -= offset;
+      if (pkt->dts != (int64_t)AV_NOPTS_VALUE)
+         pkt->dts -= offset;
+
+      /* Audio encoded slightly ahead of the first keyframe */
+      if (in != handle->muxer.vstream && pkt->pts < 0)
+      {
+         av_packet_unref(pkt);
+         continue;
+      }
+
+      av_packet_rescale_ts(pkt, in->time_base,
+            out->streams[pkt->stream_index]->time_base);
+
+      if (av_interleaved_write_frame(out, pkt) < 0)
+         goto end;
+      av_packet_unref(pkt);
+   }
+
+   ok = av_write_trailer(out) == 0;
+
+end:
+   for (i = 0; i < job->count; i++)
+      av_packet_unref(&job->packets[i]);
+
+   if (out)
+   {
+      if (out->pb)
+         avio_close(out->pb);
+      avformat_free_context(out);
+   }
+
+   if (ok)
+      RARCH_LOG("[FFmpeg]: Saved replay to \"%s\".\n", job->path);
+   else
+      RARCH_ERR("[FFmpeg]: Failed to save replay to \"%s\".\n", job->path);
+
+   free(job->packets);
+   free(job);
+
+   slock_lock(replay->lock);
+   replay->saving = false;
+   slock_unlock(replay->lock);
+}
+
+static bool ffmpeg_save_replay(void *data, const char *path)
+{
+   size_t i, seg, first, count;
+   struct ff_replay_job *job     = NULL;
+   ffmpeg_t *handle              = (ffmpeg_t*)data;
+   struct ff_replay_info *replay = NULL;
+
+   if (!handle || !handle->replay.lock)
+      return false;
+
+   replay = &handle->replay;
+
+   /* One save at a time, the main thread never waits for one */
+   slock_lock(replay->lock);
+   if (replay->saving)
+   {
+      slock_unlock(replay->lock);
+      RARCH_WARN("[FFmpeg]: Still saving the previous replay, "
+            "not saving \"%s\".\n", path);
+      return false;
+   }
+   slock_unlock(replay->lock);
+
+   /* Already done, this doesn't block */
+   if (replay->save_thread)
+      sthread_join(replay->save_thread);
+   replay->save_thread = NULL;
+
+   job = (struct ff_replay_job*)calloc(1, sizeof(*job));
+   if (!job)
+      return false;
+
+   job->handle = handle;
+   strlcpy(job->path, path, sizeof(job->path));
+
+   slock_lock(replay->lock);
+
+   if (!replay->segments_count)
+   {
+      slock_unlock(replay->lock);
+      free(job);
+      return false;
+   }
+
+   /* Latest keyframe that still gives the full replay length */
+   seg   = replay->segments_head;
+   first = replay->packets_head;
+   while (     seg + 1 < replay->segments_head + replay->segments_count
+         && replay->newest - replay->segments[seg + 1].start >= replay->length)
+      first += replay->segments[seg++].packets;
+
+   count         = replay->packets_head + replay->packets_count - first;
+   job->start_ts = replay->segments[seg].start_ts;
+   job->packets  = (AVPacket*)calloc(count, sizeof(*job->packets));
+
+   /* References only, the data is shared with the buffer */
+   if (job->packets)
+   {
+      for (i = 0; i < count; i++)
+         if (av_packet_ref(&job->packets[job->count],
+                  &replay->packets[first + i]) == 0)
+            job->count++;
+   }
+
+   if (job->count)
+      replay->saving = true;
+
+   slock_unlock(replay->lock);
+
+   if (!job->count)
+   {
+      free(job->packets);
+      free(job);
+      return false;
+   }
+
+   replay->save_thread = sthread_create(ffmpeg_replay_save_thread, job);
+
+   if (!replay->save_thread)
+      ffmpeg_replay_save_thread(job);
+
+   return true;
+}
+
 static bool encode_video(ffmpeg_t *handle, AVPacket *pkt, AVFrame *frame)
 {
    int got_packet = 0;
@@ -1224,8 +1876,112 @@ static bool encode_video(ffmpeg_t *handle, AVPacket *pkt, AVFrame *frame)
    return true;
 }
 
+/* Converts rows [y0, y1) of the input into the same rows of the
+ * output frame. Only used when no scaling takes place, so every band
+ * is an independent, identically sized conversion. */
+static void ffmpeg_scale_band(ffmpeg_t *handle, struct ff_scale_band *band,
+      const struct record_video_data *vid, AVFrame *frame)
+{
+   unsigned p;
+   uint8_t *dst[4];
+   const uint8_t *src;
+   int linesize                   = vid->pitch;
+   struct ff_video_info *video    = &handle->video;
+   const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(video->pix_fmt);
+   unsigned align                 = 1 << desc->log2_chroma_h;
+   unsigned rows                  = (vid->height / video->num_bands)
+      & ~(align - 1);
+   unsigned y0                    = band->index * rows;
+   unsigned y1                    = (band->index + 1 == video->num_bands)
+      ? vid->height : y0 + rows;
+
+   if (y1 <= y0)
+      return;
+
+   for (p = 0; p < 4; p++)
+   {
+      unsigned shift = (p == 1 || p == 2) ? desc->log2_chroma_h : 0;
+      dst[p]         = frame->data[p]
+         ? frame->data[p] + (y0 >> shift) * frame->linesize[p] : NULL;
+   }
+
+   src       = (const uint8_t*)vid->data + y0 * vid->pitch;
+
+   band->sws = sws_getCachedContext(band->sws,
+         vid->width, y1 - y0, video->in_pix_fmt,
+         vid->width, y1 - y0, video->pix_fmt,
+         SWS_POINT, NULL, NULL, NULL);
+
+   sws_scale(band->sws, &src, &linesize, 0, y1 - y0,
+         dst, frame->linesize);
+}
+
+static void ffmpeg_scale_band_thread(void *data)
+{
+   struct ff_scale_band *band  = (struct ff_scale_band*)data;
+   ffmpeg_t *handle            = band->handle;
+   struct ff_video_info *video = &handle->video;
+   unsigned generation         = 0;
+
+   slock_lock(video->scale_lock);
+
+   for (;;)
+   {
+      while (!video->scale_quit && video->scale_generation == generation)
+         scond_wait(video->scale_cond, video->scale_lock);
+
+      if (video->scale_quit)
+         break;
+
+      generation = video->scale_generation;
+      slock_unlock(video->scale_lock);
+
+      ffmpeg_scale_band(handle, band, video->scale_vid, video->scale_frame);
+
+      slock_lock(video->scale_lock);
+      if (--video->scale_pending == 0)
+         scond_signal(video->scale_done_cond);
+   }
+
+   slock_unlock(video->scale_lock);
+}
+
+static void ffmpeg_scale_bands(ffmpeg_t *handle,
+      const struct record_video_data *vid, AVFrame *frame)
+{
+   unsigned i;
+   struct ff_video_info *video = &handle->video;
+   bool threaded               = video->scale_lock && !video->scale_quit;
+
+   if (threaded)
+   {
+      slock_lock(video->scale_lock);
+      video->scale_vid     = vid;
+      video->scale_frame   = frame;
+      video->scale_pending = 0;
+      for (i = 1; i < video->num_bands; i++)
+         if (video->bands[i].thread)
+            video->scale_pending++;
+      video->scale_generation++;
+      scond_broadcast(video->scale_cond);
+      slock_unlock(video->scale_lock);
+   }
+
+   for (i = 0; i < video->num_bands; i++)
+      if (i == 0 || !threaded || !video->bands[i].thread)
+         ffmpeg_scale_band(handle, &video->bands[i], vid, frame);
+
+   if (threaded)
+   {
+      slock_lock(video->scale_lock);
+      while (video->scale_pending)
+         scond_wait(video->scale_done_cond, video->scale_lock);
+      slock_unlock(video->scale_lock);
+   }
+}
+
 static void ffmpeg_scale_input(ffmpeg_t *handle,
-      const struct record_video_data *vid)
+      const struct record_video_data *vid, AVFrame *frame)
 {
    /* Attempt to preserve more information if we scale down. */
    bool shrunk = handle->params.out_width < vid->width
@@ -1235,6 +1991,14 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
    {
       int linesize = vid->pitch;
 
+      if (     handle->video.num_bands > 1
+            && handle->params.out_width  == vid->width
+            && handle->params.out_height == vid->height)
+      {
+         ffmpeg_scale_bands(handle, vid, frame);
+         return;
+      }
+
       handle->video.sws = sws_getCachedContext(handle->video.sws,
             vid->width, vid->height, handle->video.in_pix_fmt,
             handle->params.out_width, handle->params.out_height,
@@ -1242,18 +2006,18 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
             shrunk ? SWS_BILINEAR : SWS_POINT, NULL, NULL, NULL);
 
       sws_scale(handle->video.sws, (const uint8_t* const*)&vid->data,
-            &linesize, 0, vid->height, handle->video.conv_frame->data,
-            handle->video.conv_frame->linesize);
+            &linesize, 0, vid->height, frame->data,
+            frame->linesize);
    }
    else
    {
       video_frame_record_scale(
             &handle->video.scaler,
-            handle->video.conv_frame->data[0],
+            frame->data[0],
             vid->data,
             handle->params.out_width,
             handle->params.out_height,
-            handle->video.conv_frame->linesize[0],
+            frame->linesize[0],
             vid->width,
             vid->height,
             vid->pitch,
@@ -1261,22 +2025,126 @@ static void ffmpeg_scale_input(ffmpeg_t *handle,
    }
 }
 
+/* Takes the oldest captured frame, converts it into a free output
+ * frame and hands it to the encoder. Called with handle->lock held;
+ * the lock is dropped while converting. Returns false if nothing
+ * could be done. */
+static bool ffmpeg_convert_next(ffmpeg_t *handle)
+{
+   int i;
+   int conv                    = -1;
+   struct ff_video_packet pkt;
+   struct ff_video_info *video = &handle->video;
+
+   if (!video->queue_count || video->encode_count == FFMPEG_CONV_FRAMES)
+      return false;
+
+   pkt = video->queue[video->queue_read];
+
+   if (pkt.index >= 0)
+   {
+      for (i = 0; i < FFMPEG_CONV_FRAMES; i++)
+      {
+         if (!video->conv_refs[i])
+         {
+            conv = i;
+            break;
+         }
+      }
+
+      if (conv < 0)
+         return false;
+   }
+
+   video->queue_read = (video->queue_read + 1) % FFMPEG_FRAME_POOL_SIZE;
+   video->queue_count--;
+
+   if (pkt.index >= 0)
+   {
+      /* One reference for the encoder, one as the last converted frame */
+      video->conv_refs[conv] = 2;
+      slock_unlock(handle->lock);
+
+      ffmpeg_scale_input(handle, &pkt.attr, video->conv_frames[conv]);
+
+      slock_lock(handle->lock);
+      video->slots[pkt.index].refs = 0;
+
+      /* Keep the last converted frame around for dupes */
+      if (video->last_conv >= 0)
+         video->conv_refs[video->last_conv]--;
+      video->last_conv = conv;
+   }
+   else
+   {
+      /* A dupe before anything was converted has nothing to repeat */
+      if (video->last_conv < 0)
+         return true;
+
+      conv = video->last_conv;
+      video->conv_refs[conv]++;
+   }
+
+   pkt.index = conv;
+   video->encode_queue[(video->encode_read + video->encode_count++)
+      % FFMPEG_CONV_FRAMES] = pkt;
+   scond_signal(handle->cond);
+
+   return true;
+}
+
+static void ffmpeg_convert_thread(void *data)
+{
+   ffmpeg_t *handle = (ffmpeg_t*)data;
+
+   slock_lock(handle->lock);
+
+   while (handle->alive)
+   {
+      if (!ffmpeg_convert_next(handle))
+         scond_wait(handle->video.conv_cond, handle->lock);
+   }
+
+   slock_unlock(handle->lock);
+}
+
+/* Pops the next converted frame for the encoder.
+ * Called with handle->lock held. */
+static bool ffmpeg_pop_encode(ffmpeg_t *handle, struct ff_video_packet *pkt)
+{
+   struct ff_video_info *video = &handle->video;
+
+   if (!video->encode_count)
+      return false;
+
+   *pkt               = video->encode_queue[video->encode_read];
+   video->encode_read = (video->encode_read + 1) % FFMPEG_CONV_FRAMES;
+   video->encode_count--;
+   return true;
+}
+
+static void ffmpeg_release_conv(ffmpeg_t *handle, int index)
+{
+   slock_lock(handle->lock);
+   handle->video.conv_refs[index]--;
+   scond_signal(handle->video.conv_cond);
+   slock_unlock(handle->lock);
+}
+
 static bool ffmpeg_push_video_thread(ffmpeg_t *handle,
-      const struct record_video_data *vid)
+      const struct ff_video_packet *vid)
 {
    AVPacket pkt;
+   AVFrame *frame = handle->video.conv_frames[vid->index];
 
-   if (!vid->is_dupe)
-      ffmpeg_scale_input(handle, vid);
+   frame->pts     = vid->pts;
 
-   handle->video.conv_frame->pts = handle->video.frame_cnt;
-
-   if (!encode_video(handle, &pkt, handle->video.conv_frame))
+   if (!encode_video(handle, &pkt, frame))
       return false;
 
    if (pkt.size)
    {
-      if (av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+      if (ffmpeg_write_packet(handle, &pkt) < 0)
          return false;
    }
 
@@ -1505,7 +2373,7 @@ static bool ffmpeg_push_audio_thread(ffmpeg_t *handle,
 
       if (pkt.size)
       {
-         if (av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+         if (ffmpeg_write_packet(handle, &pkt) < 0)
             return false;
       }
    }
@@ -1534,7 +2402,7 @@ static void ffmpeg_flush_audio(ffmpeg_t *handle, void *audio_buf,
    {
       AVPacket pkt;
       if (!encode_audio(handle, &pkt, true) || !pkt.size ||
-            av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+            ffmpeg_write_packet(handle, &pkt) < 0)
          break;
    }
 }
@@ -1545,7 +2413,7 @@ static void ffmpeg_flush_video(ffmpeg_t *handle)
    {
       AVPacket pkt;
       if (!encode_video(handle, &pkt, NULL) || !pkt.size ||
-            av_interleaved_write_frame(handle->muxer.ctx, &pkt) < 0)
+            ffmpeg_write_packet(handle, &pkt) < 0)
          break;
    }
 }
@@ -1553,8 +2421,6 @@ static void ffmpeg_flush_video(ffmpeg_t *handle)
 static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 {
    bool did_work;
-   void *video_buf = av_malloc(2 * handle->params.fb_width *
-         handle->params.fb_height * handle->video.pix_size);
    size_t audio_buf_size = handle->config.audio_enable ?
       (handle->audio.codec->frame_size *
        handle->params.channels * sizeof(int16_t)) : 0;
@@ -1567,7 +2433,8 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
 
    do
    {
-      struct record_video_data attr_buf;
+      bool avail_video;
+      struct ff_video_packet pkt;
 
       did_work = false;
 
@@ -1587,14 +2454,16 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
          }
       }
 
-      if (fifo_read_avail(handle->attr_fifo) >= sizeof(attr_buf))
-      {
-         fifo_read(handle->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(handle->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(handle, &attr_buf);
+      slock_lock(handle->lock);
+      if (ffmpeg_convert_next(handle))
+         did_work = true;
+      avail_video = ffmpeg_pop_encode(handle, &pkt);
+      slock_unlock(handle->lock);
 
+      if (avail_video)
+      {
+         ffmpeg_push_video_thread(handle, &pkt);
+         ffmpeg_release_conv(handle, pkt.index);
          did_work = true;
       }
    } while (did_work);
@@ -1606,7 +2475,6 @@ static void ffmpeg_flush_buffers(ffmpeg_t *handle)
    /* Flush out last video. */
    ffmpeg_flush_video(handle);
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -1623,6 +2491,14 @@ static bool ffmpeg_finalize(void *data)
 
    deinit_thread_buf(handle);
 
+   if (handle->video.frames_dropped)
+      RARCH_WARN("[FFmpeg]: Dropped %u of %u frames, the encoder could not keep up.\n",
+            handle->video.frames_dropped, handle->video.frames_pushed);
+
+   /* An unsaved replay buffer is simply discarded */
+   if (handle->replay.lock)
+      return true;
+
    /* Write final data. */
    av_write_trailer(handle->muxer.ctx);
 
@@ -1636,12 +2512,6 @@ static void ffmpeg_thread(void *data)
    size_t audio_buf_size;
    void *audio_buf = NULL;
    ffmpeg_t *ff    = (ffmpeg_t*)data;
-   /* For some reason, FFmpeg has a tendency to crash
-    * if we don't overallocate a bit. */
-   void *video_buf = av_malloc(2 * ff->params.fb_width *
-         ff->params.fb_height * ff->video.pix_size);
-
-   retro_assert(video_buf);
 
    audio_buf_size = ff->config.audio_enable ?
       (ff->audio.codec->frame_size * ff->params.channels * sizeof(int16_t)) : 0;
@@ -1649,14 +2519,13 @@ static void ffmpeg_thread(void *data)
 
    while (ff->alive)
    {
-      struct record_video_data attr_buf;
+      struct ff_video_packet pkt;
 
       bool avail_video = false;
       bool avail_audio = false;
 
       slock_lock(ff->lock);
-      if (fifo_read_avail(ff->attr_fifo) >= sizeof(attr_buf))
-         avail_video = true;
+      avail_video = ffmpeg_pop_encode(ff, &pkt);
 
       if (ff->config.audio_enable)
          if (fifo_read_avail(ff->audio_fifo) >= audio_buf_size)
@@ -1678,17 +2547,10 @@ static void ffmpeg_thread(void *data)
          slock_unlock(ff->cond_lock);
       }
 
-      if (avail_video && video_buf)
+      if (avail_video)
       {
-         slock_lock(ff->lock);
-         fifo_read(ff->attr_fifo, &attr_buf, sizeof(attr_buf));
-         fifo_read(ff->video_fifo, video_buf,
-               attr_buf.height * attr_buf.pitch);
-         slock_unlock(ff->lock);
-         scond_signal(ff->cond);
-
-         attr_buf.data = video_buf;
-         ffmpeg_push_video_thread(ff, &attr_buf);
+         ffmpeg_push_video_thread(ff, &pkt);
+         ffmpeg_release_conv(ff, pkt.index);
       }
 
       if (avail_audio && audio_buf)
@@ -1707,7 +2569,6 @@ static void ffmpeg_thread(void *data)
       }
    }
 
-   av_free(video_buf);
    av_free(audio_buf);
 }
 
@@ -1717,5 +2578,6 @@ const record_driver_t record_ffmpeg = {
    ffmpeg_push_video,
    ffmpeg_push_audio,
    ffmpeg_finalize,
+   ffmpeg_save_replay,
    "ffmpeg",
 };
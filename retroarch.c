@@ -112,6 +112,15 @@
 
 #ifdef HAVE_NETWORKING
 #include "network/netplay/netplay.h"
+#include "network/net_memwatch.h"
+#endif
+
+#ifdef HAVE_SHM_EXPORT
+#include "shm_export.h"
+#endif
+
+#ifdef HAVE_BATCH_CORE
+#include "batch_core.h"
 #endif
 
 #if defined(HAVE_HTTPSERVER) && defined(HAVE_ZLIB)
@@ -215,7 +224,9 @@ enum
    RA_OPT_LOG_FILE,
    RA_OPT_MAX_FRAMES,
    RA_OPT_MAX_FRAMES_SCREENSHOT,
-   RA_OPT_MAX_FRAMES_SCREENSHOT_PATH
+   RA_OPT_MAX_FRAMES_SCREENSHOT_PATH,
+   RA_OPT_BATCH,
+   RA_OPT_BATCH_INPUT
 };
 
 enum  runloop_state
@@ -305,6 +316,10 @@ static unsigned runloop_pending_windowed_scale                  = 0;
 static unsigned runloop_max_frames                              = 0;
 static bool runloop_max_frames_screenshot                       = false;
 static char runloop_max_frames_screenshot_path[PATH_MAX_LENGTH] = {0};
+#ifdef HAVE_BATCH_CORE
+static unsigned runloop_batch_instances                         = 0;
+static struct string_list *runloop_batch_inputs                 = NULL;
+#endif
 static unsigned fastforward_after_frames                        = 0;
 
 static retro_usec_t runloop_frame_time_last                     = 0;
@@ -1132,6 +1147,27 @@ void streaming_set_state(bool state)
    streaming_enable = state;
 }
 
+static void recording_fill_dated_path(char *s, size_t len)
+{
+   char buf[PATH_MAX_LENGTH];
+   settings_t *settings  = configuration_settings;
+   global_t *global      = &g_extern;
+   const char *game_name = path_basename(path_get(RARCH_PATH_BASENAME));
+   const char *ext       = "png";
+
+   buf[0] = '\0';
+
+   if (settings->uints.video_record_quality < RECORD_CONFIG_TYPE_RECORDING_WEBM_FAST)
+      ext = "mkv";
+   else if (settings->uints.video_record_quality < RECORD_CONFIG_TYPE_RECORDING_GIF)
+      ext = "webm";
+   else if (settings->uints.video_record_quality < RECORD_CONFIG_TYPE_RECORDING_APNG)
+      ext = "gif";
+
+   fill_str_dated_filename(buf, game_name, ext, sizeof(buf));
+   fill_pathname_join(s, global->record.output_dir, buf, len);
+}
+
 /**
  * recording_init:
  *
@@ -1142,7 +1178,6 @@ void streaming_set_state(bool state)
 bool recording_init(void)
 {
    char output[PATH_MAX_LENGTH];
-   char buf[PATH_MAX_LENGTH];
    struct record_params params          = {0};
    struct retro_system_av_info *av_info = &video_driver_av_info;
    settings_t *settings                 = configuration_settings;
@@ -1184,33 +1219,7 @@ bool recording_init(void)
             /* Fallback, stream locally to 127.0.0.1 */
             snprintf(output, sizeof(output), "udp://127.0.0.1:%u", settings->uints.video_stream_port);
       else
-      {
-         const char *game_name = path_basename(path_get(RARCH_PATH_BASENAME));
-         if (settings->uints.video_record_quality < RECORD_CONFIG_TYPE_RECORDING_WEBM_FAST)
-         {
-            fill_str_dated_filename(buf, game_name,
-                     "mkv", sizeof(buf));
-            fill_pathname_join(output, global->record.output_dir, buf, sizeof(output));
-         }
-         else if (settings->uints.video_record_quality >= RECORD_CONFIG_TYPE_RECORDING_WEBM_FAST && settings->uints.video_record_quality < RECORD_CONFIG_TYPE_RECORDING_GIF)
-         {
-            fill_str_dated_filename(buf, game_name,
-                     "webm", sizeof(buf));
-            fill_pathname_join(output, global->record.output_dir, buf, sizeof(output));
-         }
-         else if (settings->uints.video_record_quality >= RECORD_CONFIG_TYPE_RECORDING_GIF && settings->uints.video_record_quality < RECORD_CONFIG_TYPE_RECORDING_APNG)
-         {
-            fill_str_dated_filename(buf, game_name,
-                     "gif", sizeof(buf));
-            fill_pathname_join(output, global->record.output_dir, buf, sizeof(output));
-         }
-         else
-         {
-            fill_str_dated_filename(buf, game_name,
-                     "png", sizeof(buf));
-            fill_pathname_join(output, global->record.output_dir, buf, sizeof(output));
-         }
-      }
+         recording_fill_dated_path(output, sizeof(output));
    }
 
    params.out_width  = av_info->geometry.base_width;
@@ -1243,6 +1252,15 @@ bool recording_init(void)
       }
    }
 
+   /* Streams always go out live. Otherwise nothing is written
+    * until the replay is saved, @output only picks the container. */
+   if (!streaming_is_enabled() && settings->uints.video_replay_buffer_length)
+   {
+      params.replay_length = settings->uints.video_replay_buffer_length;
+      params.replay_budget = (size_t)settings->uints.video_replay_buffer_size
+         * 1024 * 1024;
+   }
+
    if (video_driver_supports_recording())
    {
       unsigned gpu_size;
@@ -1326,6 +1344,10 @@ bool recording_init(void)
          params.fb_width, params.fb_height,
          (unsigned)params.pix_fmt);
 
+   if (params.replay_length)
+      RARCH_LOG("[recording] Keeping the last %u seconds in memory (%u MB).\n",
+            params.replay_length, settings->uints.video_replay_buffer_size);
+
    if (!record_driver_init_first(&recording_driver, &recording_data, &params))
    {
       RARCH_ERR("[recording] %s\n", msg_hash_to_str(MSG_FAILED_TO_START_RECORDING));
@@ -1337,6 +1359,43 @@ bool recording_init(void)
    return true;
 }
 
+bool recording_save_replay(void)
+{
+   char output[PATH_MAX_LENGTH];
+   char msg[PATH_MAX_LENGTH];
+   settings_t *settings = configuration_settings;
+
+   if (     !recording_data
+         || !recording_driver
+         || !recording_driver->save_replay
+         || streaming_is_enabled()
+         || !settings->uints.video_replay_buffer_length)
+   {
+      runloop_msg_queue_push(
+            msg_hash_to_str(MSG_REPLAY_BUFFER_NOT_RUNNING),
+            1, 180, true,
+            NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      return false;
+   }
+
+   output[0] = '\0';
+   recording_fill_dated_path(output, sizeof(output));
+
+   if (!recording_driver->save_replay(recording_data, output))
+   {
+      RARCH_ERR("[recording] Failed to save replay to \"%s\".\n", output);
+      return false;
+   }
+
+   snprintf(msg, sizeof(msg), "%s \"%s\"",
+         msg_hash_to_str(MSG_SAVING_REPLAY_TO), path_basename(output));
+   RARCH_LOG("[recording] %s\n", msg);
+   runloop_msg_queue_push(msg, 1, 180, true,
+         NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+
+   return true;
+}
+
 void *recording_driver_get_data_ptr(void)
 {
    return recording_data;
@@ -1843,6 +1902,7 @@ const struct input_bind_map input_config_bind_map[RARCH_BIND_LIST_END_NULL] = {
 #endif
       DECLARE_META_BIND(2, recording_toggle,      RARCH_RECORDING_TOGGLE,      MENU_ENUM_LABEL_VALUE_INPUT_META_RECORDING_TOGGLE),
       DECLARE_META_BIND(2, streaming_toggle,      RARCH_STREAMING_TOGGLE,      MENU_ENUM_LABEL_VALUE_INPUT_META_STREAMING_TOGGLE),
+      DECLARE_META_BIND(2, replay_save,           RARCH_REPLAY_SAVE,           MENU_ENUM_LABEL_VALUE_INPUT_META_REPLAY_SAVE),
       DECLARE_META_BIND(2, streaming_toggle,      RARCH_AI_SERVICE,      MENU_ENUM_LABEL_VALUE_INPUT_META_AI_SERVICE),
 };
 
@@ -1884,6 +1944,9 @@ static input_keyboard_press_t g_keyboard_press_cb;
 static turbo_buttons_t input_driver_turbo_btns;
 #ifdef HAVE_COMMAND
 static command_t *input_driver_command            = NULL;
+#ifdef HAVE_NETWORKING
+static net_memwatch_t *input_driver_memwatch      = NULL;
+#endif
 #endif
 #ifdef HAVE_NETWORKGAMEPAD
 static input_remote_t *input_driver_remote        = NULL;
@@ -2927,6 +2990,12 @@ bool input_driver_init_command(void)
    bool input_network_cmd_enable = settings->bools.network_cmd_enable;
    bool grab_stdin               = current_input->grab_stdin && current_input->grab_stdin(current_input_data);
 
+#ifdef HAVE_NETWORKING
+   if (settings->bools.network_memwatch_enable)
+      input_driver_memwatch = net_memwatch_new(
+            settings->uints.network_memwatch_port);
+#endif
+
    if (!input_stdin_cmd_enable && !input_network_cmd_enable)
       return false;
 
@@ -2956,6 +3025,10 @@ void input_driver_deinit_command(void)
    if (input_driver_command)
       command_free(input_driver_command);
    input_driver_command = NULL;
+#ifdef HAVE_NETWORKING
+   net_memwatch_free(input_driver_memwatch);
+   input_driver_memwatch = NULL;
+#endif
 #endif
 }
 
@@ -7128,6 +7201,13 @@ static retro_time_t video_driver_frame_time_samples[MEASURE_FRAME_TIME_SAMPLES_C
 static uint64_t video_driver_frame_time_count            = 0;
 static uint64_t video_driver_frame_count                 = 0;
 
+/* Settings-derived part of video_frame_info_t, see
+ * video_driver_build_info */
+static video_frame_info_t video_driver_info_cache;
+static settings_t *video_driver_info_cache_settings      = NULL;
+static unsigned video_driver_info_cache_generation       = 0;
+static unsigned video_driver_info_generation             = 1;
+
 static void *video_driver_data                           = NULL;
 static video_driver_t *current_video                     = NULL;
 
@@ -7920,6 +8000,8 @@ static bool video_driver_init_internal(bool *video_is_threaded)
    settings_t *settings                   = configuration_settings;
    struct retro_game_geometry *geom       = &video_driver_av_info.geometry;
 
+   video_driver_build_info_invalidate();
+
    if (!string_is_empty(settings->paths.path_softfilter_plugin))
       video_driver_init_filter(video_driver_pix_fmt);
 
@@ -8289,6 +8371,9 @@ void video_monitor_set_refresh_rate(float hz)
    configuration_set_float(settings,
          settings->floats.video_refresh_rate,
          hz);
+
+   /* Drivers read it from the cached video info every frame */
+   video_driver_build_info_invalidate();
 }
 
 /**
@@ -9593,21 +9678,21 @@ bool video_driver_texture_unload(uintptr_t *id)
    return true;
 }
 
-void video_driver_build_info(video_frame_info_t *video_info)
+/**
+ * video_driver_build_info_invalidate:
+ *
+ * Marks the cached, settings-derived part of the frame info
+ * as stale, so that the next call to video_driver_build_info
+ * will copy it again from the current settings.
+ **/
+void video_driver_build_info_invalidate(void)
+{
+   video_driver_info_generation++;
+}
+
+static void video_driver_build_info_settings(
+      video_frame_info_t *video_info, settings_t *settings)
 {
-   bool is_perfcnt_enable            = false;
-   bool is_paused                    = false;
-   bool is_idle                      = false;
-   bool is_slowmotion                = false;
-   video_viewport_t *custom_vp       = NULL;
-   struct retro_hw_render_callback *hwr =
-      video_driver_get_hw_context_internal();
-   settings_t *settings              = configuration_settings;
-#ifdef HAVE_THREADS
-   bool is_threaded                  = video_driver_is_threaded_internal();
-   video_driver_threaded_lock(is_threaded);
-#endif
-   custom_vp                         = &settings->video_viewport_custom;
    video_info->refresh_rate          = settings->floats.video_refresh_rate;
    video_info->crt_switch_resolution = settings->uints.crt_switch_resolution;
    video_info->crt_switch_resolution_super = settings->uints.crt_switch_resolution_super;
@@ -9624,38 +9709,20 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->input_menu_swap_ok_cancel_buttons    = settings->bools.input_menu_swap_ok_cancel_buttons;
    video_info->max_swapchain_images  = settings->uints.video_max_swapchain_images;
    video_info->windowed_fullscreen   = settings->bools.video_windowed_fullscreen;
-   video_info->fullscreen            = settings->bools.video_fullscreen || retroarch_is_forced_fullscreen();
+   video_info->fullscreen            = settings->bools.video_fullscreen;
    video_info->monitor_index         = settings->uints.video_monitor_index;
    video_info->shared_context        = settings->bools.video_shared_context;
 
-   if (libretro_get_shared_context() && hwr && hwr->context_type != RETRO_HW_CONTEXT_NONE)
-      video_info->shared_context     = true;
-
    video_info->font_enable           = settings->bools.video_font_enable;
    video_info->font_msg_pos_x        = settings->floats.video_msg_pos_x;
    video_info->font_msg_pos_y        = settings->floats.video_msg_pos_y;
    video_info->font_msg_color_r      = settings->floats.video_msg_color_r;
    video_info->font_msg_color_g      = settings->floats.video_msg_color_g;
    video_info->font_msg_color_b      = settings->floats.video_msg_color_b;
-   video_info->custom_vp_x           = custom_vp->x;
-   video_info->custom_vp_y           = custom_vp->y;
-   video_info->custom_vp_width       = custom_vp->width;
-   video_info->custom_vp_height      = custom_vp->height;
-   video_info->custom_vp_full_width  = custom_vp->full_width;
-   video_info->custom_vp_full_height = custom_vp->full_height;
-
-   video_info->fps_text[0]           = '\0';
-
-   video_info->width                 = video_driver_width;
-   video_info->height                = video_driver_height;
 
-   video_info->use_rgba              = video_driver_use_rgba;
-
-   video_info->libretro_running       = false;
    video_info->msg_bgcolor_enable     = settings->bools.video_msg_bgcolor_enable;
 
 #ifdef HAVE_MENU
-   video_info->menu_is_alive          = menu_driver_is_alive();
    video_info->menu_footer_opacity    = settings->floats.menu_footer_opacity;
    video_info->menu_header_opacity    = settings->floats.menu_header_opacity;
    video_info->materialui_color_theme = settings->uints.menu_materialui_color_theme;
@@ -9669,10 +9736,7 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->xmb_alpha_factor       = settings->uints.menu_xmb_alpha_factor;
    video_info->menu_wallpaper_opacity   = settings->floats.menu_wallpaper_opacity;
    video_info->menu_framebuffer_opacity = settings->floats.menu_framebuffer_opacity;
-
-   video_info->libretro_running       = core_is_game_loaded();
 #else
-   video_info->menu_is_alive          = false;
    video_info->menu_footer_opacity    = 0.0f;
    video_info->menu_header_opacity    = 0.0f;
    video_info->materialui_color_theme = 0;
@@ -9686,9 +9750,89 @@ void video_driver_build_info(video_frame_info_t *video_info)
    video_info->menu_framebuffer_opacity = 0.0f;
    video_info->menu_wallpaper_opacity = 0.0f;
 #endif
+}
+
+/**
+ * video_driver_build_info:
+ * @video_info           : frame info to fill in.
+ *
+ * Fills in the frame info passed to the video driver's
+ * frame callback. The settings-derived fields are kept in a
+ * cached snapshot which is only refreshed after
+ * video_driver_build_info_invalidate has been called (or while
+ * the menu is active, since settings can then change at any
+ * time); everything else is refreshed on each call.
+ **/
+void video_driver_build_info(video_frame_info_t *video_info)
+{
+   static struct retro_perf_counter video_build_info = {0};
+   bool is_perfcnt_enable            = false;
+   bool is_paused                    = false;
+   bool is_idle                      = false;
+   bool is_slowmotion                = false;
+   bool menu_is_alive                = false;
+   video_viewport_t *custom_vp       = NULL;
+   struct retro_hw_render_callback *hwr =
+      video_driver_get_hw_context_internal();
+   settings_t *settings              = configuration_settings;
+#ifdef HAVE_THREADS
+   bool is_threaded                  = video_driver_is_threaded_internal();
+   video_driver_threaded_lock(is_threaded);
+#endif
 
    runloop_get_status(&is_paused, &is_idle, &is_slowmotion, &is_perfcnt_enable);
 
+   performance_counter_init(video_build_info, "video_build_info");
+   performance_counter_start_plus(is_perfcnt_enable, video_build_info);
+
+#ifdef HAVE_MENU
+   menu_is_alive                     = menu_driver_is_alive();
+#endif
+
+   /* Settings can be changed from anywhere in the menu,
+    * so refresh the snapshot while it is active and once
+    * more when it has just been closed. */
+   if (     (video_driver_info_cache_generation != video_driver_info_generation)
+         || (video_driver_info_cache_settings   != settings)
+         || menu_is_alive
+         || video_driver_info_cache.menu_is_alive)
+   {
+      video_driver_build_info_settings(&video_driver_info_cache, settings);
+      video_driver_info_cache_generation = video_driver_info_generation;
+      video_driver_info_cache_settings   = settings;
+   }
+
+   video_driver_info_cache.menu_is_alive = menu_is_alive;
+
+   *video_info                       = video_driver_info_cache;
+
+   if (retroarch_is_forced_fullscreen())
+      video_info->fullscreen         = true;
+
+   if (libretro_get_shared_context() && hwr && hwr->context_type != RETRO_HW_CONTEXT_NONE)
+      video_info->shared_context     = true;
+
+   custom_vp                         = &settings->video_viewport_custom;
+   video_info->custom_vp_x           = custom_vp->x;
+   video_info->custom_vp_y           = custom_vp->y;
+   video_info->custom_vp_width       = custom_vp->width;
+   video_info->custom_vp_height      = custom_vp->height;
+   video_info->custom_vp_full_width  = custom_vp->full_width;
+   video_info->custom_vp_full_height = custom_vp->full_height;
+
+   video_info->fps_text[0]           = '\0';
+
+   video_info->width                 = video_driver_width;
+   video_info->height                = video_driver_height;
+
+   video_info->use_rgba              = video_driver_use_rgba;
+
+#ifdef HAVE_MENU
+   video_info->libretro_running       = core_is_game_loaded();
+#else
+   video_info->libretro_running       = false;
+#endif
+
    video_info->is_perfcnt_enable      = is_perfcnt_enable;
    video_info->runloop_is_paused      = is_paused;
    video_info->runloop_is_idle        = is_idle;
@@ -9705,6 +9849,8 @@ void video_driver_build_info(video_frame_info_t *video_info)
 
    video_info->userdata               = video_driver_get_ptr(false);
 
+   performance_counter_stop_plus(is_perfcnt_enable, video_build_info);
+
 #ifdef HAVE_THREADS
    video_driver_threaded_unlock(is_threaded);
 #endif
@@ -12101,7 +12247,16 @@ static void retroarch_print_help(const char *arg0)
    puts("      --max-frames-ss\n"
         "                        Takes a screenshot at the end of max-frames.");
    puts("      --max-frames-ss-path=FILE\n"
-        "                        Path to save the screenshot to at the end of max-frames.\n");
+        "                        Path to save the screenshot to at the end of max-frames.");
+#ifdef HAVE_BATCH_CORE
+   puts("      --batch=NUMBER    Runs the --batch-input scripts headless on NUMBER\n"
+        "                        instances of the core in parallel, prints the CRC32\n"
+        "                        of the video, audio and final state of each, then exits.");
+   puts("      --batch-input=FILE\n"
+        "                        Input script for --batch, one line per frame with the\n"
+        "                        hexadecimal joypad mask of each port. Can be repeated.");
+#endif
+   puts("");
 }
 
 #define FFMPEG_RECORD_ARG "r:"
@@ -12182,6 +12337,10 @@ static void retroarch_parse_input_and_config(int argc, char *argv[])
       { "eof-exit",           0, NULL, RA_OPT_EOF_EXIT },
       { "version",            0, NULL, RA_OPT_VERSION },
       { "log-file",           1, NULL, RA_OPT_LOG_FILE },
+#ifdef HAVE_BATCH_CORE
+      { "batch",              1, NULL, RA_OPT_BATCH },
+      { "batch-input",        1, NULL, RA_OPT_BATCH_INPUT },
+#endif
       { NULL, 0, NULL, 0 }
    };
 
@@ -12621,6 +12780,25 @@ static void retroarch_parse_input_and_config(int argc, char *argv[])
                strlcpy(runloop_max_frames_screenshot_path, optarg, sizeof(runloop_max_frames_screenshot_path));
                break;
 
+#ifdef HAVE_BATCH_CORE
+            case RA_OPT_BATCH:
+               runloop_batch_instances = (unsigned)strtoul(optarg, NULL, 10);
+               break;
+
+            case RA_OPT_BATCH_INPUT:
+               {
+                  union string_list_elem_attr attr;
+
+                  attr.i = 0;
+
+                  if (!runloop_batch_inputs)
+                     runloop_batch_inputs = string_list_new();
+                  if (runloop_batch_inputs)
+                     string_list_append(runloop_batch_inputs, optarg, attr);
+               }
+               break;
+#endif
+
             case RA_OPT_SUBSYSTEM:
                path_set(RARCH_PATH_SUBSYSTEM, optarg);
                break;
@@ -12897,6 +13075,20 @@ bool retroarch_main_init(int argc, char *argv[])
 
    retroarch_validate_cpu_features();
 
+#ifdef HAVE_BATCH_CORE
+   /* Headless, never initializes the main core or any driver */
+   if (runloop_batch_instances)
+   {
+      bool ret = batch_core_run_inputs(path_get(RARCH_PATH_CORE),
+            path_get(RARCH_PATH_CONTENT), runloop_batch_instances,
+            runloop_batch_inputs);
+
+      string_list_free(runloop_batch_inputs);
+      runloop_batch_inputs = NULL;
+      exit(ret ? 0 : 1);
+   }
+#endif
+
    rarch_ctl(RARCH_CTL_TASK_INIT, NULL);
 
    {
@@ -14779,6 +14971,9 @@ static enum runloop_state runloop_check_state(
    /* Check if we have pressed the streaming toggle button */
    HOTKEY_CHECK(RARCH_STREAMING_TOGGLE, CMD_EVENT_STREAMING_TOGGLE, true, NULL); 
 
+   /* Check if we have pressed the replay save button */
+   HOTKEY_CHECK(RARCH_REPLAY_SAVE, CMD_EVENT_REPLAY_SAVE, true, NULL);
+
    if (BIT256_GET(current_input, RARCH_VOLUME_UP))
       command_event(CMD_EVENT_VOLUME_UP, NULL);
    else if (BIT256_GET(current_input, RARCH_VOLUME_DOWN))
@@ -15257,6 +15452,23 @@ int runloop_iterate(unsigned *sleep_ms)
 #endif
    cheat_manager_apply_retro_cheats();
 
+#if defined(HAVE_COMMAND) && defined(HAVE_NETWORKING)
+   /* Push the memory the core just produced to watching tools */
+   if (input_driver_memwatch)
+      net_memwatch_update(input_driver_memwatch, video_driver_frame_count);
+#endif
+
+#ifdef HAVE_SHM_EXPORT
+   if (settings->bools.shm_export_enable)
+      shm_export_update(video_driver_frame_count,
+            (frame_cache_data != RETRO_HW_FRAME_BUFFER_VALID)
+            ? frame_cache_data : NULL,
+            frame_cache_width, frame_cache_height, frame_cache_pitch,
+            video_driver_pix_fmt, &video_driver_av_info.geometry);
+   else
+      shm_export_deinit();
+#endif
+
 #ifdef HAVE_DISCORD
    if (discord_is_inited)
    {
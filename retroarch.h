@@ -781,6 +781,12 @@ struct record_params
 
    /* Path to config. Optional. */
    const char *config;
+
+   /* Seconds kept in memory instead of being written to @filename,
+    * 0 to record normally. See record_driver::save_replay. */
+   unsigned replay_length;
+   /* Upper bound of the memory used by the replay buffer, in bytes. */
+   size_t replay_budget;
 };
 
 struct record_video_data
@@ -805,6 +811,10 @@ typedef struct record_driver
    bool  (*push_video)(void *data, const struct record_video_data *video_data);
    bool  (*push_audio)(void *data, const struct record_audio_data *audio_data);
    bool  (*finalize)(void *data);
+   /* Writes the replay buffer to @path in the background,
+    * without re-encoding. Fails while the previous save is running.
+    * Optional, only used when recording with a replay length. */
+   bool  (*save_replay)(void *data, const char *path);
    const char *ident;
 } record_driver_t;
 
@@ -849,6 +859,16 @@ bool recording_deinit(void);
  **/
 bool recording_init(void);
 
+/**
+ * recording_save_replay:
+ *
+ * Writes the last seconds kept by the replay buffer to a new file
+ * in the recording output directory.
+ *
+ * Returns: true (1) if successful, otherwise false (0).
+ **/
+bool recording_save_replay(void);
+
 bool recording_is_enabled(void);
 
 void recording_set_state(bool state);
@@ -1934,6 +1954,8 @@ bool video_driver_texture_unload(uintptr_t *id);
 
 void video_driver_build_info(video_frame_info_t *video_info);
 
+void video_driver_build_info_invalidate(void);
+
 void video_driver_reinit(void);
 
 void video_driver_get_window_title(char *buf, unsigned len);
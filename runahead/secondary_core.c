@@ -140,7 +140,10 @@ static bool write_file_with_random_name(char **tempDllPath,
    return okay;
 }
 
-static char *copy_core_to_temp_file(void)
+/* Copies the core to a temporary file, so it can be loaded again
+ * as a separate instance. 'prefix' is prepended to the file name
+ * and keeps copies made for different instances apart. */
+char *copy_core_to_temp_file(const char *corePath, const char *prefix)
 {
    bool failed              = false;
    char *tempDirectory      = NULL;
@@ -148,7 +151,6 @@ static char *copy_core_to_temp_file(void)
    char *tempDllPath        = NULL;
    void *dllFileData        = NULL;
    int64_t dllFileSize      = 0;
-   const char *corePath     = path_get(RARCH_PATH_CORE);
    const char *coreBaseName = path_basename(corePath);
 
    if (strlen(coreBaseName) == 0)
@@ -182,6 +184,8 @@ static char *copy_core_to_temp_file(void)
    }
 
    strcat_alloc(&tempDllPath, retroarchTempPath);
+   if (prefix)
+      strcat_alloc(&tempDllPath, prefix);
    strcat_alloc(&tempDllPath, coreBaseName);
 
    if (!filestream_write_file(tempDllPath, dllFileData, dllFileSize))
@@ -249,7 +253,8 @@ static bool secondary_core_create(void)
    if (secondary_library_path)
       free(secondary_library_path);
    secondary_library_path = NULL;
-   secondary_library_path = copy_core_to_temp_file();
+   secondary_library_path = copy_core_to_temp_file(
+         path_get(RARCH_PATH_CORE), NULL);
 
    if (!secondary_library_path)
       return false;
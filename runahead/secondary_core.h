@@ -18,6 +18,7 @@ void set_last_core_type(enum rarch_core_type type);
 void remember_controller_port_device(long port, long device);
 void clear_controller_port_map(void);
 void secondary_core_set_variable_update(void);
+char *copy_core_to_temp_file(const char *corePath, const char *prefix);
 
 RETRO_END_DECLS
 
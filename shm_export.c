@@ -0,0 +1,347 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shm_export.h"
+
+#include "core.h"
+#include "retroarch.h"
+#include "verbosity.h"
+
+#define SHM_EXPORT_MAX_REGIONS 64
+#define SHM_EXPORT_ALIGN(x)    (((x) + 63) & ~(uint64_t)63)
+
+#if defined(__GNUC__)
+#define SHM_EXPORT_BARRIER()   __sync_synchronize()
+#else
+#define SHM_EXPORT_BARRIER()   ((void)0)
+#endif
+
+static int shm_export_fd                         = -1;
+static uint8_t *shm_export_base                  = NULL;
+static size_t shm_export_size                    = 0;
+static char shm_export_name[32]                  = {0};
+
+/* Layout of the current frame, compared against the mapped one */
+static struct shm_export_region shm_export_regions[SHM_EXPORT_MAX_REGIONS];
+static const uint8_t *shm_export_sources[SHM_EXPORT_MAX_REGIONS];
+
+/* Layout the last creation failed for, not retried until it changes */
+static bool shm_export_failed                    = false;
+static struct shm_export_header shm_export_failed_header;
+static struct shm_export_region shm_export_failed_regions[SHM_EXPORT_MAX_REGIONS];
+
+static unsigned shm_export_bpp(enum retro_pixel_format format)
+{
+   return (format == RETRO_PIXEL_FORMAT_XRGB8888) ? 4 : 2;
+}
+
+/* Adds a region to the layout. Regions aliasing one already
+ * added share its contents instead of being copied twice. */
+static void shm_export_add_region(unsigned *count, uint64_t *slot_size,
+      uint32_t type, uint32_t id, uint64_t flags, uint64_t start,
+      const uint8_t *data, size_t size)
+{
+   unsigned i;
+   struct shm_export_region *region = NULL;
+
+   if (!data || !size || *count >= SHM_EXPORT_MAX_REGIONS)
+      return;
+
+   region         = &shm_export_regions[*count];
+   region->type   = type;
+   region->id     = id;
+   region->flags  = flags;
+   region->start  = start;
+   region->size   = size;
+   region->offset = *slot_size;
+
+   shm_export_sources[*count] = data;
+
+   for (i = 0; i < *count; i++)
+   {
+      if (     shm_export_sources[i] == data
+            && shm_export_regions[i].size >= size)
+      {
+         region->offset             = shm_export_regions[i].offset;
+         shm_export_sources[*count] = NULL;
+         break;
+      }
+   }
+
+   if (shm_export_sources[*count])
+      *slot_size += SHM_EXPORT_ALIGN(size);
+
+   (*count)++;
+}
+
+static unsigned shm_export_collect_regions(uint64_t *slot_size)
+{
+   unsigned i;
+   unsigned count                 = 0;
+   rarch_system_info_t *system    = runloop_get_system_info();
+
+   if (system)
+   {
+      for (i = 0; i < system->mmaps.num_descriptors; i++)
+      {
+         const struct retro_memory_descriptor *desc =
+            &system->mmaps.descriptors[i].core;
+
+         if (!desc->ptr)
+            continue;
+
+         shm_export_add_region(&count, slot_size,
+               SHM_EXPORT_REGION_MMAP, i, desc->flags, desc->start,
+               (const uint8_t*)desc->ptr + desc->offset, desc->len);
+      }
+   }
+
+   /* Cores without a memory map */
+   if (!count)
+   {
+      for (i = RETRO_MEMORY_SAVE_RAM; i <= RETRO_MEMORY_VIDEO_RAM; i++)
+      {
+         retro_ctx_memory_info_t mem_info;
+
+         mem_info.id   = i;
+         mem_info.data = NULL;
+         mem_info.size = 0;
+
+         core_get_memory(&mem_info);
+
+         shm_export_add_region(&count, slot_size,
+               SHM_EXPORT_REGION_MEMORY, i, 0, 0,
+               (const uint8_t*)mem_info.data, mem_info.size);
+      }
+   }
+
+   return count;
+}
+
+void shm_export_deinit(void)
+{
+   if (shm_export_base)
+   {
+      struct shm_export_header *header =
+         (struct shm_export_header*)shm_export_base;
+
+      /* Tell readers still mapping it to reopen */
+      header->magic = 0;
+      munmap(shm_export_base, shm_export_size);
+   }
+
+   if (shm_export_fd >= 0)
+   {
+      close(shm_export_fd);
+      shm_unlink(shm_export_name);
+   }
+
+   shm_export_fd     = -1;
+   shm_export_base   = NULL;
+   shm_export_size   = 0;
+   shm_export_failed = false;
+}
+
+static bool shm_export_create(unsigned num_regions, uint64_t slot_size,
+      uint64_t frame_offset, uint64_t frame_capacity,
+      enum retro_pixel_format format)
+{
+   struct shm_export_header *header = NULL;
+   uint64_t header_size             = SHM_EXPORT_ALIGN(sizeof(*header)
+         + num_regions * sizeof(struct shm_export_region));
+   uint64_t size                    = header_size + 2 * slot_size;
+   bool created                     = !shm_export_base;
+
+   shm_export_deinit();
+
+   snprintf(shm_export_name, sizeof(shm_export_name),
+         "/retroarch-%d", (int)getpid());
+
+   /* Readers find the new object under the same name */
+   shm_unlink(shm_export_name);
+
+   shm_export_fd = shm_open(shm_export_name,
+         O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+   if (shm_export_fd < 0)
+      goto error;
+
+   if (ftruncate(shm_export_fd, (off_t)size) != 0)
+      goto error;
+
+   shm_export_base = (uint8_t*)mmap(NULL, (size_t)size,
+         PROT_READ | PROT_WRITE, MAP_SHARED, shm_export_fd, 0);
+   if (shm_export_base == MAP_FAILED)
+   {
+      shm_export_base = NULL;
+      goto error;
+   }
+
+   shm_export_size                = (size_t)size;
+
+   /* ftruncate zero fills, only the non-zero fields are set */
+   header                         = (struct shm_export_header*)shm_export_base;
+   header->version                = SHM_EXPORT_VERSION;
+   header->header_size            = sizeof(*header);
+   header->num_regions            = num_regions;
+   header->pixel_format           = format;
+   header->size                   = size;
+   header->frame_offset           = frame_offset;
+   header->frame_capacity         = frame_capacity;
+   header->slots[0].offset        = header_size;
+   header->slots[1].offset        = header_size + slot_size;
+   /* Nothing written yet, readers retry until the first update */
+   header->slots[0].sequence      = 1;
+   header->slots[1].sequence      = 1;
+
+   memcpy(header + 1, shm_export_regions,
+         num_regions * sizeof(struct shm_export_region));
+
+   SHM_EXPORT_BARRIER();
+   header->magic                  = SHM_EXPORT_MAGIC;
+
+   if (created)
+      RARCH_LOG("[SHM]: Exporting core memory to \"%s\".\n",
+            shm_export_name);
+   return true;
+
+error:
+   RARCH_ERR("[SHM]: Failed to create \"%s\".\n", shm_export_name);
+   shm_export_deinit();
+
+   header                         = &shm_export_failed_header;
+   header->num_regions            = num_regions;
+   header->pixel_format           = format;
+   header->frame_offset           = frame_offset;
+   header->frame_capacity         = frame_capacity;
+   header->slots[0].offset        = header_size;
+   header->slots[1].offset        = header_size + slot_size;
+   memcpy(shm_export_failed_regions, shm_export_regions,
+         num_regions * sizeof(struct shm_export_region));
+   shm_export_failed              = true;
+   return false;
+}
+
+static bool shm_export_layout_changed(
+      const struct shm_export_header *header,
+      const struct shm_export_region *regions, unsigned num_regions,
+      uint64_t slot_size, uint64_t frame_offset, uint64_t frame_capacity,
+      enum retro_pixel_format format)
+{
+   return header->num_regions != num_regions
+      || header->pixel_format != (uint32_t)format
+      || header->frame_offset != frame_offset
+      || header->frame_capacity != frame_capacity
+      || header->slots[1].offset - header->slots[0].offset != slot_size
+      || memcmp(regions, shm_export_regions,
+            num_regions * sizeof(struct shm_export_region));
+}
+
+void shm_export_update(uint64_t frame_count,
+      const void *frame, unsigned width, unsigned height, size_t pitch,
+      enum retro_pixel_format format,
+      const struct retro_game_geometry *geom)
+{
+   unsigned i;
+   uint8_t *dst;
+   size_t row_size;
+   struct shm_export_slot *slot     = NULL;
+   struct shm_export_header *header = NULL;
+   uint64_t slot_size               = 0;
+   unsigned bpp                     = shm_export_bpp(format);
+   uint64_t frame_capacity          = geom
+      ? (uint64_t)geom->max_width * geom->max_height * bpp : 0;
+   uint64_t frame_offset            = 0;
+   unsigned num_regions             = shm_export_collect_regions(&slot_size);
+
+   if (frame_capacity)
+   {
+      frame_offset = slot_size;
+      slot_size   += SHM_EXPORT_ALIGN(frame_capacity);
+   }
+
+   if (!slot_size)
+      return;
+
+   header = (struct shm_export_header*)shm_export_base;
+
+   if (!header || shm_export_layout_changed(header,
+            (const struct shm_export_region*)(header + 1), num_regions,
+            slot_size, frame_offset, frame_capacity, format))
+   {
+      /* Don't retry (and log) every frame */
+      if (shm_export_failed && !shm_export_layout_changed(
+               &shm_export_failed_header, shm_export_failed_regions,
+               num_regions, slot_size, frame_offset, frame_capacity,
+               format))
+         return;
+
+      if (!shm_export_create(num_regions, slot_size,
+               frame_offset, frame_capacity, format))
+         return;
+   }
+
+   /* Write the slot readers aren't directed to */
+   header           = (struct shm_export_header*)shm_export_base;
+   slot             = &header->slots[header->latest ^ 1];
+   dst              = shm_export_base + slot->offset;
+
+   *(volatile uint32_t*)&slot->sequence = (slot->sequence + 1) | 1;
+   SHM_EXPORT_BARRIER();
+
+   for (i = 0; i < num_regions; i++)
+      if (shm_export_sources[i])
+         memcpy(dst + shm_export_regions[i].offset,
+               shm_export_sources[i], (size_t)shm_export_regions[i].size);
+
+   row_size = width * bpp;
+
+   /* Frames larger than the core's announced maximum are dropped */
+   if (     frame && frame_capacity && row_size <= pitch
+         && (uint64_t)row_size * height <= frame_capacity)
+   {
+      const uint8_t *src = (const uint8_t*)frame;
+      uint8_t *out       = dst + frame_offset;
+
+      for (i = 0; i < height; i++, src += pitch, out += row_size)
+         memcpy(out, src, row_size);
+
+      slot->frame_width  = width;
+      slot->frame_height = height;
+      slot->frame_pitch  = (uint32_t)row_size;
+   }
+   else
+   {
+      slot->frame_width  = 0;
+      slot->frame_height = 0;
+      slot->frame_pitch  = 0;
+   }
+
+   slot->frame_count = frame_count;
+
+   SHM_EXPORT_BARRIER();
+   *(volatile uint32_t*)&slot->sequence = slot->sequence + 1;
+   SHM_EXPORT_BARRIER();
+   *(volatile uint32_t*)&header->latest = header->latest ^ 1;
+}
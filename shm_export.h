@@ -0,0 +1,117 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2017 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SHM_EXPORT_H
+#define __SHM_EXPORT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <boolean.h>
+#include <retro_common_api.h>
+#include <libretro.h>
+
+RETRO_BEGIN_DECLS
+
+/* Shared memory export of the core's memory and the last video frame,
+ * for processes on the same host. The object is named
+ * "/retroarch-<pid>" and starts with a struct shm_export_header,
+ * followed by num_regions struct shm_export_region entries.
+ *
+ * The data is double buffered. Each slot has a sequence number that
+ * is odd while the slot is being written. A reader picks the slot
+ * named by 'latest', reads its sequence, copies what it needs and
+ * retries if the sequence is odd or changed in between. The frontend
+ * never waits for readers.
+ *
+ * When the layout changes (a new core, a resized memory map) the
+ * object is recreated: magic is cleared in the old one, readers should
+ * then unmap it and open the name again. */
+
+#define SHM_EXPORT_MAGIC         0x4d485352 /* "RSHM" */
+#define SHM_EXPORT_VERSION       1
+
+#define SHM_EXPORT_REGION_MMAP   0
+#define SHM_EXPORT_REGION_MEMORY 1
+
+struct shm_export_slot
+{
+   uint32_t sequence;
+   uint32_t frame_width;
+   uint32_t frame_height;
+   uint32_t frame_pitch;
+   /* Number of the frame the slot was taken after */
+   uint64_t frame_count;
+   /* Offset of the slot from the start of the object */
+   uint64_t offset;
+};
+
+struct shm_export_header
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t header_size;
+   uint32_t num_regions;
+   /* Index of the last completed slot */
+   uint32_t latest;
+   /* enum retro_pixel_format of the frame */
+   uint32_t pixel_format;
+   uint64_t size;
+   /* Offset of the frame within a slot, 0 when not exported */
+   uint64_t frame_offset;
+   uint64_t frame_capacity;
+   struct shm_export_slot slots[2];
+};
+
+struct shm_export_region
+{
+   /* SHM_EXPORT_REGION_MMAP with the memory descriptor index as id,
+    * or SHM_EXPORT_REGION_MEMORY with a RETRO_MEMORY_* id */
+   uint32_t type;
+   uint32_t id;
+   /* RETRO_MEMDESC_* flags of the descriptor */
+   uint64_t flags;
+   /* Emulated address of the region */
+   uint64_t start;
+   uint64_t size;
+   /* Offset of the contents within a slot */
+   uint64_t offset;
+};
+
+/**
+ * shm_export_update:
+ * @frame_count      : number of the frame that just ran.
+ * @frame            : last software frame of the core, or NULL.
+ * @width            : width of @frame.
+ * @height           : height of @frame.
+ * @pitch            : pitch of @frame in bytes.
+ * @format           : pixel format of @frame.
+ * @geom             : geometry of the core, sizes the frame area.
+ *
+ * Copies the memory of the running core and @frame into the
+ * shared memory object, creating or recreating it when needed.
+ **/
+void shm_export_update(uint64_t frame_count,
+      const void *frame, unsigned width, unsigned height, size_t pitch,
+      enum retro_pixel_format format,
+      const struct retro_game_geometry *geom);
+
+/* Removes the shared memory object, if any. */
+void shm_export_deinit(void);
+
+RETRO_END_DECLS
+
+#endif
@@ -56,19 +56,60 @@ typedef struct database_state_handle
    char archive_name[511];
    char serial[4096];
    database_info_list_t *info;
+   database_info_scan_t *scan;
    struct string_list *list;
+   /* Files of the archives added to the scan, with their CRC32
+    * read from each archive in one go */
+   struct string_list *archive_members;
+   uint32_t *archive_member_crcs;
+   size_t archive_member_index;
 } database_state_handle_t;
 
+/* A playlist entry added for a scanned file */
+typedef struct database_manifest_match
+{
+   char *db_name;
+   char *path;
+   char *crc32;
+} database_manifest_match_t;
+
+typedef struct database_manifest_entry
+{
+   char *path;
+   int64_t size;
+   int64_t mtime;
+   uint32_t crc;
+   /* Whether the file was unchanged and the entry moved over to
+    * the manifest of the new scan */
+   bool kept;
+   unsigned num_matches;
+   database_manifest_match_t *matches;
+} database_manifest_entry_t;
+
+/* What the last scan of a directory found, so that rescanning it
+ * only has to look at the files that changed since */
+typedef struct database_manifest
+{
+   uint32_t signature;
+   size_t count;
+   /* Sorted by path */
+   database_manifest_entry_t *entries;
+} database_manifest_t;
+
 typedef struct db_handle
 {
    bool is_directory;
    bool scan_started;
    bool scan_without_core_match;
+   bool scan_incremental;
    bool show_hidden_files;
    unsigned status;
    char *playlist_directory;
    char *content_database_path;
    char *fullpath;
+   char *manifest_path;
+   database_manifest_t manifest;
+   database_manifest_t old_manifest;
    database_info_handle_t *handle;
    database_state_handle_t state;
 } db_handle_t;
@@ -127,11 +168,11 @@ static const char *database_info_get_current_element_name(
    if (!handle || !handle->list)
       return NULL;
    /* Skip pruned entries */
-   while (handle->list->elems[handle->list_ptr].data == NULL)
-   {
-      if (++handle->list_ptr >= handle->list->size)
-         return NULL;
-   }
+   while (  handle->list_ptr < handle->list->size
+         && !handle->list->elems[handle->list_ptr].data)
+      handle->list_ptr++;
+   if (handle->list_ptr >= handle->list->size)
+      return NULL;
    return handle->list->elems[handle->list_ptr].data;
 }
 
@@ -571,7 +612,11 @@ static void gdi_prune(database_info_handle_t *db, const char *name)
    }
 
 end:
-   free(fd);
+   if (fd)
+   {
+      intfstream_close(fd);
+      free(fd);
+   }
    free(path);
 }
 
@@ -619,6 +664,708 @@ static enum msg_file_type extension_to_file_type(const char *ext)
    return FILE_TYPE_NONE;
 }
 
+/* Manifest of an incremental scan, stored next to the playlists.
+ *
+ * The file is a header followed by the entries sorted by path, in
+ * native byte order, strings are a length (~0 for NULL) and their
+ * bytes. Files are scanned again when their size or modification
+ * time changed, or when the databases or cores they were scanned
+ * against did, as summed up by the signature. */
+
+#define DATABASE_MANIFEST_MAGIC   "RASCANMF"
+#define DATABASE_MANIFEST_VERSION 1
+
+typedef struct
+{
+   const uint8_t *data;
+   size_t len;
+   size_t pos;
+   bool error;
+} database_manifest_reader_t;
+
+/* Own copy of the path, the list element may be freed while
+ * the files are still searched */
+typedef struct
+{
+   char *path;
+   size_t idx;
+} database_manifest_file_t;
+
+static void task_database_manifest_free(database_manifest_t *manifest)
+{
+   size_t i;
+   unsigned j;
+
+   for (i = 0; i < manifest->count; i++)
+   {
+      database_manifest_entry_t *entry = &manifest->entries[i];
+
+      for (j = 0; j < entry->num_matches; j++)
+      {
+         free(entry->matches[j].db_name);
+         free(entry->matches[j].path);
+         free(entry->matches[j].crc32);
+      }
+
+      free(entry->matches);
+      free(entry->path);
+   }
+
+   free(manifest->entries);
+   memset(manifest, 0, sizeof(*manifest));
+}
+
+static int task_database_manifest_entry_cmp(const void *a, const void *b)
+{
+   return strcmp(((const database_manifest_entry_t*)a)->path,
+         ((const database_manifest_entry_t*)b)->path);
+}
+
+static database_manifest_entry_t *task_database_manifest_find(
+      database_manifest_t *manifest, const char *path)
+{
+   database_manifest_entry_t key;
+
+   if (!manifest->entries)
+      return NULL;
+
+   key.path = (char*)path;
+
+   return (database_manifest_entry_t*)bsearch(&key, manifest->entries,
+         manifest->count, sizeof(*manifest->entries),
+         task_database_manifest_entry_cmp);
+}
+
+static void task_database_manifest_read_bytes(
+      database_manifest_reader_t *reader, void *data, size_t len)
+{
+   if (reader->error || reader->len - reader->pos < len)
+   {
+      reader->error = true;
+      memset(data, 0, len);
+      return;
+   }
+
+   memcpy(data, reader->data + reader->pos, len);
+   reader->pos += len;
+}
+
+static uint32_t task_database_manifest_read_uint(
+      database_manifest_reader_t *reader)
+{
+   uint32_t val;
+   task_database_manifest_read_bytes(reader, &val, sizeof(val));
+   return val;
+}
+
+static char *task_database_manifest_read_string(
+      database_manifest_reader_t *reader)
+{
+   char *str;
+   uint32_t len = task_database_manifest_read_uint(reader);
+
+   if (reader->error || len == (uint32_t)~0)
+      return NULL;
+
+   if (reader->len - reader->pos < len)
+   {
+      reader->error = true;
+      return NULL;
+   }
+
+   if (!(str = (char*)malloc(len + 1)))
+   {
+      reader->error = true;
+      return NULL;
+   }
+
+   task_database_manifest_read_bytes(reader, str, len);
+   str[len] = '\0';
+   return str;
+}
+
+static bool task_database_manifest_read_entry(
+      database_manifest_reader_t *reader,
+      database_manifest_entry_t *entry)
+{
+   unsigned i;
+
+   entry->path        = task_database_manifest_read_string(reader);
+   task_database_manifest_read_bytes(reader, &entry->size,  sizeof(entry->size));
+   task_database_manifest_read_bytes(reader, &entry->mtime, sizeof(entry->mtime));
+   entry->crc         = task_database_manifest_read_uint(reader);
+   entry->num_matches = task_database_manifest_read_uint(reader);
+
+   /* Every match takes more than a byte */
+   if (reader->error || !entry->path
+         || entry->num_matches > reader->len - reader->pos)
+   {
+      entry->num_matches = 0;
+      return false;
+   }
+
+   if (entry->num_matches == 0)
+      return true;
+
+   entry->matches = (database_manifest_match_t*)calloc(
+         entry->num_matches, sizeof(*entry->matches));
+
+   if (!entry->matches)
+   {
+      entry->num_matches = 0;
+      return false;
+   }
+
+   for (i = 0; i < entry->num_matches; i++)
+   {
+      database_manifest_match_t *match = &entry->matches[i];
+
+      match->db_name = task_database_manifest_read_string(reader);
+      match->path    = task_database_manifest_read_string(reader);
+      match->crc32   = task_database_manifest_read_string(reader);
+
+      if (reader->error || !match->db_name || !match->path)
+         return false;
+   }
+
+   return true;
+}
+
+static bool task_database_manifest_load(database_manifest_t *manifest,
+      const char *path)
+{
+   char magic[8];
+   uint32_t i, count;
+   void *data                        = NULL;
+   int64_t len                       = 0;
+   bool ret                          = false;
+   database_manifest_reader_t reader = {0};
+
+   if (!path_is_valid(path) || !filestream_read_file(path, &data, &len))
+      return false;
+
+   reader.data = (const uint8_t*)data;
+   reader.len  = (size_t)len;
+
+   task_database_manifest_read_bytes(&reader, magic, sizeof(magic));
+
+   if (  memcmp(magic, DATABASE_MANIFEST_MAGIC, sizeof(magic))
+         || task_database_manifest_read_uint(&reader)
+         != DATABASE_MANIFEST_VERSION)
+      goto end;
+
+   manifest->signature = task_database_manifest_read_uint(&reader);
+   count               = task_database_manifest_read_uint(&reader);
+
+   /* Every entry takes more than a byte */
+   if (reader.error || count > reader.len)
+      goto end;
+
+   manifest->entries = (database_manifest_entry_t*)
+      calloc(count ? count : 1, sizeof(*manifest->entries));
+
+   if (!manifest->entries)
+      goto end;
+
+   for (i = 0; i < count; i++)
+   {
+      bool valid = task_database_manifest_read_entry(&reader,
+            &manifest->entries[i]);
+
+      manifest->count++;
+
+      if (!valid)
+         goto end;
+   }
+
+   qsort(manifest->entries, manifest->count,
+         sizeof(*manifest->entries), task_database_manifest_entry_cmp);
+
+   ret = true;
+
+end:
+   if (!ret)
+   {
+      RARCH_WARN("Ignoring invalid scan manifest \"%s\".\n", path);
+      task_database_manifest_free(manifest);
+   }
+   free(data);
+   return ret;
+}
+
+static void task_database_manifest_write_uint(RFILE *file, uint32_t val)
+{
+   filestream_write(file, &val, sizeof(val));
+}
+
+static void task_database_manifest_write_string(RFILE *file,
+      const char *str)
+{
+   if (!str)
+   {
+      task_database_manifest_write_uint(file, (uint32_t)~0);
+      return;
+   }
+
+   task_database_manifest_write_uint(file, (uint32_t)strlen(str));
+   filestream_write(file, str, strlen(str));
+}
+
+static void task_database_manifest_write(database_manifest_t *manifest,
+      const char *path)
+{
+   size_t i;
+   unsigned j;
+   RFILE *file = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+   {
+      RARCH_WARN("Failed to write scan manifest \"%s\".\n", path);
+      return;
+   }
+
+   filestream_write(file, DATABASE_MANIFEST_MAGIC, 8);
+   task_database_manifest_write_uint(file, DATABASE_MANIFEST_VERSION);
+   task_database_manifest_write_uint(file, manifest->signature);
+   task_database_manifest_write_uint(file, (uint32_t)manifest->count);
+
+   for (i = 0; i < manifest->count; i++)
+   {
+      const database_manifest_entry_t *entry = &manifest->entries[i];
+
+      task_database_manifest_write_string(file, entry->path);
+      filestream_write(file, &entry->size,  sizeof(entry->size));
+      filestream_write(file, &entry->mtime, sizeof(entry->mtime));
+      task_database_manifest_write_uint(file, entry->crc);
+      task_database_manifest_write_uint(file, entry->num_matches);
+
+      for (j = 0; j < entry->num_matches; j++)
+      {
+         task_database_manifest_write_string(file,
+               entry->matches[j].db_name);
+         task_database_manifest_write_string(file,
+               entry->matches[j].path);
+         task_database_manifest_write_string(file,
+               entry->matches[j].crc32);
+      }
+   }
+
+   filestream_close(file);
+}
+
+static uint32_t task_database_manifest_hash_file(const char *path)
+{
+   int64_t size     = 0;
+   int64_t mtime    = 0;
+   uint32_t crc     = encoding_crc32(0, (const uint8_t*)path, strlen(path));
+
+   path_get_size_mtime(path, &size, &mtime);
+
+   crc = encoding_crc32(crc, (const uint8_t*)&size,  sizeof(size));
+   return encoding_crc32(crc, (const uint8_t*)&mtime, sizeof(mtime));
+}
+
+static uint32_t task_database_manifest_hash_string(uint32_t crc,
+      const char *str)
+{
+   if (string_is_empty(str))
+      return encoding_crc32(crc, (const uint8_t*)"", 1);
+   return encoding_crc32(crc, (const uint8_t*)str, strlen(str) + 1);
+}
+
+/* Sums up everything besides the files themselves that decides
+ * what a scan finds. The sum doesn't depend on the order of the
+ * databases, which are reordered while scanning. */
+static uint32_t task_database_manifest_signature(db_handle_t *db,
+      database_state_handle_t *db_state)
+{
+   size_t i;
+   uint32_t signature = db->scan_without_core_match ? 1 : 0;
+
+   if (db_state->list)
+      for (i = 0; i < db_state->list->size; i++)
+         signature += task_database_manifest_hash_file(
+               db_state->list->elems[i].data);
+
+   if (!db->scan_without_core_match)
+   {
+      core_info_list_t *core_info_list = NULL;
+
+      core_info_get_list(&core_info_list);
+
+      if (core_info_list)
+      {
+         for (i = 0; i < core_info_list->count; i++)
+         {
+            const core_info_t *info = &core_info_list->list[i];
+            uint32_t crc            = 0;
+
+            crc        = task_database_manifest_hash_string(crc, info->path);
+            crc        = task_database_manifest_hash_string(crc,
+                  info->supported_extensions);
+            crc        = task_database_manifest_hash_string(crc,
+                  info->databases);
+            signature += crc;
+         }
+      }
+   }
+
+   return signature;
+}
+
+static int task_database_manifest_file_cmp(const void *a, const void *b)
+{
+   return strcmp(((const database_manifest_file_t*)a)->path,
+         ((const database_manifest_file_t*)b)->path);
+}
+
+/* Folds the tracks referenced by a sheet into its size and
+ * modification time, since those are what actually gets looked
+ * up, and prunes them from the scan like a full scan would. */
+static void task_database_manifest_add_tracks(database_info_handle_t *db,
+      database_manifest_file_t *files, size_t num_files,
+      const char *name, enum msg_file_type type,
+      int64_t *size, int64_t *mtime)
+{
+   char         *path = (char*)malloc(PATH_MAX_LENGTH + 1);
+   intfstream_t *fd   = intfstream_open_file(name,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!fd || !path)
+      goto end;
+
+   while (type == FILE_TYPE_CUE
+         ? cue_next_file(fd, name, path, PATH_MAX_LENGTH)
+         : gdi_next_file(fd, name, path, PATH_MAX_LENGTH))
+   {
+      int64_t track_size            = 0;
+      int64_t track_mtime           = 0;
+      database_manifest_file_t key;
+      database_manifest_file_t *file;
+
+      key.path = path;
+      file     = (database_manifest_file_t*)bsearch(&key, files, num_files,
+            sizeof(*files), task_database_manifest_file_cmp);
+
+      if (file && db->list->elems[file->idx].data)
+      {
+         free(db->list->elems[file->idx].data);
+         db->list->elems[file->idx].data = NULL;
+      }
+
+      path_get_size_mtime(path, &track_size, &track_mtime);
+
+      *size  = *size  * 31 + track_size;
+      *mtime = *mtime * 31 + track_mtime;
+   }
+
+end:
+   if (fd)
+   {
+      intfstream_close(fd);
+      free(fd);
+   }
+   free(path);
+}
+
+/* Whether the playlists of all the matches of @entry still exist,
+ * so that deleting a playlist is enough to get it scanned again */
+static bool task_database_manifest_has_playlists(db_handle_t *db,
+      struct string_list *checked, const database_manifest_entry_t *entry)
+{
+   unsigned i;
+
+   for (i = 0; i < entry->num_matches; i++)
+   {
+      int found = string_list_find_elem(checked, entry->matches[i].db_name);
+
+      if (!found)
+      {
+         char *path = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+         union string_list_elem_attr attr;
+
+         fill_pathname_join(path, db->playlist_directory,
+               entry->matches[i].db_name, PATH_MAX_LENGTH * sizeof(char));
+         attr.i = path_is_valid(path);
+         free(path);
+
+         string_list_append(checked, entry->matches[i].db_name, attr);
+         found  = (int)checked->size;
+      }
+
+      if (!checked->elems[found - 1].attr.i)
+         return false;
+   }
+
+   return true;
+}
+
+/* Loads the manifest of the last scan of the directory and leaves
+ * out the files that are unchanged since from the scan */
+static void task_database_manifest_begin(db_handle_t *db,
+      database_info_handle_t *dbinfo,
+      database_state_handle_t *db_state)
+{
+   char name[32];
+   size_t i;
+   size_t num_files               = 0;
+   bool keep                      = false;
+   database_manifest_t *manifest  = &db->manifest;
+   database_manifest_t *old       = &db->old_manifest;
+   database_manifest_file_t *files= NULL;
+   struct string_list *checked    = NULL;
+   struct string_list *list       = dbinfo->list;
+
+   if (string_is_empty(db->playlist_directory) || !list)
+      return;
+
+   db->manifest_path = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+
+   snprintf(name, sizeof(name), "%08X%s",
+         encoding_crc32(0, (const uint8_t*)db->fullpath,
+            strlen(db->fullpath)),
+         file_path_str(FILE_PATH_SCAN_MANIFEST_EXTENSION));
+   fill_pathname_join(db->manifest_path, db->playlist_directory,
+         name, PATH_MAX_LENGTH * sizeof(char));
+
+   manifest->signature = task_database_manifest_signature(db, db_state);
+
+   /* Entries scanned against other databases or cores are only
+    * kept to clean the playlists up once the scan is done */
+   if (task_database_manifest_load(old, db->manifest_path))
+      keep = old->signature == manifest->signature;
+
+   manifest->entries  = (database_manifest_entry_t*)calloc(
+         list->size ? list->size : 1, sizeof(*manifest->entries));
+   files              = (database_manifest_file_t*)calloc(
+         list->size ? list->size : 1, sizeof(*files));
+   checked            = string_list_new();
+
+   if (!manifest->entries || !files || !checked)
+      goto end;
+
+   for (i = 0, num_files = 0; i < list->size; i++)
+   {
+      if (!list->elems[i].data)
+         continue;
+      if (!(files[num_files].path = strdup(list->elems[i].data)))
+         continue;
+      files[num_files].idx  = i;
+      num_files++;
+   }
+
+   qsort(files, num_files, sizeof(*files), task_database_manifest_file_cmp);
+
+   for (i = 0; i < list->size; i++)
+   {
+      int64_t size                         = 0;
+      int64_t mtime                        = 0;
+      const char *path                     = list->elems[i].data;
+      database_manifest_entry_t *entry     = &manifest->entries[manifest->count];
+      database_manifest_entry_t *old_entry = NULL;
+      enum msg_file_type type;
+
+      /* Pruned by a sheet */
+      if (!path || !path_get_size_mtime(path, &size, &mtime))
+         continue;
+
+      type = extension_to_file_type(path_get_extension(path));
+
+      if (type == FILE_TYPE_CUE || type == FILE_TYPE_GDI)
+         task_database_manifest_add_tracks(dbinfo, files, num_files,
+               path, type, &size, &mtime);
+
+      if (!(entry->path = strdup(path)))
+         continue;
+
+      entry->size  = size;
+      entry->mtime = mtime;
+      manifest->count++;
+
+      if (keep)
+         old_entry = task_database_manifest_find(old, path);
+
+      if (  !old_entry
+            || old_entry->size  != size
+            || old_entry->mtime != mtime
+            || !task_database_manifest_has_playlists(db, checked, old_entry))
+         continue;
+
+      /* Unchanged, the matches move over to the new manifest */
+      entry->crc             = old_entry->crc;
+      entry->num_matches     = old_entry->num_matches;
+      entry->matches         = old_entry->matches;
+      old_entry->kept        = true;
+      old_entry->num_matches = 0;
+      old_entry->matches     = NULL;
+
+      /* Skipped by database_info_get_current_element_name */
+      free(list->elems[i].data);
+      list->elems[i].data    = NULL;
+   }
+
+   qsort(manifest->entries, manifest->count,
+         sizeof(*manifest->entries), task_database_manifest_entry_cmp);
+
+end:
+   if (files)
+   {
+      for (i = 0; i < num_files; i++)
+         free(files[i].path);
+      free(files);
+   }
+   if (checked)
+      string_list_free(checked);
+}
+
+/* Records that scanning the list element @name added @path to
+ * the playlist @db_name */
+static void task_database_manifest_add_match(db_handle_t *db,
+      const char *name, const char *db_name,
+      const char *path, const char *crc32, uint32_t crc)
+{
+   char *origin;
+   char *hash;
+   database_manifest_match_t *matches = NULL;
+   database_manifest_entry_t *entry   = NULL;
+
+   if (!db->manifest_path || string_is_empty(name))
+      return;
+
+   /* Archive members are scanned as archive#member */
+   origin = strdup(name);
+
+   while (origin && !(entry = task_database_manifest_find(
+               &db->manifest, origin)) && (hash = strrchr(origin, '#')))
+      *hash = '\0';
+
+   free(origin);
+
+   if (!entry)
+      return;
+
+   matches = (database_manifest_match_t*)realloc(entry->matches,
+         (entry->num_matches + 1) * sizeof(*matches));
+
+   if (!matches)
+      return;
+
+   entry->matches                       = matches;
+   matches[entry->num_matches].db_name  = strdup(db_name);
+   matches[entry->num_matches].path     = strdup(path);
+   matches[entry->num_matches].crc32    = crc32 ? strdup(crc32) : NULL;
+   entry->num_matches++;
+
+   if (crc)
+      entry->crc = crc;
+}
+
+static int task_database_manifest_match_cmp(const void *a, const void *b)
+{
+   return strcmp((*(const database_manifest_match_t**)a)->db_name,
+         (*(const database_manifest_match_t**)b)->db_name);
+}
+
+static bool task_database_manifest_entry_has_match(
+      const database_manifest_entry_t *entry,
+      const database_manifest_match_t *match)
+{
+   unsigned i;
+
+   for (i = 0; i < entry->num_matches; i++)
+      if (     string_is_equal(entry->matches[i].db_name, match->db_name)
+            && string_is_equal(entry->matches[i].path,    match->path))
+         return true;
+
+   return false;
+}
+
+/* Removes the playlist entries of files that are gone, or that
+ * changed and weren't found again, then saves the manifest */
+static void task_database_manifest_finish(db_handle_t *db)
+{
+   size_t i, j;
+   size_t num_stale                    = 0;
+   size_t cap_stale                    = 0;
+   database_manifest_match_t **stale   = NULL;
+   char *playlist_path                 = NULL;
+
+   if (!db->manifest_path)
+      return;
+
+   for (i = 0; i < db->old_manifest.count; i++)
+   {
+      unsigned k;
+      database_manifest_entry_t *old_entry = &db->old_manifest.entries[i];
+      database_manifest_entry_t *entry     = NULL;
+
+      if (old_entry->kept || old_entry->num_matches == 0)
+         continue;
+
+      entry = task_database_manifest_find(&db->manifest, old_entry->path);
+
+      for (k = 0; k < old_entry->num_matches; k++)
+      {
+         if (entry && task_database_manifest_entry_has_match(entry,
+                  &old_entry->matches[k]))
+            continue;
+
+         if (num_stale == cap_stale)
+         {
+            size_t new_cap                        = cap_stale ? cap_stale * 2 : 64;
+            database_manifest_match_t **new_stale = (database_manifest_match_t**)
+               realloc(stale, new_cap * sizeof(*stale));
+
+            if (!new_stale)
+               goto end;
+
+            stale     = new_stale;
+            cap_stale = new_cap;
+         }
+
+         stale[num_stale++] = &old_entry->matches[k];
+      }
+   }
+
+   if (num_stale)
+   {
+      playlist_path = (char*)malloc(PATH_MAX_LENGTH * sizeof(char));
+
+      qsort(stale, num_stale, sizeof(*stale),
+            task_database_manifest_match_cmp);
+
+      /* Each playlist is loaded and written once */
+      for (i = 0; i < num_stale; i = j)
+      {
+         playlist_t *playlist = NULL;
+
+         fill_pathname_join(playlist_path, db->playlist_directory,
+               stale[i]->db_name, PATH_MAX_LENGTH * sizeof(char));
+
+         playlist = playlist_init(playlist_path, COLLECTION_SIZE);
+
+         for (j = i; j < num_stale
+               && string_is_equal(stale[j]->db_name, stale[i]->db_name); j++)
+         {
+            RARCH_LOG("Removing \"%s\" from playlist \"%s\".\n",
+                  stale[j]->path, stale[j]->db_name);
+            playlist_delete_by_path(playlist, stale[j]->path);
+         }
+
+         playlist_write_file(playlist);
+         playlist_free(playlist);
+      }
+   }
+
+   task_database_manifest_write(&db->manifest, db->manifest_path);
+
+end:
+   free(playlist_path);
+   free(stale);
+}
+
 static int task_database_iterate_playlist(
       database_state_handle_t *db_state,
       database_info_handle_t *db, const char *name)
@@ -686,6 +1433,51 @@ static int task_database_iterate_playlist(
    return 1;
 }
 
+/* Makes room for the CRC32s of @count more archive members */
+static uint32_t *task_database_add_archive_members(
+      database_state_handle_t *db_state, size_t count)
+{
+   uint32_t *crcs = NULL;
+   size_t size    = 0;
+
+   if (!db_state->archive_members
+         && !(db_state->archive_members = string_list_new()))
+      return NULL;
+
+   size = db_state->archive_members->size;
+
+   if (!(crcs = (uint32_t*)realloc(db_state->archive_member_crcs,
+               (size + count) * sizeof(*crcs))))
+      return NULL;
+
+   db_state->archive_member_crcs = crcs;
+   return crcs + size;
+}
+
+/* Gets the CRC32 of an archive member added to the scan */
+static bool task_database_get_archive_member_crc(
+      database_state_handle_t *db_state, const char *name, uint32_t *crc)
+{
+   size_t i;
+
+   if (!db_state->archive_members)
+      return false;
+
+   /* Members are scanned in the order they were added */
+   for (i = db_state->archive_member_index;
+         i < db_state->archive_members->size; i++)
+   {
+      if (string_is_equal(db_state->archive_members->elems[i].data, name))
+      {
+         *crc                           = db_state->archive_member_crcs[i];
+         db_state->archive_member_index = i + 1;
+         return *crc != 0;
+      }
+   }
+
+   return false;
+}
+
 static int database_info_list_iterate_end_no_match(
       database_info_handle_t *db,
       database_state_handle_t *db_state,
@@ -705,6 +1497,11 @@ static int database_info_list_iterate_end_no_match(
       if (archive_list && archive_list->size > 0)
       {
          unsigned i;
+         uint32_t *crcs = task_database_add_archive_members(
+               db_state, archive_list->size);
+
+         if (crcs && !file_archive_get_file_crc32s(path, archive_list, crcs))
+            memset(crcs, 0, archive_list->size * sizeof(*crcs));
 
          for (i = 0; i < archive_list->size; i++)
          {
@@ -729,6 +1526,10 @@ static int database_info_list_iterate_end_no_match(
             string_list_append(db->list, new_path,
                archive_list->elems[i].attr);
 
+            if (crcs)
+               string_list_append(db_state->archive_members, new_path,
+                     archive_list->elems[i].attr);
+
             free(new_path);
          }
 
@@ -757,10 +1558,20 @@ static int task_database_iterate_next(database_info_handle_t *db)
    return -1;
 }
 
+static database_info_scan_t *task_database_get_scan(
+      database_state_handle_t *db_state)
+{
+   /* Loaded on the first lookup, then shared by every scanned file */
+   if (!db_state->scan)
+      db_state->scan = database_info_scan_new(db_state->list);
+   return db_state->scan;
+}
+
 static int database_info_list_iterate_new(database_state_handle_t *db_state,
-      const char *query)
+      enum database_type type, const char *query)
 {
-   const char *new_database = database_info_get_current_name(db_state);
+   const char *new_database     = database_info_get_current_name(db_state);
+   database_info_scan_t *scan   = task_database_get_scan(db_state);
 
 #ifndef RARCH_INTERNAL
    fprintf(stderr, "Check database [%d/%d] : %s\n", (unsigned)db_state->list_index,
@@ -771,7 +1582,15 @@ static int database_info_list_iterate_new(database_state_handle_t *db_state,
       database_info_list_free(db_state->info);
       free(db_state->info);
    }
-   db_state->info = database_info_list_new(new_database, query);
+
+   if (!scan)
+      db_state->info = database_info_list_new(new_database, query);
+   else if (type == DATABASE_TYPE_SERIAL_LOOKUP)
+      db_state->info = database_info_scan_list_serial(scan,
+            new_database, db_state->serial);
+   else
+      db_state->info = database_info_scan_list_crc(scan,
+            new_database, db_state->crc, db_state->archive_crc);
    return 0;
 }
 
@@ -853,6 +1672,10 @@ static int database_info_list_iterate_found_match(
    fprintf(stderr, "entry path str: %s\n", entry_path_str);
 #endif
 
+   task_database_manifest_add_match(_db, entry_path,
+         db_playlist_base_str, entry_path_str, db_crc,
+         db_state->crc ? db_state->crc : db_state->archive_crc);
+
    if (!playlist_entry_exists(playlist, entry_path_str, db_crc))
    {
       struct playlist_entry entry;
@@ -940,9 +1763,16 @@ static int task_database_iterate_crc_lookup(
    if (db_state->entry_index == 0)
    {
       char query[50];
+      database_info_scan_t *scan = task_database_get_scan(db_state);
 
       query[0] = '\0';
 
+      /* Nothing to look for in any of the databases */
+      if (scan && db_state->list_index == 0
+            && !database_info_scan_has_crc(scan, db_state->crc)
+            && !database_info_scan_has_crc(scan, db_state->archive_crc))
+         return database_info_list_iterate_end_no_match(db, db_state, name);
+
       if (!_db->scan_without_core_match)
       {
          /* don't scan files that can't be in this database.
@@ -966,7 +1796,11 @@ static int task_database_iterate_crc_lookup(
             "{crc:or(b\"%08X\",b\"%08X\")}",
             db_state->crc, db_state->archive_crc);
 
-      database_info_list_iterate_new(db_state, query);
+      database_info_list_iterate_new(db_state,
+            DATABASE_TYPE_CRC_LOOKUP, query);
+
+      if (db_state->info && db_state->info->count == 0)
+         return database_info_list_iterate_next(db_state);
    }
 
    if (db_state->info)
@@ -1022,7 +1856,8 @@ static int task_database_iterate_playlist_archive(
       return task_database_iterate_crc_lookup(
             _db, db_state, db, name, db_state->archive_name);
 
-   db_state->crc = file_archive_get_file_crc32(name);
+   if (!task_database_get_archive_member_crc(db_state, name, &db_state->crc))
+      db_state->crc = file_archive_get_file_crc32(name);
 #endif
 
    return 1;
@@ -1049,6 +1884,10 @@ static int task_database_iterate_playlist_lutro(
 
    free(db_playlist_path);
 
+   task_database_manifest_add_match(_db, path,
+         file_path_str(FILE_PATH_LUTRO_PLAYLIST), path,
+         file_path_str(FILE_PATH_DETECT), 0);
+
    if (!playlist_entry_exists(playlist,
             path, file_path_str(FILE_PATH_DETECT)))
    {
@@ -1103,8 +1942,16 @@ static int task_database_iterate_serial_lookup(
    if (db_state->entry_index == 0)
    {
       char query[50];
-      char *serial_buf =
-         bin_to_hex_alloc((uint8_t*)db_state->serial, strlen(db_state->serial) * sizeof(uint8_t));
+      char *serial_buf           = NULL;
+      database_info_scan_t *scan = task_database_get_scan(db_state);
+
+      /* Nothing to look for in any of the databases */
+      if (scan && db_state->list_index == 0
+            && !database_info_scan_has_serial(scan, db_state->serial))
+         return database_info_list_iterate_end_no_match(db, db_state, name);
+
+      serial_buf = bin_to_hex_alloc((uint8_t*)db_state->serial,
+            strlen(db_state->serial) * sizeof(uint8_t));
 
       if (!serial_buf)
          return 1;
@@ -1112,9 +1959,13 @@ static int task_database_iterate_serial_lookup(
       query[0] = '\0';
 
       snprintf(query, sizeof(query), "{'serial': b'%s'}", serial_buf);
-      database_info_list_iterate_new(db_state, query);
+      database_info_list_iterate_new(db_state,
+            DATABASE_TYPE_SERIAL_LOOKUP, query);
 
       free(serial_buf);
+
+      if (db_state->info && db_state->info->count == 0)
+         return database_info_list_iterate_next(db_state);
    }
 
    if (db_state->info)
@@ -1287,6 +2138,10 @@ static void task_database_handler(retro_task_t *task)
                }
             }
          }
+
+         if (db->scan_incremental && db->is_directory)
+            task_database_manifest_begin(db, dbinfo, dbstate);
+
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
       case DATABASE_STATUS_ITERATE_START:
@@ -1312,6 +2167,9 @@ static void task_database_handler(retro_task_t *task)
          else
          {
             const char *msg = NULL;
+
+            task_database_manifest_finish(db);
+
             if (db->is_directory)
                msg = msg_hash_to_str(MSG_SCANNING_OF_DIRECTORY_FINISHED);
             else
@@ -1342,6 +2200,11 @@ task_finished:
    {
       if (dbstate->list)
          dir_list_free(dbstate->list);
+      if (dbstate->scan)
+         database_info_scan_free(dbstate->scan);
+      if (dbstate->archive_members)
+         string_list_free(dbstate->archive_members);
+      free(dbstate->archive_member_crcs);
    }
 
    if (db)
@@ -1352,6 +2215,10 @@ task_finished:
          free(db->content_database_path);
       if (!string_is_empty(db->fullpath))
          free(db->fullpath);
+      if (db->manifest_path)
+         free(db->manifest_path);
+      task_database_manifest_free(&db->manifest);
+      task_database_manifest_free(&db->old_manifest);
       if (db->state.buf)
          free(db->state.buf);
 
@@ -1399,6 +2266,7 @@ bool task_push_dbscan(
 #ifdef RARCH_INTERNAL
    t->progress_cb            = task_database_progress_cb;
    db->scan_without_core_match = settings->bools.scan_without_core_match;
+   db->scan_incremental      = settings->bools.scan_incremental;
 #endif
    db->show_hidden_files     = db_dir_show_hidden_files;
    db->is_directory          = directory;
@@ -33,6 +33,8 @@ struct nat_traversal_state_data
 {
    struct natt_status *nat_traversal_state;
    uint16_t port;
+   /* 0 if there's no UDP input port */
+   uint16_t udp_port;
 };
 
 static void netplay_nat_traversal_callback(retro_task_t *task,
@@ -55,14 +57,26 @@ static void task_netplay_nat_traversal_handler(retro_task_t *task)
    natt_init();
 
    if (natt_new(ntsd->nat_traversal_state))
+   {
+      /* Separate status, the announced address is the TCP one */
+      struct natt_status udp_state;
+
+      if (ntsd->udp_port && natt_new(&udp_state))
+      {
+         natt_open_port_any(&udp_state, ntsd->udp_port, SOCKET_PROTOCOL_UDP);
+         natt_free(&udp_state);
+      }
+
       natt_open_port_any(ntsd->nat_traversal_state, ntsd->port, SOCKET_PROTOCOL_TCP);
+   }
 
    task_set_progress(task, 100);
    task_set_finished(task, true);
 }
 #endif
 
-bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port)
+bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port,
+      uint16_t udp_port)
 {
 #ifdef HAVE_NETWORKING
    struct nat_traversal_state_data *ntsd;
@@ -82,6 +96,7 @@ bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port)
    ntsd->nat_traversal_state =
       (struct natt_status *) nat_traversal_state;
    ntsd->port = port;
+   ntsd->udp_port = udp_port;
 
    task->type     = TASK_TYPE_BLOCKING;
    task->handler  = task_netplay_nat_traversal_handler;
@@ -101,13 +101,25 @@ static bool screenshot_dump_direct(screenshot_task_state_t *state)
 
    scaler_ctx_gen_reset(&state->scaler);
 
-   ret = rpng_save_image_bgr24(
-         state->filename,
-         state->out_buffer,
-         state->width,
-         state->height,
-         state->width * 3
-         );
+   /* Silent screenshots (savestate thumbnails, achievement unlocks)
+    * are taken in the middle of gameplay, so favour encode time
+    * over file size */
+   if (state->silence)
+      ret = rpng_save_image_bgr24_fast(
+            state->filename,
+            state->out_buffer,
+            state->width,
+            state->height,
+            state->width * 3
+            );
+   else
+      ret = rpng_save_image_bgr24(
+            state->filename,
+            state->out_buffer,
+            state->width,
+            state->height,
+            state->width * 3
+            );
 
    free(state->out_buffer);
 #elif defined(HAVE_RBMP)
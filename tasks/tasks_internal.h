@@ -59,7 +59,8 @@ bool task_push_netplay_crc_scan(uint32_t crc, char* name,
 
 bool task_push_netplay_lan_scan_rooms(retro_task_callback_t cb);
 
-bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port);
+bool task_push_netplay_nat_traversal(void *nat_traversal_state, uint16_t port,
+      uint16_t udp_port);
 
 #ifdef HAVE_MENU
 bool task_push_pl_thumbnail_download(const char *system, const char *playlist_path);